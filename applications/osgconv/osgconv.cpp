@@ -12,6 +12,8 @@
 #include <osg/BlendFunc>
 #include <osg/Timer>
 
+#include <OpenThreads/Thread>
+
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
@@ -410,6 +412,24 @@ public:
 
 };
 
+/** Collect the unique osg::Geometry of a scene graph.*/
+class CollectGeometriesVisitor : public osg::NodeVisitor
+{
+public:
+
+    CollectGeometriesVisitor():osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Geometry& geometry) { _geometries.insert(&geometry); }
+
+    std::set<osg::Geometry*> _geometries;
+};
+
+/** Regenerate the surface normals of an osg::Geometry, as the osgUtil::SmoothingVisitor does.*/
+struct SmoothGeometryFunctor : public osgUtil::Optimizer::GeometryFunctor
+{
+    virtual void operator() (osg::Geometry& geometry) { osgUtil::SmoothingVisitor::smooth(geometry); }
+};
+
 
 static void usage( const char *prog, const char *msg )
 {
@@ -512,6 +532,11 @@ static void usage( const char *prog, const char *msg )
                               << std::endl;
     osg::notify(osg::NOTICE)<<"    --smooth           - Smooth the surface by regenerating surface normals on\n"
                               "                         all geometry nodes"<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --optimizer-threads n - Number of additional threads used to smooth and\n"
+                              "                         optimize independent geometries in parallel,\n"
+                              "                         defaults to the number of processors minus one."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --no-optimizer-report - Don't report the time, memory change and node\n"
+                              "                         counts of each optimizer pass."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --addMissingColors - Add a white color value to all geometry nodes\n"
                               "                         that don't have their own color values\n"
                               "                         (--addMissingColours also accepted)."<< std::endl;
@@ -747,6 +772,20 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    osgUtil::Optimizer optimizer;
+    if (!getenv("OSG_OPTIMIZER_NUM_THREADS"))
+    {
+        int numProcessors = OpenThreads::GetNumberOfProcessors();
+        optimizer.setNumThreads(numProcessors>1 ? numProcessors-1 : 0);
+    }
+
+    unsigned int numOptimizerThreads = 0;
+    while(arguments.read("--optimizer-threads", numOptimizerThreads)) { optimizer.setNumThreads(numOptimizerThreads); }
+
+    bool optimizerReport = true;
+    while(arguments.read("--no-optimizer-report")) { optimizerReport = false; }
+    optimizer.setReportPasses(optimizerReport);
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -806,8 +845,12 @@ int main( int argc, char **argv )
 
         if (smooth)
         {
-            osgUtil::SmoothingVisitor sv;
-            root->accept(sv);
+            CollectGeometriesVisitor cgv;
+            root->accept(cgv);
+
+            osgUtil::Optimizer::GeometryList geometries(cgv._geometries.begin(), cgv._geometries.end());
+            SmoothGeometryFunctor functor;
+            optimizer.forEachGeometry(geometries, functor);
         }
 
         if (addMissingColours)
@@ -817,9 +860,14 @@ int main( int argc, char **argv )
         }
 
         // optimize the scene graph, remove redundant nodes and state etc.
-        osgUtil::Optimizer optimizer;
         optimizer.optimize(root.get());
 
+        if (optimizerReport)
+        {
+            osg::notify(osg::NOTICE)<<"Optimizer passes:"<<std::endl;
+            optimizer.writePassReports(osg::notify(osg::NOTICE));
+        }
+
         if( do_convert )
             root = oc.convert( root.get() );
 
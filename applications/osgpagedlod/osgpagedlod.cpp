@@ -0,0 +1,114 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This application is open source and may be redistributed and/or modified
+ * freely and without restriction, both in commercial and non commercial applications,
+ * as long as this copyright notice is maintained.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#include <osg/Timer>
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+
+#include <osgDB/PagedLODBuilder>
+#include <osgDB/ReadFile>
+
+#include <iostream>
+
+
+int main( int argc, char **argv )
+{
+    // use an ArgumentParser object to manage the program arguments.
+    osg::ArgumentParser arguments(&argc,argv);
+
+    // set up the usage document, in case we need to print out how to use this program.
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" is an application for building a paged database from a large model, partitioning it into tiles with simplified levels of detail loaded by PagedLOD's.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] filename ... -o database.osgb");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("-o <filename>","Write the root tile of the database to the file, and the other tiles alongside it.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-triangles <num>","Maximum number of triangles of each tile, 50000 by default.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-levels <num>","Maximum number of levels of tiles, 10 by default.");
+    arguments.getApplicationUsage()->addCommandLineOption("--range-factor <factor>","Load the children of a tile within this multiple of its radius, 4 by default.");
+    arguments.getApplicationUsage()->addCommandLineOption("--octree","Subdivide the tiles into octrees.");
+    arguments.getApplicationUsage()->addCommandLineOption("--quadtree","Subdivide the tiles into quadtrees, rather than choosing from the shape of the model.");
+    arguments.getApplicationUsage()->addCommandLineOption("--simplifier","Simplify the tiles with osgUtil::Simplifier rather than osgUtil::QuadricSimplifier.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Number of additional threads building tiles, one less than the number of processors by default.");
+    arguments.getApplicationUsage()->addCommandLineOption("--extension <ext>","Extension of the tile files, osgb by default.");
+    arguments.getApplicationUsage()->addCommandLineOption("-O <option_string>","Options passed to the plugin writing the tiles.");
+
+    // if user request help write it out to cout.
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    osg::ref_ptr<osgDB::PagedLODBuilder> builder = new osgDB::PagedLODBuilder;
+
+    std::string outputFileName;
+    while (arguments.read("-o",outputFileName)) {}
+
+    unsigned int num;
+    while (arguments.read("--max-triangles",num)) builder->setMaximumNumTrianglesPerTile(num);
+    while (arguments.read("--max-levels",num)) builder->setMaximumNumLevels(num);
+    while (arguments.read("--threads",num)) builder->setNumThreads(num);
+
+    float rangeFactor;
+    while (arguments.read("--range-factor",rangeFactor)) builder->setRangeFactor(rangeFactor);
+
+    while (arguments.read("--octree")) builder->setSubdivisionMode(osgDB::PagedLODBuilder::OCTREE);
+    while (arguments.read("--quadtree")) builder->setSubdivisionMode(osgDB::PagedLODBuilder::QUADTREE);
+    while (arguments.read("--simplifier")) builder->setUseQuadricSimplifier(false);
+
+    std::string extension;
+    while (arguments.read("--extension",extension)) builder->setTileExtension(extension);
+
+    std::string optionString;
+    while (arguments.read("-O",optionString)) builder->setOptions(new osgDB::Options(optionString));
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<osg::Node> model = osgDB::readRefNodeFiles(arguments);
+
+    // any option left unread are converted into errors to write out later.
+    arguments.reportRemainingOptionsAsUnrecognized();
+
+    // report any errors if they have occurred when parsing the program arguments.
+    if (arguments.errors())
+    {
+        arguments.writeErrorMessages(std::cout);
+        return 1;
+    }
+
+    if (!model)
+    {
+        std::cout<<arguments.getApplicationName()<<": No data loaded."<<std::endl;
+        return 1;
+    }
+
+    if (outputFileName.empty())
+    {
+        std::cout<<arguments.getApplicationName()<<": No output file name given, use -o <filename>."<<std::endl;
+        return 1;
+    }
+
+    osg::Timer_t loadedTick = osg::Timer::instance()->tick();
+    std::cout<<"Loaded model in "<<osg::Timer::instance()->delta_s(startTick, loadedTick)<<"s"<<std::endl;
+
+    bool result = builder->build(*model, outputFileName);
+
+    std::cout<<"Built "<<builder->getNumTiles()<<" tiles in "<<builder->getNumLevels()<<" levels, writing "<<builder->getNumFilesWritten()
+             <<" files in "<<osg::Timer::instance()->delta_s(loadedTick, osg::Timer::instance()->tick())<<"s"<<std::endl;
+
+    if (!result)
+    {
+        std::cout<<arguments.getApplicationName()<<": Failed to write the database "<<outputFileName<<std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/* OpenSceneGraph example, osgloadbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Compares the load time of .osgb files read via a file stream against memory mapped reading,
+// with and without the AlignedArrays layout.
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/FileUtils>
+#include <osgDB/fstream>
+
+#include <iostream>
+#include <stdlib.h>
+
+osg::Node* createScene(unsigned int numGeometries, unsigned int numVertices)
+{
+    osg::Group* group = new osg::Group;
+    for(unsigned int g=0; g<numGeometries; ++g)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(numVertices);
+        osg::ref_ptr<osg::Vec3Array> normals = new osg::Vec3Array(numVertices);
+        osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array(numVertices);
+        osg::ref_ptr<osg::Vec4ubArray> colors = new osg::Vec4ubArray(numVertices);
+        osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+        triangles->reserve(numVertices*3);
+
+        for(unsigned int i=0; i<numVertices; ++i)
+        {
+            (*vertices)[i].set(float(rand())/float(RAND_MAX), float(rand())/float(RAND_MAX), float(g));
+            (*normals)[i].set(0.0f, 0.0f, 1.0f);
+            (*texcoords)[i].set((*vertices)[i].x(), (*vertices)[i].y());
+            (*colors)[i].set(255, 255, 255, 255);
+
+            triangles->push_back(i);
+            triangles->push_back((i+1)%numVertices);
+            triangles->push_back((i+2)%numVertices);
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(vertices.get());
+        geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->setTexCoordArray(0, texcoords.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->setColorArray(colors.get(), osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(triangles.get());
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(geometry.get());
+        group->addChild(geode.get());
+    }
+    return group;
+}
+
+double fileSize(const std::string& fileName)
+{
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+    fin.seekg(0, std::ios::end);
+    return double(fin.tellg());
+}
+
+void benchmark(const std::string& title, const std::string& fileName, const std::string& optionString, unsigned int numIterations)
+{
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionString);
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+    // load once to make sure the plugin is loaded and the file is in the page cache.
+    osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName, options.get());
+    if (!node)
+    {
+        std::cout<<title<<" : failed to load "<<fileName<<std::endl;
+        return;
+    }
+    node = 0;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        node = osgDB::readRefNodeFile(fileName, options.get());
+        node = 0;
+    }
+    double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())/double(numIterations);
+
+    double megabytes = fileSize(fileName)/(1024.0*1024.0);
+    std::cout<<title<<" : "<<time*1000.0<<"ms, "<<megabytes/time<<"MB/s"<<std::endl;
+}
+
+int main( int argc, char **argv )
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares the load time of .osgb files read via a file stream and memory mapped.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename.osgb]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("--geometries <num>","Number of geometries in the generated test scene, default 1000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--vertices <num>","Number of vertices per geometry in the generated test scene, default 10000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>","Number of times each file is loaded, default 5.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numGeometries = 1000;
+    unsigned int numVertices = 10000;
+    unsigned int numIterations = 5;
+
+    while(arguments.read("--geometries", numGeometries)) {}
+    while(arguments.read("--vertices", numVertices)) {}
+    while(arguments.read("--iterations", numIterations)) {}
+    if (numIterations<1) numIterations = 1;
+
+    std::string fileName;
+    std::string alignedFileName;
+    for(int pos=1;pos<arguments.argc();++pos)
+    {
+        if (!arguments.isOption(pos)) fileName = arguments[pos];
+    }
+
+    osg::ref_ptr<osg::Node> scene;
+    if (fileName.empty())
+    {
+        scene = createScene(numGeometries, numVertices);
+        fileName = "osgloadbenchmark.osgb";
+        osgDB::writeNodeFile(*scene, fileName);
+    }
+    else
+    {
+        scene = osgDB::readRefNodeFile(fileName);
+        if (!scene)
+        {
+            std::cout<<arguments.getApplicationName()<<": unable to load "<<fileName<<std::endl;
+            return 1;
+        }
+    }
+
+    alignedFileName = "osgloadbenchmark_aligned.osgb";
+    osgDB::writeNodeFile(*scene, alignedFileName, new osgDB::Options("AlignedArrays"));
+    scene = 0;
+
+    std::cout<<"File size                : "<<fileSize(fileName)/(1024.0*1024.0)<<"MB"<<std::endl;
+    benchmark("File stream              ", fileName, "MemoryMapped=false", numIterations);
+    benchmark("Memory mapped            ", fileName, "", numIterations);
+    benchmark("Memory mapped and aligned", alignedFileName, "", numIterations);
+
+    return 0;
+}
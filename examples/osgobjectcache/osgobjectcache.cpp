@@ -17,11 +17,20 @@
 */
 
 #include <osg/Group>
+#include <osg/Image>
+#include <osg/Timer>
+#include <osg/ArgumentParser>
 #include <osgDB/ReadFile>
+#include <osgDB/ObjectCache>
 
 #include <osgViewer/Viewer>
 
+#include <OpenThreads/Thread>
+
 #include <assert.h>
+#include <iostream>
+#include <sstream>
+#include <vector>
 
 osg::Group* createObjectCache()
 {
@@ -84,8 +93,123 @@ osg::Group* createObjectCache()
     return group;
 }
 
-int main(int , char **)
+// Thread that repeatedly looks up files in a shared ObjectCache, adding them to the cache on a miss as Registry::readImplementation does.
+class CacheBenchmarkThread : public osg::Referenced, public OpenThreads::Thread
+{
+public:
+
+    CacheBenchmarkThread(osgDB::ObjectCache* cache, const std::vector<std::string>& fileNames, unsigned int numLookups, unsigned int imageSize, unsigned int seed):
+        _cache(cache),
+        _fileNames(fileNames),
+        _numLookups(numLookups),
+        _imageSize(imageSize),
+        _seed(seed) {}
+
+    virtual void run()
+    {
+        for(unsigned int i=0; i<_numLookups; ++i)
+        {
+            // skew the lookups towards the start of the file list so that there is a working set for the LRU to retain.
+            _seed = _seed*1103515245u + 12345u;
+            double r = static_cast<double>((_seed>>8) & 0xffff)/65536.0;
+            const std::string& fileName = _fileNames[static_cast<unsigned int>(r*r*static_cast<double>(_fileNames.size()))];
+
+            osg::ref_ptr<osg::Object> object = _cache->getRefFromObjectCache(fileName);
+            if (!object)
+            {
+                osg::ref_ptr<osg::Image> image = new osg::Image;
+                image->allocateImage(_imageSize, _imageSize, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+                _cache->addEntryToObjectCache(fileName, image.get());
+            }
+        }
+    }
+
+protected:
+
+    osgDB::ObjectCache*         _cache;
+    std::vector<std::string>    _fileNames;
+    unsigned int                _numLookups;
+    unsigned int                _imageSize;
+    unsigned int                _seed;
+};
+
+int runCacheBenchmark(osg::ArgumentParser& arguments)
+{
+    unsigned int numFiles = 10000;
+    unsigned int numLookups = 1000000;
+    unsigned int maxThreads = OpenThreads::GetNumberOfProcessors()*2;
+    unsigned int imageSize = 64;
+    double maximumSize = 0.0;
+
+    while(arguments.read("--files", numFiles)) {}
+    while(arguments.read("--lookups", numLookups)) {}
+    while(arguments.read("--threads", maxThreads)) {}
+    while(arguments.read("--image-size", imageSize)) {}
+    while(arguments.read("--max-size", maximumSize)) {}
+    if (numFiles<1) numFiles = 1;
+    if (maxThreads<1) maxThreads = 1;
+
+    std::vector<std::string> fileNames;
+    for(unsigned int i=0; i<numFiles; ++i)
+    {
+        std::ostringstream str;
+        str<<"tiles/tile_"<<i<<".osgb";
+        fileNames.push_back(str.str());
+    }
+
+    std::cout<<"Files "<<numFiles<<", lookups per thread "<<numLookups<<", maximum size "<<maximumSize<<"MB"<<std::endl;
+    std::cout<<"Threads\tLookups/sec\tHit rate\tEvictions\tCache size(MB)"<<std::endl;
+
+    for(unsigned int numThreads=1; numThreads<=maxThreads; numThreads*=2)
+    {
+        osg::ref_ptr<osgDB::ObjectCache> cache = new osgDB::ObjectCache;
+        cache->setMaximumSize(static_cast<unsigned long long>(maximumSize*1024.0*1024.0));
+
+        std::vector< osg::ref_ptr<CacheBenchmarkThread> > threads;
+        for(unsigned int t=0; t<numThreads; ++t)
+        {
+            threads.push_back(new CacheBenchmarkThread(cache.get(), fileNames, numLookups, imageSize, t+1));
+        }
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+        for(unsigned int t=0; t<numThreads; ++t) threads[t]->startThread();
+        for(unsigned int t=0; t<numThreads; ++t) threads[t]->join();
+
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+        double totalLookups = static_cast<double>(numLookups)*static_cast<double>(numThreads);
+        double hitRate = static_cast<double>(cache->getNumHits())/static_cast<double>(cache->getNumHits()+cache->getNumMisses());
+
+        std::cout<<numThreads<<"\t"<<totalLookups/time<<"\t"<<hitRate*100.0<<"%\t\t"<<cache->getNumEvictions()
+                 <<"\t\t"<<static_cast<double>(cache->getSize())/(1024.0*1024.0)<<std::endl;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" checks the ObjectCache lookups with Options, and benchmarks concurrent access to the ObjectCache.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark","Benchmark concurrent lookups of an ObjectCache rather than viewing the cached models.");
+    arguments.getApplicationUsage()->addCommandLineOption("--files <num>","Number of distinct files looked up by the benchmark, default 10000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--lookups <num>","Number of lookups by each benchmark thread, default 1000000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Maximum number of benchmark threads, doubling from 1, default twice the number of processors.");
+    arguments.getApplicationUsage()->addCommandLineOption("--image-size <num>","Width and height of the RGBA image cached for each file by the benchmark, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-size <megabytes>","Maximum size of the ObjectCache used by the benchmark, default 0 for unlimited.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    if (arguments.read("--benchmark")) return runCacheBenchmark(arguments);
+
     // construct the viewer.
     osgViewer::Viewer viewer;
 
@@ -0,0 +1,257 @@
+/* OpenSceneGraph example, osgpagerbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Headless benchmark of the DatabasePager request scheduling. Tiles are "loaded" by an in process
+// ReaderWriter that simulates the read latency, so the benchmark measures the cost of queuing, scheduling
+// and merging requests rather than disk or network performance.
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/FrameStamp>
+#include <osg/Group>
+#include <osg/Timer>
+
+#include <osgDB/DatabasePager>
+#include <osgDB/ReaderWriter>
+#include <osgDB/Registry>
+#include <osgDB/FileNameUtils>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+
+class SimulatedTileReaderWriter : public osgDB::ReaderWriter
+{
+public:
+
+    SimulatedTileReaderWriter(unsigned int readLatency):
+        _readLatency(readLatency)
+    {
+        supportsExtension("pagerbenchmark","Simulated tile used by osgpagerbenchmark");
+    }
+
+    virtual const char* className() const { return "osgpagerbenchmark simulated tile reader"; }
+
+    virtual ReadResult readNode(const std::string& fileName, const osgDB::ReaderWriter::Options*) const
+    {
+        if (!acceptsExtension(osgDB::getLowerCaseFileExtension(fileName))) return ReadResult::FILE_NOT_HANDLED;
+
+        if (_readLatency>0) OpenThreads::Thread::microSleep(_readLatency);
+
+        osg::ref_ptr<osg::Group> tile = new osg::Group;
+        tile->setName(fileName);
+        return tile.get();
+    }
+
+protected:
+
+    unsigned int _readLatency;
+};
+
+// Example of a custom request priority, older requests are progressively penalized rather than strictly ordered by frame.
+struct AgeWeightedPriorityCallback : public osgDB::DatabasePager::ComputeRequestPriorityCallback
+{
+    virtual double computeRequestPriority(unsigned int frameNumber, unsigned int frameNumberLastRequest, double /*timestampLastRequest*/, float priorityLastRequest) const
+    {
+        double age = frameNumber>frameNumberLastRequest ? static_cast<double>(frameNumber-frameNumberLastRequest) : 0.0;
+        return static_cast<double>(priorityLastRequest) / (1.0 + age);
+    }
+};
+
+struct Tile
+{
+    Tile(): requestTick(0), merged(false) {}
+
+    // one parent and request per view, as in a CompositeViewer with a separate copy of the database per view.
+    std::vector< osg::ref_ptr<osg::Group> >         parents;
+    std::vector< osg::ref_ptr<osg::Referenced> >    databaseRequests;
+    std::string                     fileName;
+    float                           priority;
+    osg::Timer_t                    requestTick;
+    bool                            merged;
+};
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    std::size_t index = static_cast<std::size_t>(p*static_cast<double>(sorted.size()-1)+0.5);
+    return sorted[index];
+}
+
+int main( int argc, char **argv )
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" benchmarks the throughput and latency of the DatabasePager request scheduling.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("--tiles <num>","Total number of tiles to request, default 10000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--requests-per-frame <num>","Number of new tiles requested each frame, default 500.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Number of DatabaseThreads, default 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--latency <microseconds>","Simulated read time of each tile, default 100.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frame-time <microseconds>","Simulated duration of each frame, default 16000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--age-weighted-priority","Use an age weighted ComputeRequestPriorityCallback.");
+    arguments.getApplicationUsage()->addCommandLineOption("--views <num>","Number of views independently requesting each tile, default 1.");
+    arguments.getApplicationUsage()->addCommandLineOption("--coalesce","Enable coalescing of requests for the same file.");
+    arguments.getApplicationUsage()->addCommandLineOption("--cancel","Enable cancelling of reads that are no longer required.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numTiles = 10000;
+    unsigned int requestsPerFrame = 500;
+    unsigned int numThreads = 4;
+    unsigned int readLatency = 100;
+    unsigned int frameTime = 16000;
+    unsigned int numViews = 1;
+
+    while(arguments.read("--tiles", numTiles)) {}
+    while(arguments.read("--requests-per-frame", requestsPerFrame)) {}
+    while(arguments.read("--threads", numThreads)) {}
+    while(arguments.read("--latency", readLatency)) {}
+    while(arguments.read("--frame-time", frameTime)) {}
+    while(arguments.read("--views", numViews)) {}
+    if (numViews<1) numViews = 1;
+
+    osgDB::Registry::instance()->addReaderWriter(new SimulatedTileReaderWriter(readLatency));
+
+    osg::ref_ptr<osgDB::DatabasePager> pager = osgDB::DatabasePager::create();
+    pager->setDoPreCompile(false);
+    pager->setTargetMaximumNumberOfPageLOD(numTiles);
+    pager->setUpThreads(numThreads, 0);
+
+    if (arguments.read("--age-weighted-priority")) pager->setComputeRequestPriorityCallback(new AgeWeightedPriorityCallback);
+    if (arguments.read("--coalesce")) pager->setCoalesceRequests(true);
+    if (arguments.read("--cancel")) pager->setCancelInFlightReads(true);
+
+    std::vector<Tile> tiles(numTiles);
+    for(unsigned int i=0; i<numTiles; ++i)
+    {
+        std::ostringstream str;
+        str<<"tile_"<<i<<".pagerbenchmark";
+        tiles[i].fileName = str.str();
+        tiles[i].databaseRequests.resize(numViews);
+        for(unsigned int v=0; v<numViews; ++v) tiles[i].parents.push_back(new osg::Group);
+        tiles[i].priority = static_cast<float>(rand())/static_cast<float>(RAND_MAX);
+    }
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    std::vector<double> latencies;
+    latencies.reserve(numTiles);
+
+    unsigned int numRequested = 0;
+    unsigned int frameNumber = 0;
+    double totalRequestTime = 0.0;
+    double totalUpdateTime = 0.0;
+
+    while(latencies.size()<numTiles)
+    {
+        ++frameNumber;
+        frameStamp->setFrameNumber(frameNumber);
+        frameStamp->setReferenceTime(osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick()));
+
+        pager->signalBeginFrame(frameStamp.get());
+
+        // issue the new requests for this frame
+        unsigned int numToRequest = std::min(numTiles, numRequested+requestsPerFrame);
+        for(; numRequested<numToRequest; ++numRequested)
+        {
+            tiles[numRequested].requestTick = osg::Timer::instance()->tick();
+        }
+
+        // re-request all the outstanding tiles, as a cull traversal would, so that they remain current.
+        osg::Timer_t beforeRequests = osg::Timer::instance()->tick();
+        for(unsigned int i=0; i<numRequested; ++i)
+        {
+            Tile& tile = tiles[i];
+            if (tile.merged) continue;
+
+            for(unsigned int v=0; v<numViews; ++v)
+            {
+                if (tile.parents[v]->getNumChildren()>0) continue;
+
+                osg::NodePath nodePath;
+                nodePath.push_back(tile.parents[v].get());
+                pager->requestNodeFile(tile.fileName, nodePath, tile.priority, frameStamp.get(), tile.databaseRequests[v], 0);
+            }
+        }
+        osg::Timer_t afterRequests = osg::Timer::instance()->tick();
+        totalRequestTime += osg::Timer::instance()->delta_m(beforeRequests, afterRequests);
+
+        OpenThreads::Thread::microSleep(frameTime);
+
+        osg::Timer_t beforeUpdate = osg::Timer::instance()->tick();
+        pager->updateSceneGraph(*frameStamp);
+        osg::Timer_t afterUpdate = osg::Timer::instance()->tick();
+        totalUpdateTime += osg::Timer::instance()->delta_m(beforeUpdate, afterUpdate);
+
+        for(unsigned int i=0; i<numRequested; ++i)
+        {
+            Tile& tile = tiles[i];
+            if (tile.merged) continue;
+
+            unsigned int numMerged = 0;
+            for(unsigned int v=0; v<numViews; ++v)
+            {
+                if (tile.parents[v]->getNumChildren()>0) ++numMerged;
+            }
+
+            if (numMerged==numViews)
+            {
+                tile.merged = true;
+                tile.databaseRequests.clear();
+                latencies.push_back(osg::Timer::instance()->delta_m(tile.requestTick, afterUpdate));
+            }
+        }
+
+        pager->signalEndFrame();
+    }
+
+    double totalTime = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+    pager->cancel();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout<<"Threads                        : "<<numThreads<<std::endl;
+    std::cout<<"Tiles                          : "<<numTiles<<std::endl;
+    std::cout<<"Views                          : "<<numViews<<std::endl;
+    std::cout<<"Frames                         : "<<frameNumber<<std::endl;
+    std::cout<<"Total time                     : "<<totalTime<<"s"<<std::endl;
+    std::cout<<"Requests/sec                   : "<<static_cast<double>(numTiles)/totalTime<<std::endl;
+    std::cout<<"Average requestNodeFile/frame  : "<<totalRequestTime/static_cast<double>(frameNumber)<<"ms"<<std::endl;
+    std::cout<<"Average updateSceneGraph/frame : "<<totalUpdateTime/static_cast<double>(frameNumber)<<"ms"<<std::endl;
+    std::cout<<"Latency p50                    : "<<percentile(latencies, 0.50)<<"ms"<<std::endl;
+    std::cout<<"Latency p90                    : "<<percentile(latencies, 0.90)<<"ms"<<std::endl;
+    std::cout<<"Latency p99                    : "<<percentile(latencies, 0.99)<<"ms"<<std::endl;
+    std::cout<<"Latency max                    : "<<(latencies.empty() ? 0.0 : latencies.back())<<"ms"<<std::endl;
+    std::cout<<"Coalesced requests             : "<<pager->getNumCoalescedRequests()<<std::endl;
+    std::cout<<"Cancelled reads                : "<<pager->getNumCancelledReads()<<std::endl;
+
+    return 0;
+}
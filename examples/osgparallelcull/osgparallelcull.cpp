@@ -0,0 +1,272 @@
+/* OpenSceneGraph example, osgparallelcull.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Headless benchmark of the cull traversal of a large synthetic scene graph, comparing a serial cull
+// against culling the children of large Groups in parallel, and against compiling each Group of tiles
+// into an osg::CompiledStaticGroup. No graphics context is required as only the cull traversal of an
+// osgUtil::SceneView is run.
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/CompiledStaticGroup>
+#include <osg/FrameStamp>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Material>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+
+#include <osgUtil/SceneView>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <vector>
+
+osg::Geometry* createQuad(const osg::Vec4& color)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    vertices->push_back(osg::Vec3(-0.4f, -0.4f, 0.0f));
+    vertices->push_back(osg::Vec3( 0.4f, -0.4f, 0.0f));
+    vertices->push_back(osg::Vec3( 0.4f,  0.4f, 0.0f));
+    vertices->push_back(osg::Vec3(-0.4f,  0.4f, 0.0f));
+
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array;
+    colors->push_back(color);
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->setColorArray(colors.get(), osg::Array::BIND_OVERALL);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_QUADS, 0, 4));
+    return geometry;
+}
+
+// a grid of transformed tiles grouped into blocks, each block a Group with many children, using a pool of
+// StateSets so that the cull builds a realistic StateGraph, and with some transparent tiles in a depth sorted bin.
+osg::Node* createScene(unsigned int numBlocks, unsigned int tilesPerBlock, unsigned int numStateSets, bool compiled)
+{
+    std::vector< osg::ref_ptr<osg::StateSet> > stateSets;
+    std::vector< osg::ref_ptr<osg::Geometry> > geometries;
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        osg::Vec4 color(float(i%3)/2.0f, float((i/3)%3)/2.0f, float((i/9)%3)/2.0f, (i%4==0) ? 0.5f : 1.0f);
+
+        osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+        osg::ref_ptr<osg::Material> material = new osg::Material;
+        material->setDiffuse(osg::Material::FRONT_AND_BACK, color);
+        stateset->setAttribute(material.get());
+        if (color.a()<1.0f) stateset->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+        stateSets.push_back(stateset);
+
+        geometries.push_back(createQuad(color));
+    }
+
+    unsigned int numColumns = 1;
+    while(numColumns*numColumns < numBlocks*tilesPerBlock) ++numColumns;
+
+    osg::Group* root = new osg::Group;
+    unsigned int tile = 0;
+    for(unsigned int b=0; b<numBlocks; ++b)
+    {
+        osg::ref_ptr<osg::Group> block = compiled ? new osg::CompiledStaticGroup : new osg::Group;
+        for(unsigned int t=0; t<tilesPerBlock; ++t, ++tile)
+        {
+            unsigned int s = (tile*7)%numStateSets;
+
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(geometries[s].get());
+            geode->setStateSet(stateSets[s].get());
+
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+            transform->setMatrix(osg::Matrix::translate(float(tile%numColumns), float(tile/numColumns), 0.0f));
+            transform->addChild(geode.get());
+            block->addChild(transform.get());
+        }
+        root->addChild(block.get());
+    }
+    return root;
+}
+
+void addToChecksum(const osgUtil::RenderLeaf* leaf, unsigned int& numLeaves, unsigned long long& checksum)
+{
+    checksum = checksum*1099511628211ULL + reinterpret_cast<unsigned long long>(leaf->getDrawable());
+    checksum = checksum*1099511628211ULL + leaf->_traversalOrderNumber;
+    ++numLeaves;
+}
+
+// accumulate a checksum of the drawables and traversal order numbers of the leaves in draw order,
+// which should be independent of whether the scene was culled serially or in parallel.
+void computeChecksum(const osgUtil::RenderBin* renderBin, unsigned int& numLeaves, unsigned long long& checksum)
+{
+    for(osgUtil::RenderBin::RenderLeafList::const_iterator litr = renderBin->getRenderLeafList().begin();
+        litr != renderBin->getRenderLeafList().end();
+        ++litr)
+    {
+        addToChecksum(*litr, numLeaves, checksum);
+    }
+
+    for(osgUtil::RenderBin::StateGraphList::const_iterator sitr = renderBin->getStateGraphList().begin();
+        sitr != renderBin->getStateGraphList().end();
+        ++sitr)
+    {
+        for(osgUtil::StateGraph::LeafList::const_iterator litr = (*sitr)->_leaves.begin();
+            litr != (*sitr)->_leaves.end();
+            ++litr)
+        {
+            addToChecksum(litr->get(), numLeaves, checksum);
+        }
+    }
+
+    for(osgUtil::RenderBin::RenderBinList::const_iterator bitr = renderBin->getRenderBinList().begin();
+        bitr != renderBin->getRenderBinList().end();
+        ++bitr)
+    {
+        checksum = checksum*1099511628211ULL + static_cast<unsigned long long>(bitr->first);
+        computeChecksum(bitr->second.get(), numLeaves, checksum);
+    }
+}
+
+struct Result
+{
+    Result(): time(0.0), numLeaves(0), checksum(0), znear(0.0), zfar(0.0) {}
+
+    double              time;
+    unsigned int        numLeaves;
+    unsigned long long  checksum;
+    double              znear;
+    double              zfar;
+};
+
+Result benchmark(osg::Node* scene, unsigned int numThreads, unsigned int minimumNumChildren, unsigned int numIterations)
+{
+    osg::ref_ptr<osgUtil::SceneView> sceneView = new osgUtil::SceneView;
+    sceneView->setDefaults();
+    sceneView->setSceneData(scene);
+    sceneView->setViewport(0, 0, 1920, 1080);
+    sceneView->setNumParallelCullThreads(numThreads);
+    sceneView->setParallelCullMinimumNumChildren(minimumNumChildren);
+
+    // look down at the grid from one corner so that part of the scene is frustum culled.
+    const osg::BoundingSphere& bs = scene->getBound();
+    sceneView->setProjectionMatrixAsPerspective(60.0, 1920.0/1080.0, 1.0, bs.radius()*4.0);
+    sceneView->setViewMatrixAsLookAt(bs.center()-osg::Vec3(bs.radius()*0.5f, bs.radius()*0.5f, -bs.radius()*0.5f), bs.center(), osg::Vec3(0.0f, 0.0f, 1.0f));
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    sceneView->setFrameStamp(frameStamp.get());
+
+    Result result;
+
+    // the first cull warms up the threads and the RenderLeaf and StateGraph pools.
+    for(unsigned int i=0; i<=numIterations; ++i)
+    {
+        frameStamp->setFrameNumber(i);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        sceneView->cull();
+        if (i>0) result.time += osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+    }
+    result.time /= double(numIterations);
+
+    computeChecksum(sceneView->getRenderStage(), result.numLeaves, result.checksum);
+    result.znear = sceneView->getCullVisitor()->getCalculatedNearPlane();
+    result.zfar = sceneView->getCullVisitor()->getCalculatedFarPlane();
+    return result;
+}
+
+int main( int argc, char **argv )
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" benchmarks culling the children of large Groups in parallel, or compiled into CompiledStaticGroups, against a serial cull traversal.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("--blocks <num>","Number of Groups of tiles, default 16.");
+    arguments.getApplicationUsage()->addCommandLineOption("--tiles <num>","Number of tiles in each Group, default 32768.");
+    arguments.getApplicationUsage()->addCommandLineOption("--statesets <num>","Number of distinct StateSets, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Maximum number of parallel cull threads, default the number of processors minus one.");
+    arguments.getApplicationUsage()->addCommandLineOption("--minimum-children <num>","Minimum number of children of a Group for it to be culled in parallel, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>","Number of cull traversals timed, default 10.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numBlocks = 16;
+    unsigned int tilesPerBlock = 32768;
+    unsigned int numStateSets = 64;
+    unsigned int maxNumThreads = OpenThreads::GetNumberOfProcessors()>1 ? OpenThreads::GetNumberOfProcessors()-1 : 1;
+    unsigned int minimumNumChildren = 64;
+    unsigned int numIterations = 10;
+
+    while(arguments.read("--blocks", numBlocks)) {}
+    while(arguments.read("--tiles", tilesPerBlock)) {}
+    while(arguments.read("--statesets", numStateSets)) {}
+    while(arguments.read("--threads", maxNumThreads)) {}
+    while(arguments.read("--minimum-children", minimumNumChildren)) {}
+    while(arguments.read("--iterations", numIterations)) {}
+    if (numStateSets<1) numStateSets = 1;
+    if (numIterations<1) numIterations = 1;
+
+    osg::ref_ptr<osg::Node> scene = createScene(numBlocks, tilesPerBlock, numStateSets, false);
+
+    std::cout<<"Nodes : "<<numBlocks*tilesPerBlock*2+numBlocks+1<<std::endl;
+
+    Result serial = benchmark(scene.get(), 0, minimumNumChildren, numIterations);
+    std::cout<<"Serial cull                : "<<serial.time<<"ms, "<<serial.numLeaves<<" leaves"<<std::endl;
+
+    std::vector<unsigned int> threadCounts;
+    for(unsigned int numThreads=1; numThreads<maxNumThreads; numThreads*=2) threadCounts.push_back(numThreads);
+    threadCounts.push_back(maxNumThreads);
+
+    bool identical = true;
+    for(std::vector<unsigned int>::iterator itr = threadCounts.begin(); itr != threadCounts.end(); ++itr)
+    {
+        unsigned int numThreads = *itr;
+        Result parallel = benchmark(scene.get(), numThreads, minimumNumChildren, numIterations);
+        bool same = parallel.numLeaves==serial.numLeaves && parallel.checksum==serial.checksum &&
+                    parallel.znear==serial.znear && parallel.zfar==serial.zfar;
+        identical = identical && same;
+
+        std::cout<<"Parallel cull, "<<numThreads<<" thread(s) : "<<parallel.time<<"ms, "<<parallel.numLeaves<<" leaves, speedup "
+                 <<serial.time/parallel.time<<(same ? "" : ", RESULTS DIFFER FROM SERIAL CULL")<<std::endl;
+    }
+
+    // with a low minimum both the root and the blocks qualify, the blocks are then nested within the
+    // root's parallel ranges so are culled serially by whichever visitor is culling their range.
+    {
+        Result nested = benchmark(scene.get(), maxNumThreads, 2, numIterations);
+        bool same = nested.numLeaves==serial.numLeaves && nested.checksum==serial.checksum &&
+                    nested.znear==serial.znear && nested.zfar==serial.zfar;
+        identical = identical && same;
+
+        std::cout<<"Parallel cull, nested groups: "<<nested.time<<"ms, "<<nested.numLeaves<<" leaves, speedup "
+                 <<serial.time/nested.time<<(same ? "" : ", RESULTS DIFFER FROM SERIAL CULL")<<std::endl;
+    }
+
+    // the compiled arrays group the leaves by StateSet so only the number of leaves is comparable with the serial cull.
+    osg::ref_ptr<osg::Node> compiledScene = createScene(numBlocks, tilesPerBlock, numStateSets, true);
+    Result compiled = benchmark(compiledScene.get(), 0, minimumNumChildren, numIterations);
+    std::cout<<"Compiled static groups     : "<<compiled.time<<"ms, "<<compiled.numLeaves<<" leaves, speedup "
+             <<serial.time/compiled.time<<std::endl;
+
+    return identical ? 0 : 1;
+}
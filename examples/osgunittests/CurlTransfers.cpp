@@ -0,0 +1,226 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Writes tile files and an osga archive of them to a directory, which is expected to be served over http at the url
+// given, then reads the files through the curl plugin from one and several threads, with each thread's own connection
+// and with the plugin's shared connection pool, reporting the throughput and the mean latency of the requests, and
+// reads files from the archive with it downloaded whole and read by byte range requests.
+
+#include <osgDB/Archive>
+#include <osgDB/FileUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+namespace
+{
+
+const unsigned int numFiles = 128;
+
+std::string createFileName(unsigned int i)
+{
+    std::ostringstream str;
+    str<<"file_"<<i<<".osgb";
+    return str.str();
+}
+
+osg::Node* createTile(unsigned int resolution)
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for(unsigned int r=0; r<=resolution; ++r)
+    {
+        for(unsigned int c=0; c<=resolution; ++c)
+        {
+            vertices->push_back(osg::Vec3(float(c), float(r), float(rand())/float(RAND_MAX)));
+        }
+    }
+    geometry->setVertexArray(vertices.get());
+
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r<resolution; ++r)
+    {
+        for(unsigned int c=0; c<resolution; ++c)
+        {
+            GLuint i = r*(resolution+1)+c;
+            triangles->push_back(i); triangles->push_back(i+1); triangles->push_back(i+resolution+2);
+            triangles->push_back(i); triangles->push_back(i+resolution+2); triangles->push_back(i+resolution+1);
+        }
+    }
+    geometry->addPrimitiveSet(triangles.get());
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode.release();
+}
+
+class ReadThread : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        ReadThread(const std::string& url, unsigned int first, unsigned int stride, const osgDB::Options* options):
+            _url(url),
+            _first(first),
+            _stride(stride),
+            _options(options),
+            _numRead(0),
+            _totalLatency(0.0) {}
+
+        virtual void run()
+        {
+            for(unsigned int i=_first; i<numFiles; i+=_stride)
+            {
+                osg::Timer_t start = osg::Timer::instance()->tick();
+                osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(_url+"/"+createFileName(i), _options.get());
+                _totalLatency += osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+                if (node.valid()) ++_numRead;
+            }
+        }
+
+        std::string                         _url;
+        unsigned int                        _first;
+        unsigned int                        _stride;
+        osg::ref_ptr<const osgDB::Options>  _options;
+        unsigned int                        _numRead;
+        double                              _totalLatency;
+
+    protected:
+
+        virtual ~ReadThread() {}
+};
+
+osgDB::Options* createOptions(const std::string& optionString)
+{
+    osgDB::Options* options = new osgDB::Options(optionString);
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+    return options;
+}
+
+/** Read all the files from a number of threads, returning whether all were read.*/
+bool readFiles(const std::string& url, unsigned int numThreads, bool useConnectionPool)
+{
+    osg::ref_ptr<osgDB::Options> options = createOptions(useConnectionPool ? "OSG_CURL_CONNECTION_POOL=1" : "OSG_CURL_CONNECTION_POOL=0");
+
+    std::vector< osg::ref_ptr<ReadThread> > threads;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        threads.push_back(new ReadThread(url, i, numThreads, options.get()));
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numThreads; ++i) threads[i]->startThread();
+    for(unsigned int i=0; i<numThreads; ++i) threads[i]->join();
+    double time = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    unsigned int numRead = 0;
+    double totalLatency = 0.0;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        numRead += threads[i]->_numRead;
+        totalLatency += threads[i]->_totalLatency;
+    }
+
+    std::cout<<"  "<<numThreads<<" threads, "<<(useConnectionPool ? "connection pool  " : "thread connections")<<" : "
+             <<double(numRead)/time<<" files/s, mean latency "<<totalLatency/double(numFiles)<<"ms"<<std::endl;
+
+    return numRead==numFiles;
+}
+
+/** Open the archive and read some of its files, returning whether all were read.*/
+bool readArchive(const std::string& archiveFileName, bool useRangeRequests)
+{
+    osg::ref_ptr<osgDB::Options> options = createOptions(useRangeRequests ? "OSG_CURL_RANGE_BLOCK_SIZE=65536" : "OSG_CURL_RANGE_BLOCK_SIZE=0");
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    osg::ref_ptr<osgDB::Archive> archive = osgDB::openArchive(archiveFileName, osgDB::Archive::READ, 4096, options.get());
+    double openTime = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+    if (!archive) return false;
+
+    const unsigned int numFilesRead = 8;
+    unsigned int numRead = 0;
+    for(unsigned int i=0; i<numFilesRead; ++i)
+    {
+        if (archive->readNode(createFileName(i*numFiles/numFilesRead), options.get()).validNode()) ++numRead;
+    }
+    double readTime = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) - openTime;
+
+    std::cout<<"  archive "<<(useRangeRequests ? "read by range requests" : "downloaded whole     ")<<" : opened in "<<openTime<<"ms, "
+             <<numRead<<" of its "<<numFiles<<" files read in "<<readTime<<"ms"<<std::endl;
+
+    return numRead==numFilesRead;
+}
+
+}
+
+void runCurlBenchmark(const std::string& directory, const std::string& url)
+{
+    std::cout<<"******   curl plugin benchmark   ******"<<std::endl;
+
+    std::string filesDirectory = directory + "/curl";
+    osgDB::makeDirectory(filesDirectory);
+
+    // two copies of the archive, so that each is opened from the server rather than the Registry's archive cache.
+    osg::ref_ptr<osgDB::Archive> archives[2];
+    for(unsigned int i=0; i<2; ++i)
+    {
+        std::ostringstream archiveFileName;
+        archiveFileName<<filesDirectory<<"/archive_"<<i<<".osga";
+        archives[i] = osgDB::openArchive(archiveFileName.str(), osgDB::Archive::CREATE);
+    }
+
+    for(unsigned int i=0; i<numFiles; ++i)
+    {
+        osg::ref_ptr<osg::Node> tile = createTile(64);
+        osgDB::writeNodeFile(*tile, filesDirectory+"/"+createFileName(i));
+        for(unsigned int a=0; a<2; ++a)
+        {
+            if (archives[a].valid()) archives[a]->writeNode(*tile, createFileName(i));
+        }
+    }
+    // the Registry caches the archives it opens, so close them explicitly to write their indices.
+    for(unsigned int a=0; a<2; ++a)
+    {
+        if (archives[a].valid()) archives[a]->close();
+    }
+    std::cout<<"  wrote "<<numFiles<<" files and two archives of them to "<<filesDirectory<<std::endl;
+
+    bool passed = true;
+
+    unsigned int numThreads[] = { 1, 8 };
+    for(unsigned int t=0; t<2; ++t)
+    {
+        passed = readFiles(url+"/curl", numThreads[t], false) && passed;
+        passed = readFiles(url+"/curl", numThreads[t], true) && passed;
+    }
+
+    passed = readArchive(url+"/curl/archive_0.osga", false) && passed;
+    passed = readArchive(url+"/curl/archive_1.osga", true) && passed;
+
+    std::cout<<"  "<<(passed ? "all files read" : "FILES NOT READ")<<std::endl;
+}
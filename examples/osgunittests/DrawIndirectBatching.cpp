@@ -0,0 +1,174 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Packs many small Geometries into osgUtil::DrawIndirectBatch's, checking that the commands built for the batches
+// draw the same vertices as the original Geometries and timing the building of the command buffers, which is done
+// on the CPU so no graphics context is required.
+
+#include <osgUtil/DrawIndirectBatch>
+#include <osg/Geode>
+#include <osg/Timer>
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+namespace
+{
+
+osg::Geometry* createSmallGeometry(unsigned int i)
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+
+    unsigned int numVertices = 4 + rand()%60;
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec3Array* normals = new osg::Vec3Array;
+    osg::Vec2Array* texcoords = new osg::Vec2Array;
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        vertices->push_back(osg::Vec3(float(i), float(v), float(rand()%100)));
+        normals->push_back(osg::Vec3(0.0f, 0.0f, 1.0f));
+        texcoords->push_back(osg::Vec2(float(v)/float(numVertices), float(i%7)));
+    }
+    geometry->setVertexArray(vertices);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->setTexCoordArray(0, texcoords, osg::Array::BIND_PER_VERTEX);
+
+    // a mixture of indexed and non indexed triangles, as found in converted models.
+    if (i%3==0)
+    {
+        geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, (numVertices/3)*3));
+    }
+    else
+    {
+        osg::DrawElementsUShort* elements = new osg::DrawElementsUShort(GL_TRIANGLES);
+        unsigned int numTriangles = 2 + rand()%40;
+        for(unsigned int t=0; t<numTriangles*3; ++t) elements->push_back(rand()%numVertices);
+        geometry->addPrimitiveSet(elements);
+    }
+    if (i%5==0)
+    {
+        geometry->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, 3));
+    }
+
+    return geometry.release();
+}
+
+// compare the vertices drawn by each command against those of the original PrimitiveSet.
+unsigned int countMismatches(const osg::Geometry& geometry)
+{
+    const osgUtil::DrawIndirectBatch::Member* member = osgUtil::DrawIndirectBatch::getMember(&geometry);
+    if (!member) return 1;
+
+    const osgUtil::DrawIndirectBatch* batch = member->getBatch();
+    const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+    const osg::Vec3Array* packedVertices = static_cast<const osg::Vec3Array*>(batch->getGeometry()->getVertexArray());
+    const osg::MultiDrawElementsIndirectUInt* packedPrimitives = static_cast<const osg::MultiDrawElementsIndirectUInt*>(batch->getGeometry()->getPrimitiveSet(0));
+    if (member->getNumCommands()!=geometry.getNumPrimitiveSets()) return 1;
+
+    unsigned int numMismatches = 0;
+    for(unsigned int i=0; i<member->getNumCommands(); ++i)
+    {
+        const osg::DrawElementsIndirectCommand& command = batch->getMemberCommands()[member->getFirstCommand()+i];
+        const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (command.count!=primitiveSet->getNumIndices()) { ++numMismatches; continue; }
+
+        for(unsigned int j=0; j<command.count; ++j)
+        {
+            unsigned int packedIndex = command.baseVertex + (*packedPrimitives)[command.firstIndex+j];
+            if ((*packedVertices)[packedIndex]!=(*vertices)[primitiveSet->index(j)]) ++numMismatches;
+        }
+    }
+    return numMismatches;
+}
+
+}
+
+void runDrawIndirectBatchBenchmark(unsigned int numGeometries)
+{
+    std::cout<<"******   DrawIndirectBatch benchmark   ******"<<std::endl;
+
+    // a few StateSets shared by many small Geometries.
+    std::vector< osg::ref_ptr<osg::StateSet> > statesets;
+    for(unsigned int i=0; i<4; ++i) statesets.push_back(new osg::StateSet);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    for(unsigned int i=0; i<numGeometries; ++i)
+    {
+        osg::Geometry* geometry = createSmallGeometry(i);
+        geometry->setStateSet(statesets[i%statesets.size()].get());
+        geode->addDrawable(geometry);
+    }
+
+    osg::Timer* timer = osg::Timer::instance();
+
+    osg::Timer_t startTick = timer->tick();
+    osgUtil::DrawIndirectBatchVisitor batchVisitor;
+    geode->accept(batchVisitor);
+    batchVisitor.batch();
+    osg::Timer_t endTick = timer->tick();
+
+    unsigned int numBatched = 0, numMismatches = 0;
+    for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+    {
+        const osg::Geometry* geometry = geode->getDrawable(i)->asGeometry();
+        if (osgUtil::DrawIndirectBatch::getMember(geometry))
+        {
+            ++numBatched;
+            numMismatches += countMismatches(*geometry);
+        }
+    }
+
+    std::cout<<numGeometries<<" Geometries, "<<numBatched<<" packed into "<<batchVisitor.getBatches().size()<<" batches in "<<timer->delta_m(startTick, endTick)<<"ms, "<<numMismatches<<" mismatches"<<std::endl;
+
+    // build the command buffers for random visible subsets, as the RenderBin does each frame.
+    const unsigned int numFrames = 100;
+    osg::ref_ptr<osg::DefaultIndirectCommandDrawElements> commands = new osg::DefaultIndirectCommandDrawElements;
+    osgUtil::DrawIndirectBatch::MemberList members;
+    unsigned int numCommands = 0;
+    double buildTime = 0.0;
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        for(unsigned int b=0; b<batchVisitor.getBatches().size(); ++b)
+        {
+            osgUtil::DrawIndirectBatch* batch = batchVisitor.getBatches()[b].get();
+
+            members.clear();
+            for(unsigned int i=0; i<geode->getNumDrawables(); ++i)
+            {
+                const osgUtil::DrawIndirectBatch::Member* member = osgUtil::DrawIndirectBatch::getMember(geode->getDrawable(i));
+                if (member && member->getBatch()==batch && rand()%2==0) members.push_back(member);
+            }
+
+            osg::Timer_t buildStartTick = timer->tick();
+            batch->buildCommands(members, *commands);
+            buildTime += timer->delta_s(buildStartTick, timer->tick());
+
+            numCommands += commands->getNumElements();
+        }
+    }
+
+    std::cout<<"  DrawIndirectBatch::buildCommands() : "<<buildTime*1000.0/double(numFrames)<<"ms per frame, "
+             <<numCommands/numFrames<<" commands per frame drawn with "
+             <<batchVisitor.getBatches().size()<<" multi draw calls"<<std::endl;
+
+    std::cout<<std::endl;
+}
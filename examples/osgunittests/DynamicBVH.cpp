@@ -0,0 +1,204 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Moves a fraction of many MatrixTransforms each frame, then picks them with LineSegmentIntersectors and
+// PolytopeIntersectors, placed both under an osg::Group and an osgUtil::DynamicBVHGroup, reporting the time taken to
+// update the hierarchy and for each query, and checking that both find the same intersections.
+
+#include <osgUtil/DynamicBVHGroup>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/PolytopeIntersector>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+
+#include <iostream>
+#include <set>
+#include <stdlib.h>
+
+namespace
+{
+
+double random(double min, double max) { return min + (max-min)*double(rand())/double(RAND_MAX); }
+
+osg::Vec3d randomPosition() { return osg::Vec3d(random(0.0, 1000.0), random(0.0, 1000.0), random(0.0, 100.0)); }
+
+osg::Node* createObject()
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    geometry->setVertexArray(vertices.get());
+
+    // a box of 12 triangles.
+    const float size = 1.0f;
+    for(unsigned int i=0; i<8; ++i)
+    {
+        vertices->push_back(osg::Vec3((i&1) ? size : -size, (i&2) ? size : -size, (i&4) ? size : -size));
+    }
+
+    const GLuint indices[] = { 0,2,1, 1,2,3, 4,5,6, 5,7,6, 0,1,4, 1,5,4, 2,6,3, 3,6,7, 0,4,2, 2,4,6, 1,3,5, 3,7,5 };
+    geometry->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, 36, indices));
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode.release();
+}
+
+typedef std::vector< osg::ref_ptr<osg::MatrixTransform> > Transforms;
+
+typedef std::set<const osg::Node*> NodeSet;
+
+// the transforms above the drawables intersected.
+template<class Intersections>
+NodeSet getIntersectedNodes(const Intersections& intersections)
+{
+    NodeSet nodes;
+    for(typename Intersections::const_iterator itr = intersections.begin(); itr != intersections.end(); ++itr)
+    {
+        for(osg::NodePath::const_iterator nitr = itr->nodePath.begin(); nitr != itr->nodePath.end(); ++nitr)
+        {
+            if (dynamic_cast<const osg::MatrixTransform*>(*nitr)) nodes.insert(*nitr);
+        }
+    }
+    return nodes;
+}
+
+}
+
+void runDynamicBVHBenchmark(unsigned int numObjects)
+{
+    std::cout<<"******   DynamicBVHGroup benchmark   ******"<<std::endl;
+
+    srand(1);
+
+    osg::ref_ptr<osg::Node> object = createObject();
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    osg::ref_ptr<osgUtil::DynamicBVHGroup> bvhGroup = new osgUtil::DynamicBVHGroup;
+
+    Transforms transforms;
+    for(unsigned int i=0; i<numObjects; ++i)
+    {
+        osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrix::translate(randomPosition()));
+        transform->addChild(object.get());
+        transforms.push_back(transform);
+        group->addChild(transform.get());
+        bvhGroup->addChild(transform.get());
+    }
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    bvhGroup->getBound();
+    double buildTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+    group->getBound();
+
+    std::cout<<"  "<<numObjects<<" objects, hierarchy built in "<<buildTime<<"ms, "<<bvhGroup->getHierarchyHeight()<<" levels"<<std::endl;
+
+    const unsigned int numFrames = 20;
+    const unsigned int numMovedPerFrame = numObjects/20;
+    const unsigned int numRaysPerFrame = 50;
+
+    double updateTime = 0.0, groupRayTime = 0.0, bvhRayTime = 0.0, groupPolytopeTime = 0.0, bvhPolytopeTime = 0.0;
+    unsigned int numRayHits = 0, numPolytopeHits = 0, numDifferent = 0;
+
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        // move some of the objects a short distance, and teleport a few of them.
+        for(unsigned int i=0; i<numMovedPerFrame; ++i)
+        {
+            osg::MatrixTransform* transform = transforms[rand()%numObjects].get();
+            osg::Vec3d position = (i%10==0) ? randomPosition() : transform->getMatrix().getTrans() + osg::Vec3d(random(-0.2, 0.2), random(-0.2, 0.2), random(-0.2, 0.2));
+            transform->setMatrix(osg::Matrix::translate(position));
+        }
+
+        group->getBound();
+
+        startTick = osg::Timer::instance()->tick();
+        bvhGroup->getBound();
+        updateTime += osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+        for(unsigned int r=0; r<numRaysPerFrame; ++r)
+        {
+            // a pick aimed at an object, and a polytope around another.
+            osg::Vec3d target = transforms[rand()%numObjects]->getMatrix().getTrans();
+            osg::Vec3d start(target.x()+random(-0.5, 0.5), target.y()+random(-0.5, 0.5), 200.0);
+            osg::Vec3d end(start.x(), start.y(), -10.0);
+
+            osg::ref_ptr<osgUtil::LineSegmentIntersector> groupRay = new osgUtil::LineSegmentIntersector(start, end);
+            osg::ref_ptr<osgUtil::LineSegmentIntersector> bvhRay = new osgUtil::LineSegmentIntersector(start, end);
+
+            startTick = osg::Timer::instance()->tick();
+            {
+                osgUtil::IntersectionVisitor iv(groupRay.get());
+                group->accept(iv);
+            }
+            groupRayTime += osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+            startTick = osg::Timer::instance()->tick();
+            {
+                osgUtil::IntersectionVisitor iv(bvhRay.get());
+                bvhGroup->accept(iv);
+            }
+            bvhRayTime += osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+            target = transforms[rand()%numObjects]->getMatrix().getTrans();
+            osg::Polytope polytope;
+            polytope.setToBoundingBox(osg::BoundingBox(target-osg::Vec3d(5.0, 5.0, 5.0), target+osg::Vec3d(5.0, 5.0, 5.0)));
+
+            osg::ref_ptr<osgUtil::PolytopeIntersector> groupPolytope = new osgUtil::PolytopeIntersector(polytope);
+            osg::ref_ptr<osgUtil::PolytopeIntersector> bvhPolytope = new osgUtil::PolytopeIntersector(polytope);
+
+            startTick = osg::Timer::instance()->tick();
+            {
+                osgUtil::IntersectionVisitor iv(groupPolytope.get());
+                group->accept(iv);
+            }
+            groupPolytopeTime += osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+            startTick = osg::Timer::instance()->tick();
+            {
+                osgUtil::IntersectionVisitor iv(bvhPolytope.get());
+                bvhGroup->accept(iv);
+            }
+            bvhPolytopeTime += osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+            numRayHits += groupRay->getIntersections().size();
+            numPolytopeHits += groupPolytope->getIntersections().size();
+
+            if (getIntersectedNodes(groupRay->getIntersections())!=getIntersectedNodes(bvhRay->getIntersections()) ||
+                groupRay->getIntersections().size()!=bvhRay->getIntersections().size()) ++numDifferent;
+
+            if (getIntersectedNodes(groupPolytope->getIntersections())!=getIntersectedNodes(bvhPolytope->getIntersections()) ||
+                groupPolytope->getIntersections().size()!=bvhPolytope->getIntersections().size()) ++numDifferent;
+        }
+    }
+
+    unsigned int numQueries = numFrames*numRaysPerFrame;
+    std::cout<<"  "<<numMovedPerFrame<<" objects moved per frame, hierarchy updated in "<<updateTime/double(numFrames)<<"ms per frame, "
+             <<bvhGroup->getHierarchyHeight()<<" levels"<<std::endl;
+    std::cout<<"  LineSegmentIntersector : Group "<<groupRayTime/double(numQueries)<<"ms, DynamicBVHGroup "<<bvhRayTime/double(numQueries)
+             <<"ms per query, "<<numRayHits<<" intersections"<<std::endl;
+    std::cout<<"  PolytopeIntersector    : Group "<<groupPolytopeTime/double(numQueries)<<"ms, DynamicBVHGroup "<<bvhPolytopeTime/double(numQueries)
+             <<"ms per query, "<<numPolytopeHits<<" intersections"<<std::endl;
+    std::cout<<"  Intersections "<<(numDifferent==0 ? "match" : "DIFFER")<<" ("<<numDifferent<<" of "<<2*numQueries<<" queries differ)"<<std::endl;
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,259 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Writes a quadtree of PagedLOD terrain tiles to a directory, which is expected to be served over http at the url given,
+// for instance by "python3 -m http.server" run in it, then prefetches the tiles needed along a camera path through an
+// osgDB::FileCache, first into an empty cache and then again with the cache's index reloaded, checks that a reduced
+// maximum size is kept to by evicting the least recently used files, that corrupted files are detected, and compares
+// the time taken by writes to the cache with and without write behind.
+
+#include <osgDB/FileCache>
+#include <osgDB/FileNameUtils>
+#include <osgDB/FileUtils>
+#include <osgDB/WriteFile>
+#include <osgDB/fstream>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/PagedLOD>
+#include <osg/Timer>
+
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+
+const double terrainSize = 10000.0;
+const unsigned int numLevels = 5;
+const unsigned int tileResolution = 32;
+
+std::string createTileFileName(unsigned int level, unsigned int x, unsigned int y)
+{
+    std::ostringstream str;
+    str<<"tile_"<<level<<"_"<<x<<"_"<<y<<".osgb";
+    return str.str();
+}
+
+osg::Node* createTileGeometry(unsigned int level, unsigned int x, unsigned int y)
+{
+    double tileSize = terrainSize/double(1<<level);
+    osg::Vec3d origin(double(x)*tileSize, double(y)*tileSize, 0.0);
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for(unsigned int r=0; r<=tileResolution; ++r)
+    {
+        for(unsigned int c=0; c<=tileResolution; ++c)
+        {
+            float height = 20.0f*float(rand())/float(RAND_MAX);
+            vertices->push_back(osg::Vec3(origin.x()+tileSize*double(c)/double(tileResolution), origin.y()+tileSize*double(r)/double(tileResolution), height));
+        }
+    }
+    geometry->setVertexArray(vertices.get());
+
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r<tileResolution; ++r)
+    {
+        for(unsigned int c=0; c<tileResolution; ++c)
+        {
+            GLuint i = r*(tileResolution+1)+c;
+            triangles->push_back(i); triangles->push_back(i+1); triangles->push_back(i+tileResolution+2);
+            triangles->push_back(i); triangles->push_back(i+tileResolution+2); triangles->push_back(i+tileResolution+1);
+        }
+    }
+    geometry->addPrimitiveSet(triangles.get());
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode.release();
+}
+
+/** A tile's PagedLOD, drawing its own geometry from afar and loading the file of its four children up close.*/
+osg::Node* createTile(unsigned int level, unsigned int x, unsigned int y)
+{
+    osg::ref_ptr<osg::Node> geometry = createTileGeometry(level, x, y);
+    if (level+1==numLevels) return geometry.release();
+
+    double tileSize = terrainSize/double(1<<level);
+    float radius = float(tileSize*0.75);
+
+    osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+    plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+    plod->setCenter(osg::Vec3(float((double(x)+0.5)*tileSize), float((double(y)+0.5)*tileSize), 0.0f));
+    plod->setRadius(radius);
+    plod->addChild(geometry.get(), radius*3.0f, 1e10f);
+    plod->setFileName(1, createTileFileName(level+1, x*2, y*2));
+    plod->setRange(1, 0.0f, radius*3.0f);
+    return plod.release();
+}
+
+/** Write the files of the tiles below a tile, returning the number written.*/
+unsigned int writeChildTiles(const std::string& directory, unsigned int level, unsigned int x, unsigned int y)
+{
+    if (level+1>=numLevels) return 0;
+
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    for(unsigned int i=0; i<4; ++i)
+    {
+        group->addChild(createTile(level+1, x*2+(i&1), y*2+(i>>1)));
+    }
+
+    unsigned int numFiles = osgDB::writeNodeFile(*group, directory+"/"+createTileFileName(level+1, x*2, y*2)) ? 1 : 0;
+    for(unsigned int i=0; i<4; ++i)
+    {
+        numFiles += writeChildTiles(directory, level+1, x*2+(i&1), y*2+(i>>1));
+    }
+    return numFiles;
+}
+
+void removeDirectoryContents(const std::string& directory)
+{
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(directory);
+    for(osgDB::DirectoryContents::iterator itr = contents.begin(); itr != contents.end(); ++itr)
+    {
+        if (*itr=="." || *itr=="..") continue;
+
+        std::string fileName = directory + "/" + *itr;
+        if (osgDB::fileType(fileName)==osgDB::DIRECTORY) removeDirectoryContents(fileName);
+        remove(fileName.c_str());
+    }
+}
+
+double prefetch(osgDB::FileCache* fileCache, const std::string& fileName, const osg::AnimationPath* path)
+{
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    fileCache->prefetch(fileName, path, 1.0);
+    fileCache->flush();
+    return osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+}
+
+}
+
+void runFileCacheBenchmark(const std::string& directory, const std::string& url)
+{
+    std::cout<<"******   FileCache benchmark   ******"<<std::endl;
+
+    std::string databaseDirectory = directory + "/database";
+    std::string cacheDirectory = directory + "/cache";
+    osgDB::makeDirectory(databaseDirectory);
+    removeDirectoryContents(cacheDirectory);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    osg::ref_ptr<osg::Node> root = createTile(0, 0, 0);
+    unsigned int numFiles = osgDB::writeNodeFile(*root, databaseDirectory+"/root.osgb") ? 1 : 0;
+    numFiles += writeChildTiles(databaseDirectory, 0, 0, 0);
+    std::cout<<"  wrote "<<numFiles<<" tile files to "<<databaseDirectory<<" in "<<osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick())<<"ms"<<std::endl;
+
+    // a flight low across the terrain, from one corner to the other.
+    osg::ref_ptr<osg::AnimationPath> path = new osg::AnimationPath;
+    for(unsigned int i=0; i<=10; ++i)
+    {
+        double ratio = double(i)/10.0;
+        path->insert(ratio*100.0, osg::AnimationPath::ControlPoint(osg::Vec3d(ratio*terrainSize, ratio*terrainSize*0.8, 200.0)));
+    }
+
+    std::string rootFileName = url + "/database/root.osgb";
+
+    // prefetch into the empty cache, fetching the tiles from the server.
+    unsigned long long maximumSize = 1024*1024*1024;
+    osg::ref_ptr<osgDB::FileCache> fileCache = new osgDB::FileCache(cacheDirectory);
+    fileCache->setMaximumSize(maximumSize);
+    fileCache->setWriteBehind(true);
+
+    double coldTime = prefetch(fileCache.get(), rootFileName, path.get());
+    unsigned int numPrefetchedFiles = fileCache->getNumPrefetchedFiles();
+    unsigned long long prefetchedSize = fileCache->getSize();
+    std::cout<<"  cold prefetch : "<<numPrefetchedFiles<<" files, "<<prefetchedSize<<" bytes fetched into the cache in "<<coldTime<<"ms"<<std::endl;
+    fileCache = 0;
+
+    // prefetch again with a new cache loading the index written by the first, reading every tile from the cache.
+    fileCache = new osgDB::FileCache(cacheDirectory);
+    fileCache->setMaximumSize(maximumSize);
+
+    bool indexLoaded = fileCache->getNumFiles()==numPrefetchedFiles && fileCache->getSize()==prefetchedSize;
+    double warmTime = prefetch(fileCache.get(), rootFileName, path.get());
+    std::cout<<"  warm prefetch : "<<fileCache->getNumPrefetchedFiles()<<" files fetched, "<<warmTime<<"ms, index "<<(indexLoaded ? "reloaded" : "NOT reloaded")<<std::endl;
+    bool warmCorrect = indexLoaded && fileCache->getNumPrefetchedFiles()==0;
+
+    // halve the maximum size, evicting the least recently used files, then prefetch again.
+    maximumSize = prefetchedSize/2;
+    fileCache->setMaximumSize(maximumSize);
+    bool evicted = fileCache->getSize()<=maximumSize && fileCache->getNumFiles()<numPrefetchedFiles;
+    std::cout<<"  maximum size "<<maximumSize<<" bytes : "<<fileCache->getNumFiles()<<" files, "<<fileCache->getSize()<<" bytes kept"<<std::endl;
+
+    double budgetTime = prefetch(fileCache.get(), rootFileName, path.get());
+    bool withinBudget = fileCache->getSize()<=maximumSize;
+    std::cout<<"  prefetch within the maximum size : "<<fileCache->getNumPrefetchedFiles()<<" files fetched again, "
+             <<fileCache->getSize()<<" bytes kept, "<<budgetTime<<"ms"<<std::endl;
+
+    // corrupt the most recently read tile, which should then be detected as it's read and removed from the cache.
+    std::string tileFileName = url + "/database/" + createTileFileName(numLevels-1, 0, 0);
+    bool corruptionDetected = true;
+    if (fileCache->existsInCache(tileFileName))
+    {
+        {
+            osgDB::ofstream fout(fileCache->createCacheFileName(tileFileName).c_str(), std::ios::out | std::ios::binary);
+            fout<<"corrupted";
+        }
+        unsigned int numFilesBefore = fileCache->getNumFiles();
+        corruptionDetected = !fileCache->readNode(tileFileName, 0).validNode() &&
+                             fileCache->getNumFiles()==numFilesBefore-1 &&
+                             !fileCache->existsInCache(tileFileName);
+        std::cout<<"  corrupted file "<<(corruptionDetected ? "detected and removed" : "NOT detected")<<std::endl;
+    }
+    fileCache = 0;
+
+    // write a tile to the cache repeatedly, as the DatabasePager does, with and without write behind.
+    osg::ref_ptr<osg::Node> tile = createTileGeometry(numLevels-1, 0, 0);
+    const unsigned int numWrites = 200;
+    double writeTimes[2];
+    bool writeBehindCorrect = true;
+    for(unsigned int writeBehind=0; writeBehind<2; ++writeBehind)
+    {
+        removeDirectoryContents(cacheDirectory);
+
+        fileCache = new osgDB::FileCache(cacheDirectory);
+        fileCache->setMaximumSize(1024*1024*1024);
+        fileCache->setWriteBehind(writeBehind!=0);
+
+        start = osg::Timer::instance()->tick();
+        for(unsigned int i=0; i<numWrites; ++i)
+        {
+            std::ostringstream fileName;
+            fileName<<url<<"/written/"<<i<<".osgb";
+            fileCache->writeNode(*tile, fileName.str(), 0);
+        }
+        writeTimes[writeBehind] = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+        // the files are readable whether or not they've been written to disk yet.
+        writeBehindCorrect = writeBehindCorrect && fileCache->readNode(url+"/written/0.osgb", 0).validNode();
+
+        fileCache->flush();
+        writeBehindCorrect = writeBehindCorrect && fileCache->getNumFiles()==numWrites;
+        fileCache = 0;
+    }
+    std::cout<<"  writes : synchronous "<<writeTimes[0]/double(numWrites)<<"ms, write behind "<<writeTimes[1]/double(numWrites)<<"ms per file"<<std::endl;
+
+    bool passed = numPrefetchedFiles>0 && warmCorrect && evicted && withinBudget && corruptionDetected && writeBehindCorrect;
+    std::cout<<"  "<<(passed ? "all checks passed" : "CHECKS FAILED")<<std::endl;
+}
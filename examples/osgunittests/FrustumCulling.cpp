@@ -0,0 +1,137 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Microbenchmark comparing Polytope::contains() one bounding volume at a time against the batch versions
+// used by CullVisitor::cullChildren(), checking that both give the same results.
+
+#include <osg/Polytope>
+#include <osg/Matrix>
+#include <osg/Timer>
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+namespace
+{
+
+float random(float min, float max) { return min + (max-min)*float(rand())/float(RAND_MAX); }
+
+osg::Polytope createFrustum()
+{
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(osg::Matrix::lookAt(osg::Vec3(0.0f,0.0f,0.0f), osg::Vec3(0.0f,1.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f)) *
+                                      osg::Matrix::perspective(45.0, 1.5, 1.0, 1000.0));
+    return frustum;
+}
+
+void reportRate(const std::string& title, unsigned int numVolumes, double time)
+{
+    std::cout<<"  "<<title<<" : "<<time*1000.0<<"ms, "<<double(numVolumes)/time<<" per second"<<std::endl;
+}
+
+}
+
+void runFrustumCullingBenchmark(unsigned int numVolumes, unsigned int numIterations)
+{
+    std::cout<<"******   Frustum culling benchmark   ******"<<std::endl;
+
+    osg::Polytope frustum = createFrustum();
+
+    // scatter the bounding volumes around the frustum so a mixture are culled, contained and intersecting.
+    std::vector<osg::BoundingSphere> spheres(numVolumes);
+    std::vector<osg::BoundingBox> boxes(numVolumes);
+    for(unsigned int i=0; i<numVolumes; ++i)
+    {
+        osg::Vec3 center(random(-800.0f, 800.0f), random(-100.0f, 1100.0f), random(-600.0f, 600.0f));
+        float radius = random(0.1f, 50.0f);
+        spheres[i].set(center, radius);
+        boxes[i].set(center-osg::Vec3(radius,radius,radius), center+osg::Vec3(radius,radius,radius));
+    }
+
+    std::vector<char> scalarContained(numVolumes);
+    std::vector<osg::Polytope::ClippingMask> scalarMasks(numVolumes);
+    bool* contained = new bool[numVolumes];
+    std::vector<osg::Polytope::ClippingMask> masks(numVolumes);
+
+    osg::Timer* timer = osg::Timer::instance();
+
+    // spheres
+    double scalarTime = 0.0, batchTime = 0.0;
+    unsigned int numContained = 0;
+    for(unsigned int iteration=0; iteration<numIterations; ++iteration)
+    {
+        osg::Timer_t startTick = timer->tick();
+        for(unsigned int i=0; i<numVolumes; ++i)
+        {
+            scalarContained[i] = frustum.contains(spheres[i]);
+            scalarMasks[i] = frustum.getResultMask();
+        }
+        osg::Timer_t midTick = timer->tick();
+        numContained = frustum.contains(&spheres.front(), numVolumes, contained, &masks.front());
+        osg::Timer_t endTick = timer->tick();
+
+        scalarTime += timer->delta_s(startTick, midTick);
+        batchTime += timer->delta_s(midTick, endTick);
+    }
+
+    unsigned int numMismatches = 0;
+    for(unsigned int i=0; i<numVolumes; ++i)
+    {
+        if (bool(scalarContained[i])!=contained[i] || (contained[i] && scalarMasks[i]!=masks[i])) ++numMismatches;
+    }
+
+    std::cout<<"Bounding spheres, "<<numVolumes<<" tested, "<<numContained<<" not culled, "<<numMismatches<<" mismatches"<<std::endl;
+    reportRate("Polytope::contains(const BoundingSphere&)", numVolumes*numIterations, scalarTime);
+    reportRate("Polytope::contains(const BoundingSphere*, ...)", numVolumes*numIterations, batchTime);
+
+    // boxes
+    scalarTime = 0.0; batchTime = 0.0;
+    for(unsigned int iteration=0; iteration<numIterations; ++iteration)
+    {
+        osg::Timer_t startTick = timer->tick();
+        for(unsigned int i=0; i<numVolumes; ++i)
+        {
+            scalarContained[i] = frustum.contains(boxes[i]);
+            scalarMasks[i] = frustum.getResultMask();
+        }
+        osg::Timer_t midTick = timer->tick();
+        numContained = frustum.contains(&boxes.front(), numVolumes, contained, &masks.front());
+        osg::Timer_t endTick = timer->tick();
+
+        scalarTime += timer->delta_s(startTick, midTick);
+        batchTime += timer->delta_s(midTick, endTick);
+    }
+
+    numMismatches = 0;
+    for(unsigned int i=0; i<numVolumes; ++i)
+    {
+        if (bool(scalarContained[i])!=contained[i] || (contained[i] && scalarMasks[i]!=masks[i])) ++numMismatches;
+    }
+
+    std::cout<<"Bounding boxes, "<<numVolumes<<" tested, "<<numContained<<" not culled, "<<numMismatches<<" mismatches"<<std::endl;
+    reportRate("Polytope::contains(const BoundingBox&)", numVolumes*numIterations, scalarTime);
+    reportRate("Polytope::contains(const BoundingBox*, ...)", numVolumes*numIterations, batchTime);
+
+    delete [] contained;
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,192 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Builds the KdTree of a terrain serially and in parallel, then intersects line of sight segments with it one at a
+// time and batched in an IntersectorGroup, reporting the times and checking that both find the same intersections,
+// and that they match intersecting the terrain without its KdTree.
+
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+#include <osg/KdTree>
+#include <osg/Geode>
+#include <osg/Timer>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+
+osg::Geometry* createTerrain(unsigned int numTriangles)
+{
+    unsigned int numColumns = static_cast<unsigned int>(sqrt(double(numTriangles)/2.0));
+    if (numColumns<2) numColumns = 2;
+    unsigned int rowSize = numColumns+1;
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for(unsigned int r=0; r<=numColumns; ++r)
+    {
+        for(unsigned int c=0; c<=numColumns; ++c)
+        {
+            double x = 1000.0*double(c)/double(numColumns), y = 1000.0*double(r)/double(numColumns);
+            double z = 40.0*sin(x*0.01)*cos(y*0.013) + 5.0*sin(x*0.11+y*0.07);
+            vertices->push_back(osg::Vec3(x, y, z));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r<numColumns; ++r)
+    {
+        for(unsigned int c=0; c<numColumns; ++c)
+        {
+            unsigned int i00 = r*rowSize+c, i01 = i00+1, i10 = i00+rowSize, i11 = i10+1;
+            elements->push_back(i00); elements->push_back(i01); elements->push_back(i11);
+            elements->push_back(i00); elements->push_back(i11); elements->push_back(i10);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(elements.get());
+    return geometry.release();
+}
+
+double random(double min, double max) { return min + (max-min)*double(rand())/double(RAND_MAX); }
+
+osg::Geometry* buildKdTree(osg::Geode* geode, unsigned int numThreads)
+{
+    osg::Geometry* geometry = geode->getDrawable(0)->asGeometry();
+    geometry->setShape(0);
+
+    osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+    builder->_buildOptions._numThreads = numThreads;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    geode->accept(*builder);
+    double time = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    osg::KdTree* kdTree = dynamic_cast<osg::KdTree*>(geometry->getShape());
+    unsigned int numLeaves = 0, numLeafPrimitives = 0;
+    for(osg::KdTree::KdNodeList::const_iterator itr = kdTree->getNodes().begin(); itr != kdTree->getNodes().end(); ++itr)
+    {
+        if (itr->first<0) { ++numLeaves; numLeafPrimitives += itr->second; }
+    }
+
+    std::cout<<"  Build with "<<numThreads<<" additional threads : "<<time<<"ms, "<<kdTree->getNodes().size()<<" nodes, "
+             <<double(numLeafPrimitives)/double(numLeaves)<<" primitives per leaf"<<std::endl;
+    return geometry;
+}
+
+typedef std::vector< osg::ref_ptr<osgUtil::LineSegmentIntersector> > LineSegmentIntersectors;
+
+void createSegments(unsigned int numSegments, LineSegmentIntersectors& intersectors)
+{
+    srand(1);
+    intersectors.clear();
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        // lines of sight between points above the terrain, about a third of which are blocked.
+        osg::Vec3d start(random(0.0, 1000.0), random(0.0, 1000.0), random(20.0, 60.0));
+        osg::Vec3d end(random(0.0, 1000.0), random(0.0, 1000.0), random(20.0, 60.0));
+        intersectors.push_back(new osgUtil::LineSegmentIntersector(start, end));
+    }
+}
+
+bool sameIntersections(osgUtil::LineSegmentIntersector& lhs, osgUtil::LineSegmentIntersector& rhs)
+{
+    osgUtil::LineSegmentIntersector::Intersections& l = lhs.getIntersections();
+    osgUtil::LineSegmentIntersector::Intersections& r = rhs.getIntersections();
+    if (l.size()!=r.size()) return false;
+
+    for(osgUtil::LineSegmentIntersector::Intersections::iterator litr = l.begin(), ritr = r.begin(); litr != l.end(); ++litr, ++ritr)
+    {
+        // the single segment tests compute part of the intersection in float.
+        if (fabs(litr->ratio-ritr->ratio)>1e-6 || litr->primitiveIndex!=ritr->primitiveIndex) return false;
+    }
+    return true;
+}
+
+}
+
+void runKdTreeBenchmark(unsigned int numTriangles)
+{
+    std::cout<<"******   KdTree build and batched intersection benchmark   ******"<<std::endl;
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(createTerrain(numTriangles));
+    std::cout<<"  "<<geode->getDrawable(0)->asGeometry()->getPrimitiveSet(0)->getNumIndices()/3<<" triangles"<<std::endl;
+
+    buildKdTree(geode.get(), 0);
+    unsigned int numThreads = OpenThreads::GetNumberOfProcessors()>1 ? OpenThreads::GetNumberOfProcessors()-1 : 1;
+    buildKdTree(geode.get(), numThreads);
+
+    const unsigned int numSegments = 4096;
+    LineSegmentIntersectors single, batched, reference;
+    createSegments(numSegments, single);
+    createSegments(numSegments, batched);
+    createSegments(numSegments, reference);
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(LineSegmentIntersectors::iterator itr = single.begin(); itr != single.end(); ++itr)
+    {
+        osgUtil::IntersectionVisitor iv(itr->get());
+        geode->accept(iv);
+    }
+    double singleTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    osg::ref_ptr<osgUtil::IntersectorGroup> group = new osgUtil::IntersectorGroup;
+    for(LineSegmentIntersectors::iterator itr = batched.begin(); itr != batched.end(); ++itr) group->addIntersector(itr->get());
+
+    startTick = osg::Timer::instance()->tick();
+    {
+        osgUtil::IntersectionVisitor iv(group.get());
+        geode->accept(iv);
+    }
+    double batchedTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    unsigned int numBlocked = 0, numDifferent = 0;
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        if (single[i]->containsIntersections()) ++numBlocked;
+        if (!sameIntersections(*single[i], *batched[i])) ++numDifferent;
+    }
+
+    // check a subset of the segments against the terrain without its KdTree.
+    unsigned int numReference = 256, numReferenceDifferent = 0;
+    for(unsigned int i=0; i<numReference; ++i)
+    {
+        osgUtil::IntersectionVisitor iv(reference[i].get());
+        iv.setUseKdTreeWhenAvailable(false);
+        geode->accept(iv);
+        if (!sameIntersections(*reference[i], *batched[i])) ++numReferenceDifferent;
+    }
+
+    std::cout<<"  "<<numSegments<<" segments, "<<numBlocked<<" blocked"<<std::endl;
+    std::cout<<"  One at a time : "<<singleTime<<"ms"<<std::endl;
+    std::cout<<"  Batched       : "<<batchedTime<<"ms"<<std::endl;
+    std::cout<<"  Intersections "<<(numDifferent==0 ? "match" : "DIFFER")<<" ("<<numDifferent<<" segments differ), "
+             <<(numReferenceDifferent==0 ? "match" : "DIFFER")<<" without the KdTree ("<<numReferenceDifferent<<" of "<<numReference<<" differ)"<<std::endl;
+
+    std::cout<<std::endl;
+}
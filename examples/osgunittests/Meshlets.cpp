@@ -0,0 +1,164 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Partitions a finely tessellated sphere into meshlets with osgUtil::MeshletVisitor, then culls the meshlets from
+// several viewpoints, reporting the triangles left to draw and checking that no visible triangle was culled.
+
+#include <osgUtil/MeshOptimizers>
+#include <osg/Geode>
+#include <osg/Timer>
+
+#include <iostream>
+#include <math.h>
+
+namespace
+{
+
+osg::Geometry* createSphere(unsigned int numTriangles)
+{
+    unsigned int numSegments = static_cast<unsigned int>(sqrt(double(numTriangles)/2.0));
+    if (numSegments<4) numSegments = 4;
+    unsigned int numRows = numSegments/2;
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for(unsigned int r=0; r<=numRows; ++r)
+    {
+        double latitude = osg::PI*double(r)/double(numRows) - osg::PI_2;
+        for(unsigned int s=0; s<=numSegments; ++s)
+        {
+            double longitude = 2.0*osg::PI*double(s)/double(numSegments);
+            vertices->push_back(osg::Vec3(cos(latitude)*cos(longitude), cos(latitude)*sin(longitude), sin(latitude)));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    unsigned int rowSize = numSegments+1;
+    for(unsigned int r=0; r<numRows; ++r)
+    {
+        for(unsigned int s=0; s<numSegments; ++s)
+        {
+            unsigned int i00 = r*rowSize+s, i01 = i00+1, i10 = i00+rowSize, i11 = i10+1;
+            elements->push_back(i00); elements->push_back(i01); elements->push_back(i11);
+            elements->push_back(i00); elements->push_back(i11); elements->push_back(i10);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->setNormalArray(vertices.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(elements.get());
+    return geometry.release();
+}
+
+// return true if the triangle faces the eye and has a vertex inside the clip volume.
+bool isTriangleVisible(const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, const osg::Matrix& mvp, const osg::Vec3& eye, const osg::Vec3* viewDirection)
+{
+    osg::Vec3 normal = (v1-v0)^(v2-v0);
+    if (normal*(viewDirection ? *viewDirection : v0-eye) >= 0.0f) return false;
+
+    const osg::Vec3* vertices[3] = { &v0, &v1, &v2 };
+    for(unsigned int i=0; i<3; ++i)
+    {
+        osg::Vec4 clip = osg::Vec4(*vertices[i], 1.0f)*mvp;
+        if (fabs(clip.x())<=clip.w() && fabs(clip.y())<=clip.w() && fabs(clip.z())<=clip.w()) return true;
+    }
+    return false;
+}
+
+void runView(const osgUtil::MeshletGeometry& geometry, const std::string& title, const osg::Matrix& view, const osg::Matrix& projection)
+{
+    const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+    const osg::DrawElementsUInt& elements = *geometry.getMeshletElements();
+
+    osgUtil::MeshletGeometry::RangeList ranges;
+    unsigned int numIterations = 100;
+    unsigned int numVisibleMeshlets = 0;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        numVisibleMeshlets = geometry.cull(view, projection, true, ranges);
+    }
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    std::vector<bool> drawn(elements.size()/3, false);
+    unsigned int numDrawnTriangles = 0;
+    for(osgUtil::MeshletGeometry::RangeList::const_iterator itr = ranges.begin(); itr != ranges.end(); ++itr)
+    {
+        for(unsigned int t=itr->first/3; t<(itr->first+itr->second)/3; ++t) drawn[t] = true;
+        numDrawnTriangles += itr->second/3;
+    }
+
+    osg::Matrix mvp = view*projection;
+    osg::Matrix inverseView = osg::Matrix::inverse(view);
+    osg::Vec3 eye = inverseView.getTrans();
+    osg::Vec3 viewDirection = osg::Matrix::transform3x3(osg::Vec3(0.0f,0.0f,-1.0f), inverseView);
+    bool orthographic = projection(3,3)==1.0;
+    unsigned int numVisibleTriangles = 0, numMissing = 0;
+    for(unsigned int t=0; t<drawn.size(); ++t)
+    {
+        if (isTriangleVisible((*vertices)[elements[t*3]], (*vertices)[elements[t*3+1]], (*vertices)[elements[t*3+2]], mvp, eye, orthographic ? &viewDirection : 0))
+        {
+            ++numVisibleTriangles;
+            if (!drawn[t]) ++numMissing;
+        }
+    }
+
+    std::cout<<"  "<<title<<" : "<<numVisibleMeshlets<<" of "<<geometry.getMeshlets().size()<<" meshlets in "<<ranges.size()<<" draws, "
+             <<numDrawnTriangles<<" of "<<drawn.size()<<" triangles drawn, "<<numVisibleTriangles<<" visible, "
+             <<numMissing<<" visible culled, "<<osg::Timer::instance()->delta_u(startTick, endTick)/double(numIterations)<<"us per cull"<<std::endl;
+}
+
+}
+
+void runMeshletBenchmark(unsigned int numTriangles)
+{
+    std::cout<<"******   Meshlet culling benchmark   ******"<<std::endl;
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(createSphere(numTriangles));
+
+    osgUtil::MeshletVisitor visitor;
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    geode->accept(visitor);
+    visitor.buildMeshlets();
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    const osgUtil::MeshletGeometry* geometry = dynamic_cast<const osgUtil::MeshletGeometry*>(geode->getDrawable(0));
+    if (!geometry)
+    {
+        std::cout<<"  Geometry not converted to MeshletGeometry"<<std::endl<<std::endl;
+        return;
+    }
+
+    unsigned int numIndices = geometry->getMeshletElements()->size();
+    std::cout<<"  Built "<<visitor.getNumMeshlets()<<" meshlets from "<<numIndices/3<<" triangles in "<<osg::Timer::instance()->delta_m(startTick, endTick)<<"ms, "
+             <<double(numIndices/3)/double(visitor.getNumMeshlets())<<" triangles per meshlet"<<std::endl;
+
+    osg::Matrix projection = osg::Matrix::perspective(30.0, 1.0, 0.1, 100.0);
+    runView(*geometry, "Whole sphere  ", osg::Matrix::lookAt(osg::Vec3(0.0f,-5.0f,0.0f), osg::Vec3(0.0f,0.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f)), projection);
+    runView(*geometry, "Close up      ", osg::Matrix::lookAt(osg::Vec3(0.0f,-1.3f,0.0f), osg::Vec3(0.0f,0.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f)), projection);
+    runView(*geometry, "Looking away  ", osg::Matrix::lookAt(osg::Vec3(0.0f,-5.0f,0.0f), osg::Vec3(0.0f,-10.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f)), projection);
+    runView(*geometry, "Orthographic  ", osg::Matrix::lookAt(osg::Vec3(0.0f,-5.0f,0.0f), osg::Vec3(0.0f,0.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f)),
+            osg::Matrix::ortho(-0.5, 0.5, -0.5, 0.5, 0.1, 100.0));
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,192 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Intersects line of sight segments with a terrain divided into transformed tiles, each with a KdTree, using an
+// IntersectorGroup of LineSegmentIntersectors, a MultiLineSegmentIntersector in a single traversal, and a
+// MultiLineSegmentIntersector traversing batches of segments in parallel, reporting the times and checking that all
+// three find the same intersections.
+
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/MultiLineSegmentIntersector>
+#include <osg/KdTree>
+#include <osg/Geode>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+
+const unsigned int numTilesPerSide = 16;
+const double tileSize = 1000.0/double(numTilesPerSide);
+
+double terrainHeight(double x, double y) { return 40.0*sin(x*0.01)*cos(y*0.013) + 5.0*sin(x*0.11+y*0.07); }
+
+// a tile of the terrain with its origin at the corner of the tile, placed by a MatrixTransform.
+osg::Node* createTile(unsigned int tileColumn, unsigned int tileRow, unsigned int numColumns)
+{
+    unsigned int rowSize = numColumns+1;
+    double originX = tileSize*double(tileColumn), originY = tileSize*double(tileRow);
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    for(unsigned int r=0; r<=numColumns; ++r)
+    {
+        for(unsigned int c=0; c<=numColumns; ++c)
+        {
+            double x = tileSize*double(c)/double(numColumns), y = tileSize*double(r)/double(numColumns);
+            vertices->push_back(osg::Vec3(x, y, terrainHeight(originX+x, originY+y)));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for(unsigned int r=0; r<numColumns; ++r)
+    {
+        for(unsigned int c=0; c<numColumns; ++c)
+        {
+            unsigned int i00 = r*rowSize+c, i01 = i00+1, i10 = i00+rowSize, i11 = i10+1;
+            elements->push_back(i00); elements->push_back(i01); elements->push_back(i11);
+            elements->push_back(i00); elements->push_back(i11); elements->push_back(i10);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(elements.get());
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+
+    osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrix::translate(originX, originY, 0.0));
+    transform->addChild(geode.get());
+    return transform.release();
+}
+
+osg::Node* createTerrain(unsigned int numTriangles)
+{
+    unsigned int numColumns = static_cast<unsigned int>(sqrt(double(numTriangles)/2.0)/double(numTilesPerSide));
+    if (numColumns<2) numColumns = 2;
+
+    osg::ref_ptr<osg::Group> group = new osg::Group;
+    for(unsigned int r=0; r<numTilesPerSide; ++r)
+    {
+        for(unsigned int c=0; c<numTilesPerSide; ++c)
+        {
+            group->addChild(createTile(c, r, numColumns));
+        }
+    }
+
+    osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+    group->accept(*builder);
+
+    std::cout<<"  "<<numTilesPerSide*numTilesPerSide<<" tiles of "<<2*numColumns*numColumns<<" triangles"<<std::endl;
+    return group.release();
+}
+
+double random(double min, double max) { return min + (max-min)*double(rand())/double(RAND_MAX); }
+
+typedef std::vector< osg::ref_ptr<osgUtil::LineSegmentIntersector> > LineSegmentIntersectors;
+
+bool sameIntersections(const osgUtil::LineSegmentIntersector::Intersections& l, const osgUtil::LineSegmentIntersector::Intersections& r)
+{
+    if (l.size()!=r.size()) return false;
+
+    for(osgUtil::LineSegmentIntersector::Intersections::const_iterator litr = l.begin(), ritr = r.begin(); litr != l.end(); ++litr, ++ritr)
+    {
+        // the single segment tests compute part of the intersection in float.
+        if (fabs(litr->ratio-ritr->ratio)>1e-6 || litr->primitiveIndex!=ritr->primitiveIndex) return false;
+    }
+    return true;
+}
+
+}
+
+void runMultiLineSegmentBenchmark(unsigned int numTriangles)
+{
+    std::cout<<"******   MultiLineSegmentIntersector benchmark   ******"<<std::endl;
+
+    osg::ref_ptr<osg::Node> terrain = createTerrain(numTriangles);
+
+    const unsigned int numSegments = 4096;
+    LineSegmentIntersectors grouped;
+    osg::ref_ptr<osgUtil::MultiLineSegmentIntersector> single = new osgUtil::MultiLineSegmentIntersector;
+    osg::ref_ptr<osgUtil::MultiLineSegmentIntersector> parallel = new osgUtil::MultiLineSegmentIntersector;
+
+    srand(1);
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        // short lines of sight between points above the terrain, crossing a few tiles.
+        osg::Vec3d start(random(0.0, 1000.0), random(0.0, 1000.0), random(20.0, 60.0));
+        osg::Vec3d end(start.x()+random(-150.0, 150.0), start.y()+random(-150.0, 150.0), random(20.0, 60.0));
+        grouped.push_back(new osgUtil::LineSegmentIntersector(start, end));
+        single->addSegment(start, end);
+        parallel->addSegment(start, end);
+    }
+
+    osg::ref_ptr<osgUtil::IntersectorGroup> group = new osgUtil::IntersectorGroup;
+    for(LineSegmentIntersectors::iterator itr = grouped.begin(); itr != grouped.end(); ++itr) group->addIntersector(itr->get());
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    {
+        osgUtil::IntersectionVisitor iv(group.get());
+        terrain->accept(iv);
+    }
+    double groupTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    startTick = osg::Timer::instance()->tick();
+    {
+        osgUtil::IntersectionVisitor iv(single.get());
+        terrain->accept(iv);
+    }
+    double singleTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    unsigned int numThreads = OpenThreads::GetNumberOfProcessors()>1 ? OpenThreads::GetNumberOfProcessors()-1 : 1;
+    parallel->setNumThreads(numThreads);
+
+    startTick = osg::Timer::instance()->tick();
+    {
+        osgUtil::IntersectionVisitor iv;
+        parallel->computeIntersections(*terrain, iv);
+    }
+    double parallelTime = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+
+    unsigned int numBlocked = 0, numSingleDifferent = 0, numParallelDifferent = 0;
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        if (grouped[i]->containsIntersections()) ++numBlocked;
+        if (!sameIntersections(grouped[i]->getIntersections(), single->getIntersections(i))) ++numSingleDifferent;
+        if (!sameIntersections(grouped[i]->getIntersections(), parallel->getIntersections(i))) ++numParallelDifferent;
+    }
+
+    std::cout<<"  "<<numSegments<<" segments, "<<numBlocked<<" blocked"<<std::endl;
+    std::cout<<"  IntersectorGroup                  : "<<groupTime<<"ms"<<std::endl;
+    std::cout<<"  MultiLineSegmentIntersector       : "<<singleTime<<"ms"<<std::endl;
+    std::cout<<"  With "<<numThreads<<" additional threads   : "<<parallelTime<<"ms"<<std::endl;
+    std::cout<<"  Intersections "<<(numSingleDifferent==0 ? "match" : "DIFFER")<<" ("<<numSingleDifferent<<" segments differ), "
+             <<(numParallelDifferent==0 ? "match" : "DIFFER")<<" in parallel ("<<numParallelDifferent<<" segments differ)"<<std::endl;
+
+    std::cout<<std::endl;
+}
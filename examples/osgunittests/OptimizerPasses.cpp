@@ -0,0 +1,165 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Runs the mesh optimizing passes of osgUtil::Optimizer over a scene of unindexed grids, once serially and once with
+// additional threads, checking that both produce the same triangles and printing the report of each pass.
+
+#include <osgUtil/Optimizer>
+#include <osg/Group>
+#include <osg/Geometry>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <stdlib.h>
+
+namespace
+{
+
+osg::Geometry* createGrid(unsigned int i)
+{
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+
+    // unindexed triangles, as produced by many CAD exporters, so that INDEX_MESH has duplicates to remove.
+    unsigned int size = 8 + rand()%24;
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    osg::Vec3Array* normals = new osg::Vec3Array;
+    for(unsigned int r=0; r<size; ++r)
+    {
+        for(unsigned int c=0; c<size; ++c)
+        {
+            float x = static_cast<float>(c), y = static_cast<float>(r), z = static_cast<float>(i);
+            osg::Vec3 v00(x, y, z);
+            osg::Vec3 v10(x+1.0f, y, z);
+            osg::Vec3 v01(x, y+1.0f, z);
+            osg::Vec3 v11(x+1.0f, y+1.0f, z);
+            vertices->push_back(v00); vertices->push_back(v10); vertices->push_back(v11);
+            vertices->push_back(v00); vertices->push_back(v11); vertices->push_back(v01);
+        }
+    }
+    normals->resize(vertices->size(), osg::Vec3(0.0f, 0.0f, 1.0f));
+
+    geometry->setVertexArray(vertices);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_TRIANGLES, 0, vertices->size()));
+
+    return geometry.release();
+}
+
+osg::Node* createScene(unsigned int numGeometries)
+{
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    osg::Group* group = 0;
+    for(unsigned int i=0; i<numGeometries; ++i)
+    {
+        if (i%16==0)
+        {
+            group = new osg::Group;
+            root->addChild(group);
+        }
+        group->addChild(createGrid(i));
+    }
+    return root.release();
+}
+
+// sums the vertices drawn by the triangles of the scene, in drawing order.
+class ChecksumVisitor : public osg::NodeVisitor
+{
+public:
+
+    ChecksumVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _numGeometries(0),
+        _numVertices(0),
+        _numIndices(0),
+        _checksum(0.0) {}
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+        if (!vertices) return;
+
+        ++_numGeometries;
+        _numVertices += vertices->size();
+        for(unsigned int p=0; p<geometry.getNumPrimitiveSets(); ++p)
+        {
+            const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(p);
+            for(unsigned int j=0; j<primitiveSet->getNumIndices(); ++j)
+            {
+                const osg::Vec3& v = (*vertices)[primitiveSet->index(j)];
+                _checksum += double(v.x()) + double(v.y())*3.0 + double(v.z())*7.0 + double(j%11);
+            }
+            _numIndices += primitiveSet->getNumIndices();
+        }
+    }
+
+    unsigned int    _numGeometries;
+    unsigned int    _numVertices;
+    unsigned int    _numIndices;
+    double          _checksum;
+};
+
+void runOptimizer(osg::Node* scene, unsigned int numThreads, const char* label)
+{
+    osgUtil::Optimizer optimizer;
+    optimizer.setNumThreads(numThreads);
+    optimizer.setReportPasses(true);
+    optimizer.optimize(scene, osgUtil::Optimizer::MERGE_GEOMETRY |
+                              osgUtil::Optimizer::INDEX_MESH |
+                              osgUtil::Optimizer::VERTEX_POSTTRANSFORM |
+                              osgUtil::Optimizer::REDUCE_OVERDRAW |
+                              osgUtil::Optimizer::VERTEX_PRETRANSFORM);
+
+    ChecksumVisitor checksum;
+    scene->accept(checksum);
+
+    std::cout<<label<<" with "<<numThreads<<" additional threads: "<<checksum._numGeometries<<" Geometries, "
+             <<checksum._numVertices<<" vertices, "<<checksum._numIndices<<" indices, checksum "<<checksum._checksum<<std::endl;
+    optimizer.writePassReports(std::cout);
+    std::cout<<std::endl;
+}
+
+}
+
+void runOptimizerBenchmark(unsigned int numGeometries)
+{
+    std::cout<<"******   Optimizer passes benchmark   ******"<<std::endl;
+
+    osg::ref_ptr<osg::Node> serialScene = createScene(numGeometries);
+    osg::ref_ptr<osg::Node> parallelScene = static_cast<osg::Node*>(serialScene->clone(osg::CopyOp::DEEP_COPY_ALL));
+
+    int numProcessors = OpenThreads::GetNumberOfProcessors();
+    unsigned int numThreads = numProcessors>1 ? numProcessors-1 : 1;
+
+    runOptimizer(serialScene.get(), 0, "Serial");
+    runOptimizer(parallelScene.get(), numThreads, "Parallel");
+
+    ChecksumVisitor serialChecksum, parallelChecksum;
+    serialScene->accept(serialChecksum);
+    parallelScene->accept(parallelChecksum);
+
+    bool match = serialChecksum._numVertices==parallelChecksum._numVertices &&
+                 serialChecksum._numIndices==parallelChecksum._numIndices &&
+                 serialChecksum._checksum==parallelChecksum._checksum;
+    std::cout<<"Serial and parallel results "<<(match ? "match" : "DIFFER")<<std::endl;
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,178 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Microbenchmark comparing the radix sorts of RenderBin's depth sorting modes against the std::sort
+// of RenderLeaf pointers they replace, checking that both give the same depth ordering, and checking
+// that sorting by Program, then texture, then front to back gives leaves in that order.
+
+#include <osgUtil/RenderBin>
+#include <osg/Geometry>
+#include <osg/Program>
+#include <osg/Texture2D>
+#include <osg/Timer>
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <vector>
+#include <stdlib.h>
+
+namespace
+{
+
+struct BackToFrontSortFunctor
+{
+    bool operator() (const osgUtil::RenderLeaf* lhs,const osgUtil::RenderLeaf* rhs) const
+    {
+        return (rhs->_depth<lhs->_depth);
+    }
+};
+
+// return true if the leaves are grouped by Program, then by texture within each Program, and ordered
+// front to back within each group, with the Program and texture taken from each leaf's StateGraph.
+bool isSortedByProgramTextureThenFrontToBack(const osgUtil::RenderBin::RenderLeafList& leaves)
+{
+    std::set<const osg::StateAttribute*> previousPrograms;
+    std::set<const osg::StateAttribute*> previousTextures;
+    const osg::StateAttribute* currentProgram = 0;
+    const osg::StateAttribute* currentTexture = 0;
+    float currentDepth = 0.0f;
+    for(unsigned int i=0; i<leaves.size(); ++i)
+    {
+        const osg::StateSet* stateset = leaves[i]->_parent->getStateSet();
+        const osg::StateAttribute* program = stateset->getAttribute(osg::StateAttribute::PROGRAM);
+        const osg::StateAttribute* texture = stateset->getTextureAttribute(0, osg::StateAttribute::TEXTURE);
+        float depth = leaves[i]->_depth;
+
+        if (i==0 || program!=currentProgram)
+        {
+            // a Program seen before must not start another group.
+            if (!previousPrograms.insert(program).second) return false;
+            previousTextures.clear();
+            previousTextures.insert(texture);
+        }
+        else if (texture!=currentTexture)
+        {
+            if (!previousTextures.insert(texture).second) return false;
+        }
+        else if (depth<currentDepth)
+        {
+            return false;
+        }
+
+        currentProgram = program;
+        currentTexture = texture;
+        currentDepth = depth;
+    }
+    return true;
+}
+
+void addStateGraphs(osgUtil::RenderBin& bin, std::vector< osg::ref_ptr<osgUtil::StateGraph> >& stateGraphs)
+{
+    bin.reset();
+    for(unsigned int i=0; i<stateGraphs.size(); ++i)
+    {
+        bin.addStateGraph(stateGraphs[i].get());
+    }
+}
+
+}
+
+void runRenderBinSortBenchmark(unsigned int numLeaves, unsigned int numIterations)
+{
+    std::cout<<"******   RenderBin sorting benchmark   ******"<<std::endl;
+
+    // spread the leaves over StateGraphs using a handful of Programs and textures, as in a typical transparent bin.
+    const unsigned int numLeavesPerStateGraph = 16;
+    std::vector< osg::ref_ptr<osg::Program> > programs;
+    std::vector< osg::ref_ptr<osg::Texture2D> > textures;
+    for(unsigned int i=0; i<4; ++i) programs.push_back(new osg::Program);
+    for(unsigned int i=0; i<32; ++i) textures.push_back(new osg::Texture2D);
+
+    // the leaves share a Drawable, which RenderLeaf requires but the sorts don't use.
+    osg::ref_ptr<osg::Geometry> drawable = new osg::Geometry;
+
+    osg::ref_ptr<osgUtil::StateGraph> root = new osgUtil::StateGraph;
+    std::vector< osg::ref_ptr<osg::StateSet> > statesets;
+    std::vector< osg::ref_ptr<osgUtil::StateGraph> > stateGraphs;
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        if (i%numLeavesPerStateGraph==0)
+        {
+            osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+            stateset->setAttribute(programs[rand()%programs.size()].get());
+            stateset->setTextureAttribute(0, textures[rand()%textures.size()].get());
+            statesets.push_back(stateset);
+            stateGraphs.push_back(root->find_or_insert(stateset.get()));
+        }
+        stateGraphs.back()->addLeaf(new osgUtil::RenderLeaf(drawable.get(), 0, 0, 1.0f + 999.0f*float(rand())/float(RAND_MAX), i));
+    }
+
+    osg::ref_ptr<osgUtil::RenderBin> bin = new osgUtil::RenderBin(osgUtil::RenderBin::SORT_BACK_TO_FRONT);
+    osgUtil::RenderBin::RenderLeafList previousLeaves;
+
+    osg::Timer* timer = osg::Timer::instance();
+    double previousTime = 0.0, backToFrontTime = 0.0, programTextureTime = 0.0;
+    unsigned int numMismatches = 0;
+    unsigned int numOutOfOrder = 0;
+    for(unsigned int iteration=0; iteration<numIterations; ++iteration)
+    {
+        // the previous implementation, std::sort of the RenderLeaf pointers.
+        addStateGraphs(*bin, stateGraphs);
+        osg::Timer_t startTick = timer->tick();
+        bin->copyLeavesFromStateGraphListToRenderLeafList();
+        std::sort(bin->getRenderLeafList().begin(), bin->getRenderLeafList().end(), BackToFrontSortFunctor());
+        osg::Timer_t endTick = timer->tick();
+        previousTime += timer->delta_s(startTick, endTick);
+        previousLeaves = bin->getRenderLeafList();
+
+        addStateGraphs(*bin, stateGraphs);
+        startTick = timer->tick();
+        bin->sortBackToFront();
+        endTick = timer->tick();
+        backToFrontTime += timer->delta_s(startTick, endTick);
+
+        const osgUtil::RenderBin::RenderLeafList& leaves = bin->getRenderLeafList();
+        for(unsigned int i=0; i<leaves.size(); ++i)
+        {
+            if (leaves[i]->_depth!=previousLeaves[i]->_depth) ++numMismatches;
+        }
+
+        addStateGraphs(*bin, stateGraphs);
+        startTick = timer->tick();
+        bin->sortByProgramTextureThenFrontToBack();
+        endTick = timer->tick();
+        programTextureTime += timer->delta_s(startTick, endTick);
+
+        if (bin->getRenderLeafList().size()!=numLeaves || !isSortedByProgramTextureThenFrontToBack(bin->getRenderLeafList())) ++numOutOfOrder;
+    }
+
+    std::cout<<"RenderLeaf's, "<<numLeaves<<" sorted, "<<numMismatches<<" mismatches"<<std::endl;
+    std::cout<<"  std::sort back to front : "<<previousTime*1000.0/double(numIterations)<<"ms"<<std::endl;
+    std::cout<<"  RenderBin::sortBackToFront() : "<<backToFrontTime*1000.0/double(numIterations)<<"ms"<<std::endl;
+    std::cout<<"  RenderBin::sortByProgramTextureThenFrontToBack() : "<<programTextureTime*1000.0/double(numIterations)<<"ms"<<std::endl;
+    std::cout<<"  Depth order "<<(numMismatches==0 ? "matches" : "DIFFERS")<<" std::sort, Program, texture then front to back order "
+             <<(numOutOfOrder==0 ? "correct" : "WRONG")<<" ("<<numOutOfOrder<<" of "<<numIterations<<" sorts out of order)"<<std::endl;
+
+    bin->reset();
+    root->clean();
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,179 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Simplifies a bumpy sphere, textured with a seam where the texture coordinates wrap around, with
+// osgUtil::QuadricSimplifier serially and in parallel, and compares it with osgUtil::Simplifier on a smaller sphere,
+// reporting the times, the triangles left and the distance of the triangles from the surface, and checking that no
+// triangle spans the texture seam.
+
+#include <osgUtil/QuadricSimplifier>
+#include <osgUtil/Simplifier>
+#include <osg/Geode>
+#include <osg/Timer>
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+
+namespace
+{
+
+double surfaceRadius(double latitude, double longitude)
+{
+    return 1.0 + 0.05*sin(6.0*longitude)*cos(3.0*latitude);
+}
+
+osg::Geometry* createSphere(unsigned int numTriangles)
+{
+    unsigned int numSegments = static_cast<unsigned int>(sqrt(double(numTriangles)/2.0));
+    if (numSegments<4) numSegments = 4;
+    unsigned int numRows = numSegments/2;
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec2Array> texcoords = new osg::Vec2Array;
+    for(unsigned int r=0; r<=numRows; ++r)
+    {
+        double latitude = osg::PI*double(r)/double(numRows) - osg::PI_2;
+        unsigned int rowStart = vertices->size();
+        for(unsigned int s=0; s<=numSegments; ++s)
+        {
+            double longitude = 2.0*osg::PI*double(s)/double(numSegments);
+            double radius = surfaceRadius(latitude, longitude);
+            if (r==0 || r==numRows) vertices->push_back(osg::Vec3(0.0f, 0.0f, r==0 ? -radius : radius));
+            else if (s==numSegments) vertices->push_back((*vertices)[rowStart]);
+            else vertices->push_back(osg::Vec3(cos(latitude)*cos(longitude), cos(latitude)*sin(longitude), sin(latitude))*radius);
+            texcoords->push_back(osg::Vec2(float(s)/float(numSegments), float(r)/float(numRows)));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    unsigned int rowSize = numSegments+1;
+    for(unsigned int r=0; r<numRows; ++r)
+    {
+        for(unsigned int s=0; s<numSegments; ++s)
+        {
+            unsigned int i00 = r*rowSize+s, i01 = i00+1, i10 = i00+rowSize, i11 = i10+1;
+            if (r>0) { elements->push_back(i00); elements->push_back(i01); elements->push_back(i11); }
+            if (r+1<numRows) { elements->push_back(i00); elements->push_back(i11); elements->push_back(i10); }
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->setTexCoordArray(0, texcoords.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(elements.get());
+    return geometry.release();
+}
+
+unsigned int getNumTriangles(const osg::Geometry& geometry)
+{
+    unsigned int numTriangles = 0;
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (primitiveSet->getMode()==GL_TRIANGLES) numTriangles += primitiveSet->getNumIndices()/3;
+    }
+    return numTriangles;
+}
+
+void report(osg::Geometry& geometry, const std::string& title, double time)
+{
+    const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+    const osg::Vec2Array* texcoords = static_cast<const osg::Vec2Array*>(geometry.getTexCoordArray(0));
+
+    // the distance of the triangle centroids from the surface, and the triangles whose texture coordinates wrap.
+    double sumError = 0.0, maxError = 0.0;
+    unsigned int numTriangles = 0, numAcrossSeam = 0;
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (primitiveSet->getMode()!=GL_TRIANGLES) continue;
+        for(unsigned int j=0; j+2<primitiveSet->getNumIndices(); j+=3)
+        {
+            unsigned int i0 = primitiveSet->index(j), i1 = primitiveSet->index(j+1), i2 = primitiveSet->index(j+2);
+            osg::Vec3d centroid = (osg::Vec3d((*vertices)[i0])+osg::Vec3d((*vertices)[i1])+osg::Vec3d((*vertices)[i2]))/3.0;
+            double length = centroid.length();
+            double latitude = asin(osg::clampBetween(centroid.z()/length, -1.0, 1.0));
+            double longitude = atan2(centroid.y(), centroid.x());
+            double error = fabs(length-surfaceRadius(latitude, longitude));
+            sumError += error;
+            maxError = osg::maximum(maxError, error);
+            ++numTriangles;
+
+            float minU = osg::minimum((*texcoords)[i0].x(), osg::minimum((*texcoords)[i1].x(), (*texcoords)[i2].x()));
+            float maxU = osg::maximum((*texcoords)[i0].x(), osg::maximum((*texcoords)[i1].x(), (*texcoords)[i2].x()));
+            if (maxU-minU>0.5f) ++numAcrossSeam;
+        }
+    }
+
+    std::cout<<"  "<<title<<" : "<<numTriangles<<" triangles, "<<vertices->size()<<" vertices, error mean "
+             <<(numTriangles>0 ? sumError/double(numTriangles) : 0.0)<<" max "<<maxError<<", "
+             <<numAcrossSeam<<" across seam";
+    if (time>0.0) std::cout<<", "<<time<<"ms";
+    std::cout<<std::endl;
+}
+
+void runSimplifier(osg::NodeVisitor& simplifier, unsigned int numTriangles, const std::string& title)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    osg::Geometry* geometry = createSphere(numTriangles);
+    geode->addDrawable(geometry);
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    geode->accept(simplifier);
+    report(*static_cast<osg::Geometry*>(geode->getDrawable(0)), title, osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick()));
+}
+
+}
+
+void runSimplifierBenchmark(unsigned int numTriangles)
+{
+    std::cout<<"******   Simplifier benchmark   ******"<<std::endl;
+
+    osg::ref_ptr<osg::Geometry> original = createSphere(numTriangles);
+    report(*original, "Original                  ", 0.0);
+
+    osgUtil::QuadricSimplifier serial(0.1);
+    runSimplifier(serial, numTriangles, "Quadric 10%               ");
+
+    osgUtil::QuadricSimplifier parallel(0.1);
+    parallel.setNumThreads(3);
+    runSimplifier(parallel, numTriangles, "Quadric 10%, 3 threads    ");
+
+    osgUtil::QuadricSimplifier targetError(0.0, 0.002);
+    runSimplifier(targetError, numTriangles, "Quadric error 0.002       ");
+
+    osgUtil::QuadricSimplifier welded(0.1);
+    welded.setPreserveSeams(false);
+    runSimplifier(welded, numTriangles, "Quadric 10%, seams welded ");
+
+    // osgUtil::Simplifier is much slower, so is compared on a smaller sphere.
+    unsigned int numSmallTriangles = osg::minimum(numTriangles, 20000u);
+    std::cout<<"  Compared on "<<getNumTriangles(*createSphere(numSmallTriangles))<<" triangles"<<std::endl;
+
+    osgUtil::QuadricSimplifier quadric(0.1);
+    runSimplifier(quadric, numSmallTriangles, "Quadric 10%               ");
+
+    osgUtil::Simplifier simplifier(0.1);
+    runSimplifier(simplifier, numSmallTriangles, "Simplifier 10%            ");
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,183 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+// Compares the state changes made drawing a RenderBin sorted with SORT_BY_STATE against SORT_BY_STATE_COST,
+// drawing with osg::State in recording mode so that no graphics context is required, and checks that
+// SORT_BY_STATE_COST keeps all the leaves and groups the StateGraphs by Program and then by texture.
+
+#include <osgUtil/RenderBin>
+#include <osg/Program>
+#include <osg/Texture2D>
+#include <osg/Material>
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <iostream>
+#include <set>
+#include <vector>
+#include <stdlib.h>
+
+namespace
+{
+
+// a scene whose StateSets are all separate objects, though many are equal in content, as is typical of loaded models.
+struct StateSortingScene
+{
+    StateSortingScene(unsigned int numStateGraphs)
+    {
+        // the Programs and textures differ in content as well as identity.
+        for(unsigned int i=0; i<4; ++i)
+        {
+            osg::ref_ptr<osg::Program> program = new osg::Program;
+            program->addShader(new osg::Shader(osg::Shader::VERTEX, "void main() { gl_Position = vec4(" + std::string(1, char('0'+i)) + "); }"));
+            programs.push_back(program);
+        }
+        for(unsigned int i=0; i<16; ++i)
+        {
+            osg::ref_ptr<osg::Texture2D> texture = new osg::Texture2D;
+            texture->setMaxAnisotropy(float(i+1));
+            textures.push_back(texture);
+        }
+
+        drawable = new osg::Geometry;
+        root = new osgUtil::StateGraph;
+        for(unsigned int i=0; i<numStateGraphs; ++i)
+        {
+            osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+            stateset->setAttribute(programs[rand()%programs.size()].get());
+            stateset->setTextureAttributeAndModes(0, textures[rand()%textures.size()].get());
+            stateset->setAttribute(new osg::Material);
+            stateset->addUniform(new osg::Uniform("scale", float(rand()%4)));
+            statesets.push_back(stateset);
+
+            osgUtil::StateGraph* sg = root->find_or_insert(stateset.get());
+            for(unsigned int j=0; j<4; ++j)
+            {
+                sg->addLeaf(new osgUtil::RenderLeaf(drawable.get(), 0, 0, float(j), i*4+j));
+            }
+            stateGraphs.push_back(sg);
+        }
+    }
+
+    std::vector< osg::ref_ptr<osg::Program> >       programs;
+    std::vector< osg::ref_ptr<osg::Texture2D> >     textures;
+    std::vector< osg::ref_ptr<osg::StateSet> >      statesets;
+    osg::ref_ptr<osg::Geometry>                     drawable;
+    osg::ref_ptr<osgUtil::StateGraph>               root;
+    std::vector<osgUtil::StateGraph*>               stateGraphs;
+};
+
+// return the number of leaves in the StateGraphs to be drawn.
+unsigned int getNumLeaves(const osgUtil::RenderBin::StateGraphList& stateGraphs)
+{
+    unsigned int numLeaves = 0;
+    for(unsigned int i=0; i<stateGraphs.size(); ++i)
+    {
+        numLeaves += static_cast<unsigned int>(stateGraphs[i]->_leaves.size());
+    }
+    return numLeaves;
+}
+
+// return true if the StateGraphs with leaves are grouped by Program, then by texture within each Program.
+bool isSortedByProgramThenTexture(const osgUtil::RenderBin::StateGraphList& stateGraphs)
+{
+    std::set<const osg::StateAttribute*> previousPrograms;
+    std::set<const osg::StateAttribute*> previousTextures;
+    const osg::StateAttribute* currentProgram = 0;
+    const osg::StateAttribute* currentTexture = 0;
+    bool first = true;
+    for(unsigned int i=0; i<stateGraphs.size(); ++i)
+    {
+        if (stateGraphs[i]->_leaves.empty()) continue;
+
+        const osg::StateSet* stateset = stateGraphs[i]->getStateSet();
+        const osg::StateAttribute* program = stateset->getAttribute(osg::StateAttribute::PROGRAM);
+        const osg::StateAttribute* texture = stateset->getTextureAttribute(0, osg::StateAttribute::TEXTURE);
+
+        if (first || program!=currentProgram)
+        {
+            // a Program seen before must not start another group.
+            if (!previousPrograms.insert(program).second) return false;
+            previousTextures.clear();
+            previousTextures.insert(texture);
+        }
+        else if (texture!=currentTexture)
+        {
+            if (!previousTextures.insert(texture).second) return false;
+        }
+
+        currentProgram = program;
+        currentTexture = texture;
+        first = false;
+    }
+    return true;
+}
+
+void runStateSort(osgUtil::RenderBin::SortMode sortMode, const std::string& title, unsigned int numStateGraphs)
+{
+    srand(1);
+    StateSortingScene scene(numStateGraphs);
+
+    osg::ref_ptr<osgUtil::RenderBin> bin = new osgUtil::RenderBin(sortMode);
+    for(unsigned int i=0; i<scene.stateGraphs.size(); ++i)
+    {
+        bin->addStateGraph(scene.stateGraphs[i]);
+    }
+
+    osg::Timer* timer = osg::Timer::instance();
+    osg::Timer_t startTick = timer->tick();
+    bin->sort();
+    osg::Timer_t endTick = timer->tick();
+
+    bool allLeaves = getNumLeaves(bin->getStateGraphList())==numStateGraphs*4;
+    bool inOrder = sortMode!=osgUtil::RenderBin::SORT_BY_STATE_COST || isSortedByProgramThenTexture(bin->getStateGraphList());
+
+    osg::ref_ptr<osg::State> state = new osg::State;
+    state->setRecordingMode(true);
+    state->setCheckForGLErrors(osg::State::NEVER_CHECK_GL_ERRORS);
+
+    osg::RenderInfo renderInfo(state.get(), 0);
+    osgUtil::RenderLeaf* previous = 0;
+    bin->draw(renderInfo, previous);
+    if (previous) osgUtil::StateGraph::moveToRootStateGraph(*state, previous->_parent);
+
+    const osg::State::StateChangeStatistics& changes = state->getStateChangeStatistics();
+    std::cout<<"  "<<title<<" : sort "<<timer->delta_m(startTick, endTick)<<"ms, "
+             <<bin->getStateGraphList().size()<<" StateGraphs drawn, "<<bin->getNumMergedStateGraphs()<<" merged, "
+             <<bin->getNumAvoidedStateChanges()<<" state changes avoided"<<std::endl;
+    std::cout<<"    recorded "<<changes.numProgramChanges<<" Program, "<<changes.numTextureChanges<<" texture, "
+             <<changes.numAttributeChanges<<" other attribute and "<<changes.numModeChanges<<" mode changes"<<std::endl;
+    std::cout<<"    "<<(allLeaves ? "all leaves drawn" : "LEAVES MISSING")<<", order "<<(inOrder ? "correct" : "WRONG")<<std::endl;
+
+    bin->reset();
+    scene.root->clean();
+}
+
+}
+
+void runStateSortingBenchmark(unsigned int numStateGraphs)
+{
+    std::cout<<"******   RenderBin state sorting benchmark   ******"<<std::endl;
+
+    runStateSort(osgUtil::RenderBin::SORT_BY_STATE, "SORT_BY_STATE", numStateGraphs);
+    runStateSort(osgUtil::RenderBin::SORT_BY_STATE_COST, "SORT_BY_STATE_COST", numStateGraphs);
+
+    std::cout<<std::endl;
+}
@@ -0,0 +1,158 @@
+/* -*-c++-*-
+*
+*  OpenSceneGraph example, osgunittests.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+
+// Shuffles the triangles of a mesh of overlapping spheres, then optimizes it for the post-transform cache with
+// osgUtil::VertexCacheVisitor and for overdraw with osgUtil::ReduceOverdrawVisitor, reporting the cache miss ratios
+// and overdraw after each step and checking that the triangles drawn are unchanged.
+
+#include <osgUtil/MeshOptimizers>
+#include <osg/Geode>
+#include <osg/Timer>
+
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+
+namespace
+{
+
+osg::Geometry* createSpheres(unsigned int numTriangles)
+{
+    const unsigned int numSpheres = 8;
+    unsigned int numSegments = static_cast<unsigned int>(sqrt(double(numTriangles)/double(numSpheres)/2.0));
+    if (numSegments<4) numSegments = 4;
+    unsigned int numRows = numSegments/2;
+    unsigned int rowSize = numSegments+1;
+
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    std::vector<unsigned int> indices;
+    for(unsigned int i=0; i<numSpheres; ++i)
+    {
+        // spheres overlapping along each axis, so that some of each is hidden from every direction.
+        osg::Vec3 center(float(i%2)*1.2f, float((i/2)%2)*1.2f, float(i/4)*1.2f);
+        unsigned int base = vertices->size();
+        for(unsigned int r=0; r<=numRows; ++r)
+        {
+            double latitude = osg::PI*double(r)/double(numRows) - osg::PI_2;
+            for(unsigned int s=0; s<=numSegments; ++s)
+            {
+                double longitude = 2.0*osg::PI*double(s)/double(numSegments);
+                vertices->push_back(center + osg::Vec3(cos(latitude)*cos(longitude), cos(latitude)*sin(longitude), sin(latitude)));
+            }
+        }
+
+        for(unsigned int r=0; r<numRows; ++r)
+        {
+            for(unsigned int s=0; s<numSegments; ++s)
+            {
+                unsigned int i00 = base+r*rowSize+s, i01 = i00+1, i10 = i00+rowSize, i11 = i10+1;
+                indices.push_back(i00); indices.push_back(i01); indices.push_back(i11);
+                indices.push_back(i00); indices.push_back(i11); indices.push_back(i10);
+            }
+        }
+    }
+
+    // shuffle the triangles, as in meshes whose triangle order has been lost.
+    srand(1);
+    unsigned int numTris = indices.size()/3;
+    for(unsigned int t=numTris-1; t>0; --t)
+    {
+        unsigned int other = static_cast<unsigned int>(rand())%(t+1);
+        for(unsigned int j=0; j<3; ++j) std::swap(indices[t*3+j], indices[other*3+j]);
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, indices.begin(), indices.end()));
+    return geometry.release();
+}
+
+typedef std::vector<osg::Vec3> TriangleList;
+
+// the vertices of the triangles of a Geometry, each rotated to start with its smallest vertex so that the winding is
+// kept, then sorted, to compare the triangles drawn independently of their order.
+void getSortedTriangles(const osg::Geometry& geometry, std::vector<TriangleList>& triangles)
+{
+    const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+    const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(0);
+
+    triangles.clear();
+    for(unsigned int i=0; i+2<primitiveSet->getNumIndices(); i+=3)
+    {
+        TriangleList triangle;
+        for(unsigned int j=0; j<3; ++j) triangle.push_back((*vertices)[primitiveSet->index(i+j)]);
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+}
+
+void report(osg::Geometry& geometry, const std::string& title, double time)
+{
+    osgUtil::VertexCacheMissVisitor fifo16(16);
+    fifo16.setEstimateOverdraw(true);
+    fifo16.doGeometry(geometry);
+
+    osgUtil::VertexCacheMissVisitor fifo32(32);
+    fifo32.doGeometry(geometry);
+
+    std::cout<<"  "<<title<<" : ACMR "<<fifo16.getACMR()<<" (16), "<<fifo32.getACMR()<<" (32), ATVR "<<fifo16.getATVR()
+             <<", overdraw "<<fifo16.getOverdraw();
+    if (time>0.0) std::cout<<", "<<time<<"ms";
+    std::cout<<std::endl;
+}
+
+}
+
+void runVertexCacheBenchmark(unsigned int numTriangles)
+{
+    std::cout<<"******   Vertex cache and overdraw optimization benchmark   ******"<<std::endl;
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    osg::Geometry* geometry = createSpheres(numTriangles);
+    geode->addDrawable(geometry);
+
+    std::cout<<"  "<<geometry->getPrimitiveSet(0)->getNumIndices()/3<<" triangles, "<<geometry->getVertexArray()->getNumElements()<<" vertices"<<std::endl;
+
+    std::vector<TriangleList> originalTriangles;
+    getSortedTriangles(*geometry, originalTriangles);
+
+    report(*geometry, "Shuffled       ", 0.0);
+
+    osgUtil::VertexCacheVisitor vcv;
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    geode->accept(vcv);
+    vcv.optimizeVertices();
+    report(*geometry, "Vertex cache   ", osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick()));
+
+    osgUtil::ReduceOverdrawVisitor rov;
+    startTick = osg::Timer::instance()->tick();
+    geode->accept(rov);
+    rov.reduceOverdraw();
+    report(*geometry, "Reduce overdraw", osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick()));
+
+    std::vector<TriangleList> optimizedTriangles;
+    getSortedTriangles(*geometry, optimizedTriangles);
+    std::cout<<"  Triangles "<<(optimizedTriangles==originalTriangles ? "unchanged" : "DIFFER")<<std::endl;
+
+    std::cout<<std::endl;
+}
@@ -34,6 +34,19 @@
 #include <iostream>
 
 extern void runFileNameUtilsTest(osg::ArgumentParser& arguments);
+extern void runFrustumCullingBenchmark(unsigned int numVolumes, unsigned int numIterations);
+extern void runRenderBinSortBenchmark(unsigned int numLeaves, unsigned int numIterations);
+extern void runStateSortingBenchmark(unsigned int numStateGraphs);
+extern void runDrawIndirectBatchBenchmark(unsigned int numGeometries);
+extern void runOptimizerBenchmark(unsigned int numGeometries);
+extern void runMeshletBenchmark(unsigned int numTriangles);
+extern void runVertexCacheBenchmark(unsigned int numTriangles);
+extern void runSimplifierBenchmark(unsigned int numTriangles);
+extern void runKdTreeBenchmark(unsigned int numTriangles);
+extern void runMultiLineSegmentBenchmark(unsigned int numTriangles);
+extern void runDynamicBVHBenchmark(unsigned int numObjects);
+extern void runFileCacheBenchmark(const std::string& directory, const std::string& url);
+extern void runCurlBenchmark(const std::string& directory, const std::string& url);
 
 void testFrustum(double left,double right,double bottom,double top,double zNear,double zFar)
 {
@@ -572,6 +585,19 @@ int main( int argc, char** argv )
     arguments.getApplicationUsage()->addCommandLineOption("matrix","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("performance","Display qualified tests.");
     arguments.getApplicationUsage()->addCommandLineOption("read-threads <numthreads>","Run multi-thread reading test.");
+    arguments.getApplicationUsage()->addCommandLineOption("frustum-culling <numvolumes>","Run frustum culling benchmark, reporting bounding spheres and boxes tested per second.");
+    arguments.getApplicationUsage()->addCommandLineOption("render-bin-sort <numleaves>","Run RenderBin sorting benchmark, reporting the time to sort a bin of the given size.");
+    arguments.getApplicationUsage()->addCommandLineOption("state-sort <numstategraphs>","Run RenderBin state sorting benchmark, reporting the state changes recorded drawing each sorting mode.");
+    arguments.getApplicationUsage()->addCommandLineOption("draw-indirect-batch <numgeometries>","Run DrawIndirectBatch benchmark, packing small Geometries into batches and reporting the time to build their command buffers.");
+    arguments.getApplicationUsage()->addCommandLineOption("optimizer <numgeometries>","Run Optimizer mesh passes serially and in parallel, checking the results match and reporting the time of each pass.");
+    arguments.getApplicationUsage()->addCommandLineOption("meshlets <numtriangles>","Run meshlet benchmark, partitioning a sphere into meshlets and reporting the triangles left after culling them from several viewpoints.");
+    arguments.getApplicationUsage()->addCommandLineOption("vertex-cache <numtriangles>","Run vertex cache benchmark, optimizing shuffled spheres for the post-transform cache and then for overdraw, reporting ACMR, ATVR and overdraw after each.");
+    arguments.getApplicationUsage()->addCommandLineOption("simplifier <numtriangles>","Run simplifier benchmark, simplifying a textured bumpy sphere with osgUtil::QuadricSimplifier serially and in parallel, and with osgUtil::Simplifier, reporting times, triangles and errors and checking the texture seam is kept.");
+    arguments.getApplicationUsage()->addCommandLineOption("kdtree <numtriangles>","Run KdTree benchmark, building the KdTree of a terrain serially and in parallel, then intersecting line of sight segments one at a time and batched, reporting times and checking the intersections match.");
+    arguments.getApplicationUsage()->addCommandLineOption("multi-segment <numtriangles>","Run MultiLineSegmentIntersector benchmark, intersecting line of sight segments with a tiled terrain using an IntersectorGroup, a MultiLineSegmentIntersector and its parallel computeIntersections(), reporting times and checking the intersections match.");
+    arguments.getApplicationUsage()->addCommandLineOption("dynamic-bvh <numobjects>","Run DynamicBVHGroup benchmark, moving some of many MatrixTransforms each frame then picking them with line segments and polytopes under an osg::Group and an osgUtil::DynamicBVHGroup, reporting update and query times and checking the intersections match.");
+    arguments.getApplicationUsage()->addCommandLineOption("filecache <directory> <url>","Run FileCache benchmark, writing a paged terrain database to the directory, which must be served at the url, for instance by python3 -m http.server, then timing prefetches of the tiles along a camera path into an empty and a warm cache, checking eviction to a maximum size and corruption detection, and comparing write behind with synchronous writes.");
+    arguments.getApplicationUsage()->addCommandLineOption("curl <directory> <url>","Run curl plugin benchmark, writing files and osga archives to the directory, which must be served at the url, then reading the files from one and several threads with each thread's own connection and with the plugin's connection pool, and reading from the archives downloaded whole and by byte range requests, reporting throughput and latency.");
 
 
     if (arguments.argc()<=1)
@@ -601,6 +627,45 @@ int main( int argc, char** argv )
     bool printPolytopeTest = false;
     while (arguments.read("polytope")) printPolytopeTest = true;
 
+    unsigned int numFrustumCullingVolumes = 0;
+    while (arguments.read("frustum-culling", numFrustumCullingVolumes)) {}
+
+    unsigned int numRenderBinSortLeaves = 0;
+    while (arguments.read("render-bin-sort", numRenderBinSortLeaves)) {}
+
+    unsigned int numStateSortStateGraphs = 0;
+    while (arguments.read("state-sort", numStateSortStateGraphs)) {}
+
+    unsigned int numDrawIndirectGeometries = 0;
+    while (arguments.read("draw-indirect-batch", numDrawIndirectGeometries)) {}
+
+    unsigned int numOptimizerGeometries = 0;
+    while (arguments.read("optimizer", numOptimizerGeometries)) {}
+
+    unsigned int numMeshletTriangles = 0;
+    while (arguments.read("meshlets", numMeshletTriangles)) {}
+
+    unsigned int numVertexCacheTriangles = 0;
+    while (arguments.read("vertex-cache", numVertexCacheTriangles)) {}
+
+    unsigned int numSimplifierTriangles = 0;
+    while (arguments.read("simplifier", numSimplifierTriangles)) {}
+
+    unsigned int numKdTreeTriangles = 0;
+    while (arguments.read("kdtree", numKdTreeTriangles)) {}
+
+    unsigned int numMultiSegmentTriangles = 0;
+    while (arguments.read("multi-segment", numMultiSegmentTriangles)) {}
+
+    unsigned int numDynamicBVHObjects = 0;
+    while (arguments.read("dynamic-bvh", numDynamicBVHObjects)) {}
+
+    std::string fileCacheDirectory, fileCacheURL;
+    while (arguments.read("filecache", fileCacheDirectory, fileCacheURL)) {}
+
+    std::string curlDirectory, curlURL;
+    while (arguments.read("curl", curlDirectory, curlURL)) {}
+
     bool doTestThreadInitAndExit = false;
     while (arguments.read("thread")) doTestThreadInitAndExit = true;
 
@@ -692,6 +757,71 @@ int main( int argc, char** argv )
         testPolytope();
     }
 
+    if (numFrustumCullingVolumes>0)
+    {
+        runFrustumCullingBenchmark(numFrustumCullingVolumes, 10);
+    }
+
+    if (numRenderBinSortLeaves>0)
+    {
+        runRenderBinSortBenchmark(numRenderBinSortLeaves, 10);
+    }
+
+    if (numStateSortStateGraphs>0)
+    {
+        runStateSortingBenchmark(numStateSortStateGraphs);
+    }
+
+    if (numDrawIndirectGeometries>0)
+    {
+        runDrawIndirectBatchBenchmark(numDrawIndirectGeometries);
+    }
+
+    if (numOptimizerGeometries>0)
+    {
+        runOptimizerBenchmark(numOptimizerGeometries);
+    }
+
+    if (numMeshletTriangles>0)
+    {
+        runMeshletBenchmark(numMeshletTriangles);
+    }
+
+    if (numVertexCacheTriangles>0)
+    {
+        runVertexCacheBenchmark(numVertexCacheTriangles);
+    }
+
+    if (numSimplifierTriangles>0)
+    {
+        runSimplifierBenchmark(numSimplifierTriangles);
+    }
+
+    if (numKdTreeTriangles>0)
+    {
+        runKdTreeBenchmark(numKdTreeTriangles);
+    }
+
+    if (numMultiSegmentTriangles>0)
+    {
+        runMultiLineSegmentBenchmark(numMultiSegmentTriangles);
+    }
+
+    if (numDynamicBVHObjects>0)
+    {
+        runDynamicBVHBenchmark(numDynamicBVHObjects);
+    }
+
+    if (!fileCacheDirectory.empty())
+    {
+        runFileCacheBenchmark(fileCacheDirectory, fileCacheURL);
+    }
+
+    if (!curlDirectory.empty())
+    {
+        runCurlBenchmark(curlDirectory, curlURL);
+    }
+
 
     if (printQualifiedTest)
     {
@@ -25,10 +25,14 @@
 #include <osg/PrimitiveSet>
 #include <osg/Array>
 #include <osg/ContextData>
+#include <osg/ApplicationUsage>
+#include <osg/os_utils>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/Mutex>
 
+#include <string.h>
+
 #if 0
     #define CHECK_CONSISTENCY checkConsistency();
 #else
@@ -57,12 +61,22 @@ GLBufferObject::GLBufferObject(unsigned int contextID, BufferObject* bufferObjec
     _allocatedSize(0),
     _dirty(true),
     _bufferObject(0),
+    _streaming(false),
+    _streamingFailed(false),
+    _mappedData(0),
+    _segmentSize(0),
+    _currentSegment(0),
     _set(0),
     _previous(0),
     _next(0),
     _frameLastUsed(0),
     _extensions(0)
 {
+    for(unsigned int i=0; i<NUM_STREAMING_SEGMENTS; ++i)
+    {
+        _segmentFences[i] = 0;
+    }
+
     assign(bufferObject);
 
     _extensions = GLExtensions::Get(contextID, true);
@@ -121,6 +135,19 @@ void GLBufferObject::compileBuffer()
 {
     _dirty = false;
 
+    if (!_streamingFailed && _bufferObject->requiresStreaming() && isStreamingSupported())
+    {
+        streamBuffer();
+        if (_streaming) return;
+    }
+
+    if (_streaming)
+    {
+        // the streaming storage is immutable so a new buffer is required to go back to using glBufferData.
+        releaseStreamingStorage();
+        _bufferEntries.clear();
+    }
+
     _bufferEntries.reserve(_bufferObject->getNumBufferData());
 
     bool compileAll = false;
@@ -192,20 +219,7 @@ void GLBufferObject::compileBuffer()
 
     _extensions->debugObjectLabel(GL_BUFFER, _glObjectID, _bufferObject->getName());
 
-    if (newTotalSize > _profile._size)
-    {
-        OSG_INFO<<"newTotalSize="<<newTotalSize<<", _profile._size="<<_profile._size<<std::endl;
-
-        unsigned int sizeDifference = newTotalSize - _profile._size;
-        _profile._size = newTotalSize;
-
-        if (_set)
-        {
-            _set->moveToSet(this, _set->getParent()->getGLBufferObjectSet(_profile));
-            _set->getParent()->getCurrGLBufferObjectPoolSize() += sizeDifference;
-        }
-
-    }
+    expandProfile(newTotalSize);
 
     if (_allocatedSize != _profile._size)
     {
@@ -244,9 +258,183 @@ void GLBufferObject::compileBuffer()
     }
 }
 
+void GLBufferObject::expandProfile(unsigned int newTotalSize)
+{
+    if (newTotalSize > _profile._size)
+    {
+        OSG_INFO<<"newTotalSize="<<newTotalSize<<", _profile._size="<<_profile._size<<std::endl;
+
+        unsigned int sizeDifference = newTotalSize - _profile._size;
+        _profile._size = newTotalSize;
+
+        if (_set)
+        {
+            _set->moveToSet(this, _set->getParent()->getGLBufferObjectSet(_profile));
+            _set->getParent()->getCurrGLBufferObjectPoolSize() += sizeDifference;
+        }
+
+    }
+}
+
+bool GLBufferObject::isStreamingSupported() const
+{
+    return _extensions->glBufferStorage!=0 &&
+           _extensions->glMapBufferRange!=0 &&
+           _extensions->glUnmapBuffer!=0 &&
+           _extensions->glFenceSync!=0 &&
+           _extensions->glClientWaitSync!=0 &&
+           _extensions->glDeleteSync!=0;
+}
+
+void GLBufferObject::streamBuffer()
+{
+    unsigned int bufferAlignment = 4;
+
+    // lay out the BufferData relative to the start of a segment, every BufferData is copied into each new segment.
+    unsigned int numBufferData = _bufferObject->getNumBufferData();
+    _bufferEntries.resize(numBufferData);
+
+    unsigned int newSegmentSize = 0;
+    for(unsigned int i=0; i<numBufferData; ++i)
+    {
+        BufferData* bd = _bufferObject->getBufferData(i);
+        BufferEntry& entry = _bufferEntries[i];
+        entry.numRead = 0;
+        entry.offset = newSegmentSize;
+        entry.dataSize = bd ? bd->getTotalDataSize() : 0;
+        entry.dataSource = bd;
+
+        newSegmentSize = computeBufferAlignment(newSegmentSize + entry.dataSize, bufferAlignment);
+    }
+
+    expandProfile(newSegmentSize);
+
+    if (!_streaming || newSegmentSize > _segmentSize)
+    {
+        // immutable storage can't be resized, so replace the buffer when more space is required.
+        if (_streaming || _allocatedSize!=0) releaseStreamingStorage();
+
+        // align the segments so that they can be bound as uniform buffer ranges.
+        _segmentSize = computeBufferAlignment(newSegmentSize, 256);
+        _allocatedSize = _segmentSize * NUM_STREAMING_SEGMENTS;
+        _currentSegment = 0;
+        _streaming = true;
+
+        OSG_INFO<<"    Allocating new streaming glBufferStorage(), _allocatedSize="<<_allocatedSize<<std::endl;
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+        _extensions->debugObjectLabel(GL_BUFFER, _glObjectID, _bufferObject->getName());
+        _extensions->glBufferStorage(_profile._target, _allocatedSize, NULL, flags);
+        _mappedData = static_cast<unsigned char*>(_extensions->glMapBufferRange(_profile._target, 0, _allocatedSize, flags));
+
+        if (!_mappedData)
+        {
+            OSG_NOTICE<<"Warning: GLBufferObject::streamBuffer() unable to map buffer storage, falling back to glBufferSubData()."<<std::endl;
+
+            releaseStreamingStorage();
+            _bufferEntries.clear();
+            _streamingFailed = true;
+            return;
+        }
+    }
+    else
+    {
+        _extensions->glBindBuffer(_profile._target, _glObjectID);
+
+        // fence the segment last written so that it isn't overwritten whilst the GPU may still be reading from it.
+        _segmentFences[_currentSegment] = _extensions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        _currentSegment = (_currentSegment+1) % NUM_STREAMING_SEGMENTS;
+
+        GLsync& fence = _segmentFences[_currentSegment];
+        if (fence)
+        {
+            GLenum result = _extensions->glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while(result==GL_TIMEOUT_EXPIRED)
+            {
+                result = _extensions->glClientWaitSync(fence, 0, 1000000);
+            }
+
+            _extensions->glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+
+    unsigned int segmentOffset = _currentSegment * _segmentSize;
+    unsigned int numBytesStreamed = 0;
+
+    for(BufferEntries::iterator itr = _bufferEntries.begin();
+        itr != _bufferEntries.end();
+        ++itr)
+    {
+        BufferEntry& entry = *itr;
+        entry.offset += segmentOffset;
+
+        if (!entry.dataSource) continue;
+
+        entry.modifiedCount = entry.dataSource->getModifiedCount();
+
+        if (entry.dataSize==0) continue;
+
+        unsigned char* ptr = _mappedData + entry.offset;
+
+        const osg::Image* image = entry.dataSource->asImage();
+        if (image && !(image->isDataContiguous()))
+        {
+            for(osg::Image::DataIterator img_itr(image); img_itr.valid(); ++img_itr)
+            {
+                memcpy(ptr, img_itr.data(), img_itr.size());
+                ptr += img_itr.size();
+            }
+        }
+        else
+        {
+            memcpy(ptr, entry.dataSource->getDataPointer(), entry.dataSize);
+        }
+
+        numBytesStreamed += entry.dataSize;
+    }
+
+    osg::get<GLBufferObjectManager>(_contextID)->getNumberBytesStreamed() += numBytesStreamed;
+}
+
+void GLBufferObject::releaseStreamingStorage()
+{
+    for(unsigned int i=0; i<NUM_STREAMING_SEGMENTS; ++i)
+    {
+        if (_segmentFences[i])
+        {
+            _extensions->glDeleteSync(_segmentFences[i]);
+            _segmentFences[i] = 0;
+        }
+    }
+
+    if (_glObjectID!=0)
+    {
+        if (_mappedData)
+        {
+            _extensions->glBindBuffer(_profile._target, _glObjectID);
+            _extensions->glUnmapBuffer(_profile._target);
+        }
+
+        _extensions->glDeleteBuffers(1, &_glObjectID);
+        _extensions->glGenBuffers(1, &_glObjectID);
+    }
+
+    _mappedData = 0;
+    _streaming = false;
+    _segmentSize = 0;
+    _currentSegment = 0;
+    _allocatedSize = 0;
+}
+
 void GLBufferObject::deleteGLObject()
 {
     OSG_DEBUG<<"GLBufferObject::deleteGLObject() "<<_glObjectID<<std::endl;
+    if (_streaming) releaseStreamingStorage();
+
     if (_glObjectID!=0)
     {
         _extensions->glDeleteBuffers(1, &_glObjectID);
@@ -866,7 +1054,8 @@ GLBufferObjectManager::GLBufferObjectManager(unsigned int contextID):
     _numGenerated(0),
     _generateTime(0.0),
     _numApplied(0),
-    _applyTime(0.0)
+    _applyTime(0.0),
+    _numBytesStreamed(0)
 {
 }
 
@@ -993,6 +1182,8 @@ void GLBufferObjectManager::newFrame(osg::FrameStamp* fs)
     else ++_frameNumber;
 
     ++_numFrames;
+
+    _numBytesStreamed = 0;
 }
 
 void GLBufferObjectManager::reportStats(std::ostream& out)
@@ -1003,6 +1194,7 @@ void GLBufferObjectManager::reportStats(std::ostream& out)
     out<<"   total _numGenerated="<<_numGenerated<<", _generateTime="<<_generateTime<<", averagePerFrame="<<_generateTime/numFrames*1000.0<<"ms"<<std::endl;
     out<<"   total _numDeleted="<<_numDeleted<<", _deleteTime="<<_deleteTime<<", averagePerFrame="<<_deleteTime/numFrames*1000.0<<"ms"<<std::endl;
     out<<"   total _numApplied="<<_numApplied<<", _applyTime="<<_applyTime<<", averagePerFrame="<<_applyTime/numFrames*1000.0<<"ms"<<std::endl;
+    out<<"   _numBytesStreamed="<<_numBytesStreamed<<std::endl;
     out<<"   getMaxGLBufferObjectPoolSize()="<<getMaxGLBufferObjectPoolSize()<<" current/max size = "<<double(_currGLBufferObjectPoolSize)/double(getMaxGLBufferObjectPoolSize())<<std::endl;;
 
     recomputeStats(out);
@@ -1020,6 +1212,8 @@ void GLBufferObjectManager::resetStats()
 
     _numApplied = 0;
     _applyTime = 0;
+
+    _numBytesStreamed = 0;
 }
 
 void GLBufferObjectManager::recomputeStats(std::ostream& out) const
@@ -1055,17 +1249,59 @@ void GLBufferObjectManager::recomputeStats(std::ostream& out) const
 //
 // BufferObject
 //
+static ApplicationUsageProxy BufferObject_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUFFER_STREAMING <mode>","OFF | DYNAMIC | ALL, set which BufferObjects stream their data through a persistently mapped ring buffer, defaults to DYNAMIC.");
+
+static BufferObject::StreamingMode getDefaultStreamingMode()
+{
+    static BufferObject::StreamingMode s_defaultStreamingMode = BufferObject::STREAM_DYNAMIC_DATA;
+    static bool s_initialized = false;
+    if (!s_initialized)
+    {
+        std::string value;
+        if (getEnvVar("OSG_BUFFER_STREAMING", value))
+        {
+            if (value=="OFF") s_defaultStreamingMode = BufferObject::NO_STREAMING;
+            else if (value=="ALL") s_defaultStreamingMode = BufferObject::STREAM_ALL_DATA;
+            else s_defaultStreamingMode = BufferObject::STREAM_DYNAMIC_DATA;
+        }
+        s_initialized = true;
+    }
+    return s_defaultStreamingMode;
+}
+
 BufferObject::BufferObject():
-    _copyDataAndReleaseGLBufferObject(false)
+    _copyDataAndReleaseGLBufferObject(false),
+    _streamingMode(getDefaultStreamingMode())
 {
 }
 
 BufferObject::BufferObject(const BufferObject& bo,const CopyOp& copyop):
     Object(bo,copyop),
-    _copyDataAndReleaseGLBufferObject(bo._copyDataAndReleaseGLBufferObject)
+    _copyDataAndReleaseGLBufferObject(bo._copyDataAndReleaseGLBufferObject),
+    _streamingMode(bo._streamingMode)
 {
 }
 
+bool BufferObject::requiresStreaming() const
+{
+    if (_streamingMode==NO_STREAMING || _copyDataAndReleaseGLBufferObject) return false;
+
+    // only vertex, index and uniform data is streamed, other buffers may be read back or written by the GPU.
+    GLenum target = getTarget();
+    if (target!=GL_ARRAY_BUFFER_ARB && target!=GL_ELEMENT_ARRAY_BUFFER_ARB && target!=GL_UNIFORM_BUFFER) return false;
+
+    if (_streamingMode==STREAM_ALL_DATA) return true;
+
+    for(BufferDataList::const_iterator itr = _bufferDataList.begin();
+        itr != _bufferDataList.end();
+        ++itr)
+    {
+        if (*itr && (*itr)->getDataVariance()==Object::DYNAMIC) return true;
+    }
+
+    return false;
+}
+
 BufferObject::~BufferObject()
 {
     releaseGLObjects(0);
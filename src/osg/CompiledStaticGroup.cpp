@@ -0,0 +1,269 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+#include <osg/CompiledStaticGroup>
+#include <osg/Geode>
+#include <osg/MatrixTransform>
+#include <osg/PositionAttitudeTransform>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+#include <map>
+#include <typeinfo>
+
+using namespace osg;
+
+namespace
+{
+
+// Collects the Drawables of a subgraph along with their accumulated matrices and StateSet paths,
+// failing on any node that the CullVisitor would need to visit itself.
+class CompileVisitor : public NodeVisitor
+{
+public:
+
+    struct Item
+    {
+        Drawable*       drawable;
+        unsigned int    traversalOrder;
+        BoundingBox     bound;
+        unsigned int    matrixIndex;
+        unsigned int    stateSetPathIndex;
+
+        bool operator < (const Item& rhs) const { return stateSetPathIndex < rhs.stateSetPathIndex; }
+    };
+
+    typedef std::vector<Item> Items;
+    typedef std::map<CompiledStaticGroup::StateSetPath, unsigned int> StateSetPathMap;
+
+    CompileVisitor():
+        NodeVisitor(TRAVERSE_ALL_CHILDREN),
+        _succeeded(true)
+    {
+        _matrices.push_back(Matrix::identity());
+        _matrixIndexStack.push_back(0);
+    }
+
+    virtual void apply(Node& node)
+    {
+        fail(node);
+    }
+
+    virtual void apply(Group& group)
+    {
+        if (typeid(group)==typeid(Group)) traverseCompilable(group);
+        else fail(group);
+    }
+
+    virtual void apply(Geode& geode)
+    {
+        if (typeid(geode)==typeid(Geode)) traverseCompilable(geode);
+        else fail(geode);
+    }
+
+    virtual void apply(Transform& transform)
+    {
+        if ((typeid(transform)==typeid(MatrixTransform) || typeid(transform)==typeid(PositionAttitudeTransform)) &&
+            transform.getReferenceFrame()==Transform::RELATIVE_RF)
+        {
+            Matrix matrix(_matrices[_matrixIndexStack.back()]);
+            transform.computeLocalToWorldMatrix(matrix, this);
+
+            _matrixIndexStack.push_back(static_cast<unsigned int>(_matrices.size()));
+            _matrices.push_back(matrix);
+
+            traverseCompilable(transform);
+
+            _matrixIndexStack.pop_back();
+        }
+        else fail(transform);
+    }
+
+    virtual void apply(Drawable& drawable)
+    {
+        if (!isCompilable(drawable))
+        {
+            fail(drawable);
+            return;
+        }
+
+        if (drawable.getStateSet()) _stateSetPath.push_back(drawable.getStateSet());
+
+        Item item;
+        item.drawable = &drawable;
+        item.traversalOrder = static_cast<unsigned int>(_items.size());
+        item.matrixIndex = _matrixIndexStack.back();
+        item.stateSetPathIndex = getStateSetPathIndex();
+
+        const BoundingBox& bb = drawable.getBoundingBox();
+        if (bb.valid() && drawable.isCullingActive())
+        {
+            const Matrix& matrix = _matrices[item.matrixIndex];
+            for(unsigned int i=0; i<8; ++i)
+            {
+                item.bound.expandBy(bb.corner(i)*matrix);
+            }
+        }
+
+        _items.push_back(item);
+
+        if (drawable.getStateSet()) _stateSetPath.pop_back();
+    }
+
+    bool isCompilable(const Node& node) const
+    {
+        return !node.getCullCallback() && node.getNodeMask()==0xffffffff;
+    }
+
+    void traverseCompilable(Node& node)
+    {
+        if (!isCompilable(node))
+        {
+            fail(node);
+            return;
+        }
+
+        if (node.getStateSet()) _stateSetPath.push_back(node.getStateSet());
+
+        traverse(node);
+
+        if (node.getStateSet()) _stateSetPath.pop_back();
+    }
+
+    void fail(Node& node)
+    {
+        if (_succeeded)
+        {
+            OSG_INFO<<"CompiledStaticGroup unable to compile subgraph containing "<<node.className()<<" \""<<node.getName()<<"\""<<std::endl;
+        }
+        _succeeded = false;
+        setTraversalMode(TRAVERSE_NONE);
+    }
+
+    unsigned int getStateSetPathIndex()
+    {
+        StateSetPathMap::iterator itr = _stateSetPathMap.find(_stateSetPath);
+        if (itr!=_stateSetPathMap.end()) return itr->second;
+
+        unsigned int index = static_cast<unsigned int>(_stateSetPaths.size());
+        _stateSetPaths.push_back(_stateSetPath);
+        _stateSetPathMap[_stateSetPath] = index;
+        return index;
+    }
+
+    bool                                        _succeeded;
+    Items                                       _items;
+    std::vector<Matrix>                         _matrices;
+    std::vector<unsigned int>                   _matrixIndexStack;
+    CompiledStaticGroup::StateSetPath           _stateSetPath;
+    std::vector<CompiledStaticGroup::StateSetPath> _stateSetPaths;
+    StateSetPathMap                             _stateSetPathMap;
+};
+
+}
+
+CompiledStaticGroup::CompiledStaticGroup():
+    _compiled(0),
+    _compileSucceeded(false)
+{
+}
+
+CompiledStaticGroup::CompiledStaticGroup(const CompiledStaticGroup& group,const CopyOp& copyop):
+    Group(group,copyop),
+    _compiled(0),
+    _compileSucceeded(false)
+{
+}
+
+bool CompiledStaticGroup::setChild( unsigned  int i, Node* node )
+{
+    dirtyCompiled();
+    return Group::setChild(i, node);
+}
+
+void CompiledStaticGroup::childRemoved(unsigned int, unsigned int)
+{
+    dirtyCompiled();
+}
+
+void CompiledStaticGroup::childInserted(unsigned int)
+{
+    dirtyCompiled();
+}
+
+void CompiledStaticGroup::dirtyCompiled()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_compileMutex);
+    _compiled.exchange(0);
+}
+
+bool CompiledStaticGroup::compile()
+{
+    // reading the Atomic is a memory barrier, so the compiled arrays are visible once _compiled is seen to be set.
+    if (_compiled!=0) return _compileSucceeded;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_compileMutex);
+
+    // another thread may have compiled the subgraph whilst this thread waited for the lock.
+    if (_compiled!=0) return _compileSucceeded;
+
+    CompileVisitor cv;
+    for(NodeList::iterator itr = _children.begin(); itr != _children.end() && cv._succeeded; ++itr)
+    {
+        (*itr)->accept(cv);
+    }
+
+    _drawables.clear();
+    _traversalOrders.clear();
+    _boundingSpheres.clear();
+    _boundingBoxes.clear();
+    _matrixIndices.clear();
+    _matrices.clear();
+    _stateSetPathIndices.clear();
+    _stateSetPaths.clear();
+
+    if (cv._succeeded)
+    {
+        // group the Drawables by StateSetPath, the paths are numbered in the order first encountered so the
+        // relative order of the StateGraphs and of the leaves within them is the same as for a traversal.
+        // The order of leaves across StateGraphs changes, so the traversal order of each Drawable is kept
+        // for the leaves of bins drawn in traversal order.
+        std::stable_sort(cv._items.begin(), cv._items.end());
+
+        _drawables.reserve(cv._items.size());
+        _traversalOrders.reserve(cv._items.size());
+        _boundingSpheres.reserve(cv._items.size());
+        _boundingBoxes.reserve(cv._items.size());
+        _matrixIndices.reserve(cv._items.size());
+        _stateSetPathIndices.reserve(cv._items.size());
+        for(CompileVisitor::Items::iterator itr = cv._items.begin(); itr != cv._items.end(); ++itr)
+        {
+            _drawables.push_back(itr->drawable);
+            _traversalOrders.push_back(itr->traversalOrder);
+            _boundingSpheres.push_back(itr->bound.valid() ? BoundingSphere(itr->bound) : BoundingSphere());
+            _boundingBoxes.push_back(itr->bound);
+            _matrixIndices.push_back(itr->matrixIndex);
+            _stateSetPathIndices.push_back(itr->stateSetPathIndex);
+        }
+        _matrices.swap(cv._matrices);
+        _stateSetPaths.swap(cv._stateSetPaths);
+
+        OSG_INFO<<"CompiledStaticGroup::compile() compiled "<<_drawables.size()<<" drawables, "<<_matrices.size()<<" matrices and "<<_stateSetPaths.size()<<" StateSet paths"<<std::endl;
+    }
+
+    _compileSucceeded = cv._succeeded;
+    _compiled.exchange(1);
+
+    return _compileSucceeded;
+}
@@ -45,6 +45,9 @@ void CullSettings::setDefaults()
     _cullMaskLeft = 0xffffffff;
     _cullMaskRight = 0xffffffff;
 
+    _numParallelCullThreads = 0;
+    _parallelCullMinimumNumChildren = 64;
+
     // override during testing
     //_computeNearFar = COMPUTE_NEAR_FAR_USING_PRIMITIVES;
     //_nearFarRatio = 0.00005f;
@@ -70,6 +73,9 @@ void CullSettings::setCullSettings(const CullSettings& rhs)
     _cullMask = rhs._cullMask;
     _cullMaskLeft = rhs._cullMaskLeft;
     _cullMaskRight =  rhs._cullMaskRight;
+
+    _numParallelCullThreads = rhs._numParallelCullThreads;
+    _parallelCullMinimumNumChildren = rhs._parallelCullMinimumNumChildren;
 }
 
 
@@ -88,11 +94,17 @@ void CullSettings::inheritCullSettings(const CullSettings& settings, unsigned in
     if (inheritanceMask & LOD_SCALE) _LODScale = settings._LODScale;
     if (inheritanceMask & SMALL_FEATURE_CULLING_PIXEL_SIZE) _smallFeatureCullingPixelSize = settings._smallFeatureCullingPixelSize;
     if (inheritanceMask & CLAMP_PROJECTION_MATRIX_CALLBACK) _clampProjectionMatrixCallback = settings._clampProjectionMatrixCallback;
+    if (inheritanceMask & PARALLEL_CULLING)
+    {
+        _numParallelCullThreads = settings._numParallelCullThreads;
+        _parallelCullMinimumNumChildren = settings._parallelCullMinimumNumChildren;
+    }
 }
 
 
 static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_COMPUTE_NEAR_FAR_MODE <mode>","DO_NOT_COMPUTE_NEAR_FAR | COMPUTE_NEAR_FAR_USING_BOUNDING_VOLUMES | COMPUTE_NEAR_FAR_USING_PRIMITIVES");
 static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e1(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NEAR_FAR_RATIO <float>","Set the ratio between near and far planes - must greater than 0.0 but less than 1.0.");
+static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e2(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_PARALLEL_CULL_THREADS <int>","Set the number of additional threads used to cull the children of large Groups in parallel, 0 disables parallel culling.");
 
 void CullSettings::readEnvironmentalVariables()
 {
@@ -113,6 +125,11 @@ void CullSettings::readEnvironmentalVariables()
     {
         OSG_INFO<<"Set near/far ratio to "<<_nearFarRatio<<std::endl;
     }
+
+    if (getEnvVar("OSG_NUM_PARALLEL_CULL_THREADS", _numParallelCullThreads))
+    {
+        OSG_INFO<<"Set number of parallel cull threads to "<<_numParallelCullThreads<<std::endl;
+    }
 }
 
 void CullSettings::readCommandLine(ArgumentParser& arguments)
@@ -122,6 +139,7 @@ void CullSettings::readCommandLine(ArgumentParser& arguments)
     {
         arguments.getApplicationUsage()->addCommandLineOption("--COMPUTE_NEAR_FAR_MODE <mode>","DO_NOT_COMPUTE_NEAR_FAR | COMPUTE_NEAR_FAR_USING_BOUNDING_VOLUMES | COMPUTE_NEAR_FAR_USING_PRIMITIVES");
         arguments.getApplicationUsage()->addCommandLineOption("--NEAR_FAR_RATIO <float>","Set the ratio between near and far planes - must greater than 0.0 but less than 1.0.");
+        arguments.getApplicationUsage()->addCommandLineOption("--NUM_PARALLEL_CULL_THREADS <int>","Set the number of additional threads used to cull the children of large Groups in parallel, 0 disables parallel culling.");
     }
 
     std::string str;
@@ -142,6 +160,14 @@ void CullSettings::readCommandLine(ArgumentParser& arguments)
         OSG_INFO<<"Set near/far ratio to "<<_nearFarRatio<<std::endl;
     }
 
+    unsigned int numThreads;
+    while(arguments.read("--NUM_PARALLEL_CULL_THREADS",numThreads))
+    {
+        _numParallelCullThreads = numThreads;
+
+        OSG_INFO<<"Set number of parallel cull threads to "<<_numParallelCullThreads<<std::endl;
+    }
+
 }
 
 void CullSettings::write(std::ostream& out)
@@ -163,6 +189,8 @@ void CullSettings::write(std::ostream& out)
     out<<"    _cullMask = "<<_cullMask<<std::endl;
     out<<"    _cullMaskLeft = "<<_cullMaskLeft<<std::endl;
     out<<"    _cullMaskRight = "<<_cullMaskRight<<std::endl;
+    out<<"    _numParallelCullThreads = "<<_numParallelCullThreads<<std::endl;
+    out<<"    _parallelCullMinimumNumChildren = "<<_parallelCullMinimumNumChildren<<std::endl;
 
     out<<"{"<<std::endl;
 }
@@ -29,6 +29,10 @@ CullStack::CullStack()
     _index_modelviewCullingStack = 0;
     _back_modelviewCullingStack = 0;
 
+    _precomputedCullNode = 0;
+    _precomputedCulled = false;
+    _precomputedFrustumMask = 0;
+
     _referenceViewPoints.push_back(osg::Vec3(0.0f,0.0f,0.0f));
 }
 
@@ -44,6 +48,10 @@ CullStack::CullStack(const CullStack& cs):
     _index_modelviewCullingStack = 0;
     _back_modelviewCullingStack = 0;
 
+    _precomputedCullNode = 0;
+    _precomputedCulled = false;
+    _precomputedFrustumMask = 0;
+
     _referenceViewPoints.push_back(osg::Vec3(0.0f,0.0f,0.0f));
 }
 
@@ -86,6 +94,8 @@ void CullStack::reset()
     _bbCornerNear = (~_bbCornerFar)&7;
 
     _currentReuseMatrixIndex=0;
+
+    _precomputedCullNode = 0;
 }
 
 
@@ -25,6 +25,39 @@ CullingSet::~CullingSet()
 {
 }
 
+bool CullingSet::isCulled(const BoundingSphere* spheres, unsigned int numSpheres, bool* culled, Polytope::ClippingMask* frustumMasks)
+{
+#ifdef COMPILE_WITH_SHADOW_OCCLUSION_CULLING
+    if ((_mask&SHADOW_OCCLUSION_CULLING) && !_occluderList.empty()) return false;
+#endif
+
+    // as with Polytope::contains(const BoundingSphere&), an empty mask leaves the result mask unchanged.
+    if ((_mask&VIEW_FRUSTUM_CULLING) && _frustum.getCurrentMask())
+    {
+        _frustum.contains(spheres, numSpheres, culled, frustumMasks);
+        for(unsigned int i=0; i<numSpheres; ++i) culled[i] = !culled[i];
+    }
+    else
+    {
+        for(unsigned int i=0; i<numSpheres; ++i)
+        {
+            culled[i] = false;
+            frustumMasks[i] = _frustum.getResultMask();
+        }
+    }
+
+    if (_mask&SMALL_FEATURE_CULLING)
+    {
+        for(unsigned int i=0; i<numSpheres; ++i)
+        {
+            const BoundingSphere& bs = spheres[i];
+            if (!culled[i] && ((bs.center()*_pixelSizeVector)*_smallFeatureCullingPixelSize)>bs.radius()) culled[i] = true;
+        }
+    }
+
+    return true;
+}
+
 void CullingSet::disableAndPushOccludersCurrentMask(NodePath& nodePath)
 {
     for(OccluderList::iterator itr=_occluderList.begin();
@@ -19,6 +19,8 @@
 #include <osg/Program>
 #include <osg/Geode>
 
+#include <algorithm>
+
 namespace osg
 {
 
@@ -96,6 +98,36 @@ CostPair GeometryCostEstimator::estimateDrawCost(const osg::Geometry* /*geometry
     return CostPair(0.0,0.0);
 }
 
+MemoryPair GeometryCostEstimator::estimateMemoryUsage(const osg::Geometry* geometry) const
+{
+    double size = 0.0;
+    if (geometry->getVertexArray()) size += geometry->getVertexArray()->getTotalDataSize();
+    if (geometry->getNormalArray()) size += geometry->getNormalArray()->getTotalDataSize();
+    if (geometry->getColorArray()) size += geometry->getColorArray()->getTotalDataSize();
+    if (geometry->getSecondaryColorArray()) size += geometry->getSecondaryColorArray()->getTotalDataSize();
+    if (geometry->getFogCoordArray()) size += geometry->getFogCoordArray()->getTotalDataSize();
+    for(unsigned i=0; i<geometry->getNumTexCoordArrays(); ++i)
+    {
+        if (geometry->getTexCoordArray(i)) size += geometry->getTexCoordArray(i)->getTotalDataSize();
+    }
+    for(unsigned i=0; i<geometry->getNumVertexAttribArrays(); ++i)
+    {
+        if (geometry->getVertexAttribArray(i)) size += geometry->getVertexAttribArray(i)->getTotalDataSize();
+    }
+    for(unsigned i=0; i<geometry->getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primSet = geometry->getPrimitiveSet(i);
+        const osg::DrawElements* drawElements = primSet ? primSet->getDrawElements() : 0;
+        if (drawElements) size += drawElements->getTotalDataSize();
+    }
+
+    // only VBO's and display lists hold a copy of the data on the GPU
+    bool usesVBO = geometry->getUseVertexBufferObjects();
+    bool usesDL = !usesVBO && geometry->getUseDisplayList() && geometry->getSupportsDisplayList();
+
+    return MemoryPair(size, (usesVBO || usesDL) ? size : 0.0);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 //
 // TextureCostEstimator
@@ -135,6 +167,45 @@ CostPair TextureCostEstimator::estimateDrawCost(const osg::Texture* /*texture*/)
     return CostPair(0.0,0.0);
 }
 
+MemoryPair TextureCostEstimator::estimateMemoryUsage(const osg::Texture* texture) const
+{
+    MemoryPair memory(0.0,0.0);
+    for(unsigned int i=0; i<texture->getNumImages(); ++i)
+    {
+        const osg::Image* image = texture->getImage(i);
+        if (image) memory.first += image->getTotalDataSize();
+    }
+
+    bool mipmapped = texture->getFilter(osg::Texture::MIN_FILTER)!=osg::Texture::LINEAR &&
+                     texture->getFilter(osg::Texture::MIN_FILTER)!=osg::Texture::NEAREST;
+
+    if (texture->getTextureWidth()>0)
+    {
+        // texture object size is known so assume 4 bytes per texel, with a full mipmap chain adding a third.
+        double size = double(texture->getTextureWidth()) * double(std::max(texture->getTextureHeight(),1)) * double(std::max(texture->getTextureDepth(),1)) * 4.0;
+        if (mipmapped) size *= 4.0/3.0;
+        memory.second = size;
+    }
+    else
+    {
+        // texture not yet applied so assume it will be the same size as the images
+        memory.second = memory.first;
+        if (mipmapped)
+        {
+            for(unsigned int i=0; i<texture->getNumImages(); ++i)
+            {
+                const osg::Image* image = texture->getImage(i);
+                if (image && !image->isMipmap()) memory.second += double(image->getTotalDataSize())/3.0;
+            }
+        }
+    }
+
+    // images released after apply no longer occupy CPU memory
+    if (texture->getUnRefImageDataAfterApply() && texture->getTextureWidth()>0) memory.first = 0.0;
+
+    return memory;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 //
 // ProgramCostEstimator
@@ -317,6 +388,65 @@ public:
     CostPair    _costs;
 };
 
+class CollectMemoryUsage : public osg::NodeVisitor
+{
+public:
+    CollectMemoryUsage(const GraphicsCostEstimator* gce):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _gce(gce),
+        _memory(0.0,0.0)
+        {}
+
+    virtual void apply(osg::Node& node)
+    {
+        apply(node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Geometry& geom)
+    {
+        apply(geom.getStateSet());
+
+        if (_geometries.count(&geom)) return;
+        _geometries.insert(&geom);
+
+        add(_gce->estimateMemoryUsage(&geom));
+    }
+
+    void apply(osg::StateSet* stateset)
+    {
+        if (!stateset) return;
+        if (_statesets.count(stateset)) return;
+        _statesets.insert(stateset);
+
+        for(unsigned int i=0; i<stateset->getNumTextureAttributeLists(); ++i)
+        {
+            const osg::Texture* texture = dynamic_cast<const osg::Texture*>(stateset->getTextureAttribute(i, osg::StateAttribute::TEXTURE));
+            if (texture && _textures.count(texture)==0)
+            {
+                _textures.insert(texture);
+                add(_gce->estimateMemoryUsage(texture));
+            }
+        }
+    }
+
+    void add(const MemoryPair& memory)
+    {
+        _memory.first += memory.first;
+        _memory.second += memory.second;
+    }
+
+    typedef std::set<const osg::StateSet*> StateSets;
+    typedef std::set<const osg::Texture*> Textures;
+    typedef std::set<const osg::Geometry*> Geometries;
+
+    const GraphicsCostEstimator* _gce;
+    StateSets   _statesets;
+    Textures    _textures;
+    Geometries  _geometries;
+    MemoryPair  _memory;
+};
+
 CostPair GraphicsCostEstimator::estimateCompileCost(const osg::Node* node) const
 {
     if (!node) return CostPair(0.0,0.0);
@@ -333,4 +463,12 @@ CostPair GraphicsCostEstimator::estimateDrawCost(const osg::Node* node) const
     return cdc._costs;
 }
 
+MemoryPair GraphicsCostEstimator::estimateMemoryUsage(const osg::Node* node) const
+{
+    if (!node) return MemoryPair(0.0,0.0);
+    CollectMemoryUsage cmu(this);
+    const_cast<osg::Node*>(node)->accept(cmu);
+    return cmu._memory;
+}
+
 }
@@ -19,6 +19,18 @@
 
 #include <osg/io_utils>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
+#include <algorithm>
+#include <float.h>
+
+// The packet intersection tests use SSE instructions when the build targets them, otherwise the scalar versions.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define KDTREE_USE_SSE2
+#endif
+
 using namespace osg;
 
 //#define VERBOSE_OUTPUT
@@ -31,24 +43,45 @@ using namespace osg;
 struct BuildKdTree
 {
     BuildKdTree(KdTree& kdTree):
-        _kdTree(kdTree) {}
+        _kdTree(kdTree),
+        _parallelThreshold(0) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
-    typedef std::vector< unsigned int >           Indices;
-    typedef std::vector< unsigned int >         AxisStack;
+    typedef std::vector< osg::BoundingBox >     BoundsList;
+    typedef std::vector< unsigned int >         Indices;
+
+    // a subtree left to be built on a separate thread, into its own list of nodes.
+    struct Subtree
+    {
+        Subtree(int s, int e, unsigned int l, int n):
+            start(s), end(e), level(l), nodeIndex(n) {}
+
+        int                     start;
+        int                     end;
+        unsigned int            level;
+        int                     nodeIndex;
+        KdTree::KdNodeList      nodes;
+    };
+    typedef std::vector< Subtree > Subtrees;
 
     bool build(KdTree::BuildOptions& options, osg::Geometry* geometry);
 
-    void computeDivisions(KdTree::BuildOptions& options);
+    void computeBounds(int start, int end, osg::BoundingBox& bb, osg::BoundingBox& centerBB) const;
+
+    bool findSplit(const KdTree::BuildOptions& options, const osg::BoundingBox& bb, const osg::BoundingBox& centerBB,
+                   int start, int end, int& axis, int& bin) const;
+
+    int divide(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, int start, int end, unsigned int level, Subtrees* subtrees);
 
-    int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
+    void buildSubtrees(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, Subtrees& subtrees);
 
     KdTree&             _kdTree;
 
     osg::BoundingBox    _bb;
-    AxisStack           _axisStack;
     Indices             _primitiveIndices;
     CenterList          _centers;
+    BoundsList          _bounds;
+    unsigned int        _parallelThreshold;
 
 protected:
 
@@ -74,6 +107,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1)
@@ -98,6 +132,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2)
@@ -125,6 +160,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
@@ -154,6 +190,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->_bounds.push_back(bb);
     }
 
     BuildKdTree* _buildKdTree;
@@ -165,11 +202,88 @@ struct PrimitiveIndicesCollector
 //
 // BuildKdTree Implementation
 
+namespace
+{
+
+// number of bins the primitive centers are sorted into along each axis when searching for the best split.
+const int numBins = 16;
+
+// cost of traversing a node relative to that of intersecting a primitive.
+const float traversalCost = 1.0f;
+
+inline float halfSurfaceArea(const osg::BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+    float dx = bb.xMax()-bb.xMin(), dy = bb.yMax()-bb.yMin(), dz = bb.zMax()-bb.zMin();
+    return dx*dy + dy*dz + dz*dx;
+}
+
+struct BinMapping
+{
+    BinMapping(const osg::BoundingBox& centerBB, int axis):
+        _axis(axis),
+        _min(centerBB._min[axis]),
+        _scale(float(numBins)*(1.0f-1e-5f)/(centerBB._max[axis]-centerBB._min[axis])) {}
+
+    inline int operator() (const osg::Vec3& center) const
+    {
+        int bin = static_cast<int>((center[_axis]-_min)*_scale);
+        return bin<0 ? 0 : (bin<numBins ? bin : numBins-1);
+    }
+
+    int     _axis;
+    float   _min;
+    float   _scale;
+};
+
+struct InLeftBins
+{
+    InLeftBins(const BuildKdTree::CenterList& centers, const BinMapping& mapping, int bin):
+        _centers(centers), _mapping(mapping), _bin(bin) {}
+
+    inline bool operator() (unsigned int i) const { return _mapping(_centers[i])<=_bin; }
+
+    const BuildKdTree::CenterList&  _centers;
+    BinMapping                      _mapping;
+    int                             _bin;
+};
+
+struct SubtreeOperation
+{
+    BuildKdTree&                    buildKdTree;
+    const KdTree::BuildOptions&     options;
+    BuildKdTree::Subtrees&          subtrees;
+    OpenThreads::Atomic             next;
+
+    SubtreeOperation(BuildKdTree& b, const KdTree::BuildOptions& o, BuildKdTree::Subtrees& s): buildKdTree(b), options(o), subtrees(s) {}
+
+    void run()
+    {
+        unsigned int i;
+        while((i = (++next)-1) < subtrees.size())
+        {
+            BuildKdTree::Subtree& subtree = subtrees[i];
+            buildKdTree.divide(options, subtree.nodes, subtree.start, subtree.end, subtree.level, 0);
+        }
+    }
+};
+
+class SubtreeThread : public OpenThreads::Thread
+{
+public:
+    SubtreeThread(SubtreeOperation& operation): _operation(operation) {}
+    virtual void run() { _operation.run(); }
+protected:
+    SubtreeOperation& _operation;
+};
+
+}
+
 bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
 {
 
 #ifdef VERBOSE_OUTPUT
-    OSG_NOTICE<<"osg::KDTreeBuilder::createKDTree()"<<std::endl;146
+    OSG_NOTICE<<"osg::KDTreeBuilder::createKDTree()"<<std::endl;
 #endif
 
     osg::Vec3Array* vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
@@ -180,35 +294,33 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     _bb = geometry->getBoundingBox();
     _kdTree.setVertices(vertices);
 
-    unsigned int estimatedSize = (unsigned int)(2.0*float(vertices->size())/float(options._targetNumTrianglesPerLeaf));
-
-#ifdef VERBOSE_OUTPUT
-    OSG_NOTICE<<"kdTree->_kdNodes.reserve()="<<estimatedSize<<std::endl<<std::endl;
-#endif
-
-    _kdTree.getNodes().reserve(estimatedSize*5);
-
-    computeDivisions(options);
-
     options._numVerticesProcessed += vertices->size();
 
     unsigned int estimatedNumTriangles = vertices->size()*2;
     _primitiveIndices.reserve(estimatedNumTriangles);
     _centers.reserve(estimatedNumTriangles);
+    _bounds.reserve(estimatedNumTriangles);
 
     osg::TemplatePrimitiveIndexFunctor<PrimitiveIndicesCollector> collectIndices;
     collectIndices._buildKdTree = this;
     geometry->accept(collectIndices);
 
-    _primitiveIndices.reserve(vertices->size());
+    int numPrimitives = static_cast<int>(_primitiveIndices.size());
+
+    KdTree::KdNodeList nodes;
+    nodes.reserve(4*numPrimitives/(options._targetNumTrianglesPerLeaf+1)+1);
 
-    KdTree::KdNode node(-1, _primitiveIndices.size());
-    node.bb = _bb;
+    // build the top of the tree here, leaving subtrees of a few thousand primitives or more, several per thread, to be
+    // built in parallel.
+    Subtrees subtrees;
+    _parallelThreshold = options._numThreads>0 ? std::max(numPrimitives/static_cast<int>(4*(options._numThreads+1)), 1024) : 0;
+    bool buildInParallel = _parallelThreshold>0 && numPrimitives>static_cast<int>(_parallelThreshold);
 
-    int nodeNum = _kdTree.addNode(node);
+    divide(options, nodes, 0, numPrimitives, 0, buildInParallel ? &subtrees : 0);
 
-    osg::BoundingBox bb = _bb;
-    nodeNum = divide(options, bb, nodeNum, 0);
+    if (!subtrees.empty()) buildSubtrees(options, nodes, subtrees);
+
+    _kdTree.getNodes().swap(nodes);
 
     osg::KdTree::Indices& primitiveIndices = _kdTree.getPrimitiveIndices();
 
@@ -222,250 +334,481 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     }
     primitiveIndices.swap(new_indices);
 
-
 #ifdef VERBOSE_OUTPUT
-    OSG_NOTICE<<"Root nodeNum="<<nodeNum<<std::endl;
+    OSG_NOTICE<<"_kdNodes.size()="<<_kdTree.getNodes().size()<<", subtrees built in parallel="<<subtrees.size()<<std::endl;
 #endif
 
-
-//    OSG_NOTICE<<"_kdNodes.size()="<<k_kdNodes.size()<<"  estimated size = "<<estimatedSize<<std::endl;
-//    OSG_NOTICE<<"_kdLeaves.size()="<<_kdLeaves.size()<<"  estimated size = "<<estimatedSize<<std::endl<<std::endl;
-
-
     return !_kdTree.getNodes().empty();
 }
 
-void BuildKdTree::computeDivisions(KdTree::BuildOptions& options)
+void BuildKdTree::computeBounds(int start, int end, osg::BoundingBox& bb, osg::BoundingBox& centerBB) const
 {
-    osg::Vec3 dimensions(_bb.xMax()-_bb.xMin(),
-                         _bb.yMax()-_bb.yMin(),
-                         _bb.zMax()-_bb.zMin());
-
-#ifdef VERBOSE_OUTPUT
-    OSG_NOTICE<<"computeDivisions("<<options._maxNumLevels<<") "<<dimensions<< " { "<<std::endl;
-#endif
+    bb.init();
+    centerBB.init();
+    for(int i=start; i<end; ++i)
+    {
+        unsigned int primitive = _primitiveIndices[i];
+        bb.expandBy(_bounds[primitive]);
+        centerBB.expandBy(_centers[primitive]);
+    }
+}
 
-    _axisStack.reserve(options._maxNumLevels);
+bool BuildKdTree::findSplit(const KdTree::BuildOptions& options, const osg::BoundingBox& bb, const osg::BoundingBox& centerBB,
+                            int start, int end, int& axis, int& bin) const
+{
+    int count = end-start;
+    float bestCost = FLT_MAX;
 
-    for(unsigned int level=0; level<options._maxNumLevels; ++level)
+    for(int a=0; a<3; ++a)
     {
-        int axis = 0;
-        if (dimensions[0]>=dimensions[1])
+        if (!(centerBB._max[a]>centerBB._min[a])) continue;
+
+        int binCounts[numBins];
+        osg::BoundingBox binBounds[numBins];
+        for(int b=0; b<numBins; ++b) binCounts[b] = 0;
+
+        BinMapping mapping(centerBB, a);
+        for(int i=start; i<end; ++i)
+        {
+            unsigned int primitive = _primitiveIndices[i];
+            int b = mapping(_centers[primitive]);
+            ++binCounts[b];
+            binBounds[b].expandBy(_bounds[primitive]);
+        }
+
+        // sweep from the right to find the areas right of each split, then from the left to cost each split.
+        float rightAreas[numBins];
+        osg::BoundingBox rightBB;
+        for(int b=numBins-1; b>0; --b)
         {
-            if (dimensions[0]>=dimensions[2]) axis = 0;
-            else axis = 2;
+            rightBB.expandBy(binBounds[b]);
+            rightAreas[b] = halfSurfaceArea(rightBB);
         }
-        else if (dimensions[1]>=dimensions[2]) axis = 1;
-        else axis = 2;
 
-        _axisStack.push_back(axis);
-        dimensions[axis] /= 2.0f;
+        osg::BoundingBox leftBB;
+        int leftCount = 0;
+        for(int b=0; b<numBins-1; ++b)
+        {
+            leftBB.expandBy(binBounds[b]);
+            leftCount += binCounts[b];
+            if (leftCount==0 || leftCount==count) continue;
 
-#ifdef VERBOSE_OUTPUT
-        OSG_NOTICE<<"  "<<level<<", "<<dimensions<<", "<<axis<<std::endl;
-#endif
+            float cost = halfSurfaceArea(leftBB)*float(leftCount) + rightAreas[b+1]*float(count-leftCount);
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                axis = a;
+                bin = b;
+            }
+        }
     }
 
-#ifdef VERBOSE_OUTPUT
-    OSG_NOTICE<<"}"<<std::endl;
-#endif
+    if (bestCost==FLT_MAX) return false;
+
+    // keep small nodes as leaves where intersecting their primitives is cheaper than traversing their children.
+    float area = halfSurfaceArea(bb);
+    float splitCost = area>0.0f ? traversalCost + bestCost/area : 0.0f;
+    unsigned int maxNumPrimitivesPerLeaf = options._targetNumTrianglesPerLeaf*4;
+    return !(static_cast<unsigned int>(count)<=maxNumPrimitivesPerLeaf && splitCost>=float(count));
 }
 
-int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level)
+int BuildKdTree::divide(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, int start, int end, unsigned int level, Subtrees* subtrees)
 {
-    KdTree::KdNode& node = _kdTree.getNode(nodeIndex);
+    int nodeIndex = static_cast<int>(nodes.size());
+    nodes.push_back(KdTree::KdNode(-start-1, end-start));
 
-    bool needToDivide = level < _axisStack.size() &&
-                        (node.first<0 && static_cast<unsigned int>(node.second)>options._targetNumTrianglesPerLeaf);
+    osg::BoundingBox bb, centerBB;
+    computeBounds(start, end, bb, centerBB);
 
-    if (!needToDivide)
+    if (bb.valid())
     {
-        if (node.first<0)
-        {
-            int istart = -node.first-1;
-            int iend = istart+node.second-1;
+        float epsilon = 1e-6f;
+        bb._min -= osg::Vec3(epsilon, epsilon, epsilon);
+        bb._max += osg::Vec3(epsilon, epsilon, epsilon);
+    }
+    nodes[nodeIndex].bb = bb;
 
-            // leaf is done, now compute bound on it.
-            node.bb.init();
-            for(int i=istart; i<=iend; ++i)
-            {
-                unsigned int primitiveIndex = _kdTree.getPrimitiveIndices()[_primitiveIndices[i]];
-                primitiveIndex++; //skip original Primitive index
-                unsigned int numPoints = _kdTree.getVertexIndices()[primitiveIndex++];
+    unsigned int count = end-start;
+    if (count<=options._targetNumTrianglesPerLeaf || level>=options._maxNumLevels) return nodeIndex;
 
-                for(; numPoints>0; --numPoints)
-                {
-                    unsigned int vi = _kdTree.getVertexIndices()[primitiveIndex++];
-                    const osg::Vec3& v = (*_kdTree.getVertices())[vi];
-                    node.bb.expandBy(v);
-                }
-            }
+    if (subtrees && count<=_parallelThreshold)
+    {
+        subtrees->push_back(Subtree(start, end, level, nodeIndex));
+        return nodeIndex;
+    }
 
-            if (node.bb.valid())
-            {
-                float epsilon = 1e-6f;
-                node.bb._min.x() -= epsilon;
-                node.bb._min.y() -= epsilon;
-                node.bb._min.z() -= epsilon;
-                node.bb._max.x() += epsilon;
-                node.bb._max.y() += epsilon;
-                node.bb._max.z() += epsilon;
-            }
+    int axis = 0, bin = 0;
+    if (!findSplit(options, bb, centerBB, start, end, axis, bin)) return nodeIndex;
 
-#ifdef VERBOSE_OUTPUT
-            if (!node.bb.valid())
-            {
-                OSG_NOTICE<<"After reset "<<node.first<<","<<node.second<<std::endl;
-                OSG_NOTICE<<"  bb._min ("<<node.bb._min<<")"<<std::endl;
-                OSG_NOTICE<<"  bb._max ("<<node.bb._max<<")"<<std::endl;
-            }
-            else
-            {
-                OSG_NOTICE<<"Set bb for nodeIndex = "<<nodeIndex<<std::endl;
-            }
-#endif
-        }
+    Indices::iterator middle = std::partition(_primitiveIndices.begin()+start, _primitiveIndices.begin()+end,
+                                              InLeftBins(_centers, BinMapping(centerBB, axis), bin));
+    int mid = static_cast<int>(middle-_primitiveIndices.begin());
 
-        return nodeIndex;
+    int leftChildIndex = divide(options, nodes, start, mid, level+1, subtrees);
+    int rightChildIndex = divide(options, nodes, mid, end, level+1, subtrees);
+
+    KdTree::KdNode& node = nodes[nodeIndex];
+    node.first = leftChildIndex;
+    node.second = rightChildIndex;
+
+    return nodeIndex;
+}
 
+void BuildKdTree::buildSubtrees(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, Subtrees& subtrees)
+{
+    SubtreeOperation operation(*this, options, subtrees);
+
+    unsigned int numThreads = std::min(options._numThreads, static_cast<unsigned int>(subtrees.size())-1);
+    std::vector<SubtreeThread*> threads;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        threads.push_back(new SubtreeThread(operation));
+        threads.back()->start();
     }
 
-    int axis = _axisStack[level];
+    operation.run();
 
-#ifdef VERBOSE_OUTPUT
-    OSG_NOTICE<<"divide("<<nodeIndex<<", "<<level<< "), axis="<<axis<<std::endl;
-#endif
+    for(std::vector<SubtreeThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
 
-    if (node.first<0)
+    // append the nodes of each subtree, its root replacing the leaf left in its place.
+    for(Subtrees::iterator itr = subtrees.begin(); itr != subtrees.end(); ++itr)
     {
-        // leaf node as first <= 0, so look at dividing it.
+        int offset = static_cast<int>(nodes.size())-1;
+        for(unsigned int i=0; i<itr->nodes.size(); ++i)
+        {
+            KdTree::KdNode node = itr->nodes[i];
+            if (node.first>0)
+            {
+                node.first += offset;
+                node.second += offset;
+            }
 
-        int istart = -node.first-1;
-        int iend = istart+node.second-1;
+            if (i==0) nodes[itr->nodeIndex] = node;
+            else nodes.push_back(node);
+        }
+    }
+}
 
-        //OSG_NOTICE<<"  divide leaf"<<std::endl;
+////////////////////////////////////////////////////////////////////////////////
+//
+// KdTree packet intersection
 
-        float original_min = bb._min[axis];
-        float original_max = bb._max[axis];
+namespace
+{
 
-        float mid = (original_min+original_max)*0.5f;
+// four line segments intersected together, their starts relative to the center of the tree so that the tests can be
+// computed in float.
+struct SegmentPacket
+{
+    float           ox[4], oy[4], oz[4];
+    float           dx[4], dy[4], dz[4];
+    float           ix[4], iy[4], iz[4];
+    float           tmin[4], tmax[4];
 
-        int originalLeftChildIndex = 0;
-        int originalRightChildIndex = 0;
-        bool insitueDivision = false;
+    osg::Vec3d      start[4];
+    osg::Vec3d      direction[4];
+    double          length[4];
+    unsigned int    segmentIndex[4];
 
-        {
-            //osg::Vec3Array* vertices = kdTree._vertices.get();
-            int left = istart;
-            int right = iend;
+    unsigned int    activeMask;
+};
 
-            while(left<right)
-            {
-                while(left<right && (_centers[_primitiveIndices[left]][axis]<=mid)) { ++left; }
+// mask of the segments of the packet that pass through the box.
+inline unsigned int intersectBox(const SegmentPacket& packet, const osg::Vec3& bbMin, const osg::Vec3& bbMax, unsigned int mask)
+{
+#if defined(KDTREE_USE_SSE2)
+    __m128 tnear = _mm_loadu_ps(packet.tmin);
+    __m128 tfar = _mm_loadu_ps(packet.tmax);
+
+    __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMin.x()), _mm_loadu_ps(packet.ox)), _mm_loadu_ps(packet.ix));
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMax.x()), _mm_loadu_ps(packet.ox)), _mm_loadu_ps(packet.ix));
+    tnear = _mm_max_ps(tnear, _mm_min_ps(t0, t1));
+    tfar = _mm_min_ps(tfar, _mm_max_ps(t0, t1));
+
+    t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMin.y()), _mm_loadu_ps(packet.oy)), _mm_loadu_ps(packet.iy));
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMax.y()), _mm_loadu_ps(packet.oy)), _mm_loadu_ps(packet.iy));
+    tnear = _mm_max_ps(tnear, _mm_min_ps(t0, t1));
+    tfar = _mm_min_ps(tfar, _mm_max_ps(t0, t1));
+
+    t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMin.z()), _mm_loadu_ps(packet.oz)), _mm_loadu_ps(packet.iz));
+    t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bbMax.z()), _mm_loadu_ps(packet.oz)), _mm_loadu_ps(packet.iz));
+    tnear = _mm_max_ps(tnear, _mm_min_ps(t0, t1));
+    tfar = _mm_min_ps(tfar, _mm_max_ps(t0, t1));
+
+    return mask & static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(tnear, tfar)));
+#else
+    unsigned int result = 0;
+    for(unsigned int k=0; k<4; ++k)
+    {
+        if (!(mask & (1u<<k))) continue;
 
-                while(left<right && (_centers[_primitiveIndices[right]][axis]>mid)) { --right; }
+        float tnear = packet.tmin[k], tfar = packet.tmax[k];
+        for(unsigned int a=0; a<3; ++a)
+        {
+            const float* o = a==0 ? packet.ox : (a==1 ? packet.oy : packet.oz);
+            const float* inv = a==0 ? packet.ix : (a==1 ? packet.iy : packet.iz);
+            float t0 = (bbMin[a]-o[k])*inv[k];
+            float t1 = (bbMax[a]-o[k])*inv[k];
+            tnear = std::max(tnear, std::min(t0, t1));
+            tfar = std::min(tfar, std::max(t0, t1));
+        }
+        if (tnear<=tfar) result |= (1u<<k);
+    }
+    return result;
+#endif
+}
 
-                if (left<right)
-                {
-                    std::swap(_primitiveIndices[left], _primitiveIndices[right]);
-                    ++left;
-                    --right;
-                }
-            }
+// mask of the segments of the packet that may intersect the triangle, with a tolerance so that none is missed that
+// intersects it when computed in double.
+inline unsigned int intersectTriangle(const SegmentPacket& packet, const osg::Vec3& v0, const osg::Vec3& e1, const osg::Vec3& e2, unsigned int mask)
+{
+    const float tolerance = 1e-4f;
+
+#if defined(KDTREE_USE_SSE2)
+    __m128 dx = _mm_loadu_ps(packet.dx), dy = _mm_loadu_ps(packet.dy), dz = _mm_loadu_ps(packet.dz);
+    __m128 e1x = _mm_set1_ps(e1.x()), e1y = _mm_set1_ps(e1.y()), e1z = _mm_set1_ps(e1.z());
+    __m128 e2x = _mm_set1_ps(e2.x()), e2y = _mm_set1_ps(e2.y()), e2z = _mm_set1_ps(e2.z());
+
+    __m128 Tx = _mm_sub_ps(_mm_loadu_ps(packet.ox), _mm_set1_ps(v0.x()));
+    __m128 Ty = _mm_sub_ps(_mm_loadu_ps(packet.oy), _mm_set1_ps(v0.y()));
+    __m128 Tz = _mm_sub_ps(_mm_loadu_ps(packet.oz), _mm_set1_ps(v0.z()));
+
+    __m128 Px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 Py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 Pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Px, e1x), _mm_mul_ps(Py, e1y)), _mm_mul_ps(Pz, e1z));
+    __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Px, Tx), _mm_mul_ps(Py, Ty)), _mm_mul_ps(Pz, Tz));
+
+    __m128 Qx = _mm_sub_ps(_mm_mul_ps(Ty, e1z), _mm_mul_ps(Tz, e1y));
+    __m128 Qy = _mm_sub_ps(_mm_mul_ps(Tz, e1x), _mm_mul_ps(Tx, e1z));
+    __m128 Qz = _mm_sub_ps(_mm_mul_ps(Tx, e1y), _mm_mul_ps(Ty, e1x));
+
+    __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Qx, dx), _mm_mul_ps(Qy, dy)), _mm_mul_ps(Qz, dz));
+    __m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Qx, e2x), _mm_mul_ps(Qy, e2y)), _mm_mul_ps(Qz, e2z));
+
+    __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+    u = _mm_mul_ps(u, inv_det);
+    v = _mm_mul_ps(v, inv_det);
+    t = _mm_mul_ps(t, inv_det);
+
+    __m128 lower = _mm_set1_ps(-tolerance);
+    __m128 inside = _mm_and_ps(_mm_cmpge_ps(u, lower), _mm_cmpge_ps(v, lower));
+    inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f+tolerance)));
+    inside = _mm_and_ps(inside, _mm_cmpge_ps(t, _mm_loadu_ps(packet.tmin)));
+    inside = _mm_and_ps(inside, _mm_cmple_ps(t, _mm_loadu_ps(packet.tmax)));
+
+    return mask & static_cast<unsigned int>(_mm_movemask_ps(inside));
+#else
+    unsigned int result = 0;
+    for(unsigned int k=0; k<4; ++k)
+    {
+        if (!(mask & (1u<<k))) continue;
+
+        osg::Vec3 d(packet.dx[k], packet.dy[k], packet.dz[k]);
+        osg::Vec3 T(packet.ox[k]-v0.x(), packet.oy[k]-v0.y(), packet.oz[k]-v0.z());
+        osg::Vec3 P = d ^ e2;
+        float inv_det = 1.0f/(P*e1);
+        float u = (P*T)*inv_det;
+        osg::Vec3 Q = T ^ e1;
+        float v = (Q*d)*inv_det;
+        float t = (Q*e2)*inv_det;
+        if (u>=-tolerance && v>=-tolerance && u+v<=1.0f+tolerance && t>=packet.tmin[k] && t<=packet.tmax[k]) result |= (1u<<k);
+    }
+    return result;
+#endif
+}
 
-            if (left==right)
-            {
-                if (_centers[_primitiveIndices[left]][axis]<=mid) ++left;
-                else --right;
-            }
+// the intersection of a segment with a triangle computed in double, as LineSegmentIntersector does for a single segment.
+bool intersectTriangle(const osg::Vec3d& start, const osg::Vec3d& d, double length,
+                       const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2,
+                       double& ratio, float& r0, float& r1, float& r2)
+{
+    osg::Vec3d T = start - osg::Vec3d(v0);
+    osg::Vec3d E2 = v2 - v0;
+    osg::Vec3d E1 = v1 - v0;
 
-            KdTree::KdNode leftLeaf(-istart-1, (right-istart)+1);
-            KdTree::KdNode rightLeaf(-left-1, (iend-left)+1);
+    osg::Vec3d P = d ^ E2;
 
-            if (leftLeaf.second<=0)
-            {
-                //OSG_NOTICE<<"LeftLeaf empty"<<std::endl;
-                originalLeftChildIndex = 0;
-                //originalRightChildIndex = addNode(rightLeaf);
-                originalRightChildIndex = nodeIndex;
-                insitueDivision = true;
-            }
-            else if (rightLeaf.second<=0)
-            {
-                //OSG_NOTICE<<"RightLeaf empty"<<std::endl;
-                // originalLeftChildIndex = addNode(leftLeaf);
-                originalLeftChildIndex = nodeIndex;
-                originalRightChildIndex = 0;
-                insitueDivision = true;
-            }
-            else
-            {
-                originalLeftChildIndex = _kdTree.addNode(leftLeaf);
-                originalRightChildIndex = _kdTree.addNode(rightLeaf);
-            }
-        }
+    double det = P * E1;
+
+    const double epsilon = 1e-10;
+    double u, v;
+    osg::Vec3d Q;
+    if (det>epsilon)
+    {
+        u = (P*T);
+        if (u<0.0 || u>det) return false;
 
+        Q = T ^ E1;
+        v = (Q*d);
+        if (v<0.0 || v>det) return false;
 
-        float restore = bb._max[axis];
-        bb._max[axis] = mid;
+        if ((u+v)> det) return false;
+    }
+    else if (det<-epsilon)
+    {
+        u = (P*T);
+        if (u>0.0 || u<det) return false;
 
-        //OSG_NOTICE<<"  divide leftLeaf "<<kdTree.getNode(nodeNum).first<<std::endl;
-        int leftChildIndex = originalLeftChildIndex!=0 ? divide(options, bb, originalLeftChildIndex, level+1) : 0;
+        Q = T ^ E1;
+        v = (Q*d);
+        if (v>0.0 || v<det) return false;
 
-        bb._max[axis] = restore;
+        if ((u+v) < det) return false;
+    }
+    else
+    {
+        return false;
+    }
 
-        restore = bb._min[axis];
-        bb._min[axis] = mid;
+    double inv_det = 1.0/det;
+    double t = (Q*E2)*inv_det;
+    if (t<0.0 || t>length) return false;
 
-        //OSG_NOTICE<<"  divide rightLeaf "<<kdTree.getNode(nodeNum).second<<std::endl;
-        int rightChildIndex = originalRightChildIndex!=0 ? divide(options, bb, originalRightChildIndex, level+1) : 0;
+    u *= inv_det;
+    v *= inv_det;
 
-        bb._min[axis] = restore;
+    r0 = 1.0-u-v;
+    r1 = u;
+    r2 = v;
+    ratio = t/length;
+    return true;
+}
 
+struct PacketIntersector
+{
+    PacketIntersector(const KdTree::KdNodeList& nodes, const KdTree::Indices& primitiveIndices, const KdTree::Indices& vertexIndices,
+                      const osg::Vec3Array& vertices, KdTree::SegmentIntersections& intersections, bool limitOneIntersection):
+        _nodes(nodes),
+        _primitiveIndices(primitiveIndices),
+        _vertexIndices(vertexIndices),
+        _vertices(vertices),
+        _intersections(intersections),
+        _limitOneIntersection(limitOneIntersection)
+    {
+        _origin = _nodes[0].bb.valid() ? _nodes[0].bb.center() : osg::Vec3(0.0f, 0.0f, 0.0f);
+    }
 
-        if (!insitueDivision)
+    void intersect(const osg::Vec3d* starts, const osg::Vec3d* ends, unsigned int first, unsigned int num)
+    {
+        SegmentPacket packet;
+        packet.activeMask = 0;
+        for(unsigned int k=0; k<4; ++k)
         {
-            // take a second reference to node we are working on as the std::vector<> resize could
-            // have invalidate the previous node ref.
-            KdTree::KdNode& newNodeRef = _kdTree.getNode(nodeIndex);
+            // lanes past the end of the batch repeat the first segment, masked out.
+            unsigned int i = first + (k<num ? k : 0);
+            osg::Vec3d d = ends[i]-starts[i];
+            double length = d.length();
+            if (length>0.0) d /= length;
+            if (k<num && length>0.0) packet.activeMask |= (1u<<k);
+
+            osg::Vec3d o = starts[i]-osg::Vec3d(_origin);
+            packet.ox[k] = o.x(); packet.oy[k] = o.y(); packet.oz[k] = o.z();
+            packet.dx[k] = d.x(); packet.dy[k] = d.y(); packet.dz[k] = d.z();
+            packet.ix[k] = d.x()!=0.0 ? 1.0/d.x() : FLT_MAX;
+            packet.iy[k] = d.y()!=0.0 ? 1.0/d.y() : FLT_MAX;
+            packet.iz[k] = d.z()!=0.0 ? 1.0/d.z() : FLT_MAX;
+
+            float tolerance = 1e-4f*length + 1e-4f;
+            packet.tmin[k] = -tolerance;
+            packet.tmax[k] = length + tolerance;
+
+            packet.start[k] = starts[i];
+            packet.direction[k] = d;
+            packet.length[k] = length;
+            packet.segmentIndex[k] = i;
+        }
 
-            newNodeRef.first = leftChildIndex;
-            newNodeRef.second = rightChildIndex;
+        if (!packet.activeMask) return;
 
-            insitueDivision = true;
+        _stack.clear();
+        _stack.push_back(NodeMask(0, packet.activeMask));
+        while(!_stack.empty())
+        {
+            NodeMask entry = _stack.back();
+            _stack.pop_back();
 
-            newNodeRef.bb.init();
-            if (leftChildIndex!=0) newNodeRef.bb.expandBy(_kdTree.getNode(leftChildIndex).bb);
-            if (rightChildIndex!=0) newNodeRef.bb.expandBy(_kdTree.getNode(rightChildIndex).bb);
+            const KdTree::KdNode& node = _nodes[entry.first];
+            unsigned int mask = entry.second & packet.activeMask;
+            if (mask) mask = intersectBox(packet, node.bb._min-_origin, node.bb._max-_origin, mask);
+            if (!mask) continue;
 
-            if (!newNodeRef.bb.valid())
+            if (node.first<0)
             {
-                OSG_NOTICE<<"leftChildIndex="<<leftChildIndex<<" && originalLeftChildIndex="<<originalLeftChildIndex<<std::endl;
-                OSG_NOTICE<<"rightChildIndex="<<rightChildIndex<<" && originalRightChildIndex="<<originalRightChildIndex<<std::endl;
-
-                OSG_NOTICE<<"Invalid BB leftChildIndex="<<leftChildIndex<<", "<<rightChildIndex<<std::endl;
-                OSG_NOTICE<<"  bb._min ("<<newNodeRef.bb._min<<")"<<std::endl;
-                OSG_NOTICE<<"  bb._max ("<<newNodeRef.bb._max<<")"<<std::endl;
-
-                if (leftChildIndex!=0)
-                {
-                    OSG_NOTICE<<"  getNode(leftChildIndex).bb min = "<<_kdTree.getNode(leftChildIndex).bb._min<<std::endl;
-                    OSG_NOTICE<<"                                 max = "<<_kdTree.getNode(leftChildIndex).bb._max<<std::endl;
-                }
-                if (rightChildIndex!=0)
+                int istart = -node.first-1;
+                int iend = istart + node.second;
+                for(int i=istart; i<iend && mask; ++i)
                 {
-                    OSG_NOTICE<<"  getNode(rightChildIndex).bb min = "<<_kdTree.getNode(rightChildIndex).bb._min<<std::endl;
-                    OSG_NOTICE<<"                              max = "<<_kdTree.getNode(rightChildIndex).bb._max<<std::endl;
+                    unsigned int primitiveIndex = _primitiveIndices[i];
+                    unsigned int originalPIndex = _vertexIndices[primitiveIndex++];
+                    unsigned int numVertices = _vertexIndices[primitiveIndex++];
+                    const unsigned int* p = &_vertexIndices[primitiveIndex];
+                    if (numVertices==3)
+                    {
+                        intersect(packet, mask, originalPIndex, p[0], p[1], p[2]);
+                    }
+                    else if (numVertices==4)
+                    {
+                        intersect(packet, mask, originalPIndex, p[0], p[1], p[3]);
+                        intersect(packet, mask & packet.activeMask, originalPIndex, p[1], p[2], p[3]);
+                    }
+                    mask &= packet.activeMask;
                 }
             }
+            else
+            {
+                if (node.second>0) _stack.push_back(NodeMask(node.second, mask));
+                if (node.first>0) _stack.push_back(NodeMask(node.first, mask));
+            }
         }
     }
-    else
+
+    void intersect(SegmentPacket& packet, unsigned int mask, unsigned int primitiveIndex, unsigned int p0, unsigned int p1, unsigned int p2)
     {
-        OSG_NOTICE<<"NOT expecting to get here"<<std::endl;
+        const osg::Vec3& v0 = _vertices[p0];
+        const osg::Vec3& v1 = _vertices[p1];
+        const osg::Vec3& v2 = _vertices[p2];
+
+        unsigned int candidates = intersectTriangle(packet, v0-_origin, v1-v0, v2-v0, mask);
+        for(unsigned int k=0; candidates; ++k, candidates>>=1)
+        {
+            if (!(candidates&1)) continue;
+
+            KdTree::SegmentIntersection hit;
+            if (!intersectTriangle(packet.start[k], packet.direction[k], packet.length[k], v0, v1, v2,
+                                   hit.ratio, hit.ratios[0], hit.ratios[1], hit.ratios[2])) continue;
+
+            hit.segmentIndex = packet.segmentIndex[k];
+            hit.primitiveIndex = primitiveIndex;
+            hit.indices[0] = p0;
+            hit.indices[1] = p1;
+            hit.indices[2] = p2;
+            _intersections.push_back(hit);
+
+            if (_limitOneIntersection) packet.activeMask &= ~(1u<<k);
+        }
     }
 
-    return nodeIndex;
+    typedef std::pair<int, unsigned int> NodeMask;
+
+    const KdTree::KdNodeList&       _nodes;
+    const KdTree::Indices&          _primitiveIndices;
+    const KdTree::Indices&          _vertexIndices;
+    const osg::Vec3Array&           _vertices;
+    KdTree::SegmentIntersections&   _intersections;
+    bool                            _limitOneIntersection;
+    osg::Vec3                       _origin;
+    std::vector<NodeMask>           _stack;
+
+protected:
+
+    PacketIntersector& operator = (const PacketIntersector&) { return *this; }
+};
 
 }
 
@@ -476,7 +819,8 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _numThreads(0)
 {
 }
 
@@ -504,6 +848,18 @@ bool KdTree::build(BuildOptions& options, osg::Geometry* geometry)
     return build.build(options, geometry);
 }
 
+void KdTree::intersect(const osg::Vec3d* starts, const osg::Vec3d* ends, unsigned int numSegments,
+                       SegmentIntersections& intersections, bool limitOneIntersection) const
+{
+    if (_kdNodes.empty() || !_vertices.valid()) return;
+
+    PacketIntersector intersector(_kdNodes, _primitiveIndices, _vertexIndices, *_vertices, intersections, limitOneIntersection);
+    for(unsigned int i=0; i<numSegments; i+=4)
+    {
+        intersector.intersect(starts, ends, i, std::min(numSegments-i, 4u));
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTreeBuilder
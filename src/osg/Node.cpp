@@ -542,6 +542,7 @@ void Node::dirtyBound()
             itr!=_parents.end();
             ++itr)
         {
+            (*itr)->childBoundDirtied(this);
             (*itr)->dirtyBound();
         }
 
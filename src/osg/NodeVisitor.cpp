@@ -23,6 +23,7 @@
 #include <osg/MatrixTransform>
 #include <osg/OccluderNode>
 #include <osg/OcclusionQueryNode>
+#include <osg/CompiledStaticGroup>
 #include <osg/PagedLOD>
 #include <osg/PositionAttitudeTransform>
 #include <osg/AutoTransform>
@@ -201,3 +202,8 @@ void NodeVisitor::apply(OcclusionQueryNode& node)
 {
     apply(static_cast<Group&>(node));
 }
+
+void NodeVisitor::apply(CompiledStaticGroup& node)
+{
+    apply(static_cast<Group&>(node));
+}
@@ -14,6 +14,22 @@
 #include <osg/Polytope>
 #include <osg/Notify>
 
+// The batched bounding volume tests use SIMD instructions when the build targets them, computing the plane
+// distances in double precision and comparing them with float radii so that the results match the scalar
+// Plane::intersect() tests exactly, other builds use the scalar versions of the batched tests.
+#if !defined(OSG_USE_FLOAT_PLANE) && defined(OSG_USE_FLOAT_BOUNDINGSPHERE)
+    #if defined(__AVX__)
+        #include <immintrin.h>
+        #define POLYTOPE_USE_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+        #include <emmintrin.h>
+        #define POLYTOPE_USE_SSE2
+    #elif defined(__ARM_NEON) && defined(__aarch64__)
+        #include <arm_neon.h>
+        #define POLYTOPE_USE_NEON
+    #endif
+#endif
+
 using namespace osg;
 
 bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::Vec3f& v2) const
@@ -99,3 +115,357 @@ bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::V
     //OSG_NOTICE<<"Polytope::contains() triangle within Polytope, src.size()="<<src.size()<<std::endl;
     return true;
 }
+
+namespace
+{
+
+// number of bounding volumes converted to structure of arrays form at a time, must be a multiple of 4.
+const unsigned int BATCH_SIZE = 64;
+
+typedef Plane::value_type value_type;
+
+struct SphereBatch
+{
+    value_type  x[BATCH_SIZE];
+    value_type  y[BATCH_SIZE];
+    value_type  z[BATCH_SIZE];
+    BoundingSphere::value_type radius[BATCH_SIZE];
+};
+
+struct BoxBatch
+{
+    value_type  xMin[BATCH_SIZE];
+    value_type  yMin[BATCH_SIZE];
+    value_type  zMin[BATCH_SIZE];
+    value_type  xMax[BATCH_SIZE];
+    value_type  yMax[BATCH_SIZE];
+    value_type  zMax[BATCH_SIZE];
+};
+
+// an active plane of the polytope along with, for boxes, the corners furthest below and above it as used by Plane::intersect(const BoundingBox&).
+struct ActivePlane
+{
+    const value_type*       p;
+    Polytope::ClippingMask  selector;
+    const value_type*       lower[3];
+    const value_type*       upper[3];
+};
+
+unsigned int getActivePlanes(const Polytope::PlaneList& planeList, Polytope::ClippingMask mask, ActivePlane* activePlanes)
+{
+    unsigned int numActivePlanes = 0;
+    Polytope::ClippingMask selector_mask = 0x1;
+    for(Polytope::PlaneList::const_iterator itr=planeList.begin();
+        itr!=planeList.end() && numActivePlanes<32;
+        ++itr)
+    {
+        if (mask&selector_mask)
+        {
+            ActivePlane& activePlane = activePlanes[numActivePlanes++];
+            activePlane.p = itr->ptr();
+            activePlane.selector = selector_mask;
+        }
+        selector_mask <<= 1;
+    }
+    return numActivePlanes;
+}
+
+void setBoxCorners(const BoxBatch& batch, ActivePlane* activePlanes, unsigned int numActivePlanes)
+{
+    for(unsigned int i=0; i<numActivePlanes; ++i)
+    {
+        ActivePlane& ap = activePlanes[i];
+        ap.lower[0] = ap.p[0]>=0.0 ? batch.xMin : batch.xMax;
+        ap.lower[1] = ap.p[1]>=0.0 ? batch.yMin : batch.yMax;
+        ap.lower[2] = ap.p[2]>=0.0 ? batch.zMin : batch.zMax;
+        ap.upper[0] = ap.p[0]>=0.0 ? batch.xMax : batch.xMin;
+        ap.upper[1] = ap.p[1]>=0.0 ? batch.yMax : batch.yMin;
+        ap.upper[2] = ap.p[2]>=0.0 ? batch.zMax : batch.zMin;
+    }
+}
+
+// Each group of four bounding volumes is tested against the active planes in turn, as in Polytope::contains() a volume is culled
+// when it is outside of any plane and has the plane's bit cleared from its mask when it is inside of it. A volume can't be both,
+// so the outside results are simply accumulated, and testing of a group stops once all four of its volumes are culled.
+
+#if defined(POLYTOPE_USE_AVX) || defined(POLYTOPE_USE_SSE2)
+
+// distances of four sphere centers from a plane, computed in double and converted to float as in Plane::intersect(const BoundingSphere&).
+inline __m128 distances(const value_type* p, const value_type* x, const value_type* y, const value_type* z)
+{
+#if defined(POLYTOPE_USE_AVX)
+    __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(p[0]), _mm256_loadu_pd(x)),
+                                                           _mm256_mul_pd(_mm256_set1_pd(p[1]), _mm256_loadu_pd(y))),
+                                             _mm256_mul_pd(_mm256_set1_pd(p[2]), _mm256_loadu_pd(z))),
+                              _mm256_set1_pd(p[3]));
+    return _mm256_cvtpd_ps(d);
+#else
+    __m128d a = _mm_set1_pd(p[0]), b = _mm_set1_pd(p[1]), c = _mm_set1_pd(p[2]), d = _mm_set1_pd(p[3]);
+    __m128d d0 = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(x)), _mm_mul_pd(b, _mm_loadu_pd(y))), _mm_mul_pd(c, _mm_loadu_pd(z))), d);
+    __m128d d1 = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(x+2)), _mm_mul_pd(b, _mm_loadu_pd(y+2))), _mm_mul_pd(c, _mm_loadu_pd(z+2))), d);
+    return _mm_movelh_ps(_mm_cvtpd_ps(d0), _mm_cvtpd_ps(d1));
+#endif
+}
+
+// four 32 bit lane masks of whether the given corners of four boxes are above (sign>0) or below (sign<0) a plane, compared in double.
+inline __m128 cornersAbove(const value_type* p, const value_type* x, const value_type* y, const value_type* z, bool above)
+{
+#if defined(POLYTOPE_USE_AVX)
+    __m256d d = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(p[0]), _mm256_loadu_pd(x)),
+                                                           _mm256_mul_pd(_mm256_set1_pd(p[1]), _mm256_loadu_pd(y))),
+                                             _mm256_mul_pd(_mm256_set1_pd(p[2]), _mm256_loadu_pd(z))),
+                              _mm256_set1_pd(p[3]));
+    __m256d m = above ? _mm256_cmp_pd(d, _mm256_setzero_pd(), _CMP_GT_OQ) : _mm256_cmp_pd(d, _mm256_setzero_pd(), _CMP_LT_OQ);
+    return _mm_shuffle_ps(_mm_castpd_ps(_mm256_castpd256_pd128(m)), _mm_castpd_ps(_mm256_extractf128_pd(m, 1)), _MM_SHUFFLE(2,0,2,0));
+#else
+    __m128d a = _mm_set1_pd(p[0]), b = _mm_set1_pd(p[1]), c = _mm_set1_pd(p[2]), d = _mm_set1_pd(p[3]);
+    __m128d d0 = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(x)), _mm_mul_pd(b, _mm_loadu_pd(y))), _mm_mul_pd(c, _mm_loadu_pd(z))), d);
+    __m128d d1 = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a, _mm_loadu_pd(x+2)), _mm_mul_pd(b, _mm_loadu_pd(y+2))), _mm_mul_pd(c, _mm_loadu_pd(z+2))), d);
+    __m128d m0 = above ? _mm_cmpgt_pd(d0, _mm_setzero_pd()) : _mm_cmplt_pd(d0, _mm_setzero_pd());
+    __m128d m1 = above ? _mm_cmpgt_pd(d1, _mm_setzero_pd()) : _mm_cmplt_pd(d1, _mm_setzero_pd());
+    return _mm_shuffle_ps(_mm_castpd_ps(m0), _mm_castpd_ps(m1), _MM_SHUFFLE(2,0,2,0));
+#endif
+}
+
+void testSpheres(const ActivePlane* planes, unsigned int numPlanes, Polytope::ClippingMask mask, const SphereBatch& batch, unsigned int numSpheres, unsigned char* culled, Polytope::ClippingMask* masks)
+{
+    for(unsigned int i=0; i<numSpheres; i+=4)
+    {
+        __m128 radius = _mm_loadu_ps(batch.radius+i);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+        __m128i resultMasks = _mm_set1_epi32(int(mask));
+        __m128 outside = _mm_setzero_ps();
+        for(unsigned int pi=0; pi<numPlanes; ++pi)
+        {
+            __m128 distance = distances(planes[pi].p, batch.x+i, batch.y+i, batch.z+i);
+            __m128i inside = _mm_castps_si128(_mm_cmpgt_ps(distance, radius));
+            resultMasks = _mm_andnot_si128(_mm_and_si128(inside, _mm_set1_epi32(int(planes[pi].selector))), resultMasks);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+            if (_mm_movemask_ps(outside)==0xf) break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(masks+i), resultMasks);
+        culled[i/4] = static_cast<unsigned char>(_mm_movemask_ps(outside));
+    }
+}
+
+void testBoxes(const ActivePlane* planes, unsigned int numPlanes, Polytope::ClippingMask mask, unsigned int numBoxes, unsigned char* culled, Polytope::ClippingMask* masks)
+{
+    for(unsigned int i=0; i<numBoxes; i+=4)
+    {
+        __m128i resultMasks = _mm_set1_epi32(int(mask));
+        __m128 outside = _mm_setzero_ps();
+        for(unsigned int pi=0; pi<numPlanes; ++pi)
+        {
+            const ActivePlane& ap = planes[pi];
+            __m128i inside = _mm_castps_si128(cornersAbove(ap.p, ap.lower[0]+i, ap.lower[1]+i, ap.lower[2]+i, true));
+            resultMasks = _mm_andnot_si128(_mm_and_si128(inside, _mm_set1_epi32(int(ap.selector))), resultMasks);
+            outside = _mm_or_ps(outside, cornersAbove(ap.p, ap.upper[0]+i, ap.upper[1]+i, ap.upper[2]+i, false));
+            if (_mm_movemask_ps(outside)==0xf) break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(masks+i), resultMasks);
+        culled[i/4] = static_cast<unsigned char>(_mm_movemask_ps(outside));
+    }
+}
+
+#elif defined(POLYTOPE_USE_NEON)
+
+inline unsigned char laneBits(uint32x4_t m)
+{
+    return static_cast<unsigned char>((vgetq_lane_u32(m,0)&1) | (vgetq_lane_u32(m,1)&2) | (vgetq_lane_u32(m,2)&4) | (vgetq_lane_u32(m,3)&8));
+}
+
+inline float64x2_t distances2(const value_type* p, const value_type* x, const value_type* y, const value_type* z)
+{
+    return vaddq_f64(vaddq_f64(vaddq_f64(vmulq_n_f64(vld1q_f64(x), p[0]), vmulq_n_f64(vld1q_f64(y), p[1])), vmulq_n_f64(vld1q_f64(z), p[2])), vdupq_n_f64(p[3]));
+}
+
+void testSpheres(const ActivePlane* planes, unsigned int numPlanes, Polytope::ClippingMask mask, const SphereBatch& batch, unsigned int numSpheres, unsigned char* culled, Polytope::ClippingMask* masks)
+{
+    for(unsigned int i=0; i<numSpheres; i+=4)
+    {
+        float32x4_t radius = vld1q_f32(batch.radius+i);
+        float32x4_t negativeRadius = vnegq_f32(radius);
+        uint32x4_t resultMasks = vdupq_n_u32(mask);
+        uint32x4_t outside = vdupq_n_u32(0);
+        for(unsigned int pi=0; pi<numPlanes; ++pi)
+        {
+            const value_type* p = planes[pi].p;
+            float32x4_t distance = vcombine_f32(vcvt_f32_f64(distances2(p, batch.x+i, batch.y+i, batch.z+i)),
+                                                vcvt_f32_f64(distances2(p, batch.x+i+2, batch.y+i+2, batch.z+i+2)));
+            resultMasks = vbicq_u32(resultMasks, vandq_u32(vcgtq_f32(distance, radius), vdupq_n_u32(planes[pi].selector)));
+            outside = vorrq_u32(outside, vcltq_f32(distance, negativeRadius));
+            if (vminvq_u32(outside)!=0) break;
+        }
+        vst1q_u32(masks+i, resultMasks);
+        culled[i/4] = laneBits(outside);
+    }
+}
+
+void testBoxes(const ActivePlane* planes, unsigned int numPlanes, Polytope::ClippingMask mask, unsigned int numBoxes, unsigned char* culled, Polytope::ClippingMask* masks)
+{
+    const float64x2_t zero = vdupq_n_f64(0.0);
+    for(unsigned int i=0; i<numBoxes; i+=4)
+    {
+        uint32x4_t resultMasks = vdupq_n_u32(mask);
+        uint32x4_t outside = vdupq_n_u32(0);
+        for(unsigned int pi=0; pi<numPlanes; ++pi)
+        {
+            const ActivePlane& ap = planes[pi];
+            uint32x4_t inside = vcombine_u32(vmovn_u64(vcgtq_f64(distances2(ap.p, ap.lower[0]+i, ap.lower[1]+i, ap.lower[2]+i), zero)),
+                                             vmovn_u64(vcgtq_f64(distances2(ap.p, ap.lower[0]+i+2, ap.lower[1]+i+2, ap.lower[2]+i+2), zero)));
+            resultMasks = vbicq_u32(resultMasks, vandq_u32(inside, vdupq_n_u32(ap.selector)));
+            outside = vorrq_u32(outside, vcombine_u32(vmovn_u64(vcltq_f64(distances2(ap.p, ap.upper[0]+i, ap.upper[1]+i, ap.upper[2]+i), zero)),
+                                                      vmovn_u64(vcltq_f64(distances2(ap.p, ap.upper[0]+i+2, ap.upper[1]+i+2, ap.upper[2]+i+2), zero))));
+            if (vminvq_u32(outside)!=0) break;
+        }
+        vst1q_u32(masks+i, resultMasks);
+        culled[i/4] = laneBits(outside);
+    }
+}
+
+#else
+
+void testSpheres(const ActivePlane* planes, unsigned int numPlanes, Polytope::ClippingMask mask, const SphereBatch& batch, unsigned int numSpheres, unsigned char* culled, Polytope::ClippingMask* masks)
+{
+    for(unsigned int i=0; i<numSpheres; i+=4) culled[i/4] = 0;
+    for(unsigned int i=0; i<numSpheres; ++i)
+    {
+        masks[i] = mask;
+        for(unsigned int pi=0; pi<numPlanes; ++pi)
+        {
+            const value_type* p = planes[pi].p;
+            float distance = p[0]*batch.x[i] + p[1]*batch.y[i] + p[2]*batch.z[i] + p[3];
+            if (distance>batch.radius[i]) masks[i] &= ~planes[pi].selector;
+            else if (distance<-batch.radius[i]) { culled[i/4] |= (1<<(i%4)); break; }
+        }
+    }
+}
+
+void testBoxes(const ActivePlane* planes, unsigned int numPlanes, Polytope::ClippingMask mask, unsigned int numBoxes, unsigned char* culled, Polytope::ClippingMask* masks)
+{
+    for(unsigned int i=0; i<numBoxes; i+=4) culled[i/4] = 0;
+    for(unsigned int i=0; i<numBoxes; ++i)
+    {
+        masks[i] = mask;
+        for(unsigned int pi=0; pi<numPlanes; ++pi)
+        {
+            const ActivePlane& ap = planes[pi];
+            const value_type* p = ap.p;
+            if (p[0]*ap.lower[0][i] + p[1]*ap.lower[1][i] + p[2]*ap.lower[2][i] + p[3] > 0.0) masks[i] &= ~ap.selector;
+            else if (p[0]*ap.upper[0][i] + p[1]*ap.upper[1][i] + p[2]*ap.upper[2][i] + p[3] < 0.0) { culled[i/4] |= (1<<(i%4)); break; }
+        }
+    }
+}
+
+#endif
+
+}
+
+unsigned int Polytope::contains(const BoundingSphere* spheres, unsigned int numSpheres, bool* contained, ClippingMask* resultMasks) const
+{
+    const ClippingMask mask = _maskStack.back();
+    if (!mask)
+    {
+        for(unsigned int i=0; i<numSpheres; ++i)
+        {
+            contained[i] = true;
+            resultMasks[i] = 0;
+        }
+        return numSpheres;
+    }
+
+    ActivePlane activePlanes[32];
+    unsigned int numActivePlanes = getActivePlanes(_planeList, mask, activePlanes);
+
+    SphereBatch batch;
+    unsigned char culled[BATCH_SIZE/4];
+    ClippingMask masks[BATCH_SIZE];
+
+    unsigned int numContained = 0;
+    for(unsigned int start=0; start<numSpheres; start+=BATCH_SIZE)
+    {
+        unsigned int numInBatch = osg::minimum(BATCH_SIZE, numSpheres-start);
+        unsigned int numPadded = (numInBatch+3)&~3u;
+        for(unsigned int i=0; i<numPadded; ++i)
+        {
+            if (i<numInBatch)
+            {
+                const BoundingSphere& bs = spheres[start+i];
+                batch.x[i] = bs.center().x();
+                batch.y[i] = bs.center().y();
+                batch.z[i] = bs.center().z();
+                batch.radius[i] = bs.radius();
+            }
+            else
+            {
+                batch.x[i] = batch.y[i] = batch.z[i] = 0.0;
+                batch.radius[i] = 0.0;
+            }
+        }
+
+        testSpheres(activePlanes, numActivePlanes, mask, batch, numPadded, culled, masks);
+
+        for(unsigned int i=0; i<numInBatch; ++i)
+        {
+            bool isContained = (culled[i/4]&(1<<(i%4)))==0;
+            contained[start+i] = isContained;
+            resultMasks[start+i] = masks[i];
+            if (isContained) ++numContained;
+        }
+    }
+    return numContained;
+}
+
+unsigned int Polytope::contains(const BoundingBox* boxes, unsigned int numBoxes, bool* contained, ClippingMask* resultMasks) const
+{
+    const ClippingMask mask = _maskStack.back();
+    if (!mask)
+    {
+        for(unsigned int i=0; i<numBoxes; ++i)
+        {
+            contained[i] = true;
+            resultMasks[i] = 0;
+        }
+        return numBoxes;
+    }
+
+    BoxBatch batch;
+    ActivePlane activePlanes[32];
+    unsigned int numActivePlanes = getActivePlanes(_planeList, mask, activePlanes);
+    setBoxCorners(batch, activePlanes, numActivePlanes);
+
+    unsigned char culled[BATCH_SIZE/4];
+    ClippingMask masks[BATCH_SIZE];
+
+    unsigned int numContained = 0;
+    for(unsigned int start=0; start<numBoxes; start+=BATCH_SIZE)
+    {
+        unsigned int numInBatch = osg::minimum(BATCH_SIZE, numBoxes-start);
+        unsigned int numPadded = (numInBatch+3)&~3u;
+        for(unsigned int i=0; i<numPadded; ++i)
+        {
+            if (i<numInBatch)
+            {
+                const BoundingBox& bb = boxes[start+i];
+                batch.xMin[i] = bb.xMin(); batch.yMin[i] = bb.yMin(); batch.zMin[i] = bb.zMin();
+                batch.xMax[i] = bb.xMax(); batch.yMax[i] = bb.yMax(); batch.zMax[i] = bb.zMax();
+            }
+            else
+            {
+                batch.xMin[i] = batch.yMin[i] = batch.zMin[i] = 0.0;
+                batch.xMax[i] = batch.yMax[i] = batch.zMax[i] = 0.0;
+            }
+        }
+
+        testBoxes(activePlanes, numActivePlanes, mask, numPadded, culled, masks);
+
+        for(unsigned int i=0; i<numInBatch; ++i)
+        {
+            bool isContained = (culled[i/4]&(1<<(i%4)))==0;
+            contained[start+i] = isContained;
+            resultMasks[start+i] = masks[i];
+            if (isContained) ++numContained;
+        }
+    }
+    return numContained;
+}
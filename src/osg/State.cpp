@@ -103,6 +103,8 @@ State::State():
 
     _checkGLErrors = ONCE_PER_FRAME;
 
+    _recordingMode = false;
+
     std::string str;
     if (getEnvVar("OSG_GL_ERROR_CHECKING", str))
     {
@@ -1611,9 +1613,12 @@ void State::applyProjectionMatrix(const osg::RefMatrix* matrix)
             updateModelViewAndProjectionMatrixUniforms();
         }
 #ifdef OSG_GL_MATRICES_AVAILABLE
-        glMatrixMode( GL_PROJECTION );
-            glLoadMatrix(_projection->ptr());
-        glMatrixMode( GL_MODELVIEW );
+        if (!_recordingMode)
+        {
+            glMatrixMode( GL_PROJECTION );
+                glLoadMatrix(_projection->ptr());
+            glMatrixMode( GL_MODELVIEW );
+        }
 #endif
     }
 }
@@ -1627,7 +1632,7 @@ void State::loadModelViewMatrix()
     }
 
 #ifdef OSG_GL_MATRICES_AVAILABLE
-    glLoadMatrix(_modelView->ptr());
+    if (!_recordingMode) glLoadMatrix(_modelView->ptr());
 #endif
 }
 
@@ -416,7 +416,7 @@ bool Uniform::setArray( Int64Array* array )
 
 int Uniform::compare(const UniformBase& ub_rhs) const
 {
-    if (typeid(this)!=typeid(&ub_rhs)) return (this<&ub_rhs);
+    if (typeid(*this)!=typeid(ub_rhs)) return this<&ub_rhs ? -1 : 1;
 
     const Uniform& rhs = reinterpret_cast<const Uniform&>(ub_rhs);
 
@@ -438,7 +438,7 @@ int Uniform::compareData(const UniformBase& ub_rhs) const
 {
     // caller must ensure that _type==rhs._type
 
-    if (typeid(this)!=typeid(&ub_rhs)) return (this<&ub_rhs);
+    if (typeid(*this)!=typeid(ub_rhs)) return this<&ub_rhs ? -1 : 1;
 
     const Uniform& rhs = reinterpret_cast<const Uniform&>(ub_rhs);
 
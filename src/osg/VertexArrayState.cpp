@@ -717,7 +717,7 @@ void VertexArrayState::setArray(ArrayDispatch* vad, osg::State& state, const osg
                 vad->enable_and_dispatch(state, new_array);
             }
         }
-        else if (new_array!=vad->array || new_array->getModifiedCount()!=vad->modifiedCount)
+        else if (new_array!=vad->array || new_array->getModifiedCount()!=vad->modifiedCount || vad->streamed)
         {
             GLBufferObject* vbo = isVertexBufferObjectSupported() ? new_array->getOrCreateGLBufferObject(state.getContextID()) : 0;
             if (vbo)
@@ -735,6 +735,10 @@ void VertexArrayState::setArray(ArrayDispatch* vad, osg::State& state, const osg
         vad->array = new_array;
         vad->modifiedCount = new_array->getModifiedCount();
 
+        // streamed arrays move to a new segment of their GLBufferObject whenever any of its arrays are modified.
+        const GLBufferObject* glBufferObject = new_array->getGLBufferObject(state.getContextID());
+        vad->streamed = glBufferObject && glBufferObject->isStreaming();
+
     }
     else if (vad->array)
     {
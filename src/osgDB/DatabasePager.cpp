@@ -47,6 +47,7 @@ static osg::ApplicationUsageProxy DatabasePager_e0(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_DRAWABLE <mode>","Set the drawable policy for setting of loaded drawable to specified type.  mode can be one of DoNotModify, DisplayList, VBO or VertexArrays>.");
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD_MEMORY <megabytes>","Set the target maximum CPU+GPU memory that the subgraphs loaded by the database pager should occupy.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
 
 // Convert function objects that take pointer args into functions that a
@@ -284,6 +285,17 @@ public:
         return (_pagedLODs.count(plod)!=0);
     }
 
+    virtual void collectPagedLODs(osg::NodeList& pagedLODs)
+    {
+        for(PagedLODs::iterator itr = _pagedLODs.begin();
+            itr != _pagedLODs.end();
+            ++itr)
+        {
+            osg::ref_ptr<osg::PagedLOD> plod;
+            if (itr->lock(plod)) pagedLODs.push_back(plod.get());
+        }
+    }
+
 };
 
 
@@ -401,16 +413,123 @@ protected:
 //
 struct DatabasePager::SortFileRequestFunctor
 {
+    SortFileRequestFunctor(const DatabasePager::ComputeRequestPriorityCallback* callback, unsigned int frameNumber):
+        _callback(callback),
+        _frameNumber(frameNumber) {}
+
     bool operator() (const osg::ref_ptr<DatabasePager::DatabaseRequest>& lhs,const osg::ref_ptr<DatabasePager::DatabaseRequest>& rhs) const
     {
-        if (lhs->_timestampLastRequest>rhs->_timestampLastRequest) return true;
+        if (_callback)
+        {
+            return _callback->computeRequestPriority(_frameNumber, lhs->_frameNumberLastRequest, lhs->_timestampLastRequest, lhs->_priorityLastRequest) >
+                   _callback->computeRequestPriority(_frameNumber, rhs->_frameNumberLastRequest, rhs->_timestampLastRequest, rhs->_priorityLastRequest);
+        }
+
+        if (lhs->_frameNumberLastRequest>rhs->_frameNumberLastRequest) return true;
+        else if (lhs->_frameNumberLastRequest<rhs->_frameNumberLastRequest) return false;
+        else if (lhs->_timestampLastRequest>rhs->_timestampLastRequest) return true;
         else if (lhs->_timestampLastRequest<rhs->_timestampLastRequest) return false;
         else return (lhs->_priorityLastRequest>rhs->_priorityLastRequest);
     }
+
+    const DatabasePager::ComputeRequestPriorityCallback* _callback;
+    unsigned int _frameNumber;
 };
 
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  InFlightRead
+//
+class DatabasePager::InFlightRead : public osgDB::ReadCancellationCallback
+{
+public:
+
+    InFlightRead(DatabasePager* pager, DatabaseRequest* databaseRequest, const std::string& fileName, const Options* loadOptions):
+        _pager(pager),
+        _databaseRequest(databaseRequest),
+        _key(fileName, loadOptions) {}
+
+    /** the read is only cancelled once neither the request nor any of the requests coalesced with it are current.*/
+    virtual bool isReadCancelled() const
+    {
+        int frameNumber = _pager->_frameNumber;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        if (_databaseRequest->isRequestCurrent(frameNumber)) return false;
+
+        for(RequestQueue::RequestList::const_iterator itr = _coalescedRequests.begin();
+            itr != _coalescedRequests.end();
+            ++itr)
+        {
+            if ((*itr)->isRequestCurrent(frameNumber)) return false;
+        }
+
+        return true;
+    }
+
+    DatabasePager*                          _pager;
+    osg::ref_ptr<DatabaseRequest>           _databaseRequest;
+    InFlightReadMap::key_type               _key;
+
+    // protected by the pager's _dr_mutex
+    RequestQueue::RequestList               _coalescedRequests;
+
+protected:
+
+    virtual ~InFlightRead() {}
+};
+
+DatabasePager::InFlightRead* DatabasePager::startRead(DatabaseRequest* databaseRequest, const std::string& fileName, const Options* loadOptions)
+{
+    osg::ref_ptr<InFlightRead> inFlightRead = new InFlightRead(this, databaseRequest, fileName, loadOptions);
+
+    if (!_coalesceRequests) return inFlightRead.release();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inFlightReadMutex);
+
+    InFlightReadMap::iterator itr = _inFlightReads.find(inFlightRead->_key);
+    if (itr != _inFlightReads.end())
+    {
+        OSG_INFO<<"DatabasePager::startRead("<<fileName<<") coalescing with in progress read."<<std::endl;
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+        itr->second->_coalescedRequests.push_back(databaseRequest);
+        ++_numCoalescedRequests;
+        return 0;
+    }
+
+    _inFlightReads[inFlightRead->_key] = inFlightRead;
+
+    return inFlightRead.release();
+}
+
+void DatabasePager::completeRead(InFlightRead* inFlightRead, bool loaded)
+{
+    osg::ref_ptr<InFlightRead> inFlightReadRef = inFlightRead;
+
+    if (_coalesceRequests)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inFlightReadMutex);
+        InFlightReadMap::iterator itr = _inFlightReads.find(inFlightRead->_key);
+        if (itr != _inFlightReads.end() && itr->second==inFlightRead) _inFlightReads.erase(itr);
+    }
+
+    // now the read is no longer registered no further requests can be coalesced with it.
+    OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
+    if (loaded)
+    {
+        DatabaseRequest* databaseRequest = inFlightRead->_databaseRequest.get();
+        databaseRequest->_coalescedRequests.splice(databaseRequest->_coalescedRequests.end(), inFlightRead->_coalescedRequests);
+    }
+    else
+    {
+        // the coalesced requests are left orphaned and will be resubmitted by requestNodeFile(..) if still required.
+        inFlightRead->_coalescedRequests.clear();
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  DatabaseRequest
@@ -422,6 +541,7 @@ void DatabasePager::DatabaseRequest::invalidate()
     _loadedModel = 0;
     _compileSet = 0;
     _objectCache = 0;
+    _coalescedRequests.clear();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -568,51 +688,64 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
 
     if (!_requestList.empty())
     {
-        DatabasePager::SortFileRequestFunctor highPriority;
-
-        RequestQueue::RequestList::iterator selected_itr = _requestList.end();
+        takeFirstNoLock(databaseRequest);
 
-        int frameNumber = _pager->_frameNumber;
+        updateBlock();
+    }
+}
 
-        for(RequestQueue::RequestList::iterator citr = _requestList.begin();
-            citr != _requestList.end();
-            )
-        {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
-            {
-                if (selected_itr==_requestList.end() || highPriority(*citr, *selected_itr))
-                {
-                    selected_itr = citr;
-                }
+unsigned int DatabasePager::RequestQueue::takeFirstNoLock(osg::ref_ptr<DatabaseRequest>& databaseRequest)
+{
+    if (_requestList.empty()) return 0;
 
-                ++citr;
-            }
-            else
-            {
-                invalidate(citr->get());
+    unsigned int numRemoved = 0;
 
-                OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<(*citr)<<std::endl;
-                citr = _requestList.erase(citr);
-            }
+    int frameNumber = _pager->_frameNumber;
 
-        }
+    DatabasePager::SortFileRequestFunctor highPriority(_pager->_computeRequestPriorityCallback.get(), frameNumber);
 
-        _frameNumberLastPruned = frameNumber;
+    RequestQueue::RequestList::iterator selected_itr = _requestList.end();
 
-        if (selected_itr != _requestList.end())
+    for(RequestQueue::RequestList::iterator citr = _requestList.begin();
+        citr != _requestList.end();
+        )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        if ((*citr)->isRequestCurrent(frameNumber))
         {
-            databaseRequest = *selected_itr;
-            _requestList.erase(selected_itr);
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
+            if (selected_itr==_requestList.end() || highPriority(*citr, *selected_itr))
+            {
+                selected_itr = citr;
+            }
+
+            ++citr;
         }
         else
         {
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestList.size()<<std::endl;
+            invalidate(citr->get());
+
+            OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<(*citr)<<std::endl;
+            citr = _requestList.erase(citr);
+            ++numRemoved;
         }
 
-        updateBlock();
     }
+
+    _frameNumberLastPruned = frameNumber;
+
+    if (selected_itr != _requestList.end())
+    {
+        databaseRequest = *selected_itr;
+        _requestList.erase(selected_itr);
+        ++numRemoved;
+        OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
+    }
+    else
+    {
+        OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestList.size()<<std::endl;
+    }
+
+    return numRemoved;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -621,14 +754,261 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
 //
 DatabasePager::ReadQueue::ReadQueue(DatabasePager* pager, const std::string& name):
     RequestQueue(pager),
+    _numRequests(0),
     _name(name)
 {
     _block = new osg::RefBlock;
+    _subQueues.push_back(new RequestQueue(pager));
+}
+
+void DatabasePager::ReadQueue::setNumSubQueues(unsigned int numSubQueues)
+{
+    if (numSubQueues==0) numSubQueues = 1;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    // write lock the sub queues so that no DatabaseThread is taking from them while they are replaced.
+    OpenThreads::ScopedWriteLock subQueuesLock(_subQueuesMutex);
+
+    if (numSubQueues==_subQueues.size()) return;
+
+    // gather up all the pending requests, interleaving them so that the highest priority requests
+    // aren't all placed on the same sub queue.
+    RequestList requestList;
+    for(SubQueues::iterator sitr = _subQueues.begin();
+        sitr != _subQueues.end();
+        ++sitr)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> subLock((*sitr)->_requestMutex);
+        requestList.splice(requestList.end(), (*sitr)->_requestList);
+    }
+
+    _subQueues.clear();
+    for(unsigned int i=0; i<numSubQueues; ++i)
+    {
+        _subQueues.push_back(new RequestQueue(_pager));
+    }
+
+    unsigned int index = 0;
+    for(RequestList::iterator itr = requestList.begin();
+        itr != requestList.end();
+        ++itr, ++index)
+    {
+        _subQueues[index%numSubQueues]->_requestList.push_back(*itr);
+    }
+}
+
+unsigned int DatabasePager::ReadQueue::getNumSubQueues() const
+{
+    OpenThreads::ScopedReadLock subQueuesLock(_subQueuesMutex);
+    return static_cast<unsigned int>(_subQueues.size());
+}
+
+// the request count is adjusted whilst the sub queue lists are still locked so that it never disagrees with them.
+void DatabasePager::ReadQueue::addedRequests(unsigned int numAdded)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_numRequestsMutex);
+    _numRequests += numAdded;
+}
+
+void DatabasePager::ReadQueue::removedRequests(unsigned int numRemoved)
+{
+    if (numRemoved==0) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_numRequestsMutex);
+    _numRequests -= numRemoved;
+}
+
+void DatabasePager::ReadQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    {
+        OpenThreads::ScopedReadLock subQueuesLock(_subQueuesMutex);
+
+        RequestQueue* subQueue = _subQueues[(++_nextSubQueue) % _subQueues.size()].get();
+        OpenThreads::ScopedLock<OpenThreads::Mutex> subLock(subQueue->_requestMutex);
+        subQueue->_requestList.push_back(databaseRequest);
+        addedRequests(1);
+    }
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::remove(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedReadLock subQueuesLock(_subQueuesMutex);
+
+    for(SubQueues::iterator sitr = _subQueues.begin();
+        sitr != _subQueues.end();
+        ++sitr)
+    {
+        RequestQueue* subQueue = sitr->get();
+        OpenThreads::ScopedLock<OpenThreads::Mutex> subLock(subQueue->_requestMutex);
+        for(RequestList::iterator citr = subQueue->_requestList.begin();
+            citr != subQueue->_requestList.end();
+            ++citr)
+        {
+            if (citr->get()==databaseRequest)
+            {
+                subQueue->_requestList.erase(citr);
+                removedRequests(1);
+                updateBlock();
+                return;
+            }
+        }
+    }
+}
+
+void DatabasePager::ReadQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest, unsigned int queueIndex)
+{
+    bool requestsRemoved = false;
+    {
+        OpenThreads::ScopedReadLock subQueuesLock(_subQueuesMutex);
+
+        unsigned int numSubQueues = _subQueues.size();
+        unsigned int homeIndex = queueIndex % numSubQueues;
+
+        // first service our own sub queue, then try stealing from the others, skipping over any that are currently
+        // locked by another thread so that an idle thread never waits on a busy one.
+        for(unsigned int i=0; i<numSubQueues && !databaseRequest; ++i)
+        {
+            RequestQueue* subQueue = _subQueues[(homeIndex+i)%numSubQueues].get();
+            if (i==0)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> subLock(subQueue->_requestMutex);
+                unsigned int numRemoved = subQueue->takeFirstNoLock(databaseRequest);
+                removedRequests(numRemoved);
+                requestsRemoved = requestsRemoved || numRemoved>0;
+            }
+            else if (subQueue->_requestMutex.trylock()==0)
+            {
+                unsigned int numRemoved = subQueue->takeFirstNoLock(databaseRequest);
+                removedRequests(numRemoved);
+                requestsRemoved = requestsRemoved || numRemoved>0;
+                subQueue->_requestMutex.unlock();
+            }
+        }
+    }
+
+    if (requestsRemoved) updateBlock();
+}
+
+bool DatabasePager::ReadQueue::pruneOldRequestsAndCheckIfEmpty()
+{
+    unsigned int frameNumber = _pager->_frameNumber;
+    {
+        OpenThreads::ScopedReadLock subQueuesLock(_subQueuesMutex);
+
+        for(SubQueues::iterator sitr = _subQueues.begin();
+            sitr != _subQueues.end();
+            ++sitr)
+        {
+            RequestQueue* subQueue = sitr->get();
+            OpenThreads::ScopedLock<OpenThreads::Mutex> subLock(subQueue->_requestMutex);
+            if (subQueue->_frameNumberLastPruned == frameNumber) continue;
+
+            unsigned int numRemoved = 0;
+            for(RequestList::iterator citr = subQueue->_requestList.begin();
+                citr != subQueue->_requestList.end();
+                )
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                if ((*citr)->isRequestCurrent(frameNumber))
+                {
+                    ++citr;
+                }
+                else
+                {
+                    invalidate(citr->get());
+                    citr = subQueue->_requestList.erase(citr);
+                    ++numRemoved;
+                }
+            }
+
+            removedRequests(numRemoved);
+            subQueue->_frameNumberLastPruned = frameNumber;
+        }
+    }
+
+    updateBlock();
+
+    return empty();
+}
+
+bool DatabasePager::ReadQueue::empty()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_numRequestsMutex);
+    return _numRequests==0;
+}
+
+unsigned int DatabasePager::ReadQueue::size()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_numRequestsMutex);
+    return _numRequests;
+}
+
+void DatabasePager::ReadQueue::clear()
+{
+    {
+        OpenThreads::ScopedReadLock subQueuesLock(_subQueuesMutex);
+
+        for(SubQueues::iterator sitr = _subQueues.begin();
+            sitr != _subQueues.end();
+            ++sitr)
+        {
+            RequestQueue* subQueue = sitr->get();
+            OpenThreads::ScopedLock<OpenThreads::Mutex> subLock(subQueue->_requestMutex);
+            for(RequestList::iterator citr = subQueue->_requestList.begin();
+                citr != subQueue->_requestList.end();
+                ++citr)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                invalidate(citr->get());
+            }
+
+            removedRequests(subQueue->_requestList.size());
+            subQueue->_requestList.clear();
+            subQueue->_frameNumberLastPruned = _pager->_frameNumber;
+        }
+    }
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::addChildrenToDelete(ObjectList& childrenToDelete)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_childrenToDeleteListMutex);
+        // splice transfers the entire list in constant time.
+        _childrenToDeleteList.splice(_childrenToDeleteList.end(), childrenToDelete);
+    }
+
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::takeChildrenToDelete(ObjectList& childrenToDelete)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_childrenToDeleteListMutex);
+        if (_childrenToDeleteList.empty()) return;
+        childrenToDelete.swap(_childrenToDeleteList);
+    }
+
+    updateBlock();
 }
 
 void DatabasePager::ReadQueue::updateBlock()
 {
-    _block->set((!_requestList.empty() || !_childrenToDeleteList.empty()) &&
+    // compute the new block state whilst holding the _blockMutex so that concurrent adds and takes
+    // can't leave the block in a state that doesn't reflect the latest request count.
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_blockMutex);
+
+    bool childrenToDelete = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> childrenLock(_childrenToDeleteListMutex);
+        childrenToDelete = !_childrenToDeleteList.empty();
+    }
+
+    _block->set((!empty() || childrenToDelete) &&
                 !_pager->_databasePagerThreadPaused);
 }
 
@@ -641,7 +1021,8 @@ DatabasePager::DatabaseThread::DatabaseThread(DatabasePager* pager, Mode mode, c
     _active(false),
     _pager(pager),
     _mode(mode),
-    _name(name)
+    _name(name),
+    _queueIndex(0)
 {
 }
 
@@ -650,7 +1031,8 @@ DatabasePager::DatabaseThread::DatabaseThread(const DatabaseThread& dt, Database
     _active(false),
     _pager(pager),
     _mode(dt._mode),
-    _name(dt._name)
+    _name(dt._name),
+    _queueIndex(dt._queueIndex)
 {
 }
 
@@ -737,29 +1119,23 @@ void DatabasePager::DatabaseThread::run()
         //
         if (_pager->_deleteRemovedSubgraphsInDatabaseThread/* && !(read_queue->_childrenToDeleteList.empty())*/)
         {
+            // Don't hold lock during destruction of deleteList
             ObjectList deleteList;
-            {
-                // Don't hold lock during destruction of deleteList
-                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(read_queue->_requestMutex);
-                if (!read_queue->_childrenToDeleteList.empty())
-                {
-                    deleteList.swap(read_queue->_childrenToDeleteList);
-                    read_queue->updateBlock();
-                }
-            }
+            read_queue->takeChildrenToDelete(deleteList);
         }
 
         //
         // load any subgraphs that are required.
         //
         osg::ref_ptr<DatabaseRequest> databaseRequest;
-        read_queue->takeFirst(databaseRequest);
+        read_queue->takeFirst(databaseRequest, _queueIndex);
 
         bool readFromFileCache = false;
 
         osg::ref_ptr<FileCache> fileCache = osgDB::Registry::instance()->getFileCache();
         osg::ref_ptr<FileLocationCallback> fileLocationCallback = osgDB::Registry::instance()->getFileLocationCallback();
         osg::ref_ptr<Options> dr_loadOptions;
+        osg::ref_ptr<Options> loadOptions;
         std::string fileName;
         int frameNumberLastRequest = 0;
         bool cacheNodes = false;
@@ -767,6 +1143,7 @@ void DatabasePager::DatabaseThread::run()
         {
             {
                 OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+                loadOptions = databaseRequest->_loadOptions;
                 dr_loadOptions = databaseRequest->_loadOptions.valid() ? databaseRequest->_loadOptions->cloneOptions() : new osgDB::Options;
                 dr_loadOptions->setTerrain(databaseRequest->_terrain);
                 dr_loadOptions->setParentGroup(databaseRequest->_group);
@@ -804,10 +1181,14 @@ void DatabasePager::DatabaseThread::run()
                 {
                     //OSG_NOTICE<<"Found object in cache "<<fileName<<std::endl;
 
+                    osg::MemoryPair memoryUsage(0.0,0.0);
+                    if (_pager->_targetMaximumMemoryUsage>0.0) memoryUsage = _pager->_graphicsCostEstimator->estimateMemoryUsage(modelFromCache);
+
                     // assign the cached model to the request
                     {
                         OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                         databaseRequest->_loadedModel = modelFromCache;
+                        databaseRequest->_memoryUsage = memoryUsage;
                     }
 
                     // move the request to the dataToMerge list so it can be merged during the update phase of the frame.
@@ -896,6 +1277,15 @@ void DatabasePager::DatabaseThread::run()
         }
 
 
+        // register the read so that other requests for the same file can share it rather than reading it again.
+        osg::ref_ptr<InFlightRead> inFlightRead;
+        if (databaseRequest.valid())
+        {
+            inFlightRead = _pager->startRead(databaseRequest.get(), fileName, loadOptions.get());
+            if (!inFlightRead) databaseRequest = 0;
+            else if (_pager->_cancelInFlightReads) dr_loadOptions->setReadCancellationCallback(inFlightRead.get());
+        }
+
         if (databaseRequest.valid())
         {
 
@@ -912,7 +1302,12 @@ void DatabasePager::DatabaseThread::run()
 
             osg::ref_ptr<osg::Node> loadedModel;
             if (rr.validNode()) loadedModel = rr.getNode();
-            if (!rr.success()) OSG_WARN<<"Error in reading file "<<fileName<<" : "<<rr.statusMessage() << std::endl;
+            if (rr.cancelled())
+            {
+                OSG_INFO<<_name<<": Read of "<<fileName<<" cancelled as no longer required."<<std::endl;
+                ++(_pager->_numCancelledReads);
+            }
+            else if (!rr.success()) OSG_WARN<<"Error in reading file "<<fileName<<" : "<<rr.statusMessage() << std::endl;
 
             if (loadedModel.valid() &&
                 fileCache.valid() &&
@@ -922,13 +1317,19 @@ void DatabasePager::DatabaseThread::run()
                 fileCache->writeNode(*(loadedModel), fileName, dr_loadOptions.get());
             }
 
+            // the loaded subgraph may keep a reference to the Options, so don't leave it holding on to the request.
+            dr_loadOptions->setReadCancellationCallback(0);
+
+            _pager->completeRead(inFlightRead.get(), loadedModel.valid());
+
+            // the loaded model is still required if this or any of the requests coalesced with it are current.
+            if (loadedModel.valid() && inFlightRead->isReadCancelled())
             {
+                OSG_INFO<<_name<<": Warning DatabaseRquest no longer required."<<std::endl;
+                loadedModel = 0;
+
                 OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-                if ((_pager->_frameNumber-databaseRequest->_frameNumberLastRequest)>1)
-                {
-                    OSG_INFO<<_name<<": Warning DatabaseRquest no longer required."<<std::endl;
-                    loadedModel = 0;
-                }
+                databaseRequest->_coalescedRequests.clear();
             }
 
             //OSG_NOTICE<<"     node read in "<<osg::Timer::instance()->delta_m(before,osg::Timer::instance()->tick())<<" ms"<<std::endl;
@@ -941,6 +1342,11 @@ void DatabasePager::DatabaseThread::run()
                 osg::ref_ptr<osgUtil::IncrementalCompileOperation::CompileSet> compileSet = 0;
                 if (!rr.loadedFromCache())
                 {
+                    // share state with the rest of the scene before compiling, so that state already compiled isn't compiled again,
+                    // the SharedStateManager is thread safe and the subgraph isn't in the scene yet so no scene mutex is required.
+                    if (osgDB::Registry::instance()->getSharedStateManager())
+                        osgDB::Registry::instance()->getSharedStateManager()->share(loadedModel.get());
+
                     // find all the compileable rendering objects
                     DatabasePager::FindCompileableGLObjectsVisitor stateToCompile(_pager, _pager->getMarkerObject());
                     loadedModel->accept(stateToCompile);
@@ -966,11 +1372,15 @@ void DatabasePager::DatabaseThread::run()
                     OSG_NOTICE<<"Loaded from ObjectCache"<<std::endl;
                 }
 
+                // estimate the memory the subgraph will occupy so the update thread can keep within the memory budget.
+                osg::MemoryPair memoryUsage(0.0,0.0);
+                if (_pager->_targetMaximumMemoryUsage>0.0) memoryUsage = _pager->_graphicsCostEstimator->estimateMemoryUsage(loadedModel.get());
 
                 {
                     OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                     databaseRequest->_loadedModel = loadedModel;
                     databaseRequest->_compileSet = compileSet;
+                    databaseRequest->_memoryUsage = memoryUsage;
                 }
                 // Dereference the databaseRequest while the queue is
                 // locked. This prevents the request from being
@@ -1075,6 +1485,9 @@ DatabasePager::DatabasePager()
     _valueAnisotropy = 1.0f;
 
 
+    _cancelInFlightReads = false;
+    _coalesceRequests = false;
+
     _deleteRemovedSubgraphsInDatabaseThread = true;
     if( (str = getenv("OSG_DELETE_IN_DATABASE_THREAD")) != 0)
     {
@@ -1090,6 +1503,17 @@ DatabasePager::DatabasePager()
         OSG_NOTICE<<"_targetMaximumNumberOfPageLOD = "<<_targetMaximumNumberOfPageLOD<<std::endl;
     }
 
+    _targetMaximumMemoryUsage = 0.0;
+    if( (str = getenv("OSG_MAX_PAGEDLOD_MEMORY")) != 0)
+    {
+        _targetMaximumMemoryUsage = osg::asciiToDouble(str)*1024.0*1024.0;
+        OSG_NOTICE<<"_targetMaximumMemoryUsage = "<<_targetMaximumMemoryUsage<<std::endl;
+    }
+
+    _graphicsCostEstimator = new osg::GraphicsCostEstimator;
+    _memoryUsage = osg::MemoryPair(0.0,0.0);
+    _overMemoryBudget = false;
+
 
     _doPreCompile = true;
     if( (str = getenv("OSG_DO_PRE_COMPILE")) != 0)
@@ -1169,23 +1593,41 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _deleteRemovedSubgraphsInDatabaseThread = rhs._deleteRemovedSubgraphsInDatabaseThread;
 
+    _cancelInFlightReads = rhs._cancelInFlightReads;
+    _coalesceRequests = rhs._coalesceRequests;
+
     _targetMaximumNumberOfPageLOD = rhs._targetMaximumNumberOfPageLOD;
 
+    _targetMaximumMemoryUsage = rhs._targetMaximumMemoryUsage;
+    _graphicsCostEstimator = rhs._graphicsCostEstimator;
+    _memoryUsage = osg::MemoryPair(0.0,0.0);
+    _overMemoryBudget = false;
+
     _doPreCompile = rhs._doPreCompile;
 
+    // initialize the stats variables
+    resetStats();
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
 
+    _computeRequestPriorityCallback = rhs._computeRequestPriorityCallback;
+
+    unsigned int numHttpThreads = 0;
     for(DatabaseThreadList::const_iterator dt_itr = rhs._databaseThreads.begin();
         dt_itr != rhs._databaseThreads.end();
         ++dt_itr)
     {
         _databaseThreads.push_back(new DatabaseThread(**dt_itr,this));
+        if ((*dt_itr)->getMode()==DatabaseThread::HANDLE_ONLY_HTTP) ++numHttpThreads;
     }
 
+    _fileRequestQueue->setNumSubQueues(_databaseThreads.size()-numHttpThreads);
+    _httpRequestQueue->setNumSubQueues(numHttpThreads);
+
     setProcessorAffinity(rhs.getProcessorAffinity());
 
     _activePagedLODList = rhs._activePagedLODList->clone();
@@ -1265,6 +1707,10 @@ void DatabasePager::setUpThreads(unsigned int totalNumThreads, unsigned int numH
         totalNumThreads - numHttpThreads :
         1;
 
+    // give each thread its own sub queue to service so that the threads don't contend on a single queue.
+    _fileRequestQueue->setNumSubQueues(numGeneralThreads);
+    _httpRequestQueue->setNumSubQueues(numHttpThreads);
+
     if (numHttpThreads==0)
     {
         for(unsigned int i=0; i<numGeneralThreads; ++i)
@@ -1294,6 +1740,16 @@ unsigned int DatabasePager::addDatabaseThread(DatabaseThread::Mode mode, const s
 
     DatabaseThread* thread = new DatabaseThread(this, mode,name);
 
+    // assign the thread the next free index amongst the threads servicing the same queue.
+    unsigned int queueIndex = 0;
+    for(DatabaseThreadList::const_iterator dt_itr = _databaseThreads.begin();
+        dt_itr != _databaseThreads.end();
+        ++dt_itr)
+    {
+        if (((*dt_itr)->getMode()==DatabaseThread::HANDLE_ONLY_HTTP) == (mode==DatabaseThread::HANDLE_ONLY_HTTP)) ++queueIndex;
+    }
+    thread->setQueueIndex(queueIndex);
+
     thread->setProcessorAffinity(_affinity);
 
     _databaseThreads.push_back(thread);
@@ -1370,6 +1826,10 @@ void DatabasePager::clear()
     // note, no need to use a mutex as the list is only accessed from the update thread.
     _activePagedLODList->clear();
 
+    _memoryUsageMap.clear();
+    _memoryUsage = osg::MemoryPair(0.0,0.0);
+    _overMemoryBudget = false;
+
     // ??
     // _activeGraphicsContexts
 }
@@ -1381,6 +1841,21 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+    _numCoalescedRequests.exchange(0);
+    _numCancelledReads.exchange(0);
+    _numMemoryBudgetHits = 0;
+    _numMemoryBudgetMisses = 0;
+    _numMemoryBudgetExpiredSubgraphs = 0;
+}
+
+void DatabasePager::reportStats(unsigned int frameNumber, osg::Stats& stats) const
+{
+    stats.setAttribute(frameNumber, "DatabasePager CPU memory usage", _memoryUsage.first);
+    stats.setAttribute(frameNumber, "DatabasePager GPU memory usage", _memoryUsage.second);
+    stats.setAttribute(frameNumber, "DatabasePager memory budget", _targetMaximumMemoryUsage);
+    stats.setAttribute(frameNumber, "DatabasePager memory budget hits", _numMemoryBudgetHits);
+    stats.setAttribute(frameNumber, "DatabasePager memory budget misses", _numMemoryBudgetMisses);
+    stats.setAttribute(frameNumber, "DatabasePager memory budget expired subgraphs", _numMemoryBudgetExpiredSubgraphs);
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1596,14 +2071,9 @@ void DatabasePager::setDatabasePagerThreadPause(bool pause)
     if (_databasePagerThreadPaused == pause) return;
 
     _databasePagerThreadPaused = pause;
-    {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
-        _fileRequestQueue->updateBlock();
-    }
-    {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
-        _httpRequestQueue->updateBlock();
-    }
+
+    _fileRequestQueue->updateBlock();
+    _httpRequestQueue->updateBlock();
 }
 
 
@@ -1667,6 +2137,33 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
     // get the data from the _dataToMergeList, leaving it empty via a std::vector<>.swap.
     _dataToMergeList->swap(localFileLoadedList);
 
+    // requests that were coalesced with the read of another request are merged alongside it, each with its own copy
+    // of the loaded nodes so that expiring the subgraph from one parent doesn't affect the others, the drawables,
+    // state and other leaf data being shared between the copies.
+    for(RequestQueue::RequestList::iterator itr=localFileLoadedList.begin();
+        itr!=localFileLoadedList.end();
+        ++itr)
+    {
+        DatabaseRequest* databaseRequest = itr->get();
+        if (databaseRequest->_coalescedRequests.empty()) continue;
+
+        RequestQueue::RequestList coalescedRequests;
+        coalescedRequests.swap(databaseRequest->_coalescedRequests);
+
+        RequestQueue::RequestList::iterator insert_itr = itr;
+        ++insert_itr;
+        for(RequestQueue::RequestList::iterator citr=coalescedRequests.begin();
+            citr!=coalescedRequests.end();
+            ++citr)
+        {
+            if ((*citr)->valid() && databaseRequest->_loadedModel.valid())
+            {
+                (*citr)->_loadedModel = osg::clone(databaseRequest->_loadedModel.get(), osg::CopyOp::DEEP_COPY_NODES);
+                localFileLoadedList.insert(insert_itr, *citr);
+            }
+        }
+    }
+
     mid = osg::Timer::instance()->tick();
 
     // add the loaded data into the scene graph.
@@ -1682,9 +2179,6 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
         osg::ref_ptr<osg::Group> group;
         if (!databaseRequest->_groupExpired && databaseRequest->_group.lock(group))
         {
-            if (osgDB::Registry::instance()->getSharedStateManager())
-                osgDB::Registry::instance()->getSharedStateManager()->share(databaseRequest->_loadedModel.get());
-
             osg::PagedLOD* plod = dynamic_cast<osg::PagedLOD*>(group.get());
             if (plod)
             {
@@ -1703,6 +2197,8 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
             group->addChild(databaseRequest->_loadedModel.get());
 
+            if (_targetMaximumMemoryUsage>0.0) addMemoryUsage(databaseRequest->_loadedModel.get(), databaseRequest->_memoryUsage);
+
             // Check if parent plod was already registered if not start visitor from parent
             if( plod &&
                 !_activePagedLODList->containsPagedLOD( plod ) )
@@ -1791,9 +2287,12 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
     if (s_total_max_stage_a<time_a) s_total_max_stage_a = time_a;
 
 
-    if (numPagedLODs <= _targetMaximumNumberOfPageLOD)
+    bool overMemoryBudget = _targetMaximumMemoryUsage>0.0 && (_memoryUsage.first+_memoryUsage.second) > _targetMaximumMemoryUsage;
+
+    if (numPagedLODs <= _targetMaximumNumberOfPageLOD && !overMemoryBudget)
     {
         // nothing to do
+        if (_targetMaximumMemoryUsage>0.0) updateMemoryBudgetStats();
         return;
     }
 
@@ -1816,6 +2315,18 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
         _activePagedLODList->removeExpiredChildren(
             numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
 
+    if (_targetMaximumMemoryUsage>0.0)
+    {
+        for(ObjectList::iterator itr = childrenRemoved.begin();
+            itr != childrenRemoved.end();
+            ++itr)
+        {
+            releaseMemoryUsage(dynamic_cast<osg::Node*>(itr->get()));
+        }
+
+        removeExpiredSubgraphsToMeetMemoryBudget(frameStamp, childrenRemoved);
+    }
+
     osg::Timer_t end_b_Tick = osg::Timer::instance()->tick();
     double time_b = osg::Timer::instance()->delta_m(end_a_Tick,end_b_Tick);
 
@@ -1830,12 +2341,7 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
         // pass the objects across to the database pager delete list
         if (_deleteRemovedSubgraphsInDatabaseThread)
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
-            // splice transfers the entire list in constant time.
-            _fileRequestQueue->_childrenToDeleteList.splice(
-                _fileRequestQueue->_childrenToDeleteList.end(),
-                childrenRemoved);
-            _fileRequestQueue->updateBlock();
+            _fileRequestQueue->addChildrenToDelete(childrenRemoved);
         }
         else
             childrenRemoved.clear();
@@ -1854,6 +2360,183 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
                               " C="<<time_c<<" avg="<<s_total_time_stage_c/s_total_iter_stage_c<<" max = "<<s_total_max_stage_c<<std::endl;
 }
 
+// Removes the memory accounting entries of all the merged subgraphs within a removed subgraph.
+class ReleaseMemoryUsageVisitor : public osg::NodeVisitor
+{
+public:
+
+    typedef std::set<const osg::Node*> Nodes;
+
+    ReleaseMemoryUsageVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::PagedLOD& plod)
+    {
+        // only the children of PagedLOD/ProxyNode are merged by the pager
+        for(unsigned int i=0; i<plod.getNumChildren(); ++i) _nodes.insert(plod.getChild(i));
+        traverse(plod);
+    }
+
+    virtual void apply(osg::ProxyNode& proxyNode)
+    {
+        for(unsigned int i=0; i<proxyNode.getNumChildren(); ++i) _nodes.insert(proxyNode.getChild(i));
+        traverse(proxyNode);
+    }
+
+    Nodes _nodes;
+};
+
+void DatabasePager::addMemoryUsage(osg::Node* node, const osg::MemoryPair& memoryUsage)
+{
+    MemoryUsageEntry& entry = _memoryUsageMap[node];
+
+    // a subgraph shared by several coalesced requests only occupies memory once.
+    if (entry._node.valid()) return;
+
+    // discount any stale entry left by a deleted subgraph at the same address.
+    _memoryUsage.first -= entry._memoryUsage.first;
+    _memoryUsage.second -= entry._memoryUsage.second;
+
+    entry = MemoryUsageEntry(node, memoryUsage);
+    _memoryUsage.first += memoryUsage.first;
+    _memoryUsage.second += memoryUsage.second;
+}
+
+void DatabasePager::releaseMemoryUsage(osg::Node* removedChild)
+{
+    // the subgraph is still in use elsewhere in the scene graph.
+    if (!removedChild || removedChild->getNumParents()>0 || _memoryUsageMap.empty()) return;
+
+    ReleaseMemoryUsageVisitor rmuv;
+    rmuv._nodes.insert(removedChild);
+    removedChild->accept(rmuv);
+
+    for(ReleaseMemoryUsageVisitor::Nodes::iterator itr = rmuv._nodes.begin();
+        itr != rmuv._nodes.end();
+        ++itr)
+    {
+        MemoryUsageMap::iterator mitr = _memoryUsageMap.find(*itr);
+        if (mitr != _memoryUsageMap.end())
+        {
+            _memoryUsage.first -= mitr->second._memoryUsage.first;
+            _memoryUsage.second -= mitr->second._memoryUsage.second;
+            _memoryUsageMap.erase(mitr);
+        }
+    }
+}
+
+struct LessRecentlyVisible
+{
+    bool operator() (const osg::ref_ptr<osg::Node>& lhs, const osg::ref_ptr<osg::Node>& rhs) const
+    {
+        const osg::PagedLOD* lhs_plod = static_cast<const osg::PagedLOD*>(lhs.get());
+        const osg::PagedLOD* rhs_plod = static_cast<const osg::PagedLOD*>(rhs.get());
+        unsigned int lhs_child = lhs_plod->getNumChildren()-1;
+        unsigned int rhs_child = rhs_plod->getNumChildren()-1;
+        if (lhs_plod->getFrameNumber(lhs_child) < rhs_plod->getFrameNumber(rhs_child)) return true;
+        if (rhs_plod->getFrameNumber(rhs_child) < lhs_plod->getFrameNumber(lhs_child)) return false;
+        return lhs_plod->getTimeStamp(lhs_child) < rhs_plod->getTimeStamp(rhs_child);
+    }
+};
+
+void DatabasePager::removeExpiredSubgraphsToMeetMemoryBudget(const osg::FrameStamp& frameStamp, ObjectList& childrenRemoved)
+{
+    // purge entries of subgraphs that have been deleted without going through the pager's expiry.
+    for(MemoryUsageMap::iterator itr = _memoryUsageMap.begin();
+        itr != _memoryUsageMap.end();
+        )
+    {
+        if (!itr->second._node.valid())
+        {
+            _memoryUsage.first -= itr->second._memoryUsage.first;
+            _memoryUsage.second -= itr->second._memoryUsage.second;
+            _memoryUsageMap.erase(itr++);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+
+    if ((_memoryUsage.first+_memoryUsage.second) <= _targetMaximumMemoryUsage)
+    {
+        updateMemoryBudgetStats();
+        return;
+    }
+
+    double expiryTime = frameStamp.getReferenceTime() - 0.1;
+    unsigned int expiryFrame = frameStamp.getFrameNumber() - 1;
+
+    // collect the PagedLOD whose highest resolution child could be expired, then
+    // expire them in order of when they were last visible.
+    osg::NodeList candidates;
+    {
+        osg::NodeList pagedLODs;
+        _activePagedLODList->collectPagedLODs(pagedLODs);
+        for(osg::NodeList::iterator itr = pagedLODs.begin();
+            itr != pagedLODs.end();
+            ++itr)
+        {
+            osg::PagedLOD* plod = static_cast<osg::PagedLOD*>(itr->get());
+            unsigned int numChildren = plod->getNumChildren();
+            if (numChildren>plod->getNumChildrenThatCannotBeExpired() &&
+                !plod->getFileName(numChildren-1).empty() &&
+                plod->getFrameNumber(numChildren-1) < expiryFrame)
+            {
+                candidates.push_back(plod);
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), LessRecentlyVisible());
+
+    ExpirePagedLODsVisitor expirePagedLODsVisitor;
+    for(osg::NodeList::iterator itr = candidates.begin();
+        itr != candidates.end() && (_memoryUsage.first+_memoryUsage.second) > _targetMaximumMemoryUsage;
+        ++itr)
+    {
+        osg::PagedLOD* plod = static_cast<osg::PagedLOD*>(itr->get());
+
+        // skip PagedLOD that were within subgraphs expired earlier in this loop.
+        if (expirePagedLODsVisitor._childPagedLODs.count(plod)!=0) continue;
+
+        osg::NodeList expiredChildren;
+        if (expirePagedLODsVisitor.removeExpiredChildrenAndFindPagedLODs(plod, expiryTime, expiryFrame, expiredChildren))
+        {
+            for(osg::NodeList::iterator citr = expiredChildren.begin();
+                citr != expiredChildren.end();
+                ++citr)
+            {
+                releaseMemoryUsage(citr->get());
+                childrenRemoved.push_back(citr->get());
+                ++_numMemoryBudgetExpiredSubgraphs;
+            }
+        }
+    }
+
+    if (!expirePagedLODsVisitor._childPagedLODs.empty())
+    {
+        osg::NodeList childPagedLODs(expirePagedLODsVisitor._childPagedLODs.begin(), expirePagedLODsVisitor._childPagedLODs.end());
+        _activePagedLODList->removeNodes(childPagedLODs);
+    }
+
+    updateMemoryBudgetStats();
+
+    OSG_INFO<<"DatabasePager memory usage CPU="<<_memoryUsage.first<<" GPU="<<_memoryUsage.second<<" budget="<<_targetMaximumMemoryUsage<<std::endl;
+}
+
+void DatabasePager::updateMemoryBudgetStats()
+{
+    // count the transitions into and out of the budget, rather than every frame spent either side of it.
+    bool overMemoryBudget = (_memoryUsage.first+_memoryUsage.second) > _targetMaximumMemoryUsage;
+    if (overMemoryBudget==_overMemoryBudget) return;
+
+    if (overMemoryBudget) ++_numMemoryBudgetMisses;
+    else ++_numMemoryBudgetHits;
+
+    _overMemoryBudget = overMemoryBudget;
+}
+
 class DatabasePager::FindPagedLODsVisitor : public osg::NodeVisitor
 {
 public:
@@ -0,0 +1,266 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/ExternalFileLoader>
+#include <osgDB/Registry>
+#include <osgDB/ReadFile>
+
+#include <osg/Notify>
+#include <osg/NodeVisitor>
+#include <osg/StateSet>
+#include <osg/Texture>
+
+#include <OpenThreads/ScopedLock>
+
+#include <string.h>
+
+using namespace osgDB;
+
+// Loaded nodes may be shared via the object cache, so insert them into their parents one loader at a time
+// to avoid concurrent modification of their parent lists.
+static OpenThreads::Mutex s_mergeMutex;
+
+class ExternalFileLoader::ReadOperation : public osg::Operation
+{
+    public:
+
+        ReadOperation(ExternalFileLoader* loader, const std::string& fileName, const Options* options):
+            osg::Operation("ExternalFileLoader::ReadOperation", false),
+            _loader(loader),
+            _fileName(fileName),
+            _options(options),
+            _childIndex(0),
+            _imageHints(0) {}
+
+        virtual void operator () (osg::Object*)
+        {
+            if (_parent.valid())
+            {
+                _loadedNode = osgDB::readRefNodeFile(_fileName, _options.get());
+            }
+            else if (_image.valid())
+            {
+                ReaderWriter::ReadResult rr = Registry::instance()->readImage(_fileName, _options.get());
+                if (rr.validImage()) _loadedImage = rr.takeImage();
+                else if (!rr.success()) OSG_WARN << "ExternalFileLoader: " << rr.statusMessage() << ", filename: " << _fileName << std::endl;
+            }
+
+            _loader->readCompleted();
+        }
+
+        void merge()
+        {
+            if (_parent.valid() && _loadedNode.valid())
+            {
+                _parent->insertChild(_childIndex, _loadedNode.get());
+            }
+            else if (_image.valid())
+            {
+                if (_loadedImage.valid() && _loadedImage->data()) assignImage(*_image, *_loadedImage);
+                else if ((_imageHints & KEEP_IMAGE_ON_FAILURE)==0) _loader->_failedImages.insert(_image);
+            }
+        }
+
+        static void assignImage(osg::Image& image, osg::Image& loadedImage)
+        {
+            // only the pixel data and the properties derived from the external file are taken from it, as they would be
+            // when reading serially, the name, user data and data variance read from the stream into image are kept.
+            unsigned char* data = 0;
+            osg::Image::AllocationMode allocationMode = loadedImage.getAllocationMode();
+            if (allocationMode!=osg::Image::NO_DELETE && loadedImage.referenceCount()==1)
+            {
+                // the loaded image isn't shared so take ownership of its data rather than copying it.
+                data = loadedImage.data();
+                loadedImage.setAllocationMode(osg::Image::NO_DELETE);
+            }
+            else
+            {
+                unsigned int size = loadedImage.getTotalSizeInBytesIncludingMipmaps();
+                data = new unsigned char[size];
+                memcpy(data, loadedImage.data(), size);
+                allocationMode = osg::Image::USE_NEW_DELETE;
+            }
+
+            image.setImage(loadedImage.s(), loadedImage.t(), loadedImage.r(),
+                           loadedImage.getInternalTextureFormat(), loadedImage.getPixelFormat(), loadedImage.getDataType(),
+                           data, allocationMode,
+                           loadedImage.getPacking(), loadedImage.getRowLength());
+            image.setMipmapLevels(loadedImage.getMipmapLevels());
+            image.setOrigin(loadedImage.getOrigin());
+            image.setPixelAspectRatio(loadedImage.getPixelAspectRatio());
+        }
+
+        ExternalFileLoader*         _loader;
+        std::string                 _fileName;
+        osg::ref_ptr<const Options> _options;
+
+        osg::ref_ptr<osg::Group>    _parent;
+        unsigned int                _childIndex;
+        osg::ref_ptr<osg::Node>     _loadedNode;
+
+        osg::ref_ptr<osg::Image>    _image;
+        unsigned int                _imageHints;
+        osg::ref_ptr<osg::Image>    _loadedImage;
+};
+
+class RemoveFailedImagesVisitor : public osg::NodeVisitor
+{
+    public:
+
+        RemoveFailedImagesVisitor(const std::set< osg::ref_ptr<osg::Image> >& failedImages):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _failedImages(failedImages) {}
+
+        virtual void apply(osg::Node& node)
+        {
+            if (node.getStateSet()) apply(*node.getStateSet());
+            traverse(node);
+        }
+
+        void apply(osg::StateSet& stateset)
+        {
+            osg::StateSet::TextureAttributeList& textureAttributeList = stateset.getTextureAttributeList();
+            for(osg::StateSet::TextureAttributeList::iterator titr = textureAttributeList.begin();
+                titr != textureAttributeList.end();
+                ++titr)
+            {
+                for(osg::StateSet::AttributeList::iterator aitr = titr->begin();
+                    aitr != titr->end();
+                    ++aitr)
+                {
+                    osg::Texture* texture = aitr->second.first->asTexture();
+                    if (texture) apply(*texture);
+                }
+            }
+        }
+
+        void apply(osg::Texture& texture)
+        {
+            for(unsigned int i=0; i<texture.getNumImages(); ++i)
+            {
+                osg::ref_ptr<osg::Image> image = texture.getImage(i);
+                if (image.valid() && _failedImages.count(image)!=0) texture.setImage(i, 0);
+            }
+        }
+
+    protected:
+
+        const std::set< osg::ref_ptr<osg::Image> >& _failedImages;
+};
+
+ExternalFileLoader::ExternalFileLoader():
+    _numPendingReads(0)
+{
+}
+
+ExternalFileLoader::~ExternalFileLoader()
+{
+    // make sure no read operations are left referencing this loader.
+    complete();
+}
+
+void ExternalFileLoader::addNode(const std::string& fileName, const Options* options, osg::Group* parent, unsigned int childIndex)
+{
+    if (!parent) return;
+
+    osg::ref_ptr<ReadOperation> operation = new ReadOperation(this, fileName, options);
+    operation->_parent = parent;
+    operation->_childIndex = childIndex;
+    add(operation.get());
+}
+
+void ExternalFileLoader::addImage(const std::string& fileName, const Options* options, osg::Image* image, unsigned int hints)
+{
+    if (!image) return;
+
+    osg::ref_ptr<ReadOperation> operation = new ReadOperation(this, fileName, options);
+    operation->_image = image;
+    operation->_imageHints = hints;
+    add(operation.get());
+}
+
+void ExternalFileLoader::add(ReadOperation* operation)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _readOperations.push_back(operation);
+        ++_numPendingReads;
+    }
+
+    Registry::instance()->getOrCreateReadOperationQueue()->add(operation);
+}
+
+void ExternalFileLoader::readCompleted()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    --_numPendingReads;
+    if (_numPendingReads==0) _condition.broadcast();
+}
+
+unsigned int ExternalFileLoader::getNumPendingReads() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return _numPendingReads;
+}
+
+void ExternalFileLoader::complete()
+{
+    if (_readOperations.empty()) return;
+
+    // help with the queued reads rather than just blocking, so that a nested load on a read thread,
+    // or a Registry without read threads, can't leave reads queued with nothing to service them.
+    osg::ref_ptr<osg::OperationQueue> operationQueue = Registry::instance()->getOrCreateReadOperationQueue();
+    while(getNumPendingReads()>0)
+    {
+        osg::ref_ptr<osg::Operation> operation = operationQueue->getNextOperation(false);
+        if (operation.valid())
+        {
+            (*operation)(0);
+        }
+        else
+        {
+            // all of the remaining reads are being serviced by other threads.
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            while(_numPendingReads>0) _condition.wait(&_mutex);
+        }
+    }
+
+    OSG_INFO<<"ExternalFileLoader::complete() merging "<<_readOperations.size()<<" external reads"<<std::endl;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_mergeMutex);
+        for(ReadOperations::iterator itr = _readOperations.begin();
+            itr != _readOperations.end();
+            ++itr)
+        {
+            (*itr)->merge();
+        }
+    }
+
+    _readOperations.clear();
+}
+
+bool ExternalFileLoader::removeFailedImages(osg::Object* object)
+{
+    if (_failedImages.empty() || !object) return false;
+
+    OSG_INFO<<"ExternalFileLoader::removeFailedImages() removing "<<_failedImages.size()<<" images"<<std::endl;
+
+    RemoveFailedImagesVisitor rfiv(_failedImages);
+    if (object->asNode()) object->asNode()->accept(rfiv);
+    else if (object->asStateSet()) rfiv.apply(*object->asStateSet());
+    else if (object->asStateAttribute() && object->asStateAttribute()->asTexture()) rfiv.apply(*object->asStateAttribute()->asTexture());
+
+    osg::Image* image = dynamic_cast<osg::Image*>(object);
+    return image && _failedImages.count(image)!=0;
+}
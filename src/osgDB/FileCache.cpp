@@ -16,25 +16,536 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <osgDB/fstream>
+#include <osgDB/Registry>
+
+#include <osg/LOD>
+#include <osg/PagedLOD>
+#include <osg/Transform>
+
+#include <OpenThreads/ScopedLock>
+
+#include <stdio.h>
+#include <sstream>
 
 using namespace osgDB;
 
+namespace
+{
+
+const char* const indexFileName = "filecache.index";
+const char* const indexHeader = "osgDB::FileCache index 1";
+
+// number of files written between writes of the index.
+const unsigned int indexWriteInterval = 64;
+
+/** Adler-32 checksum of the contents of a file.*/
+unsigned int computeChecksum(const std::string& data)
+{
+    const unsigned int base = 65521;
+    unsigned int a = 1, b = 0;
+
+    std::string::size_type pos = 0;
+    while(pos<data.size())
+    {
+        // 5552 is the largest number of bytes that can be summed before b overflows.
+        std::string::size_type blockEnd = osg::minimum(data.size(), pos+5552);
+        for(; pos<blockEnd; ++pos)
+        {
+            a += static_cast<unsigned char>(data[pos]);
+            b += a;
+        }
+        a %= base;
+        b %= base;
+    }
+    return (b << 16) | a;
+}
+
+bool readFileContents(const std::string& fileName, std::string& data)
+{
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return false;
+
+    std::ostringstream buffer;
+    buffer<<fin.rdbuf();
+    if (fin.bad()) return false;
+
+    data = buffer.str();
+    return true;
+}
+
+/** Write a file through a temporary file renamed over it, so that readers never see it partly written.*/
+bool writeFileContents(const std::string& fileName, const std::string& data)
+{
+    static OpenThreads::Atomic s_numTemporaryFiles;
+
+    std::ostringstream tmpFileName;
+    tmpFileName<<fileName<<"."<<++s_numTemporaryFiles<<".tmp";
+
+    {
+        osgDB::ofstream fout(tmpFileName.str().c_str(), std::ios::out | std::ios::binary);
+        if (!fout) return false;
+
+        fout.write(data.data(), data.size());
+        fout.close();
+        if (fout.fail())
+        {
+            remove(tmpFileName.str().c_str());
+            return false;
+        }
+    }
+
+#if defined(_WIN32)
+    // rename() doesn't replace an existing file on Windows.
+    remove(fileName.c_str());
+#endif
+
+    if (rename(tmpFileName.str().c_str(), fileName.c_str())!=0)
+    {
+        remove(tmpFileName.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+/** Options for reading or writing a cache file to a stream, as the osg plugin's own options for the file would be,
+  * but with the original file's path as the database path so that the PagedLODs read keep referring to the remote
+  * database rather than the cache.*/
+osg::ref_ptr<osgDB::Options> createSerializationOptions(const std::string& originalFileName, const std::string& cacheFileName, const osgDB::Options* options)
+{
+    osg::ref_ptr<osgDB::Options> localOptions = options ? options->cloneOptions() : new osgDB::Options;
+    localOptions->getDatabasePathList().push_front(osgDB::getFilePath(originalFileName));
+
+    std::string ext = osgDB::getLowerCaseFileExtension(cacheFileName);
+    if (ext=="osgt") localOptions->setPluginStringData("fileType", "Ascii");
+    else if (ext=="osgx") localOptions->setPluginStringData("fileType", "XML");
+    else if (ext=="osgb") localOptions->setPluginStringData("fileType", "Binary");
+
+    return localOptions;
+}
+
+class ReleaseBlockOperation : public osg::Operation
+{
+    public:
+
+        ReleaseBlockOperation(osg::RefBlock* block):
+            osg::Operation("ReleaseBlock", false),
+            _block(block) {}
+
+        virtual void operator () (osg::Object*) { _block->release(); }
+
+    protected:
+
+        osg::ref_ptr<osg::RefBlock> _block;
+};
+
+/** Wait for the operations already added to a thread to complete.*/
+void waitForOperations(osg::OperationThread* thread)
+{
+    if (!thread) return;
+
+    osg::ref_ptr<osg::RefBlock> block = new osg::RefBlock;
+    thread->add(new ReleaseBlockOperation(block.get()));
+    block->block();
+}
+
+void stopThread(osg::OperationThread* thread)
+{
+    if (!thread) return;
+
+    thread->setDone(true);
+    thread->cancel();
+    thread->join();
+}
+
+/** Visits the tiles of a paged database that are in range of an eye point, reading those not already read, through
+  * the FileCache, and writing those that aren't in the cache to it.*/
+class PrefetchVisitor : public osg::NodeVisitor
+{
+    public:
+
+        PrefetchVisitor(const osgDB::FileCache* fileCache, const osgDB::Options* options, OpenThreads::Atomic& numPrefetchedFiles):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _fileCache(fileCache),
+            _options(options),
+            _numPrefetchedFiles(numPrefetchedFiles),
+            _generation(0)
+        {
+            _worldToLocalStack.push_back(osg::Matrix::identity());
+        }
+
+        void setEyePoint(const osg::Vec3d& eyePoint) { _eyePoint = eyePoint; }
+
+        osg::Node* loadTile(const std::string& fileName)
+        {
+            Tiles::iterator itr = _tiles.find(fileName);
+            if (itr!=_tiles.end())
+            {
+                itr->second.generation = _generation;
+                return itr->second.node.get();
+            }
+
+            bool useFileCache = _fileCache->isFileAppropriateForFileCache(fileName);
+
+            osg::ref_ptr<osg::Node> node;
+            if (useFileCache && _fileCache->existsInCache(fileName))
+            {
+                node = _fileCache->readNode(fileName, _options.get(), false).getNode();
+            }
+
+            if (!node)
+            {
+                node = osgDB::Registry::instance()->readNode(fileName, _options.get(), false).getNode();
+                if (!node) return 0;
+
+                if (useFileCache && _fileCache->writeNode(*node, fileName, _options.get()).success())
+                {
+                    ++_numPrefetchedFiles;
+                }
+            }
+
+            Tile& tile = _tiles[fileName];
+            tile.node = node;
+            tile.generation = _generation;
+            return node.get();
+        }
+
+        /** Release the tiles that weren't visited since the last call, which will be read again from the cache if
+          * they come back into range.*/
+        void releaseUnusedTiles()
+        {
+            for(Tiles::iterator itr = _tiles.begin(); itr != _tiles.end();)
+            {
+                if (itr->second.generation!=_generation) _tiles.erase(itr++);
+                else ++itr;
+            }
+            ++_generation;
+        }
+
+        virtual void apply(osg::Transform& transform)
+        {
+            osg::Matrix worldToLocal = _worldToLocalStack.back();
+            transform.computeWorldToLocalMatrix(worldToLocal, this);
+
+            _worldToLocalStack.push_back(worldToLocal);
+            traverse(transform);
+            _worldToLocalStack.pop_back();
+        }
+
+        virtual void apply(osg::LOD& lod)
+        {
+            if (lod.getRangeMode()!=osg::LOD::DISTANCE_FROM_EYE_POINT)
+            {
+                traverse(lod);
+                return;
+            }
+
+            float distance = getDistanceToEyePoint(lod);
+            unsigned int numChildren = osg::minimum(lod.getNumChildren(), lod.getNumRanges());
+            for(unsigned int i=0; i<numChildren; ++i)
+            {
+                if (lod.getMinRange(i)<=distance && distance<lod.getMaxRange(i)) lod.getChild(i)->accept(*this);
+            }
+        }
+
+        virtual void apply(osg::PagedLOD& plod)
+        {
+            if (plod.getRangeMode()!=osg::LOD::DISTANCE_FROM_EYE_POINT)
+            {
+                traverse(plod);
+                return;
+            }
+
+            float distance = getDistanceToEyePoint(plod);
+            for(unsigned int i=0; i<plod.getNumRanges(); ++i)
+            {
+                if (distance<plod.getMinRange(i) || distance>=plod.getMaxRange(i)) continue;
+
+                if (i<plod.getNumChildren())
+                {
+                    plod.getChild(i)->accept(*this);
+                }
+                else if (i<plod.getNumFileNames() && !plod.getFileName(i).empty())
+                {
+                    osg::Node* tile = loadTile(plod.getDatabasePath()+plod.getFileName(i));
+                    if (tile) tile->accept(*this);
+                }
+            }
+        }
+
+    protected:
+
+        float getDistanceToEyePoint(const osg::LOD& lod) const
+        {
+            osg::Vec3d localEyePoint = _eyePoint * _worldToLocalStack.back();
+            return static_cast<float>((localEyePoint - osg::Vec3d(lod.getCenter())).length());
+        }
+
+        struct Tile
+        {
+            Tile(): generation(0) {}
+
+            osg::ref_ptr<osg::Node> node;
+            unsigned int            generation;
+        };
+
+        typedef std::map<std::string, Tile> Tiles;
+
+        const osgDB::FileCache*             _fileCache;
+        osg::ref_ptr<const osgDB::Options>  _options;
+        OpenThreads::Atomic&                _numPrefetchedFiles;
+        osg::Vec3d                          _eyePoint;
+        std::vector<osg::Matrix>            _worldToLocalStack;
+        Tiles                               _tiles;
+        unsigned int                        _generation;
+};
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// FileCache::ReadFunctor and FileCache::WriteFunctor, which read and write each type of object to a file or a stream
+//
+struct FileCache::ReadFunctor
+{
+    enum Type { OBJECT, IMAGE, HEIGHTFIELD, NODE, SHADER };
+
+    ReadFunctor(Type type, const char* name, bool buildKdTreeIfRequired=false):
+        _type(type),
+        _name(name),
+        _buildKdTreeIfRequired(buildKdTreeIfRequired) {}
+
+    ReaderWriter::ReadResult readFile(const std::string& fileName, const Options* options) const
+    {
+        Registry* registry = Registry::instance();
+        switch(_type)
+        {
+            case(IMAGE): return registry->readImage(fileName, options);
+            case(HEIGHTFIELD): return registry->readHeightField(fileName, options);
+            case(NODE): return registry->readNode(fileName, options, _buildKdTreeIfRequired);
+            case(SHADER): return registry->readShader(fileName, options);
+            default: return registry->readObject(fileName, options);
+        }
+    }
+
+    ReaderWriter::ReadResult readStream(ReaderWriter& rw, std::istream& fin, const Options* options) const
+    {
+        switch(_type)
+        {
+            case(IMAGE): return rw.readImage(fin, options);
+            case(HEIGHTFIELD): return rw.readHeightField(fin, options);
+            case(SHADER): return rw.readShader(fin, options);
+            case(NODE):
+            {
+                ReaderWriter::ReadResult result = rw.readNode(fin, options);
+                if (_buildKdTreeIfRequired) Registry::instance()->_buildKdTreeIfRequired(result, options);
+                return result;
+            }
+            default: return rw.readObject(fin, options);
+        }
+    }
+
+    Type        _type;
+    const char* _name;
+    bool        _buildKdTreeIfRequired;
+};
+
+struct FileCache::WriteFunctor
+{
+    WriteFunctor(ReadFunctor::Type type, const char* name, const osg::Object& object):
+        _type(type),
+        _name(name),
+        _object(object) {}
+
+    ReaderWriter::WriteResult writeFile(const std::string& fileName, const Options* options) const
+    {
+        Registry* registry = Registry::instance();
+        switch(_type)
+        {
+            case(ReadFunctor::IMAGE): return registry->writeImage(static_cast<const osg::Image&>(_object), fileName, options);
+            case(ReadFunctor::HEIGHTFIELD): return registry->writeHeightField(static_cast<const osg::HeightField&>(_object), fileName, options);
+            case(ReadFunctor::NODE): return registry->writeNode(static_cast<const osg::Node&>(_object), fileName, options);
+            case(ReadFunctor::SHADER): return registry->writeShader(static_cast<const osg::Shader&>(_object), fileName, options);
+            default: return registry->writeObject(_object, fileName, options);
+        }
+    }
+
+    ReaderWriter::WriteResult writeStream(ReaderWriter& rw, std::ostream& fout, const Options* options) const
+    {
+        switch(_type)
+        {
+            case(ReadFunctor::IMAGE): return rw.writeImage(static_cast<const osg::Image&>(_object), fout, options);
+            case(ReadFunctor::HEIGHTFIELD): return rw.writeHeightField(static_cast<const osg::HeightField&>(_object), fout, options);
+            case(ReadFunctor::NODE): return rw.writeNode(static_cast<const osg::Node&>(_object), fout, options);
+            case(ReadFunctor::SHADER): return rw.writeShader(static_cast<const osg::Shader&>(_object), fout, options);
+            default: return rw.writeObject(_object, fout, options);
+        }
+    }
+
+    ReadFunctor::Type   _type;
+    const char*         _name;
+    const osg::Object&  _object;
+};
+
+struct FileCache::WriteOperation : public osg::Operation
+{
+    WriteOperation(const FileCache* fileCache, PendingWrite* pendingWrite):
+        osg::Operation("FileCacheWrite", false),
+        _fileCache(fileCache),
+        _pendingWrite(pendingWrite) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        _fileCache->writeToDisk(*_pendingWrite);
+    }
+
+    const FileCache*            _fileCache;
+    osg::ref_ptr<PendingWrite>  _pendingWrite;
+};
+
+struct FileCache::PrefetchOperation : public osg::Operation
+{
+    PrefetchOperation(FileCache* fileCache, const std::string& fileName, const osg::AnimationPath* path, double timeStep, const Options* options):
+        osg::Operation("FileCachePrefetch", false),
+        _fileCache(fileCache),
+        _fileName(fileName),
+        _path(path),
+        _timeStep(timeStep),
+        _options(options) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        _fileCache->prefetchPath(_fileName, *_path, _timeStep, _options.get());
+    }
+
+    FileCache*                              _fileCache;
+    std::string                             _fileName;
+    osg::ref_ptr<const osg::AnimationPath>  _path;
+    double                                  _timeStep;
+    osg::ref_ptr<const Options>             _options;
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // FileCache
 //
 FileCache::FileCache(const std::string& path):
     osg::Referenced(true),
-    _fileCachePath(path)
+    _fileCachePath(path),
+    _maximumSize(0),
+    _writeBehind(false),
+    _size(0),
+    _indexModified(false),
+    _numWritesSinceIndexWritten(0)
 {
     OSG_INFO<<"Constructed FileCache : "<<path<<std::endl;
 }
 
 FileCache::~FileCache()
 {
+    flush();
+
+    stopThread(_prefetchThread.get());
+    stopThread(_writeThread.get());
+
     OSG_INFO<<"Destructed FileCache "<<std::endl;
 }
 
+void FileCache::setMaximumSize(unsigned long long size)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+
+    if (size==0)
+    {
+        _index.clear();
+        _lruList.clear();
+        _size = 0;
+        _indexModified = false;
+    }
+    else if (_maximumSize==0)
+    {
+        loadIndex();
+    }
+
+    _maximumSize = size;
+    evict();
+}
+
+unsigned long long FileCache::getSize() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+    return _size;
+}
+
+unsigned int FileCache::getNumFiles() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+    return static_cast<unsigned int>(_index.size());
+}
+
+void FileCache::prefetch(const std::string& fileName, const osg::AnimationPath* path, double timeStep, const Options* options)
+{
+    if (!path || path->empty()) return;
+
+    getThread(_prefetchThread)->add(new PrefetchOperation(this, fileName, path, timeStep, options));
+}
+
+void FileCache::prefetchPath(const std::string& fileName, const osg::AnimationPath& path, double timeStep, const Options* options)
+{
+    OSG_INFO<<"FileCache::prefetchPath("<<fileName<<")"<<std::endl;
+
+    PrefetchVisitor visitor(this, options, _numPrefetchedFiles);
+
+    osg::ref_ptr<osg::Node> root = visitor.loadTile(fileName);
+    if (!root)
+    {
+        OSG_NOTICE<<"FileCache::prefetchPath() could not read "<<fileName<<std::endl;
+        return;
+    }
+
+    double lastTime = path.getLastTime();
+    for(double time = path.getFirstTime(); time<=lastTime; time += timeStep)
+    {
+        osg::AnimationPath::ControlPoint controlPoint;
+        if (!path.getInterpolatedControlPoint(time, controlPoint)) break;
+
+        visitor.setEyePoint(controlPoint.getPosition());
+        root->accept(visitor);
+        visitor.releaseUnusedTiles();
+
+        if (timeStep<=0.0) break;
+    }
+
+    OSG_INFO<<"FileCache::prefetchPath("<<fileName<<") completed, "<<_numPrefetchedFiles<<" files prefetched"<<std::endl;
+}
+
+void FileCache::flush()
+{
+    osg::ref_ptr<osg::OperationThread> prefetchThread, writeThread;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadMutex);
+        prefetchThread = _prefetchThread;
+        writeThread = _writeThread;
+    }
+
+    // prefetches write to the cache, so must complete before the writes pending are waited for.
+    waitForOperations(prefetchThread.get());
+    waitForOperations(writeThread.get());
+
+    writeIndex();
+}
+
+osg::OperationThread* FileCache::getThread(osg::ref_ptr<osg::OperationThread>& thread) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_threadMutex);
+    if (!thread)
+    {
+        thread = new osg::OperationThread;
+        thread->startThread();
+    }
+    return thread.get();
+}
+
 bool FileCache::isFileAppropriateForFileCache(const std::string& originalFileName) const
 {
     return osgDB::containsServerAddress(originalFileName);
@@ -54,6 +565,22 @@ std::string FileCache::createCacheFileName(const std::string& originalFileName)
 
 bool FileCache::existsInCache(const std::string& originalFileName) const
 {
+    if (useMemorySerialization())
+    {
+        std::string cacheFileName = createCacheFileName(originalFileName);
+
+        bool exists = false;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+            exists = _pendingWrites.count(cacheFileName)!=0 ||
+                     (_maximumSize>0 && _index.count(getIndexKey(cacheFileName))!=0);
+        }
+
+        if (!exists && _maximumSize==0) exists = osgDB::fileExists(cacheFileName);
+
+        return exists && !isCachedFileBlackListed(originalFileName);
+    }
+
     if (osgDB::fileExists(createCacheFileName(originalFileName)))
     {
         return !isCachedFileBlackListed(originalFileName);
@@ -61,13 +588,35 @@ bool FileCache::existsInCache(const std::string& originalFileName) const
     return false;
 }
 
-ReaderWriter::ReadResult FileCache::readObject(const std::string& originalFileName, const osgDB::Options* options) const
+ReaderWriter::ReadResult FileCache::read(const std::string& originalFileName, const Options* options, const ReadFunctor& readFunctor) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return 0;
+
+    if (useMemorySerialization())
     {
-        OSG_INFO<<"FileCache::readObjectFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readObject(cacheFileName, options);
+        ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension(getLowerCaseFileExtension(cacheFileName));
+        std::string data;
+        if (rw && readData(cacheFileName, data))
+        {
+            OSG_INFO<<"FileCache::"<<readFunctor._name<<"FromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+
+            osg::ref_ptr<Options> localOptions = createSerializationOptions(originalFileName, cacheFileName, options);
+            std::istringstream fin(data);
+            ReaderWriter::ReadResult result = readFunctor.readStream(*rw, fin, localOptions.get());
+            if (result.status()!=ReaderWriter::ReadResult::NOT_IMPLEMENTED &&
+                result.status()!=ReaderWriter::ReadResult::FILE_NOT_HANDLED)
+            {
+                return result;
+            }
+        }
+    }
+
+    // fall back to reading the file by name, for plugins that can't read from a stream and files the index doesn't know.
+    if (osgDB::fileExists(cacheFileName))
+    {
+        OSG_INFO<<"FileCache::"<<readFunctor._name<<"FromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        return readFunctor.readFile(cacheFileName, options);
     }
     else
     {
@@ -75,183 +624,368 @@ ReaderWriter::ReadResult FileCache::readObject(const std::string& originalFileNa
     }
 }
 
-ReaderWriter::WriteResult FileCache::writeObject(const osg::Object& object, const std::string& originalFileName, const osgDB::Options* options) const
+ReaderWriter::WriteResult FileCache::write(const std::string& originalFileName, const Options* options, const WriteFunctor& writeFunctor) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
-    {
-        std::string path = osgDB::getFilePath(cacheFileName);
+    if (cacheFileName.empty()) return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
+    if (useMemorySerialization())
+    {
+        ReaderWriter* rw = Registry::instance()->getReaderWriterForExtension(getLowerCaseFileExtension(cacheFileName));
+        if (rw)
         {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+            osg::ref_ptr<Options> localOptions = createSerializationOptions(originalFileName, cacheFileName, options);
+            std::ostringstream fout(std::ios::out | std::ios::binary);
+            ReaderWriter::WriteResult result = writeFunctor.writeStream(*rw, fout, localOptions.get());
+            if (result.success())
+            {
+                OSG_INFO<<"FileCache::"<<writeFunctor._name<<"ToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+
+                osg::ref_ptr<PendingWrite> pendingWrite = new PendingWrite;
+                pendingWrite->cacheFileName = cacheFileName;
+                pendingWrite->originalFileName = originalFileName;
+                pendingWrite->data = fout.str();
+
+                if (_writeBehind)
+                {
+                    {
+                        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+                        _pendingWrites[cacheFileName] = pendingWrite;
+                    }
+                    getThread(_writeThread)->add(new WriteOperation(this, pendingWrite.get()));
+                }
+                else if (!writeToDisk(*pendingWrite))
+                {
+                    return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+                }
+
+                removeFileFromBlackListed(originalFileName);
+                return result;
+            }
+            else if (result.status()!=ReaderWriter::WriteResult::NOT_IMPLEMENTED &&
+                     result.status()!=ReaderWriter::WriteResult::FILE_NOT_HANDLED)
+            {
+                return result;
+            }
         }
+    }
+
+    // write the file by name, for plugins that can't write to a stream and when the cache isn't managed.
+    std::string path = osgDB::getFilePath(cacheFileName);
+
+    if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
+    {
+        OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
+        return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+    }
 
-        OSG_INFO<<"FileCache::writeObjectToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeObject(object, cacheFileName, options);
-        if (result.success())
+    OSG_INFO<<"FileCache::"<<writeFunctor._name<<"ToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+    ReaderWriter::WriteResult result = writeFunctor.writeFile(cacheFileName, options);
+    if (result.success())
+    {
+        std::string data;
+        if (_maximumSize>0 && readFileContents(cacheFileName, data))
         {
-            removeFileFromBlackListed(originalFileName);
+            unsigned int checksum = computeChecksum(data);
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+            insertIntoIndex(getIndexKey(cacheFileName), data.size(), checksum);
+            evict();
         }
-        return result;
+
+        removeFileFromBlackListed(originalFileName);
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
+    return result;
 }
 
-ReaderWriter::ReadResult FileCache::readImage(const std::string& originalFileName, const osgDB::Options* options) const
+bool FileCache::writeToDisk(const PendingWrite& pendingWrite) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    std::string path = osgDB::getFilePath(pendingWrite.cacheFileName);
+
+    bool written = (osgDB::fileExists(path) || osgDB::makeDirectory(path)) &&
+                   writeFileContents(pendingWrite.cacheFileName, pendingWrite.data);
+    if (!written)
     {
-        OSG_INFO<<"FileCache::readImageFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readImage(cacheFileName, options);
+        OSG_NOTICE<<"FileCache could not write "<<pendingWrite.cacheFileName<<std::endl;
     }
-    else
+
+    unsigned int checksum = written && _maximumSize>0 ? computeChecksum(pendingWrite.data) : 0;
+
+    bool writeIndexRequired = false;
     {
-        return 0;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+
+        if (written && _maximumSize>0)
+        {
+            insertIntoIndex(getIndexKey(pendingWrite.cacheFileName), pendingWrite.data.size(), checksum);
+            evict();
+            writeIndexRequired = (++_numWritesSinceIndexWritten>=indexWriteInterval);
+        }
+
+        // the file may have been written again since this write was queued, leaving the newer write pending.
+        PendingWrites::iterator itr = _pendingWrites.find(pendingWrite.cacheFileName);
+        if (itr!=_pendingWrites.end() && itr->second.get()==&pendingWrite) _pendingWrites.erase(itr);
     }
+
+    if (writeIndexRequired) writeIndex();
+
+    return written;
 }
 
-ReaderWriter::WriteResult FileCache::writeImage(const osg::Image& image, const std::string& originalFileName, const osgDB::Options* options) const
+bool FileCache::readData(const std::string& cacheFileName, std::string& data) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    std::string key = getIndexKey(cacheFileName);
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
+        PendingWrites::const_iterator pitr = _pendingWrites.find(cacheFileName);
+        if (pitr!=_pendingWrites.end())
         {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+            data = pitr->second->data;
+            return true;
         }
 
-        OSG_INFO<<"FileCache::writeImageToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeImage(image, cacheFileName, options);
-        if (result.success())
+        if (_maximumSize>0)
         {
-            removeFileFromBlackListed(originalFileName);
+            Index::iterator itr = _index.find(key);
+            if (itr==_index.end()) return false;
+
+            // move the file to the front of the LRUList as the most recently used.
+            _lruList.splice(_lruList.begin(), _lruList, itr->second.lruPosition);
+            _indexModified = true;
         }
-        return result;
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
-}
 
-ReaderWriter::ReadResult FileCache::readHeightField(const std::string& originalFileName, const osgDB::Options* options) const
-{
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    bool read = readFileContents(cacheFileName, data);
+    if (_maximumSize==0) return read;
+
+    unsigned int checksum = read ? computeChecksum(data) : 0;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+
+    Index::iterator itr = _index.find(key);
+    if (itr==_index.end()) return read;
+
+    if (read && itr->second.checksum==0)
     {
-        OSG_INFO<<"FileCache::readHeightFieldFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readHeightField(cacheFileName, options);
+        // files adopted when the index was built have their checksum recorded when first read.
+        _size = _size - itr->second.size + data.size();
+        itr->second.size = data.size();
+        itr->second.checksum = checksum;
+        return true;
+    }
+
+    if (read && itr->second.checksum==checksum) return true;
+
+    if (read)
+    {
+        OSG_NOTICE<<"FileCache : checksum of "<<cacheFileName<<" doesn't match its index, removing it from the cache."<<std::endl;
     }
     else
     {
-        return 0;
+        OSG_NOTICE<<"FileCache : could not read "<<cacheFileName<<", removing it from the cache."<<std::endl;
     }
+
+    remove(cacheFileName.c_str());
+    eraseFromIndex(itr);
+    return false;
 }
 
-ReaderWriter::WriteResult FileCache::writeHeightField(const osg::HeightField& hf, const std::string& originalFileName, const osgDB::Options* options) const
+std::string FileCache::getIndexFileName() const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
-    {
-        std::string path = osgDB::getFilePath(cacheFileName);
-
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
-        {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
-        }
+    return _fileCachePath + "/" + indexFileName;
+}
 
-        OSG_INFO<<"FileCache::writeHeightFieldToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeHeightField(hf, cacheFileName, options);
-        if (result.success())
-        {
-            removeFileFromBlackListed(originalFileName);
-        }
-        return result;
+std::string FileCache::getIndexKey(const std::string& cacheFileName) const
+{
+    if (cacheFileName.size()>_fileCachePath.size() &&
+        cacheFileName.compare(0, _fileCachePath.size(), _fileCachePath)==0 &&
+        cacheFileName[_fileCachePath.size()]=='/')
+    {
+        return cacheFileName.substr(_fileCachePath.size()+1);
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
+    return cacheFileName;
 }
 
-ReaderWriter::ReadResult FileCache::readNode(const std::string& originalFileName, const osgDB::Options* options, bool buildKdTreeIfRequired) const
+void FileCache::loadIndex()
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    _index.clear();
+    _lruList.clear();
+    _size = 0;
+
+    osgDB::ifstream fin(getIndexFileName().c_str());
+    std::string header;
+    if (fin && std::getline(fin, header) && header==indexHeader)
     {
-        OSG_INFO<<"FileCache::readNodeFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readNode(cacheFileName, options, buildKdTreeIfRequired);
+        // the entries are listed from least to most recently used.
+        unsigned long long size;
+        unsigned int checksum;
+        while(fin >> size >> std::hex >> checksum >> std::dec)
+        {
+            fin.get();
+
+            std::string fileName;
+            if (!std::getline(fin, fileName) || fileName.empty()) break;
+
+            insertIntoIndex(fileName, size, checksum);
+        }
+        _indexModified = false;
+
+        OSG_INFO<<"FileCache : loaded index of "<<_index.size()<<" files, "<<_size<<" bytes"<<std::endl;
     }
     else
     {
-        return 0;
+        buildIndex(_fileCachePath);
+        _indexModified = true;
+
+        OSG_INFO<<"FileCache : built index of "<<_index.size()<<" files, "<<_size<<" bytes"<<std::endl;
     }
 }
 
-ReaderWriter::WriteResult FileCache::writeNode(const osg::Node& node, const std::string& originalFileName, const osgDB::Options* options) const
+void FileCache::buildIndex(const std::string& directory)
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(directory);
+    for(osgDB::DirectoryContents::iterator itr = contents.begin(); itr != contents.end(); ++itr)
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
+        if (*itr=="." || *itr=="..") continue;
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
+        std::string fileName = directory + "/" + *itr;
+        osgDB::FileType type = osgDB::fileType(fileName);
+        if (type==osgDB::DIRECTORY)
         {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+            buildIndex(fileName);
         }
-
-        OSG_INFO<<"FileCache::writeNodeToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(node, cacheFileName, options);
-        if (result.success())
+        else if (type==osgDB::REGULAR_FILE && fileName!=getIndexFileName() && getLowerCaseFileExtension(fileName)!="tmp")
         {
-            removeFileFromBlackListed(originalFileName);
+            osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+            if (!fin) continue;
+
+            // the checksum isn't known until the file is first read.
+            insertIntoIndex(getIndexKey(fileName), static_cast<unsigned long long>(fin.tellg()), 0);
         }
-        return result;
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
 }
 
+void FileCache::writeIndex() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> fileLock(_indexFileMutex);
 
-ReaderWriter::ReadResult FileCache::readShader(const std::string& originalFileName, const osgDB::Options* options) const
+    std::ostringstream out;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_indexMutex);
+        if (_maximumSize==0 || !_indexModified) return;
+
+        out<<indexHeader<<"\n";
+        for(LRUList::const_reverse_iterator itr = _lruList.rbegin(); itr != _lruList.rend(); ++itr)
+        {
+            const IndexEntry& entry = _index.find(**itr)->second;
+            out<<entry.size<<" "<<std::hex<<entry.checksum<<std::dec<<" "<<**itr<<"\n";
+        }
+
+        _indexModified = false;
+        _numWritesSinceIndexWritten = 0;
+    }
+
+    if (!osgDB::fileExists(_fileCachePath)) osgDB::makeDirectory(_fileCachePath);
+
+    if (!writeFileContents(getIndexFileName(), out.str()))
+    {
+        OSG_NOTICE<<"FileCache could not write its index "<<getIndexFileName()<<std::endl;
+    }
+}
+
+void FileCache::insertIntoIndex(const std::string& fileName, unsigned long long size, unsigned int checksum) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    Index::iterator itr = _index.find(fileName);
+    if (itr!=_index.end())
     {
-        OSG_INFO<<"FileCache::readShaderFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        return osgDB::Registry::instance()->readShader(cacheFileName, options);
+        _size = _size - itr->second.size + size;
+        _lruList.splice(_lruList.begin(), _lruList, itr->second.lruPosition);
     }
     else
     {
-        return 0;
+        itr = _index.insert(Index::value_type(fileName, IndexEntry())).first;
+        _size += size;
+        _lruList.push_front(&(itr->first));
+        itr->second.lruPosition = _lruList.begin();
     }
+
+    itr->second.size = size;
+    itr->second.checksum = checksum;
+    _indexModified = true;
 }
 
-ReaderWriter::WriteResult FileCache::writeShader(const osg::Shader& shader, const std::string& originalFileName, const osgDB::Options* options) const
+void FileCache::eraseFromIndex(Index::iterator itr) const
 {
-    std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty())
+    _size -= itr->second.size;
+    _lruList.erase(itr->second.lruPosition);
+    _index.erase(itr);
+    _indexModified = true;
+}
+
+void FileCache::evict() const
+{
+    // keep the most recently used file even if it's on its own over the maximum size.
+    while(_maximumSize>0 && _size>_maximumSize && _lruList.size()>1)
     {
-        std::string path = osgDB::getFilePath(cacheFileName);
+        Index::iterator itr = _index.find(*_lruList.back());
 
-        if (!osgDB::fileExists(path) && !osgDB::makeDirectory(path))
-        {
-            OSG_NOTICE<<"Could not create cache directory: "<<path<<std::endl;
-            return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
-        }
+        OSG_DEBUG<<"FileCache : evicting "<<itr->first<<std::endl;
 
-        OSG_INFO<<"FileCache::writeShaderToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeShader(shader, cacheFileName, options);
-        if (result.success())
-        {
-            removeFileFromBlackListed(originalFileName);
-        }
-        return result;
+        remove((_fileCachePath + "/" + itr->first).c_str());
+        eraseFromIndex(itr);
     }
-    return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
 }
 
+ReaderWriter::ReadResult FileCache::readObject(const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return read(originalFileName, options, ReadFunctor(ReadFunctor::OBJECT, "readObject"));
+}
+
+ReaderWriter::WriteResult FileCache::writeObject(const osg::Object& object, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return write(originalFileName, options, WriteFunctor(ReadFunctor::OBJECT, "writeObject", object));
+}
+
+ReaderWriter::ReadResult FileCache::readImage(const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return read(originalFileName, options, ReadFunctor(ReadFunctor::IMAGE, "readImage"));
+}
+
+ReaderWriter::WriteResult FileCache::writeImage(const osg::Image& image, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return write(originalFileName, options, WriteFunctor(ReadFunctor::IMAGE, "writeImage", image));
+}
+
+ReaderWriter::ReadResult FileCache::readHeightField(const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return read(originalFileName, options, ReadFunctor(ReadFunctor::HEIGHTFIELD, "readHeightField"));
+}
+
+ReaderWriter::WriteResult FileCache::writeHeightField(const osg::HeightField& hf, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return write(originalFileName, options, WriteFunctor(ReadFunctor::HEIGHTFIELD, "writeHeightField", hf));
+}
+
+ReaderWriter::ReadResult FileCache::readNode(const std::string& originalFileName, const osgDB::Options* options, bool buildKdTreeIfRequired) const
+{
+    return read(originalFileName, options, ReadFunctor(ReadFunctor::NODE, "readNode", buildKdTreeIfRequired));
+}
+
+ReaderWriter::WriteResult FileCache::writeNode(const osg::Node& node, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return write(originalFileName, options, WriteFunctor(ReadFunctor::NODE, "writeNode", node));
+}
+
+ReaderWriter::ReadResult FileCache::readShader(const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return read(originalFileName, options, ReadFunctor(ReadFunctor::SHADER, "readShader"));
+}
+
+ReaderWriter::WriteResult FileCache::writeShader(const osg::Shader& shader, const std::string& originalFileName, const osgDB::Options* options) const
+{
+    return write(originalFileName, options, WriteFunctor(ReadFunctor::SHADER, "writeShader", shader));
+}
 
 bool FileCache::isCachedFileBlackListed(const std::string& originalFileName) const
 {
@@ -26,7 +26,7 @@ using namespace osgDB;
 static std::string s_lastSchema;
 
 InputStream::InputStream( const osgDB::Options* options )
-    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0)
+    :   _fileVersion(0), _useSchemaData(false), _useAlignedArrays(false), _forceReadingImage(false), _dataDecompress(0)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -37,6 +37,9 @@ InputStream::InputStream( const osgDB::Options* options )
     if ( options->getPluginStringData("ForceReadingImage")=="true" )
         _forceReadingImage = true;
 
+    if ( ExternalFileLoader::useParallelLoading(options) )
+        _externalFileLoader = new ExternalFileLoader;
+
     if ( !options->getPluginStringData("CustomDomains").empty() )
     {
         StringList domains, keyAndValue;
@@ -74,6 +77,10 @@ InputStream::InputStream( const osgDB::Options* options )
 
 InputStream::~InputStream()
 {
+    // merge any external reads that the reader didn't complete.
+    if (_externalFileLoader.valid())
+        _externalFileLoader->complete();
+
     if (_dataDecompress)
         delete _dataDecompress;
 }
@@ -838,7 +845,18 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
     }
 
     bool loadedFromCache = false;
-    if ( readFromExternal && !name.empty() )
+    if ( readFromExternal && !name.empty() && _externalFileLoader.valid() && className=="osg::Image" &&
+         (getOptions()->getObjectCacheHint() & Options::CACHE_IMAGES)==0 )
+    {
+        // read the external image in parallel with the rest of the file, its data is assigned to image
+        // when the ExternalFileLoader completes. Cached images are still read immediately so they remain shared.
+        // The object fields read below are kept, and if the read fails the image is removed again unless an
+        // empty image is forced, as it is when reading serially.
+        image = new osg::Image;
+        _externalFileLoader->addImage( name, getOptions(), image.get(),
+                                       _forceReadingImage ? ExternalFileLoader::KEEP_IMAGE_ON_FAILURE : 0 );
+    }
+    else if ( readFromExternal && !name.empty() )
     {
         ReaderWriter::ReadResult rr = Registry::instance()->readImage(name, getOptions());
         if (rr.validImage())
@@ -987,6 +1005,7 @@ InputStream::ReadType InputStream::start( InputIterator* inIterator )
         unsigned int attributes; *this >> attributes;
         if ( attributes&0x4 ) inIterator->setSupportBinaryBrackets( true );
         if ( attributes&0x2 ) _useSchemaData = true;
+        if ( attributes&0x8 ) _useAlignedArrays = true;
 
         // Record custom domains
         if ( attributes&0x1 )
@@ -1106,6 +1125,26 @@ void InputStream::resetSchema()
     }
 }
 
+void InputStream::readArrayData( char* s, unsigned int numElements, unsigned int numComponentsPerElements, unsigned int componentSizeInBytes )
+{
+    if ( _useAlignedArrays )
+    {
+        unsigned char padding = 0;
+        *this >> padding;
+        if ( padding>=ARRAY_DATA_ALIGNMENT )
+        {
+            throwException( "InputStream::readArrayData() error, invalid array alignment." );
+            return;
+        }
+
+        char skipped[ARRAY_DATA_ALIGNMENT];
+        if ( padding>0 ) readCharArray( skipped, padding );
+    }
+
+    readComponentArray( s, numElements, numComponentsPerElements, componentSizeInBytes );
+    checkStream();
+}
+
 template<typename T>
 void InputStream::readArrayImplementation( T* a, unsigned int numComponentsPerElements, unsigned int componentSizeInBytes )
 {
@@ -1116,8 +1155,7 @@ void InputStream::readArrayImplementation( T* a, unsigned int numComponentsPerEl
         a->resize( size );
         if ( isBinary() )
         {
-            readComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
-            checkStream();
+            readArrayData( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
         }
         else
         {
@@ -14,6 +14,9 @@
 #include <osgDB/ObjectCache>
 #include <osgDB/Options>
 
+#include <osg/Image>
+#include <osg/Texture>
+
 using namespace osgDB;
 
 bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair& lhs, const ObjectCache::FileNameOptionsPair& rhs) const
@@ -36,12 +39,68 @@ bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair&
     return lhs.second < rhs.second;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ObjectCache::Shard
+//
+ObjectCache::ObjectCacheMap::iterator ObjectCache::Shard::find(const std::string& fileName, const osgDB::Options* options)
+{
+    // entries are sorted by filename, with the entry without Options first, so only the entries for fileName need to be checked.
+    for(ObjectCacheMap::iterator itr = _objectCache.lower_bound(FileNameOptionsPair(fileName, 0));
+        itr != _objectCache.end() && itr->first.first==fileName;
+        ++itr)
+    {
+        if (itr->first.second.valid())
+        {
+            if (options && *(itr->first.second)==*options) return itr;
+        }
+        else if (!options) return itr;
+    }
+    return _objectCache.end();
+}
+
+void ObjectCache::Shard::insert(const FileNameOptionsPair& key, osg::Object* object, double timestamp, unsigned long long size)
+{
+    ObjectCacheMap::iterator itr = _objectCache.find(key);
+    if (itr!=_objectCache.end())
+    {
+        _size -= itr->second._size;
+    }
+    else
+    {
+        itr = _objectCache.insert(ObjectCacheMap::value_type(key, CacheEntry())).first;
+        _lruList.push_front(&(itr->first));
+        itr->second._lruPosition = _lruList.begin();
+    }
+
+    itr->second._object = object;
+    itr->second._timestamp = timestamp;
+    itr->second._size = size;
+    _size += size;
+
+    touch(itr);
+}
+
+void ObjectCache::Shard::erase(ObjectCacheMap::iterator itr)
+{
+    _size -= itr->second._size;
+    _lruList.erase(itr->second._lruPosition);
+    _objectCache.erase(itr);
+}
+
+void ObjectCache::Shard::touch(ObjectCacheMap::iterator itr)
+{
+    _lruList.splice(_lruList.begin(), _lruList, itr->second._lruPosition);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // ObjectCache
 //
 ObjectCache::ObjectCache():
-    osg::Referenced(true)
+    osg::Referenced(true),
+    _maximumSize(0),
+    _graphicsCostEstimator(new osg::GraphicsCostEstimator)
 {
 //    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
 }
@@ -51,74 +110,184 @@ ObjectCache::~ObjectCache()
 //    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
 }
 
-void ObjectCache::addObjectCache(ObjectCache* objectCache)
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName)
 {
-    // don't allow a cache to be added to itself.
-    if (objectCache==this) return;
-
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
+    // FNV-1a hash of the filename
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin(); itr != fileName.end(); ++itr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    return _shards[hash % NUM_SHARDS];
+}
 
-    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
+unsigned long long ObjectCache::estimateSize(const osg::Object* object) const
+{
+    if (_maximumSize==0) return 0;
 
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
-}
+    const osg::Image* image = dynamic_cast<const osg::Image*>(object);
+    if (image) return image->getTotalDataSize();
 
+    const osg::Node* node = dynamic_cast<const osg::Node*>(object);
+    if (node) return static_cast<unsigned long long>(_graphicsCostEstimator->estimateMemoryUsage(node).first);
 
-void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
-{
-    if (!object) return;
+    const osg::Texture* texture = dynamic_cast<const osg::Texture*>(object);
+    if (texture) return static_cast<unsigned long long>(_graphicsCostEstimator->estimateMemoryUsage(texture).first);
 
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[FileNameOptionsPair(filename, options ? osg::clone(options) : 0)] = ObjectTimeStampPair(object,timestamp);
-    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+    return 0;
 }
 
-ObjectCache::ObjectCacheMap::iterator ObjectCache::find(const std::string& fileName, const osgDB::Options* options)
+void ObjectCache::setMaximumSize(unsigned long long size)
 {
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    bool estimateSizes = (_maximumSize==0 && size!=0);
+    _maximumSize = size;
+
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if (itr->first.first==fileName)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // sizes aren't estimated whilst the cache is unlimited, so compute them for the objects already cached.
+        if (estimateSizes)
         {
-            if (itr->first.second.valid())
+            shard._size = 0;
+            for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+                itr != shard._objectCache.end();
+                ++itr)
             {
-                if (options && *(itr->first.second)==*options) return itr;
+                itr->second._size = estimateSize(itr->second._object.get());
+                shard._size += itr->second._size;
             }
-            else if (!options) return itr;
         }
+
+        evict(shard);
     }
-    return _objectCache.end();
 }
 
+unsigned long long ObjectCache::getSize() const
+{
+    unsigned long long size = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = const_cast<Shard&>(_shards[i]);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        size += shard._size;
+    }
+    return size;
+}
 
-osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+unsigned int ObjectCache::getNumObjects() const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    unsigned int numObjects = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
-        {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
-        }
-        else
+        Shard& shard = const_cast<Shard&>(_shards[i]);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        numObjects += shard._objectCache.size();
+    }
+    return numObjects;
+}
+
+void ObjectCache::resetCounts()
+{
+    _numHits.exchange(0);
+    _numMisses.exchange(0);
+    _numEvictions.exchange(0);
+}
+
+void ObjectCache::reportStats(unsigned int frameNumber, osg::Stats& stats) const
+{
+    stats.setAttribute(frameNumber, "ObjectCache size", static_cast<double>(getSize()));
+    stats.setAttribute(frameNumber, "ObjectCache objects", getNumObjects());
+    stats.setAttribute(frameNumber, "ObjectCache hits", getNumHits());
+    stats.setAttribute(frameNumber, "ObjectCache misses", getNumMisses());
+    stats.setAttribute(frameNumber, "ObjectCache evictions", getNumEvictions());
+}
+
+void ObjectCache::evict(Shard& shard)
+{
+    if (_maximumSize==0) return;
+
+    unsigned long long maximumShardSize = _maximumSize / NUM_SHARDS;
+    if (shard._size<=maximumShardSize) return;
+
+    // walk from the least recently used end, skipping objects still referenced elsewhere.
+    LRUList::iterator litr = shard._lruList.end();
+    while(litr != shard._lruList.begin() && shard._size>maximumShardSize)
+    {
+        --litr;
+
+        ObjectCacheMap::iterator itr = shard._objectCache.find(**litr);
+        if (itr->second._object->referenceCount()>1) continue;
+
+        OSG_DEBUG<<"Evicting "<<itr->first.first<<" from ObjectCache "<<this<<std::endl;
+
+        // erase invalidates litr so continue from the entry after it.
+        LRUList::iterator next = litr;
+        ++next;
+        shard.erase(itr);
+        litr = next;
+        ++_numEvictions;
+    }
+}
+
+void ObjectCache::addObjectCache(ObjectCache* objectCache)
+{
+    // don't allow a cache to be added to itself.
+    if (objectCache==this) return;
+
+    // both caches use the same hash so the entries of each shard map to the same shard in this cache.
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = _shards[i];
+        Shard& otherShard = objectCache->_shards[i];
+
+        // lock both shards to prevent their contents from being modified by other threads while we merge.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(shard._mutex);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(otherShard._mutex);
+
+        OSG_DEBUG<<"Inserting objects to main ObjectCache "<<otherShard._objectCache.size()<<std::endl;
+
+        for(ObjectCacheMap::iterator itr = otherShard._objectCache.begin();
+            itr != otherShard._objectCache.end();
+            ++itr)
         {
-            OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
+            // existing entries take precedence
+            if (shard._objectCache.count(itr->first)!=0) continue;
+
+            unsigned long long size = (objectCache->_maximumSize!=0) ? itr->second._size : estimateSize(itr->second._object.get());
+            shard.insert(itr->first, itr->second._object.get(), itr->second._timestamp, size);
         }
-        return itr->second.first.get();
+
+        evict(shard);
     }
-    else return 0;
 }
 
-osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
+
+void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    if (!object) return;
+
+    unsigned long long size = estimateSize(object);
+
+    Shard& shard = getShard(filename);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    shard.insert(FileNameOptionsPair(filename, options ? osg::clone(options) : 0), object, timestamp, size);
+    evict(shard);
+    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+}
+
+osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+{
+    return getRefFromObjectCache(fileName, options).get();
+}
+
+osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options, bool countLookup)
+{
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    ObjectCacheMap::iterator itr = shard.find(fileName, options);
+    if (itr!=shard._objectCache.end())
     {
         osg::ref_ptr<const osgDB::Options> o = itr->first.second;
         if (o.valid())
@@ -129,74 +298,95 @@ osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string&
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+        shard.touch(itr);
+        if (countLookup) ++_numHits;
+        return itr->second._object.get();
+    }
+    else
+    {
+        if (countLookup) ++_numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(ObjectCacheMap::iterator itr=shard._objectCache.begin();
+            itr!=shard._objectCache.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second._object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second._timestamp = referenceTime;
+            }
         }
     }
 }
 
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if (oitr->second.second<=expiryTime)
-        {
-#if __cplusplus > 199711L
-            oitr = _objectCache.erase(oitr);
-#else
-            _objectCache.erase(oitr++);
-#endif
-        }
-        else
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // Remove expired entries from object cache
+        ObjectCacheMap::iterator oitr = shard._objectCache.begin();
+        while(oitr != shard._objectCache.end())
         {
-            ++oitr;
+            if (oitr->second._timestamp<=expiryTime)
+            {
+                shard.erase(oitr++);
+            }
+            else
+            {
+                ++oitr;
+            }
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+    ObjectCacheMap::iterator itr = shard.find(fileName, options);
+    if (itr!=shard._objectCache.end()) shard.erase(itr);
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+        shard._objectCache.clear();
+        shard._lruList.clear();
+        shard._size = 0;
+    }
 }
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        osg::Object* object = itr->second.first.get();
-        object->releaseGLObjects(state);
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            ++itr)
+        {
+            osg::Object* object = itr->second._object.get();
+            object->releaseGLObjects(state);
+        }
     }
 }
@@ -21,7 +21,8 @@ Options::Options():
     osg::Object(true),
     _objectCacheHint(CACHE_ARCHIVES),
     _precisionHint(FLOAT_PRECISION_ALL),
-    _buildKdTreesHint(NO_PREFERENCE)
+    _buildKdTreesHint(NO_PREFERENCE),
+    _loadExternalReferencesInParallel(false)
 {
 }
 
@@ -30,7 +31,8 @@ Options::Options(const std::string& str):
     _str(str),
     _objectCacheHint(CACHE_ARCHIVES),
     _precisionHint(FLOAT_PRECISION_ALL),
-    _buildKdTreesHint(NO_PREFERENCE)
+    _buildKdTreesHint(NO_PREFERENCE),
+    _loadExternalReferencesInParallel(false)
 {
     parsePluginStringData(str);
 }
@@ -44,12 +46,14 @@ Options::Options(const Options& options,const osg::CopyOp& copyop):
     _objectCache(options._objectCache),
     _precisionHint(options._precisionHint),
     _buildKdTreesHint(options._buildKdTreesHint),
+    _loadExternalReferencesInParallel(options._loadExternalReferencesInParallel),
     _pluginData(options._pluginData),
     _pluginStringData(options._pluginStringData),
     _findFileCallback(options._findFileCallback),
     _readFileCallback(options._readFileCallback),
     _writeFileCallback(options._writeFileCallback),
     _fileLocationCallback(options._fileLocationCallback),
+    _readCancellationCallback(options._readCancellationCallback),
     _fileCache(options._fileCache),
     _terrain(options._terrain),
     _parentGroup(options._parentGroup)
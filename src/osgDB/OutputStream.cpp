@@ -26,7 +26,7 @@
 using namespace osgDB;
 
 OutputStream::OutputStream( const osgDB::Options* options )
-:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _targetFileVersion(OPENSCENEGRAPH_SOVERSION)
+:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _useAlignedArrays(false), _targetFileVersion(OPENSCENEGRAPH_SOVERSION)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -38,6 +38,8 @@ OutputStream::OutputStream( const osgDB::Options* options )
         _useRobustBinaryFormat = false;
     if ( options->getPluginStringData("SchemaData")=="true" )
         _useSchemaData = true;
+    if ( options->getPluginStringData("AlignedArrays")=="true" )
+        _useAlignedArrays = true;
     if ( !options->getPluginStringData("SchemaFile").empty() )
         _schemaName = options->getPluginStringData("SchemaFile");
     if ( !options->getPluginStringData("Compressor").empty() )
@@ -781,19 +783,6 @@ void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType t
             outIterator->setSupportBinaryBrackets( true );
             attributes |= 0x4;
         }
-        *this << attributes;
-
-        // Record all custom versions
-        if ( _domainVersionMap.size()>0 )
-        {
-            unsigned int numDomains = _domainVersionMap.size();
-            *this << numDomains;
-            for ( VersionMap::iterator itr=_domainVersionMap.begin();
-                  itr!=_domainVersionMap.end(); ++itr )
-            {
-                *this << itr->first << itr->second;
-            }
-        }
 
         if ( !_compressorName.empty() )
         {
@@ -809,6 +798,30 @@ void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType t
                 useCompressSource = true;
             }
         }
+
+        // Pad binary array data so that it is aligned when memory mapped. The padding is computed from the position
+        // in the output file, which isn't known when the data is first written to a separate stream to be compressed
+        // or merged after the schema, so alignment is skipped in that case.
+        if ( _useAlignedArrays && useCompressSource )
+        {
+            OSG_INFO << "OutputStream::start(): Aligned arrays are not supported with compressors or inbuilt schema data." << std::endl;
+            _useAlignedArrays = false;
+        }
+        if ( _useAlignedArrays ) attributes |= 0x8;
+        *this << attributes;
+
+        // Record all custom versions
+        if ( _domainVersionMap.size()>0 )
+        {
+            unsigned int numDomains = _domainVersionMap.size();
+            *this << numDomains;
+            for ( VersionMap::iterator itr=_domainVersionMap.begin();
+                  itr!=_domainVersionMap.end(); ++itr )
+            {
+                *this << itr->first << itr->second;
+            }
+        }
+
         if ( !_compressorName.empty() ) *this << _compressorName;
         else *this << std::string("0");  // No compressor
 
@@ -921,13 +934,36 @@ void OutputStream::writeSchema( std::ostream& fout )
 
 // PROTECTED METHODS
 
+void OutputStream::writeArrayData( const char* s, unsigned int numElements, unsigned int elementSizeInBytes )
+{
+    if ( _useAlignedArrays )
+    {
+        // record the number of padding bytes so the reader doesn't depend upon the stream position,
+        // streams that can't report their position, such as pipes, are left unpadded.
+        unsigned char padding = 0;
+        std::ostream* ostream = _out->getStream();
+        std::streampos position = ostream ? ostream->tellp() : std::streampos(-1);
+        if ( position!=std::streampos(-1) )
+        {
+            std::streamoff offset = static_cast<std::streamoff>(position) + CHAR_SIZE;
+            padding = static_cast<unsigned char>((ARRAY_DATA_ALIGNMENT - offset%ARRAY_DATA_ALIGNMENT) % ARRAY_DATA_ALIGNMENT);
+        }
+
+        const char zeros[ARRAY_DATA_ALIGNMENT] = {0};
+        *this << padding;
+        if ( padding>0 ) writeCharArray( zeros, padding );
+    }
+
+    writeCharArray( s, numElements*elementSizeInBytes );
+}
+
 template<typename T>
 void OutputStream::writeArrayImplementation( const T* a, int write_size, unsigned int numInRow )
 {
     *this << write_size << BEGIN_BRACKET;
     if ( isBinary() )
     {
-        if (write_size) writeCharArray((char*)&((*a)[0]), write_size * sizeof((*a)[0]));
+        if (write_size) writeArrayData((char*)&((*a)[0]), write_size, sizeof((*a)[0]));
     }
     else
     {
@@ -0,0 +1,728 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/PagedLODBuilder>
+#include <osgDB/Registry>
+#include <osgDB/WriteFile>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+
+#include <osg/BoundingBox>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/PagedLOD>
+#include <osg/Transform>
+#include <osg/TriangleIndexFunctor>
+#include <osg/Notify>
+
+#include <osgUtil/Optimizer>
+#include <osgUtil/QuadricSimplifier>
+#include <osgUtil/Simplifier>
+#include <osgUtil/TransformAttributeFunctor>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+using namespace osgDB;
+
+namespace
+{
+
+typedef std::vector<unsigned int> IndexList;
+
+struct TriangleCollectOperator
+{
+    IndexList* indices;
+
+    TriangleCollectOperator(): indices(0) {}
+
+    inline void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1==p2 || p2==p3 || p1==p3) return;
+        indices->push_back(p1);
+        indices->push_back(p2);
+        indices->push_back(p3);
+    }
+};
+
+typedef osg::TriangleIndexFunctor<TriangleCollectOperator> TriangleCollector;
+
+// A Geometry of the model in model coordinates, with the StateSets along its path merged into its StateSet.
+struct SourceGeometry
+{
+    osg::ref_ptr<osg::Geometry> geometry;
+    IndexList                   triangles;  // vertex indices, three per triangle, empty when placed whole
+};
+
+typedef std::vector<SourceGeometry> SourceGeometryList;
+
+bool isPolygonMode(GLenum mode)
+{
+    switch(mode)
+    {
+        case(GL_TRIANGLES):
+        case(GL_TRIANGLE_STRIP):
+        case(GL_TRIANGLE_FAN):
+        case(GL_QUADS):
+        case(GL_QUAD_STRIP):
+        case(GL_POLYGON):
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Geometries are split into tiles by triangle when they are indexable triangles with per vertex arrays.
+bool isSplittable(const osg::Geometry& geometry)
+{
+    if (!dynamic_cast<const osg::Vec3Array*>(geometry.getVertexArray())) return false;
+
+    osg::Geometry::ArrayList arrays;
+    geometry.getArrayList(arrays);
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        if ((*itr)->getBinding()==osg::Array::BIND_PER_PRIMITIVE_SET) return false;
+    }
+
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        if (!isPolygonMode(primitiveSet->getMode()) || primitiveSet->getNumInstances()>0) return false;
+    }
+    return true;
+}
+
+// Collects the Geometries of the model, applying the transforms above them to their vertices and merging the
+// StateSets above them, so the model can be partitioned without regard to its hierarchy.
+class FlattenVisitor : public osg::NodeVisitor
+{
+public:
+    FlattenVisitor(SourceGeometryList& geometries):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _geometries(geometries)
+    {
+        _matrixStack.push_back(osg::Matrix::identity());
+        _stateSetStack.push_back(0);
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        pushStateSet(node.getStateSet());
+        traverse(node);
+        popStateSet(node.getStateSet());
+    }
+
+    virtual void apply(osg::Transform& transform)
+    {
+        osg::Matrix matrix = _matrixStack.back();
+        transform.computeLocalToWorldMatrix(matrix, this);
+        _matrixStack.push_back(matrix);
+        apply(static_cast<osg::Node&>(transform));
+        _matrixStack.pop_back();
+    }
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        const osg::Matrix& matrix = _matrixStack.back();
+        bool transformed = !matrix.isIdentity();
+
+        SourceGeometry source;
+        source.geometry = new osg::Geometry(geometry, transformed ? osg::CopyOp::DEEP_COPY_ARRAYS : osg::CopyOp::SHALLOW_COPY);
+        if (transformed)
+        {
+            osgUtil::TransformAttributeFunctor functor(matrix);
+            source.geometry->accept(functor);
+            source.geometry->dirtyBound();
+        }
+
+        pushStateSet(geometry.getStateSet());
+        source.geometry->setStateSet(_stateSetStack.back());
+        popStateSet(geometry.getStateSet());
+
+        if (isSplittable(*source.geometry))
+        {
+            TriangleCollector collector;
+            collector.indices = &source.triangles;
+            for(unsigned int i=0; i<source.geometry->getNumPrimitiveSets(); ++i)
+            {
+                source.geometry->getPrimitiveSet(i)->accept(collector);
+            }
+            if (source.triangles.empty()) return;
+        }
+
+        _geometries.push_back(source);
+    }
+
+protected:
+
+    void pushStateSet(osg::StateSet* stateset)
+    {
+        if (!stateset) return;
+
+        osg::StateSet* parent = _stateSetStack.back();
+        if (!parent)
+        {
+            _stateSetStack.push_back(stateset);
+            return;
+        }
+
+        // share the merged StateSets, so that Geometries with the same state can be merged in each tile.
+        osg::ref_ptr<osg::StateSet>& merged = _mergedStateSets[StateSetPair(parent, stateset)];
+        if (!merged)
+        {
+            merged = new osg::StateSet(*parent, osg::CopyOp::SHALLOW_COPY);
+            merged->merge(*stateset);
+        }
+        _stateSetStack.push_back(merged.get());
+    }
+
+    void popStateSet(osg::StateSet* stateset)
+    {
+        if (stateset) _stateSetStack.pop_back();
+    }
+
+    typedef std::pair<osg::StateSet*, osg::StateSet*> StateSetPair;
+    typedef std::map<StateSetPair, osg::ref_ptr<osg::StateSet> > MergedStateSetMap;
+
+    SourceGeometryList&         _geometries;
+    std::vector<osg::Matrix>    _matrixStack;
+    std::vector<osg::StateSet*> _stateSetStack;
+    MergedStateSetMap           _mergedStateSets;
+};
+
+// Copies the elements of an array at a list of indices.
+class ArrayCompactor : public osg::ConstArrayVisitor
+{
+public:
+    ArrayCompactor(const IndexList& indices): _indices(indices) {}
+
+    osg::Array* compact(const osg::Array* array)
+    {
+        if (!array) return 0;
+        if (array->getBinding()!=osg::Array::BIND_PER_VERTEX) return osg::clone(array, osg::CopyOp::DEEP_COPY_ALL);
+
+        _result = 0;
+        array->accept(*this);
+        if (_result.valid())
+        {
+            _result->setBinding(array->getBinding());
+            _result->setNormalize(array->getNormalize());
+        }
+        return _result.release();
+    }
+
+    template<class A>
+    void copy(const A& array)
+    {
+        osg::ref_ptr<A> result = new A;
+        result->reserve(_indices.size());
+        for(IndexList::const_iterator itr = _indices.begin(); itr != _indices.end(); ++itr) result->push_back(array[*itr]);
+        _result = result.get();
+    }
+
+    virtual void apply(const osg::ByteArray& array) { copy(array); }
+    virtual void apply(const osg::ShortArray& array) { copy(array); }
+    virtual void apply(const osg::IntArray& array) { copy(array); }
+    virtual void apply(const osg::UByteArray& array) { copy(array); }
+    virtual void apply(const osg::UShortArray& array) { copy(array); }
+    virtual void apply(const osg::UIntArray& array) { copy(array); }
+    virtual void apply(const osg::FloatArray& array) { copy(array); }
+    virtual void apply(const osg::DoubleArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2bArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3bArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4bArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2sArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3sArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4sArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2iArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3iArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4iArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2ubArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3ubArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4ubArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2usArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3usArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4usArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2uiArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3uiArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4uiArray& array) { copy(array); }
+    virtual void apply(const osg::Vec2Array& array) { copy(array); }
+    virtual void apply(const osg::Vec3Array& array) { copy(array); }
+    virtual void apply(const osg::Vec4Array& array) { copy(array); }
+    virtual void apply(const osg::Vec2dArray& array) { copy(array); }
+    virtual void apply(const osg::Vec3dArray& array) { copy(array); }
+    virtual void apply(const osg::Vec4dArray& array) { copy(array); }
+    virtual void apply(const osg::MatrixfArray& array) { copy(array); }
+    virtual void apply(const osg::MatrixdArray& array) { copy(array); }
+    virtual void apply(const osg::UInt64Array& array) { copy(array); }
+    virtual void apply(const osg::Int64Array& array) { copy(array); }
+
+protected:
+    const IndexList&            _indices;
+    osg::ref_ptr<osg::Array>    _result;
+};
+
+// create a Geometry of the triangles of a source Geometry, with only the vertices they use.
+osg::Geometry* extractTriangles(const osg::Geometry& source, const IndexList& triangles)
+{
+    unsigned int numVertices = source.getVertexArray()->getNumElements();
+    IndexList remap(numVertices, 0xffffffffu);
+    IndexList vertices;
+    osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    elements->reserve(triangles.size());
+    for(IndexList::const_iterator itr = triangles.begin(); itr != triangles.end(); ++itr)
+    {
+        if (remap[*itr]==0xffffffffu)
+        {
+            remap[*itr] = vertices.size();
+            vertices.push_back(*itr);
+        }
+        elements->push_back(remap[*itr]);
+    }
+
+    ArrayCompactor compactor(vertices);
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setStateSet(const_cast<osg::StateSet*>(source.getStateSet()));
+    geometry->setVertexArray(compactor.compact(source.getVertexArray()));
+    geometry->setNormalArray(compactor.compact(source.getNormalArray()));
+    geometry->setColorArray(compactor.compact(source.getColorArray()));
+    geometry->setSecondaryColorArray(compactor.compact(source.getSecondaryColorArray()));
+    geometry->setFogCoordArray(compactor.compact(source.getFogCoordArray()));
+    for(unsigned int i=0; i<source.getNumTexCoordArrays(); ++i)
+    {
+        geometry->setTexCoordArray(i, compactor.compact(source.getTexCoordArray(i)));
+    }
+    for(unsigned int i=0; i<source.getNumVertexAttribArrays(); ++i)
+    {
+        geometry->setVertexAttribArray(i, compactor.compact(source.getVertexAttribArray(i)));
+    }
+    geometry->addPrimitiveSet(elements.get());
+    return geometry.release();
+}
+
+// a triangle of a source Geometry.
+struct TriangleRef
+{
+    unsigned int source;
+    unsigned int triangle;
+
+    TriangleRef(unsigned int s, unsigned int t): source(s), triangle(t) {}
+};
+
+typedef std::vector<TriangleRef> TriangleRefList;
+
+struct Tile
+{
+    unsigned int                level;
+    unsigned int                x, y, z;
+    osg::BoundingBoxd           bounds;
+    std::vector<unsigned int>   children;
+    TriangleRefList             triangles;      // of the finest tiles
+    IndexList                   wholeGeometries; // of the finest tiles
+    unsigned int                numTriangles;
+
+    osg::ref_ptr<osg::Node>     node;           // the tile, written into its parent's file
+    osg::ref_ptr<osg::Geode>    coarse;         // the geometry of the tile, simplified for its parent
+
+    Tile(): level(0), x(0), y(0), z(0), numTriangles(0) {}
+};
+
+typedef std::vector<Tile> TileList;
+
+void mergeGeometries(osg::Geode& geode)
+{
+    // merging is limited to the number of vertices of a tile, rather than the default suited to small drawables.
+    osgUtil::Optimizer::MergeGeometryVisitor mgv;
+    mgv.setTargetMaximumNumberOfVertices(0xffffffffu);
+    mgv.mergeGroup(geode);
+}
+
+unsigned int getNumTriangles(const osg::Geode& geode)
+{
+    unsigned int numTriangles = 0;
+    IndexList triangles;
+    TriangleCollector collector;
+    collector.indices = &triangles;
+    for(unsigned int i=0; i<geode.getNumDrawables(); ++i)
+    {
+        triangles.clear();
+        geode.getDrawable(i)->accept(collector);
+        numTriangles += triangles.size()/3;
+    }
+    return numTriangles;
+}
+
+class TileBuilder
+{
+public:
+    TileBuilder(const PagedLODBuilder& builder, const SourceGeometryList& sources, TileList& tiles,
+                const std::string& directory, const std::string& baseName):
+        _builder(builder),
+        _sources(sources),
+        _tiles(tiles),
+        _directory(directory),
+        _baseName(baseName) {}
+
+    std::string getChildrenFileName(const Tile& tile) const
+    {
+        std::ostringstream str;
+        str<<_baseName<<"_L"<<tile.level+1<<"_X"<<tile.x<<"_Y"<<tile.y<<"_Z"<<tile.z<<"."<<_builder.getTileExtension();
+        return str.str();
+    }
+
+    bool write(const osg::Node& node, const std::string& fileName)
+    {
+        std::string path = osgDB::concatPaths(_directory, fileName);
+        if (!osgDB::writeNodeFile(node, path, _builder.getOptions()))
+        {
+            OSG_WARN<<"PagedLODBuilder: unable to write "<<path<<std::endl;
+            ++_numFailures;
+            return false;
+        }
+        ++_numFilesWritten;
+        return true;
+    }
+
+    void build(Tile& tile)
+    {
+        if (tile.children.empty()) buildLeaf(tile);
+        else buildParent(tile);
+    }
+
+    unsigned int getNumFilesWritten() const { return _numFilesWritten; }
+    unsigned int getNumFailures() const { return _numFailures; }
+
+protected:
+
+    void buildLeaf(Tile& tile)
+    {
+        // gather the triangles of each source Geometry.
+        std::map<unsigned int, IndexList> sourceTriangles;
+        for(TriangleRefList::const_iterator itr = tile.triangles.begin(); itr != tile.triangles.end(); ++itr)
+        {
+            const IndexList& triangles = _sources[itr->source].triangles;
+            IndexList& indices = sourceTriangles[itr->source];
+            indices.insert(indices.end(), triangles.begin()+itr->triangle*3, triangles.begin()+itr->triangle*3+3);
+        }
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        for(std::map<unsigned int, IndexList>::iterator itr = sourceTriangles.begin(); itr != sourceTriangles.end(); ++itr)
+        {
+            geode->addDrawable(extractTriangles(*_sources[itr->first].geometry, itr->second));
+        }
+        for(IndexList::const_iterator itr = tile.wholeGeometries.begin(); itr != tile.wholeGeometries.end(); ++itr)
+        {
+            // copied, as merging may append to the arrays of the Geometry, which may be shared with the model.
+            geode->addDrawable(new osg::Geometry(*_sources[*itr].geometry, osg::CopyOp::DEEP_COPY_ARRAYS | osg::CopyOp::DEEP_COPY_PRIMITIVES));
+        }
+        mergeGeometries(*geode);
+
+        tile.node = geode.get();
+        tile.coarse = geode.get();
+    }
+
+    void buildParent(Tile& tile)
+    {
+        // simplify a copy of the children's geometry, the tile not being subdivided further than its children.
+        osg::ref_ptr<osg::Geode> coarse = new osg::Geode;
+        osg::BoundingSphere bs;
+        for(std::vector<unsigned int>::const_iterator itr = tile.children.begin(); itr != tile.children.end(); ++itr)
+        {
+            const Tile& child = _tiles[*itr];
+            bs.expandBy(child.node->getBound());
+            for(unsigned int i=0; i<child.coarse->getNumDrawables(); ++i)
+            {
+                const osg::Geometry* geometry = child.coarse->getDrawable(i)->asGeometry();
+                if (geometry) coarse->addDrawable(new osg::Geometry(*geometry, osg::CopyOp::DEEP_COPY_ARRAYS | osg::CopyOp::DEEP_COPY_PRIMITIVES));
+            }
+        }
+        mergeGeometries(*coarse);
+
+        unsigned int numTriangles = getNumTriangles(*coarse);
+        unsigned int maximumNumTriangles = _builder.getMaximumNumTrianglesPerTile();
+        if (numTriangles>maximumNumTriangles)
+        {
+            double sampleRatio = double(maximumNumTriangles)/double(numTriangles);
+            if (_builder.getUseQuadricSimplifier())
+            {
+                osgUtil::QuadricSimplifier simplifier(sampleRatio);
+                simplifier.setLockBorders(true);
+                coarse->accept(simplifier);
+            }
+            else
+            {
+                osgUtil::Simplifier simplifier(sampleRatio);
+                coarse->accept(simplifier);
+            }
+        }
+
+        // the children are written together, to be paged in by the PagedLOD of the tile.
+        std::string childrenFileName = getChildrenFileName(tile);
+        osg::ref_ptr<osg::Group> children = new osg::Group;
+        for(std::vector<unsigned int>::const_iterator itr = tile.children.begin(); itr != tile.children.end(); ++itr)
+        {
+            children->addChild(_tiles[*itr].node.get());
+        }
+        write(*children, childrenFileName);
+
+        float cutOffRange = bs.radius()*_builder.getRangeFactor();
+        osg::ref_ptr<osg::PagedLOD> plod = new osg::PagedLOD;
+        plod->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+        plod->setCenter(bs.center());
+        plod->setRadius(bs.radius());
+        plod->addChild(coarse.get(), cutOffRange, FLT_MAX);
+        plod->setFileName(1, childrenFileName);
+        plod->setRange(1, 0.0f, cutOffRange);
+
+        tile.node = plod.get();
+        tile.coarse = coarse.get();
+
+        // the children have been written and simplified, so are no longer needed.
+        for(std::vector<unsigned int>::const_iterator itr = tile.children.begin(); itr != tile.children.end(); ++itr)
+        {
+            _tiles[*itr].node = 0;
+            _tiles[*itr].coarse = 0;
+        }
+    }
+
+    const PagedLODBuilder&      _builder;
+    const SourceGeometryList&   _sources;
+    TileList&                   _tiles;
+    std::string                 _directory;
+    std::string                 _baseName;
+    OpenThreads::Atomic         _numFilesWritten;
+    OpenThreads::Atomic         _numFailures;
+};
+
+// builds the tiles of a level, taking the next tile from the list until none are left.
+struct LevelOperation
+{
+    TileBuilder&                        builder;
+    TileList&                           tiles;
+    const std::vector<unsigned int>&    level;
+    OpenThreads::Atomic                 next;
+
+    LevelOperation(TileBuilder& b, TileList& t, const std::vector<unsigned int>& l): builder(b), tiles(t), level(l) {}
+
+    void run()
+    {
+        unsigned int i;
+        while((i = (++next)-1) < level.size())
+        {
+            builder.build(tiles[level[i]]);
+        }
+    }
+};
+
+class LevelThread : public OpenThreads::Thread
+{
+public:
+    LevelThread(LevelOperation& operation): _operation(operation) {}
+    virtual void run() { _operation.run(); }
+protected:
+    LevelOperation& _operation;
+};
+
+}
+
+PagedLODBuilder::PagedLODBuilder():
+    _subdivisionMode(AUTOMATIC),
+    _maximumNumTrianglesPerTile(50000),
+    _maximumNumLevels(10),
+    _rangeFactor(4.0f),
+    _useQuadricSimplifier(true),
+    _numThreads(OpenThreads::GetNumberOfProcessors()>1 ? OpenThreads::GetNumberOfProcessors()-1 : 0),
+    _tileExtension("osgb"),
+    _numFilesWritten(0),
+    _numTiles(0),
+    _numLevels(0)
+{
+}
+
+bool PagedLODBuilder::build(osg::Node& model, const std::string& fileName)
+{
+    _numFilesWritten = 0;
+    _numTiles = 0;
+    _numLevels = 0;
+
+    if (!Registry::instance()->getReaderWriterForExtension(_tileExtension))
+    {
+        OSG_WARN<<"PagedLODBuilder::build() no plugin to write ."<<_tileExtension<<" files."<<std::endl;
+        return false;
+    }
+
+    SourceGeometryList sources;
+    FlattenVisitor flattener(sources);
+    model.accept(flattener);
+
+    // the centroids of the triangles, and the centres of the Geometries placed whole, place them in the tiles.
+    TriangleRefList triangles;
+    std::vector<osg::Vec3d> centroids;
+    IndexList wholeGeometries;
+    std::vector<osg::Vec3d> wholeCentres;
+    osg::BoundingBoxd bounds;
+    for(unsigned int s=0; s<sources.size(); ++s)
+    {
+        const SourceGeometry& source = sources[s];
+        if (source.triangles.empty())
+        {
+            wholeGeometries.push_back(s);
+            wholeCentres.push_back(osg::Vec3d(source.geometry->getBoundingBox().center()));
+            bounds.expandBy(wholeCentres.back());
+            continue;
+        }
+
+        const osg::Vec3Array& vertices = *static_cast<const osg::Vec3Array*>(source.geometry->getVertexArray());
+        for(unsigned int t=0; t<source.triangles.size()/3; ++t)
+        {
+            osg::Vec3d centroid = (osg::Vec3d(vertices[source.triangles[t*3]])+osg::Vec3d(vertices[source.triangles[t*3+1]])+osg::Vec3d(vertices[source.triangles[t*3+2]]))/3.0;
+            triangles.push_back(TriangleRef(s, t));
+            centroids.push_back(centroid);
+            bounds.expandBy(centroid);
+        }
+    }
+
+    if (triangles.empty() && wholeGeometries.empty())
+    {
+        OSG_NOTICE<<"PagedLODBuilder::build() model has no geometry."<<std::endl;
+        return false;
+    }
+
+    osg::Vec3d size = bounds._max-bounds._min;
+    bool quadtree = _subdivisionMode==QUADTREE ||
+                    (_subdivisionMode==AUTOMATIC && size.z()*4.0<osg::maximum(size.x(), size.y()));
+
+    // subdivide the tiles breadth first, so the tiles of each level are contiguous.
+    TileList tiles(1);
+    tiles[0].bounds = bounds;
+    tiles[0].numTriangles = triangles.size();
+    tiles[0].triangles.swap(triangles);
+    tiles[0].wholeGeometries.swap(wholeGeometries);
+
+    // the centroid of each triangle is only needed while subdividing, so the references index them by order.
+    std::vector<IndexList> tileCentroids(1);
+    std::vector<IndexList> tileWholeCentres(1);
+    for(unsigned int i=0; i<centroids.size(); ++i) tileCentroids[0].push_back(i);
+    for(unsigned int i=0; i<wholeCentres.size(); ++i) tileWholeCentres[0].push_back(i);
+
+    std::vector< std::vector<unsigned int> > levels(1, std::vector<unsigned int>(1, 0));
+    for(unsigned int t=0; t<tiles.size(); ++t)
+    {
+        unsigned int numItems = tiles[t].triangles.size()+tiles[t].wholeGeometries.size();
+        if (tiles[t].numTriangles<=_maximumNumTrianglesPerTile || tiles[t].level+1>=_maximumNumLevels || numItems<=1) continue;
+
+        osg::Vec3d center = tiles[t].bounds.center();
+        unsigned int numChildren = quadtree ? 4 : 8;
+        unsigned int firstChild = tiles.size();
+        tiles.resize(tiles.size()+numChildren);
+        tileCentroids.resize(tiles.size());
+        tileWholeCentres.resize(tiles.size());
+
+        Tile& tile = tiles[t];
+        for(unsigned int c=0; c<numChildren; ++c)
+        {
+            Tile& child = tiles[firstChild+c];
+            child.level = tile.level+1;
+            child.x = tile.x*2+(c&1);
+            child.y = tile.y*2+((c>>1)&1);
+            child.z = quadtree ? 0 : tile.z*2+((c>>2)&1);
+            child.bounds = tile.bounds;
+            if (c&1) child.bounds.xMin() = center.x(); else child.bounds.xMax() = center.x();
+            if (c&2) child.bounds.yMin() = center.y(); else child.bounds.yMax() = center.y();
+            if (!quadtree)
+            {
+                if (c&4) child.bounds.zMin() = center.z(); else child.bounds.zMax() = center.z();
+            }
+        }
+
+        for(unsigned int i=0; i<tile.triangles.size(); ++i)
+        {
+            unsigned int centroidIndex = tileCentroids[t][i];
+            const osg::Vec3d& centroid = centroids[centroidIndex];
+            unsigned int c = (centroid.x()>=center.x() ? 1 : 0) | (centroid.y()>=center.y() ? 2 : 0) | ((!quadtree && centroid.z()>=center.z()) ? 4 : 0);
+            tiles[firstChild+c].triangles.push_back(tile.triangles[i]);
+            tileCentroids[firstChild+c].push_back(centroidIndex);
+            ++tiles[firstChild+c].numTriangles;
+        }
+        for(unsigned int i=0; i<tile.wholeGeometries.size(); ++i)
+        {
+            unsigned int centreIndex = tileWholeCentres[t][i];
+            const osg::Vec3d& centre = wholeCentres[centreIndex];
+            unsigned int c = (centre.x()>=center.x() ? 1 : 0) | (centre.y()>=center.y() ? 2 : 0) | ((!quadtree && centre.z()>=center.z()) ? 4 : 0);
+            tiles[firstChild+c].wholeGeometries.push_back(tile.wholeGeometries[i]);
+            tileWholeCentres[firstChild+c].push_back(centreIndex);
+
+            IndexList wholeTriangles;
+            TriangleCollector collector;
+            collector.indices = &wholeTriangles;
+            sources[tile.wholeGeometries[i]].geometry->accept(collector);
+            tiles[firstChild+c].numTriangles += wholeTriangles.size()/3;
+        }
+        TriangleRefList().swap(tile.triangles);
+        IndexList().swap(tile.wholeGeometries);
+        IndexList().swap(tileCentroids[t]);
+        IndexList().swap(tileWholeCentres[t]);
+
+        // keep the children with geometry, the empty ones at the end of the list being dropped below.
+        for(unsigned int c=0; c<numChildren; ++c)
+        {
+            Tile& child = tiles[firstChild+c];
+            if (child.triangles.empty() && child.wholeGeometries.empty()) continue;
+            tiles[t].children.push_back(firstChild+c);
+            if (levels.size()<=child.level) levels.resize(child.level+1);
+            levels[child.level].push_back(firstChild+c);
+        }
+    }
+    tileCentroids.clear();
+    tileWholeCentres.clear();
+
+    for(unsigned int l=0; l<levels.size(); ++l) _numTiles += levels[l].size();
+    _numLevels = levels.size();
+
+    std::string directory = osgDB::getFilePath(fileName);
+    if (!directory.empty()) osgDB::makeDirectory(directory);
+
+    // build the tiles bottom up, each level in parallel, the parent tiles simplifying their children's.
+    TileBuilder tileBuilder(*this, sources, tiles, directory, osgDB::getNameLessExtension(osgDB::getSimpleFileName(fileName)));
+    for(unsigned int l=levels.size(); l>0; --l)
+    {
+        LevelOperation operation(tileBuilder, tiles, levels[l-1]);
+
+        std::vector<LevelThread*> threads;
+        unsigned int numThreads = osg::minimum(_numThreads, static_cast<unsigned int>(levels[l-1].size()-1));
+        for(unsigned int i=0; i<numThreads; ++i)
+        {
+            threads.push_back(new LevelThread(operation));
+            threads.back()->start();
+        }
+
+        operation.run();
+
+        for(std::vector<LevelThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+
+        OSG_INFO<<"PagedLODBuilder::build() built "<<levels[l-1].size()<<" tiles of level "<<l-1<<std::endl;
+    }
+
+    bool result = tileBuilder.write(*tiles[0].node, osgDB::getSimpleFileName(fileName));
+    _numFilesWritten = tileBuilder.getNumFilesWritten();
+
+    return result && tileBuilder.getNumFailures()==0;
+}
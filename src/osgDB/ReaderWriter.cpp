@@ -64,6 +64,9 @@ std::string ReaderWriter::ReadResult::statusMessage() const
     case INSUFFICIENT_MEMORY_TO_LOAD:
         description += "insufficient memory to load";
         break;
+    case READ_CANCELLED:
+        description += "read cancelled";
+        break;
     }
 
     if (!_message.empty())
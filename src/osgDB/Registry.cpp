@@ -35,6 +35,7 @@
 #include <algorithm>
 #include <set>
 #include <memory>
+#include <sstream>
 
 #include <stdlib.h>
 
@@ -63,6 +64,10 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_READ_THREADS <value>","Set the number of threads used to read external references in parallel, when enabled via osgDB::Options.");
+static osg::ApplicationUsageProxy Registry_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OBJECT_CACHE_MAX_SIZE <megabytes>","Set the maximum estimated size of the objects held in the Registry's ObjectCache, least recently used objects are evicted once exceeded.");
+static osg::ApplicationUsageProxy Registry_e5(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_MAX_SIZE <megabytes>","Set the maximum size of the files held in the FileCache, least recently used files are removed once exceeded.");
+static osg::ApplicationUsageProxy Registry_e6(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_WRITE_BEHIND on/off","Enable/disable writing the files added to the FileCache on a background thread.");
 
 
 // from MimeTypes.cpp
@@ -238,20 +243,47 @@ Registry::Registry()
     const char* ptr=0;
 
     _expiryDelay = 10.0;
+    _inFlightReadToken = 0;
     if( (ptr = getenv("OSG_EXPIRY_DELAY")) != 0)
     {
         _expiryDelay = osg::asciiToDouble(ptr);
         OSG_INFO<<"Registry : Expiry delay = "<<_expiryDelay<<std::endl;
     }
 
+    _numReadThreads = OpenThreads::GetNumberOfProcessors();
+    if( (ptr = getenv("OSG_NUM_READ_THREADS")) != 0)
+    {
+        _numReadThreads = atoi(ptr);
+        OSG_INFO<<"Registry : Number of read threads = "<<_numReadThreads<<std::endl;
+    }
+
     const char* fileCachePath = getenv("OSG_FILE_CACHE");
     if (fileCachePath)
     {
         _fileCache = new FileCache(fileCachePath);
+
+        if( (ptr = getenv("OSG_FILE_CACHE_WRITE_BEHIND")) != 0)
+        {
+            bool switchOff = (strcmp(ptr, "off")==0 || strcmp(ptr, "OFF")==0 || strcmp(ptr, "Off")==0 );
+            _fileCache->setWriteBehind(!switchOff);
+            OSG_INFO<<"Registry : FileCache write behind = "<<!switchOff<<std::endl;
+        }
+
+        if( (ptr = getenv("OSG_FILE_CACHE_MAX_SIZE")) != 0)
+        {
+            double megabytes = osg::asciiToDouble(ptr);
+            _fileCache->setMaximumSize(static_cast<unsigned long long>(megabytes*1024.0*1024.0));
+            OSG_INFO<<"Registry : FileCache maximum size = "<<megabytes<<"MB"<<std::endl;
+        }
     }
 
     // assign ObjectCache.
     _objectCache = new ObjectCache;
+    if( (ptr = getenv("OSG_OBJECT_CACHE_MAX_SIZE")) != 0)
+    {
+        _objectCache->setMaximumSize(static_cast<unsigned long long>(osg::asciiToDouble(ptr)*1024.0*1024.0));
+        OSG_INFO<<"Registry : ObjectCache maximum size = "<<_objectCache->getMaximumSize()<<" bytes"<<std::endl;
+    }
 
     _createNodeFromImage = false;
     _openingLibrary = false;
@@ -495,6 +527,9 @@ void Registry::destruct()
     // clean up the FileCache
     _fileCache = 0;
 
+    // stop the read threads before the plugins they may be using are unloaded.
+    setNumReadThreads(0);
+
 
     // object cache clear needed here to prevent crash in unref() of
     // the objects it contains when running the TXP plugin.
@@ -1138,6 +1173,12 @@ std::string Registry::findLibraryFileImplementation(const std::string& filename,
 
 ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
 {
+    // don't start the read if the result is no longer required.
+    if (readFunctor._options && readFunctor._options->isReadCancelled())
+    {
+        return ReaderWriter::ReadResult(ReaderWriter::ReadResult::READ_CANCELLED);
+    }
+
     for(ArchiveExtensionList::iterator aitr=_archiveExtList.begin();
         aitr!=_archiveExtList.end();
         ++aitr)
@@ -1209,6 +1250,12 @@ ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
         }
     }
 
+    // a ReaderWriter may have abandoned the read, in which case don't go on to try loading further plugins.
+    if (readFunctor._options && readFunctor._options->isReadCancelled())
+    {
+        return ReaderWriter::ReadResult(ReaderWriter::ReadResult::READ_CANCELLED);
+    }
+
     // now look for a plug-in to load the file.
     std::string libraryName = createLibraryNameForFile(readFunctor._filename);
     if (loadLibrary(libraryName)!=NOT_LOADED)
@@ -1252,6 +1299,21 @@ ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
     return result;
 }
 
+bool Registry::isEnclosingRead(const InFlightRead* read, unsigned int token) const
+{
+    // follow the chain of reads that enclose the read with the given token, reads that have completed end the chain.
+    while(token!=0)
+    {
+        if (read->_token==token) return true;
+
+        InFlightReadTokenMap::const_iterator itr = _inFlightReadTokens.find(token);
+        if (itr==_inFlightReadTokens.end()) return false;
+
+        token = itr->second->_enclosingToken;
+    }
+    return false;
+}
+
 ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFunctor,Options::CacheHintOptions cacheHint)
 {
     std::string file(readFunctor._filename);
@@ -1268,7 +1330,7 @@ ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFun
 
     if (useObjectCache)
     {
-        // search for entry in the object cache.
+        // search for entry in the object cache, only this lookup is counted in the caches' hits and misses.
         osg::ref_ptr<osg::Object> object = optionsCache ? optionsCache->getRefFromObjectCache(file, options) : 0;
 
         if (!object && _objectCache.valid()) object = _objectCache->getRefFromObjectCache(file, options);
@@ -1279,29 +1341,90 @@ ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFun
             else return ReaderWriter::ReadResult("Error file does not contain an osg::Object");
         }
 
-        ReaderWriter::ReadResult rr = read(readFunctor);
-        if (rr.validObject())
+        // if another read of the same file is in progress wait for it to complete and then use the cached result.
+        // Each read passes its token on to the reads nested within it through their Options, so that a nested read
+        // of a file already being read by an enclosing read goes ahead, whichever thread it is on, rather than deadlocking.
+        static const char* inFlightReadTokenName = "osgDB::Registry::InFlightRead";
+        unsigned int enclosingToken = options ? static_cast<unsigned int>(strtoul(options->getPluginStringData(inFlightReadTokenName).c_str(), 0, 10)) : 0;
+
+        InFlightReadKey key(file, options ? options->getOptionString() : std::string());
+        osg::ref_ptr<InFlightRead> inFlightRead;
+        osg::ref_ptr<InFlightRead> otherRead;
         {
-            // search AGAIN for entry in the object cache.
-            object = _objectCache->getRefFromObjectCache(file, options);
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inFlightReadsMutex);
+            InFlightReadMap::iterator itr = _inFlightReads.find(key);
+            if (itr == _inFlightReads.end())
+            {
+                if (++_inFlightReadToken==0) ++_inFlightReadToken;
+                inFlightRead = new InFlightRead(_inFlightReadToken, enclosingToken);
+                _inFlightReads[key] = inFlightRead;
+                _inFlightReadTokens[inFlightRead->_token] = inFlightRead.get();
+            }
+            else if (!isEnclosingRead(itr->second.get(), enclosingToken))
+            {
+                otherRead = itr->second;
+            }
+        }
+
+        osg::ref_ptr<Options> tokenOptions;
+        osg::ref_ptr<ReadFunctor> tokenReadFunctor;
+        if (inFlightRead.valid())
+        {
+            tokenOptions = options ? options->cloneOptions() : new Options;
+            std::ostringstream token;
+            token<<inFlightRead->_token;
+            tokenOptions->setPluginStringData(inFlightReadTokenName, token.str());
+            tokenReadFunctor = readFunctor.cloneType(file, tokenOptions.get());
+        }
+
+        if (otherRead.valid())
+        {
+            otherRead->_block->block();
+
+            object = optionsCache ? optionsCache->getRefFromObjectCache(file, options, false) : 0;
+            if (!object && _objectCache.valid()) object = _objectCache->getRefFromObjectCache(file, options, false);
+
             if (object.valid())
             {
                 if (readFunctor.isValid(object.get())) return ReaderWriter::ReadResult(object.get(), ReaderWriter::ReadResult::FILE_LOADED_FROM_CACHE);
-                else
-                {
-                    return ReaderWriter::ReadResult("Error file does not contain an osg::Object");
-                }
+                else return ReaderWriter::ReadResult("Error file does not contain an osg::Object");
             }
 
-            // update cache with new entry.
-            if (optionsCache) optionsCache->addEntryToObjectCache(file, rr.getObject(), 0.0, options);
-            else if (_objectCache.valid()) _objectCache->addEntryToObjectCache(file, rr.getObject(), 0.0, options);
+            // the other read failed so try reading the file here.
+        }
+
+        ReaderWriter::ReadResult rr = read(tokenReadFunctor.valid() ? *tokenReadFunctor : readFunctor);
+        if (rr.validObject())
+        {
+            // search AGAIN for entry in the object cache.
+            object = optionsCache ? optionsCache->getRefFromObjectCache(file, options, false) : 0;
+            if (!object && _objectCache.valid()) object = _objectCache->getRefFromObjectCache(file, options, false);
+
+            if (object.valid())
+            {
+                if (readFunctor.isValid(object.get())) rr = ReaderWriter::ReadResult(object.get(), ReaderWriter::ReadResult::FILE_LOADED_FROM_CACHE);
+                else rr = ReaderWriter::ReadResult("Error file does not contain an osg::Object");
+            }
+            else
+            {
+                // update cache with new entry.
+                if (optionsCache) optionsCache->addEntryToObjectCache(file, rr.getObject(), 0.0, options);
+                else if (_objectCache.valid()) _objectCache->addEntryToObjectCache(file, rr.getObject(), 0.0, options);
+            }
         }
         else
         {
             OSG_INFO<<"No valid object found for "<<file<<std::endl;
         }
 
+        if (inFlightRead.valid())
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inFlightReadsMutex);
+            _inFlightReads.erase(key);
+            _inFlightReadTokens.erase(inFlightRead->_token);
+            inFlightRead->_block->release();
+        }
+
         return rr;
 
     }
@@ -1312,6 +1435,47 @@ ReaderWriter::ReadResult Registry::readImplementation(const ReadFunctor& readFun
     }
 }
 
+void Registry::setNumReadThreads(unsigned int numThreads)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_readThreadsMutex);
+
+    _numReadThreads = numThreads;
+
+    // stop any running threads, they are restarted on demand with the new number of threads.
+    for(ReadThreads::iterator itr = _readThreads.begin();
+        itr != _readThreads.end();
+        ++itr)
+    {
+        (*itr)->setDone(true);
+    }
+
+    for(ReadThreads::iterator itr = _readThreads.begin();
+        itr != _readThreads.end();
+        ++itr)
+    {
+        (*itr)->cancel();
+    }
+
+    _readThreads.clear();
+}
+
+osg::OperationQueue* Registry::getOrCreateReadOperationQueue()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_readThreadsMutex);
+
+    if (!_readOperationQueue) _readOperationQueue = new osg::OperationQueue;
+
+    while(_readThreads.size() < _numReadThreads)
+    {
+        osg::ref_ptr<osg::OperationThread> thread = new osg::OperationThread;
+        thread->setOperationQueue(_readOperationQueue.get());
+        thread->startThread();
+        _readThreads.push_back(thread);
+    }
+
+    return _readOperationQueue.get();
+}
+
 
 ReaderWriter::ReadResult Registry::openArchiveImplementation(const std::string& fileName, ReaderWriter::ArchiveStatus status, unsigned int indexBlockSizeHint, const Options* options)
 {
@@ -12,15 +12,78 @@
 */
 
 #include <osg/Timer>
+#include <osg/Uniform>
 #include <osgDB/SharedStateManager>
 
 using namespace osgDB;
 
+namespace
+{
+
+inline void hashCombine(unsigned int& hash, unsigned int value)
+{
+    hash ^= value + 0x9e3779b9 + (hash<<6) + (hash>>2);
+}
+
+inline void hashCombine(unsigned int& hash, const void* ptr)
+{
+    size_t value = reinterpret_cast<size_t>(ptr);
+    hashCombine(hash, static_cast<unsigned int>(value));
+    if (sizeof(size_t)>sizeof(unsigned int)) hashCombine(hash, static_cast<unsigned int>(static_cast<unsigned long long>(value)>>32));
+}
+
+inline void hashCombine(unsigned int& hash, const std::string& str)
+{
+    unsigned int value = 2166136261u;
+    for(std::string::const_iterator itr = str.begin(); itr != str.end(); ++itr)
+    {
+        value = (value ^ static_cast<unsigned char>(*itr)) * 16777619u;
+    }
+    hashCombine(hash, value);
+}
+
+inline void hashCombine(unsigned int& hash, const osg::StateSet::ModeList& modes)
+{
+    hashCombine(hash, static_cast<unsigned int>(modes.size()));
+    for(osg::StateSet::ModeList::const_iterator itr = modes.begin(); itr != modes.end(); ++itr)
+    {
+        hashCombine(hash, static_cast<unsigned int>(itr->first));
+        hashCombine(hash, static_cast<unsigned int>(itr->second));
+    }
+}
+
+}
+
+class SharedStateManager::ShareVisitor : public osg::NodeVisitor
+{
+    public:
+
+        ShareVisitor(SharedStateManager* manager, OpenThreads::Mutex* mt):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _manager(manager),
+            _context(mt)
+        {
+            setTraversalMask(manager->getTraversalMask());
+            setNodeMaskOverride(manager->getNodeMaskOverride());
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            osg::StateSet* ss = node.getStateSet();
+            if(ss) _manager->process(ss, &node, _context);
+            traverse(node);
+        }
+
+    protected:
+
+        SharedStateManager* _manager;
+        ShareContext        _context;
+};
+
 SharedStateManager::SharedStateManager(unsigned int mode):
     osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
 {
     setShareMode(mode);
-    _mutex=0;
 }
 
 void SharedStateManager::setShareMode(unsigned int mode)
@@ -31,6 +94,10 @@ void SharedStateManager::setShareMode(unsigned int mode)
     _shareTexture[osg::Object::STATIC] =        (_shareMode & SHARE_STATIC_TEXTURES)!=0;
     _shareTexture[osg::Object::UNSPECIFIED] =   (_shareMode & SHARE_UNSPECIFIED_TEXTURES)!=0;
 
+    _shareAttribute[osg::Object::DYNAMIC] =     (_shareMode & SHARE_DYNAMIC_ATTRIBUTES)!=0;
+    _shareAttribute[osg::Object::STATIC] =      (_shareMode & SHARE_STATIC_ATTRIBUTES)!=0;
+    _shareAttribute[osg::Object::UNSPECIFIED] = (_shareMode & SHARE_UNSPECIFIED_ATTRIBUTES)!=0;
+
     _shareStateSet[osg::Object::DYNAMIC] =      (_shareMode & SHARE_DYNAMIC_STATESETS)!=0;
     _shareStateSet[osg::Object::STATIC] =       (_shareMode & SHARE_STATIC_STATESETS)!=0;
     _shareStateSet[osg::Object::UNSPECIFIED] =  (_shareMode & SHARE_UNSPECIFIED_STATESETS)!=0;
@@ -41,23 +108,25 @@ void SharedStateManager::setShareMode(unsigned int mode)
 //----------------------------------------------------------------
 void SharedStateManager::prune()
 {
-    StateSetSet::iterator sitr;
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
+
+    // prune the StateSet's first as they hold references to the shared attributes.
+    StateSetMap::iterator sitr;
     for(sitr=_sharedStateSetList.begin(); sitr!=_sharedStateSetList.end();)
     {
-        if ((*sitr)->referenceCount()<=1)
+        if (sitr->second->referenceCount()<=1)
             _sharedStateSetList.erase(sitr++);
         else
             ++sitr;
     }
 
-    TextureSet::iterator titr;
-    for(titr=_sharedTextureList.begin(); titr!=_sharedTextureList.end();)
+    AttributeSet::iterator aitr;
+    for(aitr=_sharedAttributeList.begin(); aitr!=_sharedAttributeList.end();)
     {
-        if ((*titr)->referenceCount()<=1)
-            _sharedTextureList.erase(titr++);
+        if ((*aitr)->referenceCount()<=1)
+            _sharedAttributeList.erase(aitr++);
         else
-            ++titr;
+            ++aitr;
     }
 
 }
@@ -68,19 +137,9 @@ void SharedStateManager::prune()
 //----------------------------------------------------------------
 void SharedStateManager::share(osg::Node *node, OpenThreads::Mutex *mt)
 {
-//    const osg::Timer& timer = *osg::Timer::instance();
-//    osg::Timer_t start_tick = timer.tick();
-
-    _mutex = mt;
-    node->accept(*this);
-    tmpSharedTextureList.clear();
-    tmpSharedStateSetList.clear();
-    _mutex = 0;
-
-//    osg::Timer_t end_tick = timer.tick();
-//     std::cout << "SHARING TIME = "<<timer.delta_m(start_tick,end_tick)<<"ms"<<std::endl;
-//     std::cout << "   _sharedStateSetList.size() = "<<_sharedStateSetList.size()<<std::endl;
-//     std::cout << "   _sharedTextureList.size() = "<<_sharedTextureList.size()<<std::endl;
+    // use a visitor of our own so that several threads may share subgraphs at once.
+    ShareVisitor visitor(this, mt);
+    node->accept(visitor);
 }
 
 
@@ -90,7 +149,7 @@ void SharedStateManager::share(osg::Node *node, OpenThreads::Mutex *mt)
 void SharedStateManager::apply(osg::Node& node)
 {
     osg::StateSet* ss = node.getStateSet();
-    if(ss) process(ss, &node);
+    if(ss) process(ss, &node, _context);
     traverse(node);
 }
 
@@ -98,8 +157,9 @@ bool SharedStateManager::isShared(osg::StateSet* ss)
 {
     if (shareStateSet(ss->getDataVariance()))
     {
+        unsigned int hash = computeHash(*ss);
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-        return find(ss) != 0;
+        return find(ss, hash) != 0;
     }
     else
         return false;
@@ -116,32 +176,135 @@ bool SharedStateManager::isShared(osg::Texture* texture)
         return false;
 }
 
+unsigned int SharedStateManager::getNumSharedStateSets() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
+    return static_cast<unsigned int>(_sharedStateSetList.size());
+}
+
+unsigned int SharedStateManager::getNumSharedAttributes() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
+    return static_cast<unsigned int>(_sharedAttributeList.size());
+}
+
 //----------------------------------------------------------------
 // SharedStateManager::find
 //----------------------------------------------------------------
-//
-// The find methods don't need to lock _listMutex because the thread
-// from which they are called is doing the writing to the lists.
-osg::StateSet *SharedStateManager::find(osg::StateSet *ss)
+osg::StateSet *SharedStateManager::find(osg::StateSet *ss, unsigned int hash)
 {
-    StateSetSet::iterator result
-        = _sharedStateSetList.find(osg::ref_ptr<osg::StateSet>(ss));
-    if (result == _sharedStateSetList.end())
-        return NULL;
-    else
-        return result->get();
+    std::pair<StateSetMap::iterator, StateSetMap::iterator> range = _sharedStateSetList.equal_range(hash);
+    for(StateSetMap::iterator itr = range.first; itr != range.second; ++itr)
+    {
+        if (itr->second==ss || itr->second->compare(*ss, true)==0) return itr->second.get();
+    }
+    return NULL;
 }
 
 osg::StateAttribute *SharedStateManager::find(osg::StateAttribute *sa)
 {
-    TextureSet::iterator result
-        = _sharedTextureList.find(osg::ref_ptr<osg::StateAttribute>(sa));
-    if (result == _sharedTextureList.end())
+    AttributeSet::iterator result
+        = _sharedAttributeList.find(osg::ref_ptr<osg::StateAttribute>(sa));
+    if (result == _sharedAttributeList.end())
         return NULL;
     else
         return result->get();
 }
 
+//----------------------------------------------------------------
+// SharedStateManager::findOrInsert
+//----------------------------------------------------------------
+//
+// The shared object is returned in a ref_ptr taken whilst _listMutex
+// is locked, so that a concurrent prune() can't delete it before the
+// caller has attached it to the subgraph.
+osg::ref_ptr<osg::StateAttribute> SharedStateManager::findOrInsert(osg::StateAttribute *sa)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
+    return *(_sharedAttributeList.insert(sa).first);
+}
+
+osg::ref_ptr<osg::StateSet> SharedStateManager::findOrInsert(osg::StateSet *ss)
+{
+    unsigned int hash = computeHash(*ss);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
+    osg::StateSet* ssFromSharedList = find(ss, hash);
+    if (ssFromSharedList) return ssFromSharedList;
+
+    _sharedStateSetList.insert(StateSetMap::value_type(hash, ss));
+    return ss;
+}
+
+//----------------------------------------------------------------
+// SharedStateManager::computeHash
+//----------------------------------------------------------------
+unsigned int SharedStateManager::computeHash(const osg::StateSet& ss)
+{
+    unsigned int hash = 0;
+
+    hashCombine(hash, ss.getModeList());
+
+    const osg::StateSet::AttributeList& attributes = ss.getAttributeList();
+    hashCombine(hash, static_cast<unsigned int>(attributes.size()));
+    for(osg::StateSet::AttributeList::const_iterator itr = attributes.begin(); itr != attributes.end(); ++itr)
+    {
+        hashCombine(hash, static_cast<unsigned int>(itr->first.first));
+        hashCombine(hash, itr->first.second);
+        hashCombine(hash, static_cast<unsigned int>(itr->second.second));
+
+        // only attributes that are interned are guaranteed to be the same object when equivalent.
+        const osg::StateAttribute* sa = itr->second.first.get();
+        if (sa && shareAttribute(sa)) hashCombine(hash, sa);
+    }
+
+    const osg::StateSet::TextureModeList& textureModes = ss.getTextureModeList();
+    hashCombine(hash, static_cast<unsigned int>(textureModes.size()));
+    for(unsigned int unit=0; unit<textureModes.size(); ++unit)
+    {
+        hashCombine(hash, textureModes[unit]);
+    }
+
+    const osg::StateSet::TextureAttributeList& textureAttributes = ss.getTextureAttributeList();
+    hashCombine(hash, static_cast<unsigned int>(textureAttributes.size()));
+    for(unsigned int unit=0; unit<textureAttributes.size(); ++unit)
+    {
+        const osg::StateSet::AttributeList& unitAttributes = textureAttributes[unit];
+        hashCombine(hash, static_cast<unsigned int>(unitAttributes.size()));
+        for(osg::StateSet::AttributeList::const_iterator itr = unitAttributes.begin(); itr != unitAttributes.end(); ++itr)
+        {
+            hashCombine(hash, static_cast<unsigned int>(itr->first.first));
+            hashCombine(hash, static_cast<unsigned int>(itr->second.second));
+
+            const osg::StateAttribute* sa = itr->second.first.get();
+            if (sa && shareAttribute(sa)) hashCombine(hash, sa);
+        }
+    }
+
+    const osg::StateSet::UniformList& uniforms = ss.getUniformList();
+    hashCombine(hash, static_cast<unsigned int>(uniforms.size()));
+    for(osg::StateSet::UniformList::const_iterator itr = uniforms.begin(); itr != uniforms.end(); ++itr)
+    {
+        hashCombine(hash, itr->first);
+        hashCombine(hash, static_cast<unsigned int>(itr->second.second));
+    }
+
+    const osg::StateSet::DefineList& defines = ss.getDefineList();
+    hashCombine(hash, static_cast<unsigned int>(defines.size()));
+    for(osg::StateSet::DefineList::const_iterator itr = defines.begin(); itr != defines.end(); ++itr)
+    {
+        hashCombine(hash, itr->first);
+        hashCombine(hash, itr->second.first);
+    }
+
+    hashCombine(hash, static_cast<unsigned int>(ss.getRenderingHint()));
+    hashCombine(hash, static_cast<unsigned int>(ss.getRenderBinMode()));
+    hashCombine(hash, static_cast<unsigned int>(ss.getBinNumber()));
+    hashCombine(hash, ss.getBinName());
+
+    return hash;
+}
+
 
 //----------------------------------------------------------------
 // SharedStateManager::setStateSet
@@ -154,54 +317,76 @@ void SharedStateManager::setStateSet(osg::StateSet* ss, osg::Object* object)
 
 
 //----------------------------------------------------------------
-// SharedStateManager::shareTextures
+// SharedStateManager::share
+//----------------------------------------------------------------
+osg::StateAttribute* SharedStateManager::share(osg::StateAttribute* sa, ShareContext& context)
+{
+    ShareContext::AttributeMap::iterator aitr = context.attributes.find(sa);
+    if (aitr!=context.attributes.end()) return aitr->second.get();
+
+    // First time the attribute appears in this subgraph, search for it in the shared list
+    osg::ref_ptr<osg::StateAttribute> saFromSharedList = findOrInsert(sa);
+    context.attributes[sa] = saFromSharedList;
+    return saFromSharedList.get();
+}
+
+
+//----------------------------------------------------------------
+// SharedStateManager::shareAttributes
 //----------------------------------------------------------------
-void SharedStateManager::shareTextures(osg::StateSet* ss)
+void SharedStateManager::shareAttributes(osg::StateSet* ss, ShareContext& context)
 {
-    const osg::StateSet::TextureAttributeList& texAttributes = ss->getTextureAttributeList();
-    for(unsigned int unit=0;unit<texAttributes.size();++unit)
+    typedef std::pair<osg::StateAttribute*, osg::StateAttribute::OverrideValue> Replacement;
+    typedef std::vector<Replacement> Replacements;
+
+    if (_shareMode & (SHARE_DYNAMIC_ATTRIBUTES | SHARE_STATIC_ATTRIBUTES | SHARE_UNSPECIFIED_ATTRIBUTES))
     {
-        osg::StateSet::RefAttributePair* pair = ss->getTextureAttributePair(unit, osg::StateAttribute::TEXTURE);
-        if (!pair) continue;
+        Replacements replacements;
+        const osg::StateSet::AttributeList& attributes = ss->getAttributeList();
+        for(osg::StateSet::AttributeList::const_iterator itr = attributes.begin(); itr != attributes.end(); ++itr)
+        {
+            osg::StateAttribute* sa = itr->second.first.get();
+            if (sa && shareAttribute(sa))
+            {
+                osg::StateAttribute* saFromSharedList = share(sa, context);
+                if (saFromSharedList!=sa) replacements.push_back(Replacement(saFromSharedList, itr->second.second));
+            }
+        }
 
-        osg::StateAttribute* texture = pair->first.get();
+        if (!replacements.empty())
+        {
+            if (context.mutex) context.mutex->lock();
+            for(Replacements::iterator itr = replacements.begin(); itr != replacements.end(); ++itr)
+            {
+                ss->setAttribute(itr->first, itr->second);
+            }
+            if (context.mutex) context.mutex->unlock();
+        }
+    }
 
-        // Valid Texture to be shared
-        if(texture && shareTexture(texture->getDataVariance()))
+    const osg::StateSet::TextureAttributeList& textureAttributes = ss->getTextureAttributeList();
+    for(unsigned int unit=0;unit<textureAttributes.size();++unit)
+    {
+        Replacements replacements;
+        const osg::StateSet::AttributeList& attributes = textureAttributes[unit];
+        for(osg::StateSet::AttributeList::const_iterator itr = attributes.begin(); itr != attributes.end(); ++itr)
         {
-            TextureTextureSharePairMap::iterator titr = tmpSharedTextureList.find(texture);
-            if(titr==tmpSharedTextureList.end())
+            osg::StateAttribute* sa = itr->second.first.get();
+            if (sa && shareAttribute(sa))
             {
-                // Texture is not in tmp list:
-                // First time it appears in this file, search Texture in sharedAttributeList
-                osg::StateAttribute* textureFromSharedList = find(texture);
-                if(textureFromSharedList)
-                {
-                    // Texture is in sharedAttributeList:
-                    // Share now. Required to be shared all next times
-                    if(_mutex) _mutex->lock();
-                    pair->first = textureFromSharedList;
-                    if(_mutex) _mutex->unlock();
-                    tmpSharedTextureList[texture] = TextureSharePair(textureFromSharedList, true);
-                }
-                else
-                {
-                    // Texture is not in _sharedAttributeList:
-                    // Add to _sharedAttributeList. Not needed to be
-                    // shared all next times.
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedTextureList.insert(texture);
-                    tmpSharedTextureList[texture] = TextureSharePair(texture, false);
-                }
+                osg::StateAttribute* saFromSharedList = share(sa, context);
+                if (saFromSharedList!=sa) replacements.push_back(Replacement(saFromSharedList, itr->second.second));
             }
-            else if(titr->second.second)
+        }
+
+        if (!replacements.empty())
+        {
+            if (context.mutex) context.mutex->lock();
+            for(Replacements::iterator itr = replacements.begin(); itr != replacements.end(); ++itr)
             {
-                // Texture is in tmpSharedAttributeList and share flag is on:
-                // It should be shared
-                if(_mutex) _mutex->lock();
-                pair->first = titr->second.first;
-                if(_mutex) _mutex->unlock();
+                ss->setTextureAttribute(unit, itr->first, itr->second);
             }
+            if (context.mutex) context.mutex->unlock();
         }
     }
 }
@@ -210,55 +395,34 @@ void SharedStateManager::shareTextures(osg::StateSet* ss)
 //----------------------------------------------------------------
 // SharedStateManager::process
 //----------------------------------------------------------------
-void SharedStateManager::process(osg::StateSet* ss, osg::Object* parent)
+void SharedStateManager::process(osg::StateSet* ss, osg::Object* parent, ShareContext& context)
 {
-    // Valid StateSet to be shared
-    if (shareStateSet(ss->getDataVariance()))
+    ShareContext::StateSetMap::iterator sitr = context.stateSets.find(ss);
+    if (sitr!=context.stateSets.end())
     {
-        StateSetStateSetSharePairMap::iterator sitr = tmpSharedStateSetList.find(ss);
-        if (sitr==tmpSharedStateSetList.end())
+        // StateSet has already been seen in this subgraph:
+        // share it if an equivalent one was found
+        if (sitr->second!=ss)
         {
-            // StateSet is not in tmp list:
-            // First time it appears in this file, search StateSet in sharedObjectList
-            osg::StateSet *ssFromSharedList = find(ss);
-            if (ssFromSharedList)
-            {
-                // StateSet is in sharedStateSetList:
-                // Share now. Required to be shared all next times
-                if (_mutex) _mutex->lock();
-                setStateSet(ssFromSharedList, parent);
-                if (_mutex) _mutex->unlock();
-                tmpSharedStateSetList[ss] = StateSetSharePair(ssFromSharedList, true);
-            }
-            else
-            {
-                // StateSet is not in sharedStateSetList:
-                // Add to sharedStateSetList. Not needed to be shared all next times.
-                {
-                    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedStateSetList.insert(ss);
-                    tmpSharedStateSetList[ss]
-                        = StateSetSharePair(ss, false);
-                }
-                // Only in this case sharing textures is also required
-                if (_shareMode & (SHARE_DYNAMIC_TEXTURES | SHARE_STATIC_TEXTURES | SHARE_UNSPECIFIED_TEXTURES))
-                {
-                    shareTextures(ss);
-                }
-            }
-        }
-        else if (sitr->second.second)
-        {
-            // StateSet is in tmpSharedStateSetList and share flag is on:
-            // It should be shared
-            if(_mutex) _mutex->lock();
-            setStateSet(sitr->second.first, parent);
-            if(_mutex) _mutex->unlock();
+            if (context.mutex) context.mutex->lock();
+            setStateSet(sitr->second.get(), parent);
+            if (context.mutex) context.mutex->unlock();
         }
+        return;
     }
-    else if (_shareMode & (SHARE_DYNAMIC_TEXTURES | SHARE_STATIC_TEXTURES | SHARE_UNSPECIFIED_TEXTURES))
+
+    // Intern the attributes first, so that equivalent StateSet's reference the
+    // same attributes and can be hashed and compared by attribute address
+    shareAttributes(ss, context);
+
+    osg::ref_ptr<osg::StateSet> ssFromSharedList = shareStateSet(ss->getDataVariance()) ? findOrInsert(ss) : osg::ref_ptr<osg::StateSet>(ss);
+    context.stateSets[ss] = ssFromSharedList;
+
+    if (ssFromSharedList!=ss)
     {
-        shareTextures(ss);
+        if (context.mutex) context.mutex->lock();
+        setStateSet(ssFromSharedList.get(), parent);
+        if (context.mutex) context.mutex->unlock();
     }
 }
 
@@ -267,8 +431,8 @@ void SharedStateManager::releaseGLObjects(osg::State* state) const
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
 
     {
-        TextureSet::const_iterator it;
-        for ( it = _sharedTextureList.begin(); it != _sharedTextureList.end(); ++it )
+        AttributeSet::const_iterator it;
+        for ( it = _sharedAttributeList.begin(); it != _sharedAttributeList.end(); ++it )
         {
             if ( it->valid() )
             {
@@ -278,12 +442,12 @@ void SharedStateManager::releaseGLObjects(osg::State* state) const
     }
 
     {
-        StateSetSet::const_iterator it;
+        StateSetMap::const_iterator it;
         for( it = _sharedStateSetList.begin(); it != _sharedStateSetList.end(); ++it )
         {
-            if ( it->valid() )
+            if ( it->second.valid() )
             {
-                it->get()->releaseGLObjects(state);
+                it->second->releaseGLObjects(state);
             }
         }
     }
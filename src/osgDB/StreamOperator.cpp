@@ -35,14 +35,23 @@ void InputIterator::readComponentArray( char* s, unsigned int numElements, unsig
 
         if (_byteSwap && componentSizeInBytes>1)
         {
+            // swap the whole block with fixed size swaps so the compiler can unroll and vectorize the loops
+            unsigned int numComponents = numElements * numComponentsPerElements;
             char* ptr = s;
-            for(unsigned int i=0; i<numElements; ++i)
+            switch(componentSizeInBytes)
             {
-                for(unsigned int j=0; j<numComponentsPerElements; ++j)
-                {
-                    osg::swapBytes( ptr, componentSizeInBytes );
-                    ptr += componentSizeInBytes;
-                }
+                case 2:
+                    for(unsigned int i=0; i<numComponents; ++i, ptr+=2) osg::swapBytes2( ptr );
+                    break;
+                case 4:
+                    for(unsigned int i=0; i<numComponents; ++i, ptr+=4) osg::swapBytes4( ptr );
+                    break;
+                case 8:
+                    for(unsigned int i=0; i<numComponents; ++i, ptr+=8) osg::swapBytes8( ptr );
+                    break;
+                default:
+                    for(unsigned int i=0; i<numComponents; ++i, ptr+=componentSizeInBytes) osg::swapBytes( ptr, componentSizeInBytes );
+                    break;
             }
         }
     }
@@ -24,6 +24,7 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
+#include <osgDB/ExternalFileLoader>
 #include <OpenThreads/ReentrantMutex>
 #include <osgUtil/Optimizer>
 
@@ -149,6 +150,7 @@ class ReadExternalsVisitor : public osg::NodeVisitor
 {
     osg::ref_ptr<ReaderWriter::Options> _options;
     bool _cloneExternalReferences;
+    osg::ref_ptr<osgDB::ExternalFileLoader> _externalFileLoader;
 
 public:
 
@@ -159,12 +161,30 @@ public:
     {
         if (options)
             _cloneExternalReferences = (options->getOptionString().find("cloneExternalReferences")!=std::string::npos);
+
+        // cloned externals are copied after they are read so can't be read in parallel.
+        if (osgDB::ExternalFileLoader::useParallelLoading(options) && !_cloneExternalReferences)
+            _externalFileLoader = new osgDB::ExternalFileLoader;
     }
 
     virtual ~ReadExternalsVisitor() {}
 
     virtual void apply(ProxyNode& node)
     {
+        if (_externalFileLoader.valid())
+        {
+            // each external needs its own pools, so queue the reads with a copy of the options.
+            osg::ref_ptr<ReaderWriter::Options> options = _options->cloneOptions();
+            options->setUserData( node.getUserData() );
+            node.setUserData(NULL);
+
+            for (unsigned int pos=0; pos<node.getNumFileNames(); pos++)
+            {
+                _externalFileLoader->addNode(node.getFileName(pos), options.get(), &node, node.getNumChildren()+pos);
+            }
+            return;
+        }
+
         // Transfer ownership of pools.
         _options->setUserData( node.getUserData() );
         node.setUserData(NULL);
@@ -184,6 +204,12 @@ public:
             }
         }
     }
+
+    // wait for any externals being read in parallel and add them to their ProxyNodes.
+    void complete()
+    {
+        if (_externalFileLoader.valid()) _externalFileLoader->complete();
+    }
 };
 
 
@@ -266,44 +292,60 @@ class FLTReaderWriter : public ReaderWriter
 
         virtual ReadResult readNode(const std::string& file, const Options* options) const
         {
-            SERIALIZER();
+            // unless externals are read in parallel the whole read, including the externals and textures, is serialized.
+            if (!osgDB::ExternalFileLoader::useParallelLoading(options))
+            {
+                SERIALIZER();
+                return readNodeFile(file, options);
+            }
+
+            return readNodeFile(file, options);
+        }
 
+        ReadResult readNodeFile(const std::string& file, const Options* options) const
+        {
             std::string ext = osgDB::getLowerCaseFileExtension(file);
             if (!acceptsExtension(ext)) return ReadResult::FILE_NOT_HANDLED;
 
             std::string fileName = osgDB::findDataFile(file, options);
             if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
 
-            // in local cache?
-            {
-                osg::ref_ptr<osg::Node> node = flt::Registry::instance()->getExternalFromLocalCache(fileName);
-                if (node.valid())
-                    return ReadResult(node, ReaderWriter::ReadResult::FILE_LOADED_FROM_CACHE);
-            }
-
             // setting up the database path so that internally referenced file are searched for on relative paths.
             osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
             local_opt->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
 
             ReadResult rr;
 
-            // read file
+            // parsing is always serialized, when reading in parallel the lock is released before reading the externals.
             {
-                osgDB::ifstream istream;
-                istream.imbue(std::locale::classic());
-                istream.open(fileName.c_str(), std::ios::in | std::ios::binary);
+                SERIALIZER();
+
+                // in local cache?
+                {
+                    osg::ref_ptr<osg::Node> node = flt::Registry::instance()->getExternalFromLocalCache(fileName);
+                    if (node.valid())
+                        return ReadResult(node, ReaderWriter::ReadResult::FILE_LOADED_FROM_CACHE);
+                }
 
-                if (istream)
+                // read file
                 {
-                    rr = readNode(istream,local_opt.get());
+                    osgDB::ifstream istream;
+                    istream.imbue(std::locale::classic());
+                    istream.open(fileName.c_str(), std::ios::in | std::ios::binary);
+
+                    if (istream)
+                    {
+                        rr = readNode(istream,local_opt.get());
+                    }
                 }
+
+                // add to local cache.
+                if (rr.success())
+                    flt::Registry::instance()->addExternalToLocalCache(fileName,rr.getNode());
             }
 
             if (rr.success())
             {
-                // add to local cache.
-                flt::Registry::instance()->addExternalToLocalCache(fileName,rr.getNode());
-
                 bool keepExternalReferences = false;
                 if (options)
                     keepExternalReferences = (options->getOptionString().find("keepExternalReferences")!=std::string::npos);
@@ -317,6 +359,7 @@ class FLTReaderWriter : public ReaderWriter
                     {
                         ReadExternalsVisitor visitor(local_opt.get());
                         rr.getNode()->accept(visitor);
+                        visitor.complete();
                     }
                 }
                 else
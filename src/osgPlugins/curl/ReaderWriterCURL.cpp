@@ -14,8 +14,11 @@
 #include <osgDB/FileUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <osgDB/Archive>
 #include <osgDB/Registry>
 
+#include <OpenThreads/ScopedLock>
+
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -37,6 +40,143 @@
 using namespace osg_curl;
 
 
+//
+//  CurlMulti
+//
+CurlMulti::CurlMulti(long maxHostConnections, long maxTotalConnections):
+    _done(false)
+{
+    OSG_INFO<<"CurlMulti::CurlMulti("<<maxHostConnections<<", "<<maxTotalConnections<<")"<<std::endl;
+
+    _multi = curl_multi_init();
+
+#if LIBCURL_VERSION_NUM >= 0x071e00
+    if (maxHostConnections>0) curl_multi_setopt(_multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxHostConnections);
+    if (maxTotalConnections>0) curl_multi_setopt(_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, maxTotalConnections);
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    // multiplex the requests to HTTP/2 servers over shared connections, the default from libcurl 7.62 onwards.
+    curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+}
+
+CurlMulti::~CurlMulti()
+{
+    OSG_INFO<<"CurlMulti::~CurlMulti()"<<std::endl;
+
+    stop();
+
+    if (_multi) curl_multi_cleanup(_multi);
+    _multi = 0;
+}
+
+CURLcode CurlMulti::perform(CURL* curl)
+{
+    Transfer transfer(curl);
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        if (_done) return curl_easy_perform(curl);
+
+        _pendingTransfers.push_back(&transfer);
+    }
+
+    wakeUp();
+    transfer.completed.block();
+
+    return transfer.result;
+}
+
+void CurlMulti::stop()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _done = true;
+    }
+
+    wakeUp();
+
+    if (isRunning()) join();
+}
+
+void CurlMulti::wakeUp()
+{
+#if LIBCURL_VERSION_NUM >= 0x074400
+    curl_multi_wakeup(_multi);
+#endif
+}
+
+void CurlMulti::run()
+{
+    bool done = false;
+    while(!done)
+    {
+        Transfers transfers;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            transfers.swap(_pendingTransfers);
+            done = _done;
+        }
+
+        for(Transfers::iterator itr = transfers.begin(); itr != transfers.end(); ++itr)
+        {
+            Transfer* transfer = *itr;
+            if (!done && curl_multi_add_handle(_multi, transfer->curl)==CURLM_OK)
+            {
+                _activeTransfers[transfer->curl] = transfer;
+            }
+            else
+            {
+                transfer->result = CURLE_FAILED_INIT;
+                transfer->completed.release();
+            }
+        }
+
+        int numRunning = 0;
+        if (!done) curl_multi_perform(_multi, &numRunning);
+
+        int numMessages = 0;
+        CURLMsg* message = 0;
+        while((message = curl_multi_info_read(_multi, &numMessages)) != 0)
+        {
+            if (message->msg!=CURLMSG_DONE) continue;
+
+            // the message is freed when its handle is removed, so take its result first.
+            CURL* curl = message->easy_handle;
+            CURLcode result = message->data.result;
+            curl_multi_remove_handle(_multi, curl);
+
+            ActiveTransfers::iterator itr = _activeTransfers.find(curl);
+            if (itr!=_activeTransfers.end())
+            {
+                itr->second->result = result;
+                itr->second->completed.release();
+                _activeTransfers.erase(itr);
+            }
+        }
+
+        if (done) break;
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+        // wait for activity on the connections, or for perform() or stop() to wake the thread.
+        curl_multi_poll(_multi, NULL, 0, 1000, NULL);
+#else
+        if (_activeTransfers.empty()) OpenThreads::Thread::microSleep(1000);
+        else curl_multi_wait(_multi, NULL, 0, 10, NULL);
+#endif
+    }
+
+    // abandon the transfers still in progress.
+    for(ActiveTransfers::iterator itr = _activeTransfers.begin(); itr != _activeTransfers.end(); ++itr)
+    {
+        curl_multi_remove_handle(_multi, itr->first);
+        itr->second->result = CURLE_ABORTED_BY_CALLBACK;
+        itr->second->completed.release();
+    }
+    _activeTransfers.clear();
+}
+
+
 //
 //  StreamObject
 //
@@ -76,6 +216,13 @@ size_t EasyCurl::StreamObject::read(char* ptr, size_t maxsize)
     return realsize;
 }
 
+int EasyCurl::ProgressCallback(void *data, double /*dltotal*/, double /*dlnow*/, double /*ultotal*/, double /*ulnow*/)
+{
+    // returning non zero makes libcurl abort the transfer with CURLE_ABORTED_BY_CALLBACK
+    const osgDB::Options* options = (const osgDB::Options*)data;
+    return (options && options->isReadCancelled()) ? 1 : 0;
+}
+
 std::string EasyCurl::getResultMimeType(const StreamObject& sp) const
 {
     return sp._resultMimeType;
@@ -143,6 +290,7 @@ EasyCurl::EasyCurl()
     _connectTimeout = 0; // no timeout by default.
     _timeout = 0;
     _sslVerifyPeer = 1L;
+    _httpVersion = 0;
 
     _curl = curl_easy_init();
 
@@ -164,12 +312,58 @@ osgDB::ReaderWriter::ReadResult EasyCurl::read(const std::string& proxyAddress,
 {
     setOptions(proxyAddress, fileName, sp, options);
 
-    CURLcode responseCode = curl_easy_perform(_curl);
+    // poll the ReadCancellationCallback during the transfer so that reads no longer required can be abandoned.
+    bool cancellable = options && options->getReadCancellationCallback();
+    if (cancellable)
+    {
+        curl_easy_setopt(_curl, CURLOPT_PROGRESSFUNCTION, ProgressCallback);
+        curl_easy_setopt(_curl, CURLOPT_PROGRESSDATA, (void *)options);
+        curl_easy_setopt(_curl, CURLOPT_NOPROGRESS, 0L);
+    }
+
+    CURLcode responseCode = perform();
     curl_easy_setopt(_curl, CURLOPT_WRITEDATA, (void *)0);
 
+    if (cancellable)
+    {
+        curl_easy_setopt(_curl, CURLOPT_NOPROGRESS, 1L);
+        curl_easy_setopt(_curl, CURLOPT_PROGRESSDATA, (void *)0);
+
+        if (responseCode==CURLE_ABORTED_BY_CALLBACK)
+        {
+            OSG_INFO<<"EasyCurl::read("<<fileName<<") cancelled."<<std::endl;
+            return osgDB::ReaderWriter::ReadResult::READ_CANCELLED;
+        }
+    }
+
     return processResponse(responseCode, proxyAddress, fileName, sp);
 }
 
+osgDB::ReaderWriter::ReadResult EasyCurl::readRange(const std::string& proxyAddress, const std::string& fileName, long long offset, long long length, StreamObject& sp, const osgDB::ReaderWriter::Options *options)
+{
+    std::ostringstream range;
+    range<<offset<<"-"<<(offset+length-1);
+    curl_easy_setopt(_curl, CURLOPT_RANGE, range.str().c_str());
+
+    osgDB::ReaderWriter::ReadResult result = read(proxyAddress, fileName, sp, options);
+
+    curl_easy_setopt(_curl, CURLOPT_RANGE, (char *)0);
+
+    return result;
+}
+
+long EasyCurl::getResponseCode() const
+{
+    long code = 0;
+    curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &code);
+    return code;
+}
+
+CURLcode EasyCurl::perform()
+{
+    return _curlMulti.valid() ? _curlMulti->perform(_curl) : curl_easy_perform(_curl);
+}
+
 osgDB::ReaderWriter::WriteResult EasyCurl::write(const std::string& proxyAddress, const std::string& fileName, StreamObject& sp, const osgDB::ReaderWriter::Options *options)
 {
     setOptions(proxyAddress, fileName, sp, options);
@@ -206,7 +400,7 @@ osgDB::ReaderWriter::WriteResult EasyCurl::write(const std::string& proxyAddress
     // Tell curl to use HTTP POST to send the form data.
     curl_easy_setopt(_curl, CURLOPT_HTTPPOST, post);
 
-    CURLcode responseCode = curl_easy_perform(_curl);
+    CURLcode responseCode = perform();
 
     if (post) curl_formfree(post);
     if (postedContent) free(postedContent);
@@ -256,6 +450,14 @@ void EasyCurl::setOptions(const std::string& proxyAddress, const std::string& fi
     // setting ssl verify peer (default is enabled)
     curl_easy_setopt(_curl, CURLOPT_SSL_VERIFYPEER, _sslVerifyPeer);
 
+    curl_easy_setopt(_curl, CURLOPT_HTTP_VERSION, _httpVersion);
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    // when sharing the connections of a CurlMulti, wait for one that requests can be multiplexed over rather than
+    // opening another.
+    curl_easy_setopt(_curl, CURLOPT_PIPEWAIT, _curlMulti.valid() ? 1L : 0L);
+#endif
+
     const osgDB::AuthenticationDetails* details = authenticationMap ?
         authenticationMap->getAuthenticationDetails(fileName) :
         0;
@@ -390,11 +592,79 @@ ReaderWriterCURL::ReaderWriterCURL()
     supportsOption("OSG_CURL_CONNECTTIMEOUT","Specify the connection timeout duration in seconds [default = 0 = not set].");
     supportsOption("OSG_CURL_TIMEOUT","Specify the timeout duration of the whole transfer in seconds [default = 0 = not set].");
     supportsOption("OSG_CURL_SSL_VERIFYPEER","Specify ssl verification peer [default = 1 = set].");
+    supportsOption("OSG_CURL_HTTP_VERSION","Specify the HTTP version requested, 1.0, 1.1, 2, 2TLS for HTTP/2 over https only, or 2PRIOR for HTTP/2 without upgrading from 1.1 [default = libcurl's default].");
+    supportsOption("OSG_CURL_CONNECTION_POOL","Specify whether transfers share a pool of connections, multiplexing requests to HTTP/2 servers, the default being set by the OSG_CURL_CONNECTION_POOL environment variable [default = 0 = unset]. With libcurl older than 7.68 pooled requests may wait up to 10ms to start. The OSG_CURL_MAX_HOST_CONNECTIONS and OSG_CURL_MAX_TOTAL_CONNECTIONS environment variables limit the connections of the pool [default = 0 = unlimited].");
+    supportsOption("OSG_CURL_RANGE_BLOCK_SIZE","Specify the size in bytes of the first block read of an osga archive by byte range requests as its index and files are read, 0 to download archives whole [default = 65536].");
 }
 
 ReaderWriterCURL::~ReaderWriterCURL()
 {
     //OSG_NOTICE<<"ReaderWriterCURL::~ReaderWriterCURL()"<<std::endl;
+
+    if (_curlMulti.valid()) _curlMulti->stop();
+}
+
+CurlMulti* ReaderWriterCURL::getCurlMulti() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_curlMultiMutex);
+
+    if (!_curlMulti)
+    {
+        long maxHostConnections = 0;
+        long maxTotalConnections = 0;
+
+        const char* ptr = 0;
+        if ((ptr = getenv("OSG_CURL_MAX_HOST_CONNECTIONS")) != 0) maxHostConnections = atol(ptr);
+        if ((ptr = getenv("OSG_CURL_MAX_TOTAL_CONNECTIONS")) != 0) maxTotalConnections = atol(ptr);
+
+        _curlMulti = new CurlMulti(maxHostConnections, maxTotalConnections);
+        _curlMulti->startThread();
+    }
+
+    return _curlMulti.get();
+}
+
+EasyCurl& ReaderWriterCURL::getConfiguredEasyCurl(const osgDB::ReaderWriter::Options *options, std::string& proxyAddress, long long& rangeBlockSize) const
+{
+    long connectTimeout = 0;
+    long timeout = 0;
+    long sslVerifyPeer = 1;
+    long httpVersion = 0;
+    // the pool is opt-in, as without curl_multi_poll() and curl_multi_wakeup(), before libcurl 7.68, the pool's
+    // thread waits up to 10ms between checks for new transfers, adding latency to each request.
+    bool useConnectionPool = false;
+    rangeBlockSize = 65536;
+    getConnectionOptions(options, proxyAddress, connectTimeout, timeout, sslVerifyPeer, httpVersion, useConnectionPool, rangeBlockSize);
+
+    EasyCurl& easyCurl = getEasyCurl();
+
+    // setup the timeouts:
+    easyCurl.setConnectionTimeout(connectTimeout);
+    easyCurl.setTimeout(timeout);
+    easyCurl.setSSLVerifyPeer(sslVerifyPeer);
+    easyCurl.setHttpVersion(httpVersion);
+    easyCurl.setCurlMulti(useConnectionPool ? getCurlMulti() : 0);
+
+    return easyCurl;
+}
+
+osgDB::ReaderWriter::ReadResult ReaderWriterCURL::readRange(const std::string& fileName, long long offset, long long length, std::string& data, bool& wholeFile, const Options* options) const
+{
+    std::string proxyAddress;
+    long long rangeBlockSize = 0;
+    EasyCurl& easyCurl = getConfiguredEasyCurl(options, proxyAddress, rangeBlockSize);
+
+    std::stringstream buffer;
+    EasyCurl::StreamObject sp(&buffer, NULL, std::string());
+
+    ReadResult result = easyCurl.readRange(proxyAddress, fileName, offset, length, sp, options);
+    if (result.status()==ReadResult::FILE_LOADED)
+    {
+        // 206 is Partial Content, any other success being the whole file.
+        wholeFile = easyCurl.getResponseCode()!=206;
+        data = buffer.str();
+    }
+    return result;
 }
 
 osgDB::ReaderWriter::WriteResult ReaderWriterCURL::writeFile(const osg::Object& obj, osgDB::ReaderWriter* rw, std::ostream& fout, const osgDB::ReaderWriter::Options *options) const
@@ -437,15 +707,9 @@ osgDB::ReaderWriter::WriteResult ReaderWriterCURL::writeFile(const osg::Object&
 
     // Configure curl connection options.
     std::string proxyAddress;
-    long connectTimeout = 0;
-    long timeout = 0;
-    long sslVerifyPeer = 1;
-    getConnectionOptions(options, proxyAddress, connectTimeout, timeout, sslVerifyPeer);
+    long long rangeBlockSize = 0;
+    EasyCurl& easyCurl = getConfiguredEasyCurl(options, proxyAddress, rangeBlockSize);
     EasyCurl::StreamObject sp(&responseBuffer, &requestBuffer, std::string());
-    EasyCurl& easyCurl = getEasyCurl();
-    easyCurl.setConnectionTimeout(connectTimeout);
-    easyCurl.setTimeout(timeout);
-    easyCurl.setSSLVerifyPeer(sslVerifyPeer);
 
     // Output requestBuffer via curl, and return responseBuffer in message of result.
     return easyCurl.write(proxyAddress, fullFileName, sp, options);
@@ -465,12 +729,44 @@ osgDB::ReaderWriter::ReadResult ReaderWriterCURL::readFile(ObjectType objectType
     return ReadResult::FILE_NOT_HANDLED;
 }
 
+// holds the downloaded contents of an archive for as long as the archive reads from them.
+struct ArchiveBuffer : public osg::Referenced
+{
+    std::stringstream buffer;
+};
+
+static long getHttpVersion(const std::string& version)
+{
+    if (version=="1.0") return CURL_HTTP_VERSION_1_0;
+    if (version=="1.1") return CURL_HTTP_VERSION_1_1;
+#if LIBCURL_VERSION_NUM >= 0x072100
+    if (version=="2") return CURL_HTTP_VERSION_2_0;
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072f00
+    if (version=="2TLS") return CURL_HTTP_VERSION_2TLS;
+#endif
+#if LIBCURL_VERSION_NUM >= 0x073100
+    if (version=="2PRIOR") return CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE;
+#endif
+    OSG_NOTICE<<"Warning: HTTP version "<<version<<" not supported by the curl plugin, using libcurl's default."<<std::endl;
+    return CURL_HTTP_VERSION_NONE;
+}
+
 void ReaderWriterCURL::getConnectionOptions(const osgDB::ReaderWriter::Options *options,
     std::string& proxyAddress,
     long& connectTimeout,
     long& timeout,
-    long& sslVerifyPeer) const
+    long& sslVerifyPeer,
+    long& httpVersion,
+    bool& useConnectionPool,
+    long long& rangeBlockSize) const
 {
+    const char* connectionPoolEnv = getenv("OSG_CURL_CONNECTION_POOL");
+    if (connectionPoolEnv)
+    {
+        useConnectionPool = !(strcmp(connectionPoolEnv, "0")==0 || strcmp(connectionPoolEnv, "off")==0 || strcmp(connectionPoolEnv, "OFF")==0 || strcmp(connectionPoolEnv, "Off")==0);
+    }
+
     if (options)
     {
         std::istringstream iss(options->getOptionString());
@@ -488,6 +784,12 @@ void ReaderWriterCURL::getConnectionOptions(const osgDB::ReaderWriter::Options *
                 timeout = atol(opt.substr( index+1 ).c_str()); // this will return 0 in case of improper format.
             else if( opt.substr(0, index) == "OSG_CURL_SSL_VERIFYPEER" )
                 sslVerifyPeer = atol(opt.substr( index+1 ).c_str()); // this will return 0 in case of improper format.
+            else if( opt.substr(0, index) == "OSG_CURL_HTTP_VERSION" )
+                httpVersion = getHttpVersion(opt.substr( index+1 ));
+            else if( opt.substr(0, index) == "OSG_CURL_CONNECTION_POOL" )
+                useConnectionPool = atol(opt.substr( index+1 ).c_str())!=0;
+            else if( opt.substr(0, index) == "OSG_CURL_RANGE_BLOCK_SIZE" )
+                rangeBlockSize = atol(opt.substr( index+1 ).c_str()); // this will return 0 in case of improper format.
         }
 
 
@@ -547,10 +849,33 @@ osgDB::ReaderWriter::ReadResult ReaderWriterCURL::readFile(ObjectType objectType
     OSG_INFO<<"ReaderWriterCURL::readFile("<<fullFileName<<")"<<std::endl;
 
     std::string proxyAddress;
-    long connectTimeout = 0;
-    long timeout = 0;
-    long sslVerifyPeer = 1;
-    getConnectionOptions(options, proxyAddress, connectTimeout, timeout, sslVerifyPeer);
+    long long rangeBlockSize = 0;
+    EasyCurl& easyCurl = getConfiguredEasyCurl(options, proxyAddress, rangeBlockSize);
+
+    // read osga archives a block at a time as their index and files are read, rather than downloading them whole.
+    if (objectType==ARCHIVE && ext=="osga" && rangeBlockSize>0 && fileName.compare(0, 4, "http")==0)
+    {
+        osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension(ext);
+        if (reader)
+        {
+            // the archive reads from the stream buffer long after the request that opened it has completed, so it
+            // mustn't be cancelled along with the request.
+            osg::ref_ptr<Options> rangeOptions = options ? options->cloneOptions() : new Options;
+            rangeOptions->setReadCancellationCallback(0);
+
+            osg::ref_ptr<RangeStreamBuffer> streamBuffer = new RangeStreamBuffer(this, fileName, rangeOptions.get(), rangeBlockSize);
+            std::istream fin(streamBuffer.get());
+            if (fin.peek()!=std::istream::traits_type::eof())
+            {
+                ReadResult readResult = reader->openArchive(fin, options);
+
+                // keep the stream buffer for as long as the archive reads from it.
+                if (readResult.validArchive()) readResult.getArchive()->setUserData(streamBuffer.get());
+
+                return readResult;
+            }
+        }
+    }
 
     bool uncompress = false;
 
@@ -584,12 +909,6 @@ osgDB::ReaderWriter::ReadResult ReaderWriterCURL::readFile(ObjectType objectType
     std::stringstream buffer;
 
     EasyCurl::StreamObject sp(&buffer, NULL, std::string());
-    EasyCurl& easyCurl = getEasyCurl();
-
-    // setup the timeouts:
-    easyCurl.setConnectionTimeout(connectTimeout);
-    easyCurl.setTimeout(timeout);
-    easyCurl.setSSLVerifyPeer(sslVerifyPeer);
 
     ReadResult curlResult = easyCurl.read(proxyAddress, fileName, sp, options);
 
@@ -642,7 +961,20 @@ osgDB::ReaderWriter::ReadResult ReaderWriterCURL::readFile(ObjectType objectType
             buffer.str(uncompressed);
         }
 
-        ReadResult readResult = readFile(objectType, reader, buffer, local_opt.get() );
+        ReadResult readResult;
+        if (objectType==ARCHIVE)
+        {
+            // archives read from the stream after it's opened, so it must outlive this method.
+            osg::ref_ptr<ArchiveBuffer> archiveBuffer = new ArchiveBuffer;
+            archiveBuffer->buffer.str(buffer.str());
+
+            readResult = readFile(objectType, reader, archiveBuffer->buffer, local_opt.get());
+            if (readResult.validArchive()) readResult.getArchive()->setUserData(archiveBuffer.get());
+        }
+        else
+        {
+            readResult = readFile(objectType, reader, buffer, local_opt.get());
+        }
 
         local_opt->getDatabasePathList().pop_front();
 
@@ -655,6 +987,101 @@ osgDB::ReaderWriter::ReadResult ReaderWriterCURL::readFile(ObjectType objectType
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  RangeStreamBuffer
+//
+RangeStreamBuffer::RangeStreamBuffer(const ReaderWriterCURL* rw, const std::string& fileName, const osgDB::Options* options, long long blockSize):
+    _rw(rw),
+    _fileName(fileName),
+    _options(options),
+    _minimumBlockSize(blockSize),
+    _blockSize(blockSize),
+    _blockPosition(0),
+    _wholeFile(false),
+    _numRequests(0)
+{
+}
+
+long long RangeStreamBuffer::getPosition() const
+{
+    return eback() ? _blockPosition + (gptr()-eback()) : _blockPosition;
+}
+
+bool RangeStreamBuffer::fetch(long long position)
+{
+    if (!_wholeFile)
+    {
+        // double the size of the blocks while the file is read sequentially, up to 4MB.
+        bool sequential = !_block.empty() && position==_blockPosition+static_cast<long long>(_block.size());
+        _blockSize = sequential ? osg::minimum(_blockSize*2, osg::maximum(_minimumBlockSize, static_cast<long long>(4096*1024))) : _minimumBlockSize;
+
+        ++_numRequests;
+
+        std::string data;
+        bool wholeFile = false;
+        if (!_rw->readRange(_fileName, position, _blockSize, data, wholeFile, _options.get()).success()) return false;
+
+        OSG_DEBUG<<"RangeStreamBuffer::fetch("<<position<<") "<<_fileName<<" read "<<data.size()<<" bytes"<<std::endl;
+
+        _block.swap(data);
+        _blockPosition = wholeFile ? 0 : position;
+        _wholeFile = wholeFile;
+    }
+
+    if (position<_blockPosition || position>=_blockPosition+static_cast<long long>(_block.size())) return false;
+
+    char* begin = &_block[0];
+    setg(begin, begin+(position-_blockPosition), begin+_block.size());
+    return true;
+}
+
+RangeStreamBuffer::int_type RangeStreamBuffer::underflow()
+{
+    if (gptr()<egptr()) return traits_type::to_int_type(*gptr());
+
+    if (!fetch(getPosition())) return traits_type::eof();
+
+    return traits_type::to_int_type(*gptr());
+}
+
+RangeStreamBuffer::pos_type RangeStreamBuffer::seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
+{
+    if ((which & std::ios_base::in)==0) return pos_type(off_type(-1));
+
+    long long position;
+    if (way==std::ios_base::beg) position = off;
+    else if (way==std::ios_base::cur) position = getPosition() + off;
+    else if (way==std::ios_base::end && _wholeFile) position = static_cast<long long>(_block.size()) + off;
+    else return pos_type(off_type(-1));
+
+    if (position<0) return pos_type(off_type(-1));
+
+    if (!_block.empty() && position>=_blockPosition && position<=_blockPosition+static_cast<long long>(_block.size()))
+    {
+        char* begin = &_block[0];
+        setg(begin, begin+(position-_blockPosition), begin+_block.size());
+    }
+    else if (_wholeFile)
+    {
+        return pos_type(off_type(-1));
+    }
+    else
+    {
+        // fetch the block at the new position when it's next read.
+        _block.clear();
+        _blockPosition = position;
+        setg(0, 0, 0);
+    }
+
+    return pos_type(position);
+}
+
+RangeStreamBuffer::pos_type RangeStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
 #ifdef USE_ZLIB
 
 #include <zlib.h>
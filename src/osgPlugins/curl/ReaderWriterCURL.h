@@ -17,6 +17,14 @@
 #include <osgDB/ReaderWriter>
 #include <osgDB/FileNameUtils>
 
+#include <OpenThreads/Block>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Thread>
+
+#include <map>
+#include <streambuf>
+#include <vector>
+
 namespace osg_curl
 {
 
@@ -29,6 +37,53 @@ enum ObjectType
     NODE
 };
 
+/** Performs the transfers of EasyCurl handles on a single libcurl multi handle, driven by a thread of its own, so that
+  * connections are pooled and reused across all the threads reading from the same servers, rather than each thread's
+  * handle keeping its own, and requests to HTTP/2 servers are multiplexed over a shared connection. The thread calling
+  * perform() blocks until its transfer completes, as it would with curl_easy_perform().*/
+class CurlMulti : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        /** Construct a CurlMulti, with the maximum number of connections to each host, and in total, 0 for no limit.*/
+        CurlMulti(long maxHostConnections, long maxTotalConnections);
+
+        /** Perform the transfer of an easy handle, which mustn't be used until the transfer completes.*/
+        CURLcode perform(CURL* curl);
+
+        /** Stop the thread, returning once it has exited.*/
+        void stop();
+
+        virtual void run();
+
+    protected:
+
+        virtual ~CurlMulti();
+
+        struct Transfer
+        {
+            Transfer(CURL* c): curl(c), result(CURLE_OK) {}
+
+            CURL*               curl;
+            CURLcode            result;
+            OpenThreads::Block  completed;
+        };
+
+        typedef std::vector<Transfer*> Transfers;
+        typedef std::map<CURL*, Transfer*> ActiveTransfers;
+
+        void wakeUp();
+
+        CURLM*              _multi;
+
+        OpenThreads::Mutex  _mutex;
+        Transfers           _pendingTransfers;
+        bool                _done;
+
+        // only used by the CurlMulti's thread.
+        ActiveTransfers     _activeTransfers;
+};
+
 class EasyCurl : public osg::Referenced
 {
     public:
@@ -51,6 +106,8 @@ class EasyCurl : public osg::Referenced
 
         static size_t StreamMemoryCallback(void *ptr, size_t size, size_t nmemb, void *data);
 
+        static int ProgressCallback(void *data, double dltotal, double dlnow, double ultotal, double ulnow);
+
         EasyCurl();
 
         // Added this function to set the desired connection timeout if needed (in case someone needs to try to connect
@@ -63,9 +120,21 @@ class EasyCurl : public osg::Referenced
 
         inline void setSSLVerifyPeer(long verifyPeer) { _sslVerifyPeer = verifyPeer; }
 
+        // the HTTP version requested, as a CURL_HTTP_VERSION_* value, 0 for libcurl's default.
+        inline void setHttpVersion(long httpVersion) { _httpVersion = httpVersion; }
+
+        // the CurlMulti to perform transfers on, sharing its connections, or 0 to perform them on this handle alone.
+        inline void setCurlMulti(CurlMulti* curlMulti) { _curlMulti = curlMulti; }
+
         // Perform HTTP GET to download data from web server.
         osgDB::ReaderWriter::ReadResult read(const std::string& proxyAddress, const std::string& fileName, StreamObject& sp, const osgDB::ReaderWriter::Options *options);
 
+        // Perform HTTP GET of the length bytes from offset onwards, servers ignoring the range returning the whole file.
+        osgDB::ReaderWriter::ReadResult readRange(const std::string& proxyAddress, const std::string& fileName, long long offset, long long length, StreamObject& sp, const osgDB::ReaderWriter::Options *options);
+
+        /** Returns the HTTP response code of the previous transfer. */
+        long getResponseCode() const;
+
         // Perform HTTP POST to upload data using "multipart/form-data" encoding to web server.
         osgDB::ReaderWriter::WriteResult write(const std::string& proxyAddress, const std::string& fileName, StreamObject& sp, const osgDB::ReaderWriter::Options *options);
 
@@ -85,6 +154,7 @@ class EasyCurl : public osg::Referenced
         EasyCurl& operator = (const EasyCurl&) { return *this; }
 
         void setOptions(const std::string& proxyAddress, const std::string& fileName, StreamObject& sp, const osgDB::ReaderWriter::Options *options);
+        CURLcode perform();
         osgDB::ReaderWriter::ReadResult processResponse(CURLcode responseCode, const std::string& proxyAddress, const std::string& fileName, StreamObject& sp);
 
         CURL* _curl;
@@ -94,6 +164,46 @@ class EasyCurl : public osg::Referenced
         long            _connectTimeout;
         long            _timeout;
         long            _sslVerifyPeer;
+        long            _httpVersion;
+
+        osg::ref_ptr<CurlMulti> _curlMulti;
+};
+
+class ReaderWriterCURL;
+
+/** Stream buffer reading a file from a server in blocks fetched with byte range requests as they're needed, so that an
+  * archive can be opened and its members read without downloading the whole archive. The blocks grow while the file is
+  * read sequentially, so that large members take few requests. Servers ignoring range requests have the whole file
+  * read by the first request.*/
+class RangeStreamBuffer : public std::streambuf, public osg::Referenced
+{
+    public:
+
+        RangeStreamBuffer(const ReaderWriterCURL* rw, const std::string& fileName, const osgDB::Options* options, long long blockSize);
+
+        unsigned int getNumRequests() const { return _numRequests; }
+
+    protected:
+
+        virtual ~RangeStreamBuffer() {}
+
+        virtual int_type underflow();
+        virtual pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which = std::ios_base::in);
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in);
+
+        long long getPosition() const;
+        bool fetch(long long position);
+
+        osg::ref_ptr<const ReaderWriterCURL>    _rw;
+        std::string                             _fileName;
+        osg::ref_ptr<const osgDB::Options>      _options;
+        long long                               _minimumBlockSize;
+        long long                               _blockSize;
+
+        std::string                             _block;
+        long long                               _blockPosition;
+        bool                                    _wholeFile;
+        unsigned int                            _numRequests;
 };
 
 
@@ -173,13 +283,24 @@ class ReaderWriterCURL : public osgDB::ReaderWriter
 
         bool read(std::istream& fin, std::string& destination) const;
 
+        /** Read the length bytes of a file from offset onwards into data, setting wholeFile if the server returned the
+          * whole file instead.*/
+        ReadResult readRange(const std::string& fileName, long long offset, long long length, std::string& data, bool& wholeFile, const Options* options) const;
+
     protected:
-        void getConnectionOptions(const osgDB::ReaderWriter::Options *options, std::string& proxyAddress, long& connectTimeout, long& timeout, long& sslVerifyPeer) const;
+        void getConnectionOptions(const osgDB::ReaderWriter::Options *options, std::string& proxyAddress, long& connectTimeout, long& timeout, long& sslVerifyPeer, long& httpVersion, bool& useConnectionPool, long long& rangeBlockSize) const;
+
+        EasyCurl& getConfiguredEasyCurl(const osgDB::ReaderWriter::Options *options, std::string& proxyAddress, long long& rangeBlockSize) const;
+
+        CurlMulti* getCurlMulti() const;
 
         typedef std::map< OpenThreads::Thread*, osg::ref_ptr<EasyCurl> >    ThreadCurlMap;
 
         mutable OpenThreads::Mutex          _threadCurlMapMutex;
         mutable ThreadCurlMap               _threadCurlMap;
+
+        mutable OpenThreads::Mutex          _curlMultiMutex;
+        mutable osg::ref_ptr<CurlMulti>     _curlMulti;
 };
 
 }
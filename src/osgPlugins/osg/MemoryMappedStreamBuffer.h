@@ -0,0 +1,143 @@
+#ifndef OSG2_MEMORYMAPPEDSTREAMBUFFER
+#define OSG2_MEMORYMAPPEDSTREAMBUFFER
+
+#include <osg/Notify>
+#include <streambuf>
+#include <string>
+#include <string.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <osgDB/ConvertUTF>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// Read only stream buffer that maps the whole of a file into memory, so that reads
+// copy directly from the page cache rather than via an intermediate file buffer.
+class MemoryMappedStreamBuffer : public std::streambuf
+{
+public:
+    MemoryMappedStreamBuffer() : _data(0), _size(0)
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        , _file(INVALID_HANDLE_VALUE), _mapping(0)
+#endif
+    {}
+
+    virtual ~MemoryMappedStreamBuffer() { close(); }
+
+    bool open( const std::string& fileName )
+    {
+        close();
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        _file = CreateFileW( osgDB::convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+        if ( _file==INVALID_HANDLE_VALUE ) return false;
+
+        LARGE_INTEGER fileSize;
+        if ( !GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart==0 ) { close(); return false; }
+
+        _mapping = CreateFileMapping( _file, NULL, PAGE_READONLY, 0, 0, NULL );
+        if ( !_mapping ) { close(); return false; }
+
+        _data = static_cast<char*>(MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 ));
+        if ( !_data ) { close(); return false; }
+        _size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open( fileName.c_str(), O_RDONLY );
+        if ( fd<0 ) return false;
+
+        struct stat fileStat;
+        if ( fstat(fd, &fileStat)!=0 || fileStat.st_size==0 ) { ::close(fd); return false; }
+
+        void* data = mmap( 0, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close(fd);
+        if ( data==MAP_FAILED ) return false;
+
+    #ifdef MADV_SEQUENTIAL
+        madvise( data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL );
+    #endif
+
+        _data = static_cast<char*>(data);
+        _size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+        setg( _data, _data, _data+_size );
+        OSG_INFO<<"MemoryMappedStreamBuffer::open("<<fileName<<") mapped "<<_size<<" bytes"<<std::endl;
+        return true;
+    }
+
+    void close()
+    {
+#if defined(_WIN32) && !defined(__CYGWIN__)
+        if ( _data ) UnmapViewOfFile( _data );
+        if ( _mapping ) CloseHandle( _mapping );
+        if ( _file!=INVALID_HANDLE_VALUE ) CloseHandle( _file );
+        _mapping = 0;
+        _file = INVALID_HANDLE_VALUE;
+#else
+        if ( _data ) munmap( _data, _size );
+#endif
+        _data = 0;
+        _size = 0;
+        setg( 0, 0, 0 );
+    }
+
+    bool isOpen() const { return _data!=0; }
+
+protected:
+
+    virtual std::streamsize showmanyc() { return egptr()-gptr(); }
+
+    // copy directly from the mapping, setg is used in place of gbump as the latter is limited to int offsets.
+    virtual std::streamsize xsgetn( char* s, std::streamsize n )
+    {
+        std::streamsize available = egptr()-gptr();
+        if ( n>available ) n = available;
+        if ( n>0 )
+        {
+            memcpy( s, gptr(), static_cast<size_t>(n) );
+            setg( eback(), gptr()+n, egptr() );
+        }
+        return n;
+    }
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in )
+    {
+        if ( !(which & std::ios_base::in) || !_data ) return pos_type(off_type(-1));
+
+        off_type position = 0;
+        if ( dir==std::ios_base::beg ) position = off;
+        else if ( dir==std::ios_base::cur ) position = (gptr()-eback()) + off;
+        else position = static_cast<off_type>(_size) + off;
+
+        if ( position<0 || position>static_cast<off_type>(_size) ) return pos_type(off_type(-1));
+
+        setg( eback(), eback()+position, egptr() );
+        return pos_type(position);
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which = std::ios_base::in )
+    {
+        return seekoff( off_type(pos), std::ios_base::beg, which );
+    }
+
+    char*   _data;
+    size_t  _size;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    HANDLE  _file;
+    HANDLE  _mapping;
+#endif
+
+private:
+    MemoryMappedStreamBuffer( const MemoryMappedStreamBuffer& );
+    MemoryMappedStreamBuffer& operator=( const MemoryMappedStreamBuffer& );
+};
+
+#endif
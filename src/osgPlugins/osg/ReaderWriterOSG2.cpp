@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
+#include "MemoryMappedStreamBuffer.h"
 #include "XmlStreamOperator.h"
 
 using namespace osgDB;
@@ -131,6 +132,8 @@ public:
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
         supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
+        supportsOption( "AlignedArrays", "Export option: Align binary array data to 16 byte boundaries for faster memory mapped reading" );
+        supportsOption( "MemoryMapped=<true|false>", "Import option: Memory map binary files rather than reading via a file stream, default true" );
         supportsOption( "WriteImageHint=<hint>", "Export option: Hint of writing image to stream: "
                         "<IncludeData> writes Image::data() directly; "
                         "<IncludeFile> writes the image file itself to stream; "
@@ -174,6 +177,12 @@ public:
         return local_opt.release();
     }
 
+    bool useMemoryMapping( const Options* options ) const
+    {
+        return options->getPluginStringData("fileType")=="Binary" &&
+               options->getPluginStringData("MemoryMapped")!="false";
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,6 +191,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt) )
+        {
+            MemoryMappedStreamBuffer buffer;
+            if ( buffer.open(fileName) )
+            {
+                std::istream istream( &buffer );
+                return readObject( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -202,6 +221,11 @@ public:
         is.decompress(); CATCH_EXCEPTION(is);
 
         osg::ref_ptr<osg::Object> obj = is.readObject(); CATCH_EXCEPTION(is);
+        if ( is.getExternalFileLoader() )
+        {
+            is.getExternalFileLoader()->complete();
+            if ( is.getExternalFileLoader()->removeFailedImages(obj.get()) ) obj = 0;
+        }
         return obj;
     }
 
@@ -213,6 +237,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt) )
+        {
+            MemoryMappedStreamBuffer buffer;
+            if ( buffer.open(fileName) )
+            {
+                std::istream istream( &buffer );
+                return readImage( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -232,6 +266,11 @@ public:
 
         is.decompress(); CATCH_EXCEPTION(is);
         osg::ref_ptr<osg::Image> image = is.readImage(); CATCH_EXCEPTION(is);
+        if ( is.getExternalFileLoader() )
+        {
+            is.getExternalFileLoader()->complete();
+            if ( is.getExternalFileLoader()->removeFailedImages(image.get()) ) image = 0;
+        }
 
         return image;
     }
@@ -244,6 +283,16 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        if ( useMemoryMapping(local_opt) )
+        {
+            MemoryMappedStreamBuffer buffer;
+            if ( buffer.open(fileName) )
+            {
+                std::istream istream( &buffer );
+                return readNode( istream, local_opt );
+            }
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
@@ -263,6 +312,11 @@ public:
 
         is.decompress(); CATCH_EXCEPTION(is);
         osg::ref_ptr<osg::Node> node = is.readObjectOfType<osg::Node>(); CATCH_EXCEPTION(is);
+        if ( is.getExternalFileLoader() )
+        {
+            is.getExternalFileLoader()->complete();
+            is.getExternalFileLoader()->removeFailedImages(node.get());
+        }
         if ( !node ) return ReadResult::FILE_NOT_HANDLED;
         return node;
     }
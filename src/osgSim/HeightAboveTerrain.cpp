@@ -15,7 +15,7 @@
 #include <osgSim/HeightAboveTerrain>
 
 #include <osg/Notify>
-#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/MultiLineSegmentIntersector>
 
 using namespace osgSim;
 
@@ -43,7 +43,8 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
     osg::CoordinateSystemNode* csn = dynamic_cast<osg::CoordinateSystemNode*>(scene);
     osg::EllipsoidModel* em = csn ? csn->getEllipsoidModel() : 0;
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    // intersect all the points' segments in a single traversal of the scene.
+    osg::ref_ptr<osgUtil::MultiLineSegmentIntersector> intersector = new osgUtil::MultiLineSegmentIntersector();
 
     for(HATList::iterator itr = _HATList.begin();
         itr != _HATList.end();
@@ -63,8 +64,7 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
 
             OSG_NOTICE<<"lat = "<<latitude<<" longitude = "<<longitude<<" height = "<<height<<std::endl;
 
-            osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(start, end);
-            intersectorGroup->addIntersector( intersector.get() );
+            intersector->addSegment(start, end);
         }
         else
         {
@@ -76,34 +76,25 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
 
             itr->_hat = height;
 
-            osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector( start, end);
-            intersectorGroup->addIntersector( intersector.get() );
+            intersector->addSegment(start, end);
         }
     }
 
     _intersectionVisitor.reset();
     _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
+    _intersectionVisitor.setIntersector( intersector.get() );
 
     scene->accept(_intersectionVisitor);
 
-    unsigned int index = 0;
-    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
-    for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
-        intersector_itr != intersectors.end();
-        ++intersector_itr, ++index)
+    for(unsigned int index = 0; index < _HATList.size(); ++index)
     {
-        osgUtil::LineSegmentIntersector* lsi = dynamic_cast<osgUtil::LineSegmentIntersector*>(intersector_itr->get());
-        if (lsi)
+        osgUtil::MultiLineSegmentIntersector::Intersections& intersections = intersector->getIntersections(index);
+        if (!intersections.empty())
         {
-            osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
-            if (!intersections.empty())
-            {
-                const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersections.begin();
-                osg::Vec3d intersectionPoint = intersection.matrix.valid() ? intersection.localIntersectionPoint * (*intersection.matrix) :
-                                               intersection.localIntersectionPoint;
-                _HATList[index]._hat = (_HATList[index]._point - intersectionPoint).length();
-            }
+            const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersections.begin();
+            osg::Vec3d intersectionPoint = intersection.matrix.valid() ? intersection.localIntersectionPoint * (*intersection.matrix) :
+                                           intersection.localIntersectionPoint;
+            _HATList[index]._hat = (_HATList[index]._point - intersectionPoint).length();
         }
     }
 
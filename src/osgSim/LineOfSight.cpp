@@ -15,7 +15,7 @@
 
 #include <osg/Notify>
 #include <osgDB/ReadFile>
-#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/MultiLineSegmentIntersector>
 
 using namespace osgSim;
 
@@ -106,44 +106,36 @@ unsigned int LineOfSight::addLOS(const osg::Vec3d& start, const osg::Vec3d& end)
 
 void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
 {
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    // intersect all the lines of sight in a single traversal of the scene.
+    osg::ref_ptr<osgUtil::MultiLineSegmentIntersector> intersector = new osgUtil::MultiLineSegmentIntersector();
 
     for(LOSList::iterator itr = _LOSList.begin();
         itr != _LOSList.end();
         ++itr)
     {
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(itr->_start, itr->_end);
-        intersectorGroup->addIntersector( intersector.get() );
+        intersector->addSegment(itr->_start, itr->_end);
     }
 
     _intersectionVisitor.reset();
     _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
+    _intersectionVisitor.setIntersector( intersector.get() );
 
     scene->accept(_intersectionVisitor);
 
-    unsigned int index = 0;
-    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
-    for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
-        intersector_itr != intersectors.end();
-        ++intersector_itr, ++index)
+    for(unsigned int index = 0; index < _LOSList.size(); ++index)
     {
-        osgUtil::LineSegmentIntersector* lsi = dynamic_cast<osgUtil::LineSegmentIntersector*>(intersector_itr->get());
-        if (lsi)
-        {
-            Intersections& intersectionsLOS = _LOSList[index]._intersections;
-            _LOSList[index]._intersections.clear();
+        Intersections& intersectionsLOS = _LOSList[index]._intersections;
+        _LOSList[index]._intersections.clear();
 
-            osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
+        osgUtil::MultiLineSegmentIntersector::Intersections& intersections = intersector->getIntersections(index);
 
-            for(osgUtil::LineSegmentIntersector::Intersections::iterator itr = intersections.begin();
-                itr != intersections.end();
-                ++itr)
-            {
-                const osgUtil::LineSegmentIntersector::Intersection& intersection = *itr;
-                if (intersection.matrix.valid()) intersectionsLOS.push_back( intersection.localIntersectionPoint * (*intersection.matrix) );
-                else intersectionsLOS.push_back( intersection.localIntersectionPoint  );
-            }
+        for(osgUtil::MultiLineSegmentIntersector::Intersections::iterator itr = intersections.begin();
+            itr != intersections.end();
+            ++itr)
+        {
+            const osgUtil::LineSegmentIntersector::Intersection& intersection = *itr;
+            if (intersection.matrix.valid()) intersectionsLOS.push_back( intersection.localIntersectionPoint * (*intersection.matrix) );
+            else intersectionsLOS.push_back( intersection.localIntersectionPoint  );
         }
     }
 
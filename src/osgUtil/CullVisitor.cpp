@@ -30,8 +30,13 @@
 
 #include <osgUtil/CullVisitor>
 
+#include <osg/OperationThread>
+
+#include <OpenThreads/ScopedLock>
+
 #include <float.h>
 #include <algorithm>
+#include <typeinfo>
 
 #include <osg/Timer>
 
@@ -52,7 +57,15 @@ CullVisitor::CullVisitor():
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _currentReuseStateGraphIndex(0),
+    _numRenderLeavesAtReset(0),
+    _numMatricesAtReset(0),
+    _numStateGraphsAtReset(0),
+    _numMatricesUsed(0),
+    _numStateGraphsUsed(0),
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _isParallelCullVisitor(false),
+    _traversingInParallel(false)
 {
     _identifier = new Identifier;
 }
@@ -67,8 +80,16 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
+    _currentReuseStateGraphIndex(0),
+    _numRenderLeavesAtReset(0),
+    _numMatricesAtReset(0),
+    _numStateGraphsAtReset(0),
+    _numMatricesUsed(0),
+    _numStateGraphsUsed(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
-    _identifier(rhs._identifier)
+    _identifier(rhs._identifier),
+    _isParallelCullVisitor(false),
+    _traversingInParallel(false)
 {
 }
 
@@ -130,9 +151,41 @@ void CullVisitor::reset()
 
     // reset the resuse lists.
     _currentReuseRenderLeafIndex = 0;
+    _currentReuseStateGraphIndex = 0;
+
+    _numRenderLeavesAtReset = _reuseRenderLeafList.size();
+    _numMatricesAtReset = _reuseMatrixList.size();
+    _numStateGraphsAtReset = _reuseStateGraphList.size();
+    _numMatricesUsed = 0;
+    _numStateGraphsUsed = 0;
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
+
+    // reset the RenderLeaf and RefMatrix objects handed over by the parallel cull visitors last frame.
+    for(ParallelCullVisitorList::iterator itr = _parallelCullVisitors.begin();
+        itr != _parallelCullVisitors.end();
+        ++itr)
+    {
+        (*itr)->reset();
+    }
+}
+
+void CullVisitor::getPoolStatistics(PoolStatistics& stats) const
+{
+    stats.numRenderLeaves += _currentReuseRenderLeafIndex;
+    stats.numRenderLeavesAllocated += _reuseRenderLeafList.size() - _numRenderLeavesAtReset;
+    stats.numMatrices += _numMatricesUsed + _currentReuseMatrixIndex;
+    stats.numMatricesAllocated += _reuseMatrixList.size() - _numMatricesAtReset;
+    stats.numStateGraphs += _numStateGraphsUsed;
+    stats.numStateGraphsAllocated += _reuseStateGraphList.size() - _numStateGraphsAtReset;
+
+    for(ParallelCullVisitorList::const_iterator itr = _parallelCullVisitors.begin();
+        itr != _parallelCullVisitors.end();
+        ++itr)
+    {
+        (*itr)->getPoolStatistics(stats);
+    }
 }
 
 float CullVisitor::getDistanceToEyePoint(const Vec3& pos, bool withLODScale) const
@@ -1145,7 +1198,9 @@ void CullVisitor::apply(Group& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (useParallelCull(node)) traverseInParallel(node);
+    else if (useBatchCull(node)) cullChildren(node, 0, node.getNumChildren());
+    else handle_cull_callbacks_and_traverse(node);
 
     // pop the node's state off the render graph stack.
     if (node_state) popStateSet();
@@ -1154,6 +1209,346 @@ void CullVisitor::apply(Group& node)
     popCurrentMask();
 }
 
+namespace
+{
+
+// Threads shared by all CullVisitors for culling ranges of children in parallel, started on demand.
+class ParallelCullThreads : public osg::Referenced
+{
+public:
+
+    ParallelCullThreads():
+        _operationQueue(new osg::OperationQueue) {}
+
+    osg::OperationQueue* getOperationQueue(unsigned int numThreads)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        while(_threads.size() < numThreads)
+        {
+            osg::ref_ptr<osg::OperationThread> thread = new osg::OperationThread;
+            thread->setOperationQueue(_operationQueue.get());
+            thread->startThread();
+            _threads.push_back(thread);
+        }
+
+        return _operationQueue.get();
+    }
+
+protected:
+
+    virtual ~ParallelCullThreads()
+    {
+        for(Threads::iterator itr = _threads.begin(); itr != _threads.end(); ++itr)
+        {
+            (*itr)->setDone(true);
+        }
+
+        // cancel() waits for each thread to stop running, join() then releases it before the queue is destroyed.
+        for(Threads::iterator itr = _threads.begin(); itr != _threads.end(); ++itr)
+        {
+            (*itr)->cancel();
+            (*itr)->join();
+        }
+    }
+
+    typedef std::vector< osg::ref_ptr<osg::OperationThread> > Threads;
+
+    OpenThreads::Mutex                  _mutex;
+    osg::ref_ptr<osg::OperationQueue>   _operationQueue;
+    Threads                             _threads;
+};
+
+ParallelCullThreads* getParallelCullThreads()
+{
+    static osg::ref_ptr<ParallelCullThreads> s_parallelCullThreads = new ParallelCullThreads;
+    return s_parallelCullThreads.get();
+}
+
+// Culls a range of a Group's children with a parallel cull visitor. The group and visitor are
+// owned by the CullVisitor that queued the operation, which blocks until the operation completes.
+class ParallelCullOperation : public osg::Operation
+{
+public:
+
+    ParallelCullOperation(CullVisitor* cv, osg::Group* group, unsigned int begin, unsigned int end, osg::RefBlockCount* block):
+        osg::Operation("ParallelCullOperation", false),
+        _cullVisitor(cv),
+        _group(group),
+        _begin(begin),
+        _end(end),
+        _block(block) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        _cullVisitor->cullChildren(*_group, _begin, _end);
+
+        _block->completed();
+    }
+
+    CullVisitor*                        _cullVisitor;
+    osg::Group*                         _group;
+    unsigned int                        _begin;
+    unsigned int                        _end;
+    osg::ref_ptr<osg::RefBlockCount>    _block;
+};
+
+typedef std::map<StateGraph*, StateGraph*> StateGraphMap;
+
+// find the StateGraph below the merge point with the same StateSet path as a StateGraph collected by a parallel cull visitor.
+StateGraph* findEquivalentStateGraph(StateGraph* sg, StateGraphMap& stateGraphMap)
+{
+    StateGraphMap::iterator itr = stateGraphMap.find(sg);
+    if (itr!=stateGraphMap.end()) return itr->second;
+
+    StateGraph* parent = findEquivalentStateGraph(sg->_parent, stateGraphMap);
+    StateGraph* equivalent = parent->find_or_insert(sg->getStateSet());
+    stateGraphMap[sg] = equivalent;
+    return equivalent;
+}
+
+void mergeRenderBin(RenderBin& source, RenderBin& destination, StateGraphMap& stateGraphMap, unsigned int traversalOrderOffset)
+{
+    for(RenderBin::StateGraphList::iterator itr = source.getStateGraphList().begin();
+        itr != source.getStateGraphList().end();
+        ++itr)
+    {
+        StateGraph* sg = *itr;
+        StateGraph* equivalent = findEquivalentStateGraph(sg, stateGraphMap);
+
+        // as in CullVisitor::addDrawable(), a StateGraph is added to a RenderBin when it receives its first leaf.
+        if (equivalent->leaves_empty()) destination.addStateGraph(equivalent);
+
+        for(StateGraph::LeafList::iterator litr = sg->_leaves.begin();
+            litr != sg->_leaves.end();
+            ++litr)
+        {
+            (*litr)->_traversalOrderNumber += traversalOrderOffset;
+            equivalent->addLeaf(litr->get());
+        }
+        sg->_leaves.clear();
+    }
+
+    for(RenderBin::RenderBinList::iterator itr = source.getRenderBinList().begin();
+        itr != source.getRenderBinList().end();
+        ++itr)
+    {
+        mergeRenderBin(*(itr->second), *(destination.find_or_insert(*(itr->second))), stateGraphMap, traversalOrderOffset);
+    }
+}
+
+}
+
+bool CullVisitor::useBatchCull(const osg::Group& group) const
+{
+    // groups with only a few children gain nothing from testing their bounds together.
+    const unsigned int minimumNumChildren = 8;
+    return group.getNumChildren()>=minimumNumChildren &&
+           !group.getCullCallback() &&
+           typeid(group)==typeid(osg::Group) &&
+           _traversalMode!=TRAVERSE_NONE && _traversalMode!=TRAVERSE_PARENTS;
+}
+
+void CullVisitor::cullChildren(osg::Group& group, unsigned int begin, unsigned int end)
+{
+    const unsigned int batchSize = 64;
+    osg::BoundingSphere bounds[batchSize];
+    unsigned int boundChildren[batchSize];
+    bool culled[batchSize];
+    osg::Polytope::ClippingMask frustumMasks[batchSize];
+
+    for(unsigned int batchBegin=begin; batchBegin<end; batchBegin+=batchSize)
+    {
+        unsigned int batchEnd = osg::minimum(batchBegin+batchSize, end);
+
+        // children with culling disabled are left to isCulled(const osg::Node&) to pass.
+        unsigned int numBounds = 0;
+        for(unsigned int i=batchBegin; i<batchEnd; ++i)
+        {
+            osg::Node* child = group.getChild(i);
+            if (child->isCullingActive())
+            {
+                bounds[numBounds] = child->getBound();
+                boundChildren[numBounds++] = i;
+            }
+        }
+
+        if (numBounds==0 || !getCurrentCullingSet().isCulled(bounds, numBounds, culled, frustumMasks)) numBounds = 0;
+
+        // culled children are still accepted, as not every node's apply() method tests its bound with isCulled(const osg::Node&).
+        unsigned int b = 0;
+        for(unsigned int i=batchBegin; i<batchEnd; ++i)
+        {
+            osg::Node* child = group.getChild(i);
+            if (b<numBounds && boundChildren[b]==i)
+            {
+                setPrecomputedCullResult(child, culled[b], frustumMasks[b]);
+                ++b;
+
+                child->accept(*this);
+
+                setPrecomputedCullResult(0, false, 0);
+            }
+            else
+            {
+                child->accept(*this);
+            }
+        }
+    }
+}
+
+bool CullVisitor::useParallelCull(const osg::Group& group) const
+{
+    // only plain Groups are split as subclasses may override traverse(), and nested
+    // RenderBins are left to the serial traversal as bins may be relative to the RenderStage.
+    // Groups nested within a group already being culled in parallel are culled serially, as
+    // the parallel cull visitors are still in use culling the enclosing group's other ranges.
+    return getNumParallelCullThreads()>0 &&
+           !_isParallelCullVisitor &&
+           !_traversingInParallel &&
+           group.getNumChildren()>=osg::maximum(getParallelCullMinimumNumChildren(), 2u) &&
+           !group.getCullCallback() &&
+           typeid(group)==typeid(osg::Group) &&
+           _currentRenderBin && _currentRenderBin==_currentRenderBin->getStage() &&
+           _traversalMode!=TRAVERSE_NONE && _traversalMode!=TRAVERSE_PARENTS;
+}
+
+void CullVisitor::traverseInParallel(osg::Group& group)
+{
+    unsigned int numChildren = group.getNumChildren();
+    unsigned int numRanges = osg::minimum(getNumParallelCullThreads()+1, numChildren);
+
+    while(_parallelCullVisitors.size() < numRanges-1)
+    {
+        osg::ref_ptr<CullVisitor> cv = clone();
+        cv->_isParallelCullVisitor = true;
+        cv->setStateGraph(new StateGraph);
+        cv->setRenderStage(new RenderStage);
+        _parallelCullVisitors.push_back(cv);
+    }
+
+    osg::OperationQueue* operationQueue = getParallelCullThreads()->getOperationQueue(getNumParallelCullThreads());
+    // a BlockCount starts released, so needs resetting to wait for the parallel ranges to complete.
+    osg::ref_ptr<osg::RefBlockCount> block = new osg::RefBlockCount(numRanges-1);
+    block->reset();
+
+    for(unsigned int r=1; r<numRanges; ++r)
+    {
+        CullVisitor* cv = _parallelCullVisitors[r-1].get();
+        setUpParallelCullVisitor(*cv);
+        operationQueue->add(new ParallelCullOperation(cv, &group, (numChildren*r)/numRanges, (numChildren*(r+1))/numRanges, block.get()));
+    }
+
+    // cull the first range on this thread.
+    _traversingInParallel = true;
+    cullChildren(group, 0, numChildren/numRanges);
+
+    // help with any ranges that haven't been picked up by the parallel cull threads yet, then wait for the rest.
+    osg::ref_ptr<osg::Operation> operation;
+    while((operation = operationQueue->getNextOperation(false)).valid())
+    {
+        (*operation)(0);
+    }
+    block->block();
+    _traversingInParallel = false;
+
+    for(unsigned int r=1; r<numRanges; ++r)
+    {
+        mergeParallelCullVisitor(*_parallelCullVisitors[r-1]);
+    }
+}
+
+void CullVisitor::setUpParallelCullVisitor(CullVisitor& cv)
+{
+    // reset the per traversal state, the RenderLeaf objects passed on by earlier merges are only reset by reset().
+    cv._numMatricesUsed += cv._currentReuseMatrixIndex;
+    cv.CullStack::reset();
+    cv._renderBinStack.clear();
+    cv._traversalOrderNumber = 0;
+    cv._computed_znear = FLT_MAX;
+    cv._computed_zfar = -FLT_MAX;
+    cv._nearPlaneCandidateMap.clear();
+    cv._farPlaneCandidateMap.clear();
+
+    cv.setCullSettings(*this);
+    cv.setTraversalMask(getTraversalMask());
+    cv.setNodeMaskOverride(getNodeMaskOverride());
+    cv.setTraversalNumber(getTraversalNumber());
+    cv.setFrameStamp(_frameStamp.get());
+    cv.setDatabaseRequestHandler(_databaseRequestHandler.get());
+    cv.setImageRequestHandler(_imageRequestHandler.get());
+    cv.setRenderInfo(_renderInfo);
+    cv.setIdentifier(_identifier.get());
+    cv.getNodePath() = getNodePath();
+    cv.setOccluderList(getOccluderList());
+    cv._numberOfEncloseOverrideRenderBinDetails = _numberOfEncloseOverrideRenderBinDetails;
+
+    cv._rootStateGraph->clean();
+    cv._currentStateGraph = cv._rootStateGraph.get();
+
+    // mirror the current RenderStage so that nested Cameras inherit the same settings as in a serial traversal.
+    RenderStage* stage = _currentRenderBin->getStage();
+    RenderStage* cv_stage = cv._rootRenderStage.get();
+    cv_stage->reset();
+    cv_stage->setCamera(stage->getCamera());
+    cv_stage->setViewport(stage->getViewport());
+    cv_stage->setInitialViewMatrix(stage->getInitialViewMatrix());
+    cv_stage->setClearMask(stage->getClearMask());
+    cv_stage->setClearColor(stage->getClearColor());
+    cv_stage->setColorMask(stage->getColorMask());
+    cv_stage->setDrawBuffer(stage->getDrawBuffer(), stage->getDrawBufferApplyMask());
+    cv_stage->setReadBuffer(stage->getReadBuffer(), stage->getReadBufferApplyMask());
+    cv._currentRenderBin = cv_stage;
+
+    cv.pushViewport(getViewport());
+    cv.pushProjectionMatrix(getProjectionMatrix());
+    cv.pushModelViewMatrix(getModelViewMatrix(), osg::Transform::ABSOLUTE_RF);
+    cv._referenceViewPoints.back() = getReferenceViewPoint();
+    cv._viewPointStack.back() = getViewPointLocal();
+}
+
+void CullVisitor::mergeParallelCullVisitor(CullVisitor& cv)
+{
+    // the root StateGraph of the parallel cull visitor maps onto the current StateGraph at the point the traversal was split.
+    StateGraphMap stateGraphMap;
+    stateGraphMap[cv._rootStateGraph.get()] = _currentStateGraph;
+
+    RenderStage* stage = _currentRenderBin->getStage();
+    RenderStage* cv_stage = cv._rootRenderStage.get();
+
+    mergeRenderBin(*cv_stage, *_currentRenderBin, stateGraphMap, _traversalOrderNumber);
+    _traversalOrderNumber += cv._traversalOrderNumber;
+
+    cv._rootStateGraph->prune();
+
+    if (cv._computed_znear < _computed_znear) _computed_znear = cv._computed_znear;
+    if (cv._computed_zfar > _computed_zfar) _computed_zfar = cv._computed_zfar;
+    _nearPlaneCandidateMap.insert(cv._nearPlaneCandidateMap.begin(), cv._nearPlaneCandidateMap.end());
+    _farPlaneCandidateMap.insert(cv._farPlaneCandidateMap.begin(), cv._farPlaneCandidateMap.end());
+
+    PositionalStateContainer* psc = cv_stage->getPositionalStateContainer();
+    for(PositionalStateContainer::AttrMatrixList::iterator itr = psc->getAttrMatrixList().begin();
+        itr != psc->getAttrMatrixList().end();
+        ++itr)
+    {
+        stage->addPositionedAttribute(itr->second.get(), itr->first.get());
+    }
+
+    for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator titr = psc->getTexUnitAttrMatrixListMap().begin();
+        titr != psc->getTexUnitAttrMatrixListMap().end();
+        ++titr)
+    {
+        for(PositionalStateContainer::AttrMatrixList::iterator itr = titr->second.begin();
+            itr != titr->second.end();
+            ++itr)
+        {
+            stage->addPositionedTextureAttribute(titr->first, itr->second.get(), itr->first.get());
+        }
+    }
+
+    stage->movePreAndPostRenderStages(*cv_stage);
+}
+
 void CullVisitor::apply(Transform& node)
 {
     if (isCulled(node)) return;
@@ -1714,6 +2109,130 @@ void CullVisitor::apply(osg::OccluderNode& node)
     popOccludersCurrentMask(_nodePath);
 }
 
+void CullVisitor::apply(osg::CompiledStaticGroup& node)
+{
+    // state frustums are applied per Drawable by apply(Drawable&) so leave them to the normal traversal.
+    if (node.getCullCallback() ||
+        _traversalMode==TRAVERSE_NONE || _traversalMode==TRAVERSE_PARENTS ||
+        !getCurrentCullingSet().getStateFrustumList().empty() ||
+        !node.compile())
+    {
+        apply(static_cast<osg::Group&>(node));
+        return;
+    }
+
+    if (isCulled(node)) return;
+
+    // push the culling mode.
+    pushCurrentMask();
+
+    // push the node's state.
+    StateSet* node_state = node.getStateSet();
+    if (node_state) pushStateSet(node_state);
+
+    cullCompiledDrawables(node);
+
+    // pop the node's state off the render graph stack.
+    if (node_state) popStateSet();
+
+    // pop the culling mode.
+    popCurrentMask();
+}
+
+void CullVisitor::cullCompiledDrawables(osg::CompiledStaticGroup& node)
+{
+    const std::vector<osg::Drawable*>& drawables = node.getCompiledDrawables();
+    const std::vector<unsigned int>& traversalOrders = node.getCompiledTraversalOrders();
+    const std::vector<osg::BoundingSphere>& boundingSpheres = node.getCompiledBoundingSpheres();
+    const std::vector<osg::BoundingBox>& boundingBoxes = node.getCompiledBoundingBoxes();
+    const std::vector<unsigned int>& matrixIndices = node.getCompiledMatrixIndices();
+    const std::vector<osg::Matrix>& matrices = node.getCompiledMatrices();
+    const std::vector<unsigned int>& stateSetPathIndices = node.getCompiledStateSetPathIndices();
+    const std::vector<osg::CompiledStaticGroup::StateSetPath>& stateSetPaths = node.getCompiledStateSetPaths();
+
+    // the modelview matrices are created on demand, the first compiled matrix is always the identity.
+    RefMatrix* modelview = getModelViewMatrix();
+    _compiledMatrices.assign(matrices.size(), 0);
+    _compiledMatrices[0] = modelview;
+
+    CullingSet& cs = getCurrentCullingSet();
+
+    const unsigned int batchSize = 64;
+    bool culled[batchSize];
+    osg::Polytope::ClippingMask frustumMasks[batchSize];
+
+    unsigned int numDrawables = static_cast<unsigned int>(drawables.size());
+    unsigned int currentStateSetPath = numDrawables;
+
+    // number the leaves by their Drawable's position in a traversal of the subgraph rather than the grouped
+    // order they are added in, so that bins sorted by traversal order draw them as a traversal would.
+    unsigned int traversalOrderBase = _traversalOrderNumber;
+    unsigned int numPopStateSetRequired = 0;
+
+    for(unsigned int batchBegin=0; batchBegin<numDrawables; batchBegin+=batchSize)
+    {
+        unsigned int numInBatch = osg::minimum(batchSize, numDrawables-batchBegin);
+
+        // the bounding spheres are culled as nodes are, including small feature culling,
+        // then the bounding boxes of those intersecting the frustum are culled as apply(Drawable&) does.
+        if (!cs.isCulled(&boundingSpheres[batchBegin], numInBatch, culled, frustumMasks))
+        {
+            for(unsigned int k=0; k<numInBatch; ++k)
+            {
+                culled[k] = cs.isCulled(boundingSpheres[batchBegin+k]);
+                frustumMasks[k] = cs.getFrustum().getResultMask();
+            }
+        }
+
+        for(unsigned int k=0; k<numInBatch; ++k)
+        {
+            unsigned int i = batchBegin+k;
+            if (boundingSpheres[i].valid())
+            {
+                if (culled[k]) continue;
+                if (frustumMasks[k]!=0 && isCulled(boundingBoxes[i])) continue;
+            }
+
+            osg::Drawable* drawable = drawables[i];
+
+            RefMatrix*& matrix = _compiledMatrices[matrixIndices[i]];
+            if (!matrix) matrix = createOrReuseMatrix(matrices[matrixIndices[i]]*(*modelview));
+
+            const BoundingBox& bb = drawable->getBoundingBox();
+            if (_computeNearFar && bb.valid())
+            {
+                if (!updateCalculatedNearFar(*matrix,*drawable,false)) continue;
+            }
+
+            if (stateSetPathIndices[i]!=currentStateSetPath)
+            {
+                for(; numPopStateSetRequired>0; --numPopStateSetRequired) popStateSet();
+
+                currentStateSetPath = stateSetPathIndices[i];
+                const osg::CompiledStaticGroup::StateSetPath& stateSetPath = stateSetPaths[currentStateSetPath];
+                for(osg::CompiledStaticGroup::StateSetPath::const_iterator itr = stateSetPath.begin();
+                    itr != stateSetPath.end();
+                    ++itr)
+                {
+                    pushStateSet(*itr);
+                }
+                numPopStateSetRequired = static_cast<unsigned int>(stateSetPath.size());
+            }
+
+            float depth = bb.valid() ? distance(bb.center(),*matrix) : 0.0f;
+            if (!osg::isNaN(depth))
+            {
+                _traversalOrderNumber = traversalOrderBase + traversalOrders[i];
+                addDrawableAndDepth(drawable,matrix,depth);
+            }
+        }
+    }
+
+    _traversalOrderNumber = traversalOrderBase + numDrawables;
+
+    for(; numPopStateSetRequired>0; --numPopStateSetRequired) popStateSet();
+}
+
 void CullVisitor::apply(osg::OcclusionQueryNode& node)
 {
     if (isCulled(node)) return;
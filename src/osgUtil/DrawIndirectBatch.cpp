@@ -0,0 +1,325 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+#include <osgUtil/DrawIndirectBatch>
+
+#include <osg/GLExtensions>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+#include <string.h>
+
+using namespace osgUtil;
+
+DrawIndirectBatch::DrawIndirectBatch():
+    _numMembers(0),
+    _mode(GL_TRIANGLES),
+    _numTexCoordArrays(0),
+    _numVertexAttribArrays(0)
+{
+}
+
+void DrawIndirectBatch::getArrays(const osg::Geometry& geometry, ArrayList& arrays)
+{
+    arrays.clear();
+    arrays.push_back(geometry.getVertexArray());
+    arrays.push_back(geometry.getNormalArray());
+    arrays.push_back(geometry.getColorArray());
+    arrays.push_back(geometry.getSecondaryColorArray());
+    arrays.push_back(geometry.getFogCoordArray());
+    for(unsigned int unit=0; unit<geometry.getNumTexCoordArrays(); ++unit)
+    {
+        arrays.push_back(geometry.getTexCoordArray(unit));
+    }
+    for(unsigned int index=0; index<geometry.getNumVertexAttribArrays(); ++index)
+    {
+        arrays.push_back(geometry.getVertexAttribArray(index));
+    }
+}
+
+bool DrawIndirectBatch::isBatchable(const osg::Geometry& geometry)
+{
+    if (geometry.getDrawCallback() || geometry.containsDeprecatedData()) return false;
+
+    const osg::Array* vertices = geometry.getVertexArray();
+    if (!vertices || vertices->getNumElements()==0 || geometry.getNumPrimitiveSets()==0) return false;
+
+    ArrayList arrays;
+    getArrays(geometry, arrays);
+    for(ArrayList::const_iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        const osg::Array* array = *itr;
+        if (array && array!=vertices &&
+            (array->getBinding()!=osg::Array::BIND_PER_VERTEX || array->getNumElements()!=vertices->getNumElements())) return false;
+    }
+
+    GLenum mode = geometry.getPrimitiveSet(0)->getMode();
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geometry.getPrimitiveSet(i);
+        switch(primitiveSet->getType())
+        {
+            case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
+            case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
+                break;
+            default:
+                return false;
+        }
+        if (primitiveSet->getMode()!=mode || primitiveSet->getNumInstances()!=0 || primitiveSet->getNumIndices()==0) return false;
+    }
+
+    return true;
+}
+
+bool DrawIndirectBatch::isCompatible(const osg::Geometry& geometry) const
+{
+    if (geometry.getNumPrimitiveSets()==0) return false;
+    if (!_geometry) return true;
+
+    if (geometry.getPrimitiveSet(0)->getMode()!=_mode ||
+        geometry.getNumTexCoordArrays()!=_numTexCoordArrays ||
+        geometry.getNumVertexAttribArrays()!=_numVertexAttribArrays) return false;
+
+    ArrayList arrays, packedArrays;
+    getArrays(geometry, arrays);
+    getArrays(*_geometry, packedArrays);
+    for(unsigned int i=0; i<arrays.size(); ++i)
+    {
+        const osg::Array* array = arrays[i];
+        const osg::Array* packedArray = packedArrays[i];
+        if (!array || !packedArray)
+        {
+            if (array!=packedArray) return false;
+            continue;
+        }
+
+        if (array->getType()!=packedArray->getType() ||
+            array->getNormalize()!=packedArray->getNormalize() ||
+            array->getPreserveDataType()!=packedArray->getPreserveDataType()) return false;
+    }
+
+    return true;
+}
+
+bool DrawIndirectBatch::add(osg::Geometry* geometry)
+{
+    if (!geometry || !isBatchable(*geometry) || !isCompatible(*geometry)) return false;
+
+    ArrayList arrays;
+    getArrays(*geometry, arrays);
+
+    if (!_geometry)
+    {
+        _mode = geometry->getPrimitiveSet(0)->getMode();
+        _numTexCoordArrays = geometry->getNumTexCoordArrays();
+        _numVertexAttribArrays = geometry->getNumVertexAttribArrays();
+
+        _geometry = new osg::Geometry;
+        _geometry->setUseDisplayList(false);
+        _geometry->setUseVertexBufferObjects(true);
+
+        std::vector< osg::ref_ptr<osg::Array> > packedArrays;
+        for(ArrayList::const_iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+        {
+            osg::Array* packedArray = 0;
+            if (*itr)
+            {
+                packedArray = static_cast<osg::Array*>((*itr)->cloneType());
+                packedArray->setBinding(osg::Array::BIND_PER_VERTEX);
+                packedArray->setNormalize((*itr)->getNormalize());
+                packedArray->setPreserveDataType((*itr)->getPreserveDataType());
+            }
+            packedArrays.push_back(packedArray);
+        }
+
+        _geometry->setVertexArray(packedArrays[0].get());
+        if (packedArrays[1].valid()) _geometry->setNormalArray(packedArrays[1].get());
+        if (packedArrays[2].valid()) _geometry->setColorArray(packedArrays[2].get());
+        if (packedArrays[3].valid()) _geometry->setSecondaryColorArray(packedArrays[3].get());
+        if (packedArrays[4].valid()) _geometry->setFogCoordArray(packedArrays[4].get());
+        for(unsigned int unit=0; unit<_numTexCoordArrays; ++unit)
+        {
+            if (packedArrays[5+unit].valid()) _geometry->setTexCoordArray(unit, packedArrays[5+unit].get());
+        }
+        for(unsigned int index=0; index<_numVertexAttribArrays; ++index)
+        {
+            if (packedArrays[5+_numTexCoordArrays+index].valid()) _geometry->setVertexAttribArray(index, packedArrays[5+_numTexCoordArrays+index].get());
+        }
+
+        _commands = new osg::DefaultIndirectCommandDrawElements;
+        _primitives = new osg::MultiDrawElementsIndirectUInt(_mode);
+        _primitives->setIndirectCommandArray(_commands.get());
+        _geometry->addPrimitiveSet(_primitives.get());
+    }
+
+    // append the vertex arrays, the indices of the Geometry are kept relative to its own arrays with the
+    // position of its vertices in the packed arrays used as the base vertex of its commands.
+    unsigned int baseVertex = _geometry->getVertexArray()->getNumElements();
+    unsigned int numVertices = geometry->getVertexArray()->getNumElements();
+
+    ArrayList packedArrays;
+    getArrays(*_geometry, packedArrays);
+    for(unsigned int i=0; i<arrays.size(); ++i)
+    {
+        if (!arrays[i]) continue;
+
+        osg::Array* packedArray = const_cast<osg::Array*>(packedArrays[i]);
+        packedArray->resizeArray(baseVertex+numVertices);
+        memcpy(const_cast<GLvoid*>(packedArray->getDataPointer(baseVertex)), arrays[i]->getDataPointer(), numVertices*arrays[i]->getElementSize());
+        packedArray->dirty();
+    }
+
+    // append the indices with a command for each PrimitiveSet.
+    unsigned int firstCommand = static_cast<unsigned int>(_memberCommands.size());
+    for(unsigned int i=0; i<geometry->getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geometry->getPrimitiveSet(i);
+        unsigned int firstIndex = static_cast<unsigned int>(_primitives->size());
+        unsigned int numIndices = primitiveSet->getNumIndices();
+
+        _primitives->reserve(firstIndex+numIndices);
+        for(unsigned int j=0; j<numIndices; ++j)
+        {
+            _primitives->push_back(primitiveSet->index(j));
+        }
+
+        _memberCommands.push_back(osg::DrawElementsIndirectCommand(numIndices, 1, firstIndex, baseVertex, 0));
+    }
+    _primitives->dirty();
+
+    geometry->setDrawCallback(new Member(this, firstCommand, geometry->getNumPrimitiveSets()));
+    ++_numMembers;
+
+    return true;
+}
+
+void DrawIndirectBatch::buildCommands(const MemberList& members, osg::DefaultIndirectCommandDrawElements& commands) const
+{
+    commands.clear();
+    for(MemberList::const_iterator itr = members.begin(); itr != members.end(); ++itr)
+    {
+        const Member* member = *itr;
+        CommandList::const_iterator first = _memberCommands.begin()+member->getFirstCommand();
+        commands.insert(commands.end(), first, first+member->getNumCommands());
+    }
+}
+
+bool DrawIndirectBatch::isSupported(osg::State& state)
+{
+    const osg::GLExtensions* extensions = state.get<osg::GLExtensions>();
+    return extensions->isVBOSupported && extensions->glMultiDrawElementsIndirect!=0 && state.useVertexBufferObject(true);
+}
+
+void DrawIndirectBatch::draw(osg::RenderInfo& renderInfo, const MemberList& members)
+{
+    if (!_geometry || members.empty()) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_drawMutex);
+
+    buildCommands(members, *_commands);
+    _commands->dirty();
+
+    _geometry->draw(renderInfo);
+}
+
+void DrawIndirectBatch::resizeGLObjectBuffers(unsigned int maxSize)
+{
+    if (_geometry.valid()) _geometry->resizeGLObjectBuffers(maxSize);
+}
+
+void DrawIndirectBatch::releaseGLObjects(osg::State* state) const
+{
+    if (_geometry.valid()) _geometry->releaseGLObjects(state);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  DrawIndirectBatchVisitor
+//
+DrawIndirectBatchVisitor::DrawIndirectBatchVisitor():
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _maximumNumVerticesPerBatch(1<<20),
+    _maximumNumVerticesPerGeometry(4096)
+{
+}
+
+void DrawIndirectBatchVisitor::reset()
+{
+    _geometries.clear();
+    _batches.clear();
+}
+
+void DrawIndirectBatchVisitor::apply(osg::Geometry& geometry)
+{
+    if (geometry.getVertexArray() && geometry.getVertexArray()->getNumElements()<=_maximumNumVerticesPerGeometry &&
+        DrawIndirectBatch::isBatchable(geometry))
+    {
+        _geometries[geometry.getStateSet()].push_back(&geometry);
+    }
+}
+
+void DrawIndirectBatchVisitor::batch()
+{
+    unsigned int numGeometriesBatched = 0;
+    for(StateSetGeometryMap::iterator itr = _geometries.begin(); itr != _geometries.end(); ++itr)
+    {
+        GeometryList& geometries = itr->second;
+        if (geometries.size()<2) continue;
+
+        // the batches still being filled for this StateSet, one per vertex format.
+        BatchList batches;
+        std::vector<unsigned int> numVertices;
+        for(GeometryList::iterator gitr = geometries.begin(); gitr != geometries.end(); ++gitr)
+        {
+            osg::Geometry* geometry = *gitr;
+
+            // geometries shared between several parents are only packed once.
+            if (DrawIndirectBatch::getMember(geometry)) continue;
+
+            unsigned int geometryNumVertices = geometry->getVertexArray()->getNumElements();
+
+            unsigned int i = 0;
+            for(; i<batches.size(); ++i)
+            {
+                if (batches[i]->isCompatible(*geometry)) break;
+            }
+
+            if (i<batches.size() && numVertices[i]+geometryNumVertices>_maximumNumVerticesPerBatch)
+            {
+                // start a new batch for this vertex format.
+                batches.erase(batches.begin()+i);
+                numVertices.erase(numVertices.begin()+i);
+                i = static_cast<unsigned int>(batches.size());
+            }
+
+            if (i==batches.size())
+            {
+                batches.push_back(new DrawIndirectBatch);
+                numVertices.push_back(0);
+                _batches.push_back(batches.back());
+            }
+
+            if (batches[i]->add(geometry))
+            {
+                numVertices[i] += geometryNumVertices;
+                ++numGeometriesBatched;
+            }
+        }
+    }
+
+    _geometries.clear();
+
+    OSG_INFO<<"DrawIndirectBatchVisitor::batch() packed "<<numGeometriesBatched<<" Geometries into "<<_batches.size()<<" batches"<<std::endl;
+}
@@ -0,0 +1,525 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/DynamicBVHGroup>
+#include <osgUtil/IntersectionVisitor>
+
+#include <osg/Transform>
+
+#include <algorithm>
+
+using namespace osgUtil;
+
+namespace
+{
+
+// half the surface area of a box, the cost of a node of the hierarchy being proportional to the area of its box.
+inline double area(const osg::BoundingBox& bb)
+{
+    double dx = bb.xMax()-bb.xMin(), dy = bb.yMax()-bb.yMin(), dz = bb.zMax()-bb.zMin();
+    return dx*dy + dy*dz + dz*dx;
+}
+
+inline osg::BoundingBox combine(const osg::BoundingBox& lhs, const osg::BoundingBox& rhs)
+{
+    osg::BoundingBox bb(lhs);
+    bb.expandBy(rhs);
+    return bb;
+}
+
+inline bool contains(const osg::BoundingBox& outer, const osg::BoundingBox& inner)
+{
+    return outer.contains(inner._min) && outer.contains(inner._max);
+}
+
+// the box a child is culled by, invalid if it is to be traversed whatever its bound.
+osg::BoundingBox computeChildBox(osg::Node* child)
+{
+    osg::BoundingBox bb;
+
+    const osg::Transform* transform = child->asTransform();
+    if (transform && transform->getReferenceFrame()!=osg::Transform::RELATIVE_RF) return bb;
+
+    osg::Drawable* drawable = child->asDrawable();
+    if (drawable)
+    {
+        bb = drawable->getBoundingBox();
+    }
+    else
+    {
+        const osg::BoundingSphere& bs = child->getBound();
+        if (bs.valid()) bb.expandBy(bs);
+    }
+
+    if (!child->isCullingActive()) bb.init();
+    return bb;
+}
+
+}
+
+DynamicBVHGroup::DynamicBVHGroup():
+    _margin(0.1f),
+    _root(-1),
+    _freeList(-1)
+{
+}
+
+DynamicBVHGroup::DynamicBVHGroup(const DynamicBVHGroup& group, const osg::CopyOp& copyop):
+    osg::Group(group, copyop),
+    _margin(group._margin),
+    _root(-1),
+    _freeList(-1)
+{
+    // the children were added by the Group's constructor, before this class could track them.
+    for(osg::NodeList::iterator itr = _children.begin(); itr != _children.end(); ++itr)
+    {
+        addToHierarchy(itr->get());
+    }
+}
+
+void DynamicBVHGroup::childInserted(unsigned int pos)
+{
+    addToHierarchy(_children[pos].get());
+}
+
+void DynamicBVHGroup::childRemoved(unsigned int pos, unsigned int numChildrenToRemove)
+{
+    unsigned int end = std::min(pos+numChildrenToRemove, static_cast<unsigned int>(_children.size()));
+    for(unsigned int i=pos; i<end; ++i)
+    {
+        removeFromHierarchy(_children[i].get());
+    }
+}
+
+bool DynamicBVHGroup::setChild(unsigned int i, osg::Node* node)
+{
+    osg::ref_ptr<osg::Node> origNode = i<_children.size() ? _children[i].get() : 0;
+    if (!osg::Group::setChild(i, node)) return false;
+
+    removeFromHierarchy(origNode.get());
+    addToHierarchy(node);
+    return true;
+}
+
+void DynamicBVHGroup::childBoundDirtied(osg::Node* child)
+{
+    OpenThreads::ScopedWriteLock lock(_hierarchyMutex);
+    _dirtyChildren.push_back(child);
+}
+
+void DynamicBVHGroup::addToHierarchy(osg::Node* child)
+{
+    OpenThreads::ScopedWriteLock lock(_hierarchyMutex);
+
+    // the child's leaf is created when the hierarchy is next updated, once its bound is known.
+    _leaves.insert(LeafMap::value_type(child, -1));
+    _dirtyChildren.push_back(child);
+}
+
+void DynamicBVHGroup::removeFromHierarchy(osg::Node* child)
+{
+    OpenThreads::ScopedWriteLock lock(_hierarchyMutex);
+
+    LeafMap::iterator itr = _leaves.find(child);
+    if (itr == _leaves.end()) return;
+
+    if (itr->second>=0)
+    {
+        removeLeaf(itr->second);
+        freeNode(itr->second);
+    }
+
+    _unboundedChildren.erase(child);
+    _leaves.erase(itr);
+}
+
+void DynamicBVHGroup::updateHierarchy() const
+{
+    OpenThreads::ScopedWriteLock lock(_hierarchyMutex);
+    updateHierarchyImplementation();
+}
+
+unsigned int DynamicBVHGroup::getHierarchyHeight() const
+{
+    OpenThreads::ScopedReadLock lock(_hierarchyMutex);
+    return _root<0 ? 0 : static_cast<unsigned int>(_nodes[_root].height+1);
+}
+
+void DynamicBVHGroup::updateHierarchyImplementation() const
+{
+    // take the list of dirty children first, any dirtied while their bounds are computed being kept for the next update.
+    DirtyChildren dirtyChildren;
+    dirtyChildren.swap(_dirtyChildren);
+
+    for(DirtyChildren::iterator itr = dirtyChildren.begin(); itr != dirtyChildren.end(); ++itr)
+    {
+        // children removed since they were dirtied are no longer in the map, and aren't dereferenced.
+        LeafMap::iterator litr = _leaves.find(*itr);
+        if (litr == _leaves.end()) continue;
+
+        osg::Node* child = *itr;
+        int leaf = litr->second;
+
+        osg::BoundingBox bb = computeChildBox(child);
+        if (!bb.valid())
+        {
+            if (leaf>=0)
+            {
+                removeLeaf(leaf);
+                freeNode(leaf);
+                litr->second = -1;
+            }
+            _unboundedChildren.insert(child);
+            continue;
+        }
+
+        _unboundedChildren.erase(child);
+
+        if (leaf>=0)
+        {
+            // the child has moved within its leaf's box.
+            if (contains(_nodes[leaf].bb, bb)) continue;
+
+            removeLeaf(leaf);
+        }
+        else
+        {
+            leaf = allocateNode();
+            _nodes[leaf].node = child;
+            litr->second = leaf;
+        }
+
+        float margin = bb.radius()*_margin;
+        _nodes[leaf].bb.set(bb._min - osg::Vec3(margin, margin, margin), bb._max + osg::Vec3(margin, margin, margin));
+        insertLeaf(leaf);
+    }
+}
+
+osg::BoundingSphere DynamicBVHGroup::computeBound() const
+{
+    OpenThreads::ScopedWriteLock lock(_hierarchyMutex);
+
+    updateHierarchyImplementation();
+
+    osg::BoundingSphere bsphere;
+    if (_root>=0)
+    {
+        const osg::BoundingBox& bb = _nodes[_root].bb;
+        bsphere.set(bb.center(), bb.radius());
+    }
+
+    for(UnboundedChildren::const_iterator itr = _unboundedChildren.begin(); itr != _unboundedChildren.end(); ++itr)
+    {
+        const osg::Transform* transform = (*itr)->asTransform();
+        if (!transform || transform->getReferenceFrame()==osg::Transform::RELATIVE_RF)
+        {
+            bsphere.expandBy((*itr)->getBound());
+        }
+    }
+
+    return bsphere;
+}
+
+void DynamicBVHGroup::traverse(osg::NodeVisitor& nv)
+{
+    IntersectionVisitor* iv = nv.asIntersectionVisitor();
+    Intersector* intersector = iv ? iv->getCurrentIntersector() : 0;
+    if (!intersector)
+    {
+        osg::Group::traverse(nv);
+        return;
+    }
+
+    {
+        OpenThreads::ScopedWriteLock lock(_hierarchyMutex);
+        if (!_dirtyChildren.empty()) updateHierarchyImplementation();
+    }
+
+    // other threads may traverse the hierarchy at the same time, but not update it.
+    OpenThreads::ScopedReadLock lock(_hierarchyMutex);
+
+    for(UnboundedChildren::iterator itr = _unboundedChildren.begin(); itr != _unboundedChildren.end(); ++itr)
+    {
+        (*itr)->accept(nv);
+    }
+
+    if (_root<0) return;
+
+    // visit the children whose leaves the intersector may intersect.
+    std::vector<int> stack;
+    stack.push_back(_root);
+    while(!stack.empty())
+    {
+        int index = stack.back();
+        stack.pop_back();
+
+        if (!intersector->mayIntersect(_nodes[index].bb)) continue;
+
+        if (_nodes[index].child1<0)
+        {
+            _nodes[index].node->accept(nv);
+        }
+        else
+        {
+            stack.push_back(_nodes[index].child2);
+            stack.push_back(_nodes[index].child1);
+        }
+    }
+}
+
+int DynamicBVHGroup::allocateNode() const
+{
+    if (_freeList<0)
+    {
+        _nodes.push_back(TreeNode());
+        return static_cast<int>(_nodes.size())-1;
+    }
+
+    // free nodes are linked through their parent index.
+    int index = _freeList;
+    _freeList = _nodes[index].parent;
+    _nodes[index] = TreeNode();
+    return index;
+}
+
+void DynamicBVHGroup::freeNode(int index) const
+{
+    _nodes[index] = TreeNode();
+    _nodes[index].parent = _freeList;
+    _nodes[index].height = -1;
+    _freeList = index;
+}
+
+void DynamicBVHGroup::insertLeaf(int leaf) const
+{
+    if (_root<0)
+    {
+        _root = leaf;
+        _nodes[leaf].parent = -1;
+        return;
+    }
+
+    // descend to the sibling that adds least to the area of the hierarchy, counting the growth of the boxes above it.
+    osg::BoundingBox leafBB = _nodes[leaf].bb;
+    int index = _root;
+    while(_nodes[index].child1>=0)
+    {
+        int child1 = _nodes[index].child1;
+        int child2 = _nodes[index].child2;
+
+        double combinedArea = area(combine(_nodes[index].bb, leafBB));
+
+        // the cost of pairing the leaf with this node, and the cost pushed down to its children for the growth of its box.
+        double cost = 2.0*combinedArea;
+        double inheritanceCost = 2.0*(combinedArea - area(_nodes[index].bb));
+
+        double cost1 = area(combine(leafBB, _nodes[child1].bb)) + inheritanceCost;
+        if (_nodes[child1].child1>=0) cost1 -= area(_nodes[child1].bb);
+
+        double cost2 = area(combine(leafBB, _nodes[child2].bb)) + inheritanceCost;
+        if (_nodes[child2].child1>=0) cost2 -= area(_nodes[child2].bb);
+
+        if (cost<cost1 && cost<cost2) break;
+
+        index = cost1<cost2 ? child1 : child2;
+    }
+
+    int sibling = index;
+
+    // create a new parent for the sibling and the leaf.
+    int oldParent = _nodes[sibling].parent;
+    int newParent = allocateNode();
+    _nodes[newParent].parent = oldParent;
+    _nodes[newParent].bb = combine(leafBB, _nodes[sibling].bb);
+    _nodes[newParent].height = _nodes[sibling].height+1;
+    _nodes[newParent].child1 = sibling;
+    _nodes[newParent].child2 = leaf;
+    _nodes[sibling].parent = newParent;
+    _nodes[leaf].parent = newParent;
+
+    if (oldParent>=0)
+    {
+        if (_nodes[oldParent].child1==sibling) _nodes[oldParent].child1 = newParent;
+        else _nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        _root = newParent;
+    }
+
+    // refit the boxes and heights of the ancestors, rebalancing as we go.
+    index = _nodes[leaf].parent;
+    while(index>=0)
+    {
+        index = balance(index);
+
+        int child1 = _nodes[index].child1;
+        int child2 = _nodes[index].child2;
+        _nodes[index].height = 1 + std::max(_nodes[child1].height, _nodes[child2].height);
+        _nodes[index].bb = combine(_nodes[child1].bb, _nodes[child2].bb);
+
+        index = _nodes[index].parent;
+    }
+}
+
+void DynamicBVHGroup::removeLeaf(int leaf) const
+{
+    if (leaf==_root)
+    {
+        _root = -1;
+        return;
+    }
+
+    int parent = _nodes[leaf].parent;
+    int grandParent = _nodes[parent].parent;
+    int sibling = _nodes[parent].child1==leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+    // replace the parent by the sibling.
+    if (grandParent>=0)
+    {
+        if (_nodes[grandParent].child1==parent) _nodes[grandParent].child1 = sibling;
+        else _nodes[grandParent].child2 = sibling;
+        _nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        int index = grandParent;
+        while(index>=0)
+        {
+            index = balance(index);
+
+            int child1 = _nodes[index].child1;
+            int child2 = _nodes[index].child2;
+            _nodes[index].bb = combine(_nodes[child1].bb, _nodes[child2].bb);
+            _nodes[index].height = 1 + std::max(_nodes[child1].height, _nodes[child2].height);
+
+            index = _nodes[index].parent;
+        }
+    }
+    else
+    {
+        _root = sibling;
+        _nodes[sibling].parent = -1;
+        freeNode(parent);
+    }
+
+    _nodes[leaf].parent = -1;
+}
+
+int DynamicBVHGroup::balance(int iA) const
+{
+    // if one child of A is more than one level taller than the other, rotate it up to replace A, giving A its shorter
+    // child, and return the index of the node now in A's place.
+    TreeNode& A = _nodes[iA];
+    if (A.child1<0 || A.height<2) return iA;
+
+    int iB = A.child1;
+    int iC = A.child2;
+    TreeNode& B = _nodes[iB];
+    TreeNode& C = _nodes[iC];
+
+    int difference = C.height - B.height;
+
+    if (difference>1)
+    {
+        // rotate C up.
+        int iF = C.child1;
+        int iG = C.child2;
+        TreeNode& F = _nodes[iF];
+        TreeNode& G = _nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        if (C.parent>=0)
+        {
+            if (_nodes[C.parent].child1==iA) _nodes[C.parent].child1 = iC;
+            else _nodes[C.parent].child2 = iC;
+        }
+        else
+        {
+            _root = iC;
+        }
+
+        if (F.height>G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.bb = combine(B.bb, G.bb);
+            C.bb = combine(A.bb, F.bb);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.bb = combine(B.bb, F.bb);
+            C.bb = combine(A.bb, G.bb);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+
+        return iC;
+    }
+
+    if (difference<-1)
+    {
+        // rotate B up.
+        int iD = B.child1;
+        int iE = B.child2;
+        TreeNode& D = _nodes[iD];
+        TreeNode& E = _nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        if (B.parent>=0)
+        {
+            if (_nodes[B.parent].child1==iA) _nodes[B.parent].child1 = iB;
+            else _nodes[B.parent].child2 = iB;
+        }
+        else
+        {
+            _root = iB;
+        }
+
+        if (D.height>E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.bb = combine(C.bb, E.bb);
+            B.bb = combine(A.bb, D.bb);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.bb = combine(C.bb, D.bb);
+            B.bb = combine(A.bb, E.bb);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
@@ -25,6 +25,8 @@
 #include <osg/Notify>
 #include <osg/io_utils>
 
+#include <typeinfo>
+
 using namespace osgUtil;
 
 
@@ -105,6 +107,20 @@ void IntersectorGroup::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable
 {
     if (disabled()) return;
 
+    // test LineSegmentIntersectors together where the drawable has a KdTree, their segments traversing it in packets.
+    LineSegmentIntersector::LineSegmentIntersectorList lineSegmentIntersectors;
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if (!(*itr)->disabled() && typeid(*(itr->get()))==typeid(LineSegmentIntersector))
+        {
+            lineSegmentIntersectors.push_back(static_cast<LineSegmentIntersector*>(itr->get()));
+        }
+    }
+
+    bool batched = lineSegmentIntersectors.size()>=4 && LineSegmentIntersector::intersectBatch(iv, drawable, lineSegmentIntersectors);
+
     unsigned int numTested = 0;
     for(Intersectors::iterator itr = _intersectors.begin();
         itr != _intersectors.end();
@@ -112,6 +128,8 @@ void IntersectorGroup::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable
     {
         if (!(*itr)->disabled())
         {
+            if (batched && typeid(*(itr->get()))==typeid(LineSegmentIntersector)) continue;
+
             (*itr)->intersect(iv, drawable);
 
             ++numTested;
@@ -145,6 +163,17 @@ bool IntersectorGroup::containsIntersections()
     return false;
 }
 
+bool IntersectorGroup::mayIntersect(const osg::BoundingBox& bb)
+{
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if (!(*itr)->disabled() && (*itr)->mayIntersect(bb)) return true;
+    }
+    return false;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -496,6 +496,14 @@ bool LineSegmentIntersector::enter(const osg::Node& node)
     return !node.isCullingActive() || intersects( node.getBound() );
 }
 
+bool LineSegmentIntersector::mayIntersect(const osg::BoundingBox& bb)
+{
+    if (reachedLimit()) return false;
+
+    osg::Vec3d s(_start), e(_end);
+    return intersectAndClip(s, e, bb);
+}
+
 void LineSegmentIntersector::leave()
 {
     // do nothing
@@ -550,6 +558,87 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
     }
 }
 
+bool LineSegmentIntersector::intersectBatch(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable, const LineSegmentIntersectorList& intersectors)
+{
+    osg::KdTree* kdTree = iv.getUseKdTreeWhenAvailable() ? dynamic_cast<osg::KdTree*>(drawable->getShape()) : 0;
+    if (!kdTree || !kdTree->getVertices()) return false;
+
+    if (iv.getDoDummyTraversal()) return true;
+
+    // clip the segments to the drawable, batching those that stop at their first intersection separately from the rest.
+    for(unsigned int pass=0; pass<2; ++pass)
+    {
+        bool limitOneIntersection = pass==1;
+
+        LineSegmentIntersectorList batch;
+        std::vector<osg::Vec3d> starts, ends;
+        for(LineSegmentIntersectorList::const_iterator itr = intersectors.begin();
+            itr != intersectors.end();
+            ++itr)
+        {
+            LineSegmentIntersector* lsi = *itr;
+            if (lsi->reachedLimit()) continue;
+
+            IntersectionLimit limit = lsi->getIntersectionLimit();
+            if ((limit == LIMIT_ONE_PER_DRAWABLE || limit == LIMIT_ONE) != limitOneIntersection) continue;
+
+            osg::Vec3d s(lsi->_start), e(lsi->_end);
+            if ( drawable->isCullingActive() && !lsi->intersectAndClip( s, e, drawable->getBoundingBox() ) ) continue;
+
+            batch.push_back(lsi);
+            starts.push_back(s);
+            ends.push_back(e);
+        }
+
+        if (batch.empty()) continue;
+
+        osg::KdTree::SegmentIntersections hits;
+        kdTree->intersect(&starts.front(), &ends.front(), batch.size(), hits, limitOneIntersection);
+
+        const osg::Vec3Array* vertices = kdTree->getVertices();
+        for(osg::KdTree::SegmentIntersections::iterator itr = hits.begin();
+            itr != hits.end();
+            ++itr)
+        {
+            LineSegmentIntersector* lsi = batch[itr->segmentIndex];
+            const osg::Vec3d& s = starts[itr->segmentIndex];
+            const osg::Vec3d& e = ends[itr->segmentIndex];
+
+            // Remap ratio into the range of LineSegment
+            double remap_ratio = ((s - lsi->_start).length() + itr->ratio*(e - s).length())/(lsi->_end - lsi->_start).length();
+
+            const osg::Vec3& v0 = (*vertices)[itr->indices[0]];
+            osg::Vec3d normal = osg::Vec3d((*vertices)[itr->indices[1]] - v0)^osg::Vec3d((*vertices)[itr->indices[2]] - v0);
+            normal.normalize();
+
+            Intersection hit;
+            hit.ratio = remap_ratio;
+            hit.matrix = iv.getModelMatrix();
+            hit.nodePath = iv.getNodePath();
+            hit.drawable = drawable;
+            hit.primitiveIndex = itr->primitiveIndex;
+
+            hit.localIntersectionPoint = lsi->_start*(1.0 - remap_ratio) + lsi->_end*remap_ratio;
+            hit.localIntersectionNormal = normal;
+
+            hit.indexList.reserve(3);
+            hit.ratioList.reserve(3);
+            for(unsigned int i=0; i<3; ++i)
+            {
+                if (itr->ratios[i]!=0.0f)
+                {
+                    hit.indexList.push_back(itr->indices[i]);
+                    hit.ratioList.push_back(itr->ratios[i]);
+                }
+            }
+
+            lsi->insertIntersection(hit);
+        }
+    }
+
+    return true;
+}
+
 void LineSegmentIntersector::reset()
 {
     Intersector::reset();
@@ -13,6 +13,7 @@
 */
 
 #include <cassert>
+#include <float.h>
 #include <limits>
 
 #include <algorithm>
@@ -20,6 +21,7 @@
 
 #include <iostream>
 
+#include <osg/BoundingBox>
 #include <osg/Geometry>
 #include <osg/Math>
 #include <osg/PrimitiveSet>
@@ -215,6 +217,30 @@ struct MyTriangleOperator
 
 };
 typedef osg::TriangleIndexFunctor<MyTriangleOperator> MyTriangleIndexFunctor;
+
+// Collect the indices of the non degenerate triangles of primitives.
+struct TriangleCollectOperator
+{
+    IndexList* indices;
+    TriangleCollectOperator() : indices(0) {}
+
+    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1 == p2 || p2 == p3 || p1 == p3)
+            return;
+        indices->push_back(p1);
+        indices->push_back(p2);
+        indices->push_back(p3);
+    }
+};
+
+struct TriangleCollector : public TriangleIndexFunctor<TriangleCollectOperator>
+{
+    TriangleCollector(IndexList* indices_)
+    {
+        indices = indices_;
+    }
+};
 }
 
 void IndexMeshVisitor::makeMesh(Geometry& geom)
@@ -399,64 +425,6 @@ void IndexMeshVisitor::makeMesh()
 
 namespace
 {
-// A simulation of a Least Recently Used cache. Position in the cache
-// corresponds to when the vertex was used i.e., 0 is the most
-// recently used.
-struct LRUCache
-{
-    LRUCache(size_t maxSize_) : maxSize(maxSize_)
-    {
-        entries.reserve(maxSize_ + 3);
-    }
-    std::vector<unsigned> entries;
-    size_t maxSize;
-
-    // Add a list of values to the cache
-    void addEntries(unsigned* begin, unsigned* end)
-    {
-        // If any of the new vertices are already in the cache, remove
-        // them, leaving some room at the front of the cache.
-        std::vector<unsigned>::reverse_iterator validEnd = entries.rend();
-        for (unsigned* pent = begin; pent != end; ++pent)
-        {
-            validEnd = std::remove(entries.rbegin(), validEnd, *pent);
-        }
-        // Now make room still needed for new cache entries
-        size_t newEnts = end - begin;
-        int spaceNeeded = newEnts - (entries.rend() - validEnd);
-        if (spaceNeeded > 0)
-        {
-            if (maxSize - entries.size() >= static_cast<unsigned>(spaceNeeded))
-                entries.resize(entries.size() + spaceNeeded);
-            else if (entries.size() < maxSize)
-                entries.resize(maxSize);
-            std::copy_backward(entries.begin() + newEnts - spaceNeeded,
-                               entries.end() - spaceNeeded, entries.end());
-        }
-        std::copy(begin, end, entries.begin());
-    }
-
-    bool empty()
-    {
-        return entries.empty();
-    }
-};
-
-// A list of triangles that use a vertex is associated with the Vertex
-// structure in another array.
-struct Vertex
-{
-    int cachePosition;
-    float score;
-    int trisUsing;
-    int numActiveTris;          // triangles left to process
-    size_t triList;             // index to start of triangle storage
-    Vertex()
-        : cachePosition(-1), score(0.0f), trisUsing(0), numActiveTris(0), triList(0)
-    {
-    }
-};
-
 // Code from Tom Forsyth's article. The algorithm is described in
 // detail at
 // http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html.
@@ -469,10 +437,12 @@ struct Vertex
 // cache and ejected from the cache are updated. Then the scores of
 // triangles that use those vertices are updated.
 //
-// Unless the cache is empty, the "best" triangle is found by
-// searching triangles that use vertices in the cache, not the whole
-// mesh. This keeps the algorithm running in time proportional to the
-// size of the mesh.
+// The "best" triangle is only searched for among the triangles that
+// use vertices in the cache, which are the only ones whose scores
+// change. When none are left the next triangle not yet drawn, in the
+// original order, is taken, rather than searching the whole mesh.
+// This keeps the algorithm running in time proportional to the size
+// of the mesh.
 
 // The "magic" scoring functions are described in the paper.
 const float cacheDecayPower = 1.5f;
@@ -481,172 +451,63 @@ const float valenceBoostScale = 2.0f;
 const float valenceBoostPower = 0.5f;
 
 const int maxCacheSize = 32;
+const unsigned maxValenceScore = 32;
 
-float findVertexScore (Vertex& vert)
+// The scores for the position of a vertex in the cache and for the
+// number of triangles still to use it, computed once up front.
+struct VertexScoreTable
 {
-
-    if (vert.numActiveTris == 0)
+    VertexScoreTable()
     {
-        // No tri needs this vertex!
-        return -1.0f;
+        for (int i = 0; i < maxCacheSize; ++i)
+        {
+            if (i < 3)
+            {
+                // This vertex was used in the last triangle,
+                // so it has a fixed score, whichever of the three
+                // it's in. Otherwise, you can get very different
+                // answers depending on whether you add
+                // the triangle 1,2,3 or 3,1,2 - which is silly.
+                cacheScore[i] = lastTriScore;
+            }
+            else
+            {
+                // Points for being high in the cache.
+                const float scaler = 1.0f / (maxCacheSize - 3);
+                cacheScore[i] = powf(1.0f - (i - 3) * scaler, cacheDecayPower);
+            }
+        }
+        valenceScore[0] = 0.0f;
+        for (unsigned i = 1; i < maxValenceScore; ++i)
+            valenceScore[i] = valenceBoostScale * powf(float(i), -valenceBoostPower);
     }
-    float score = 0.0f;
-    int cachePosition = vert.cachePosition;
 
-    if (cachePosition < 0)
+    float score(int cachePosition, unsigned numActiveTris) const
     {
-        // Vertex is not in FIFO cache - no score.
-    }
-    else
-    {
-        if (cachePosition < 3)
+        if (numActiveTris == 0)
         {
-            // This vertex was used in the last triangle,
-            // so it has a fixed score, whichever of the three
-            // it's in. Otherwise, you can get very different
-            // answers depending on whether you add
-            // the triangle 1,2,3 or 3,1,2 - which is silly.
-            score = lastTriScore;
+            // No tri needs this vertex!
+            return -1.0f;
         }
+        float result = cachePosition < 0 ? 0.0f : cacheScore[cachePosition];
+        // Bonus points for having a low number of tris still to
+        // use the vert, so we get rid of lone verts quickly.
+        if (numActiveTris < maxValenceScore)
+            result += valenceScore[numActiveTris];
         else
-        {
-            assert (cachePosition < maxCacheSize);
-            // Points for being high in the cache.
-            const float scaler = 1.0f / (maxCacheSize - 3);
-            score = 1.0f - (cachePosition - 3 ) * scaler;
-            score = powf(score, cacheDecayPower);
-        }
+            result += valenceBoostScale * powf(float(numActiveTris), -valenceBoostPower);
+        return result;
     }
-    // Bonus points for having a low number of tris still to
-    // use the vert, so we get rid of lone verts quickly.
-    float valenceBoost = powf(vert.numActiveTris, -valenceBoostPower);
-    score += valenceBoostScale * valenceBoost;
-    return score;
-}
-
 
-typedef std::vector<Vertex> VertexList;
-
-struct Triangle
-{
-    float score;
-    unsigned verts[3];
+    float cacheScore[maxCacheSize];
+    float valenceScore[maxValenceScore];
 };
 
-typedef std::vector<Triangle> TriangleList;
-
-inline float findTriangleScore(Triangle& tri, const VertexList& vertices)
+const VertexScoreTable& getVertexScoreTable()
 {
-    float result = 0.0f;
-    for (int i = 0; i < 3; ++i)
-        result += vertices[tri.verts[i]].score;
-    return result;
+    static const VertexScoreTable s_table;
+    return s_table;
 }
-
-typedef std::pair<unsigned, float> TriangleScore;
-
-TriangleScore computeTriScores(Vertex& vert, const VertexList& vertices,
-                               TriangleList& triangles, std::vector<unsigned>& triStore)
-{
-    float bestScore = 0.0;
-    unsigned bestTri = 0;
-    for (size_t i = vert.triList;
-         i < vert.triList + vert.numActiveTris;
-         ++i)
-    {
-        unsigned tri = triStore[i];
-        float score = triangles[tri].score = findTriangleScore(triangles[tri],
-                                                               vertices);
-        if (score > bestScore)
-        {
-            bestScore = score;
-            bestTri = tri;
-        }
-    }
-    return std::make_pair(bestTri, bestScore);
-}
-
-typedef std::vector<Triangle> TriangleList;
-
-struct TriangleCounterOperator
-{
-    VertexList* vertices;
-    int triangleCount;
-    TriangleCounterOperator() : vertices(0), triangleCount(0) {}
-
-    void doVertex(unsigned p)
-    {
-        if (vertices->size() <= p)
-            vertices->resize(p + 1);
-        (*vertices)[p].trisUsing++;
-    }
-
-    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
-    {
-        if (p1 == p2 || p2 == p3 || p1 == p3)
-            return;
-        doVertex(p1);
-        doVertex(p2);
-        doVertex(p3);
-        triangleCount++;
-    }
-};
-
-struct TriangleCounter : public TriangleIndexFunctor<TriangleCounterOperator>
-{
-    TriangleCounter(std::vector<Vertex>* vertices_)
-    {
-        vertices = vertices_;
-    }
-};
-
-// Initialize the vertex triangle lists and the triangle data structures
-struct TriangleAddOperator
-{
-    VertexList* vertices;
-    std::vector<unsigned>* vertexTris;
-    TriangleList* triangles;
-    int triIdx;
-    TriangleAddOperator() : vertices(0), vertexTris(0), triangles(0), triIdx(0) {}
-
-    void doVertex(unsigned p)
-    {
-        (*vertexTris)[(*vertices)[p].triList + (*vertices)[p].numActiveTris++] = triIdx;
-    }
-
-    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
-    {
-        if (p1 == p2 || p2 == p3 || p1 == p3)
-            return;
-
-        doVertex(p1);
-        doVertex(p2);
-        doVertex(p3);
-        (*triangles)[triIdx].verts[0] = p1;
-        (*triangles)[triIdx].verts[1] = p2;
-        (*triangles)[triIdx].verts[2] = p3;
-        triIdx++;
-    }
-};
-
-struct TriangleAdder : public TriangleIndexFunctor<TriangleAddOperator>
-{
-    TriangleAdder(VertexList* vertices_, std::vector<unsigned>* vertexTris_,
-                  TriangleList* triangles_)
-    {
-        vertices = vertices_;
-        vertexTris = vertexTris_;
-        triangles = triangles_;
-    }
-};
-
-struct CompareTriangle
-{
-    bool operator()(const Triangle& lhs, const Triangle& rhs)
-    {
-        return lhs.score < rhs.score;
-    }
-};
 }
 
 void VertexCacheVisitor::optimizeVertices(Geometry& geom)
@@ -742,126 +603,136 @@ void VertexCacheVisitor::optimizeVertices(Geometry& geom)
 void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
                                               std::vector<unsigned>& vertDrawList)
 {
+    const VertexScoreTable& scoreTable = getVertexScoreTable();
+
     Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
-    // lists for all the vertices and triangles
-    VertexList vertices;
-    TriangleList triangles;
-    TriangleCounter triCounter(&vertices);
+    IndexList indices;
+    TriangleCollector collector(&indices);
     for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
              end = primSets.end();
          itr != end;
          ++itr)
-        (*itr)->accept(triCounter);
-    triangles.resize(triCounter.triangleCount);
-    // Get total of triangles used by all the vertices
-    size_t vertTrisSize = 0;
-    for (VertexList::iterator itr = vertices.begin(), end = vertices.end();
+        (*itr)->accept(collector);
+
+    const unsigned numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return;
+    const unsigned numVertices = *std::max_element(indices.begin(), indices.end()) + 1;
+
+    // The triangles using each vertex, stored contiguously, those
+    // still to be drawn being kept at the start of each vertex's list.
+    std::vector<unsigned> numActiveTris(numVertices, 0);
+    for (IndexList::const_iterator itr = indices.begin(), end = indices.end();
          itr != end;
          ++itr)
+        ++numActiveTris[*itr];
+    std::vector<unsigned> triList(numVertices + 1, 0);
+    for (unsigned v = 0; v < numVertices; ++v)
+        triList[v + 1] = triList[v] + numActiveTris[v];
+    std::vector<unsigned> vertTriListStore(indices.size());
     {
-        itr->triList = vertTrisSize;
-        vertTrisSize += itr->trisUsing;
+        std::vector<unsigned> fill(triList.begin(), triList.end() - 1);
+        for (unsigned i = 0; i < indices.size(); ++i)
+            vertTriListStore[fill[indices[i]]++] = i / 3;
     }
-    // Store for lists of triangles (indices) used by the vertices
-    std::vector<unsigned> vertTriListStore(vertTrisSize);
-    TriangleAdder triAdder(&vertices, &vertTriListStore, &triangles);
-    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
-             end = primSets.end();
-         itr != end;
-         ++itr)
-        (*itr)->accept(triAdder);
+
     // Set up initial scores for vertices and triangles
-    for (VertexList::iterator itr = vertices.begin(), end = vertices.end();
-         itr != end;
-         ++itr)
-        itr->score = findVertexScore(*itr);
-    for (TriangleList::iterator itr = triangles.begin(), end = triangles.end();
-         itr != end;
-         ++itr)
+    std::vector<float> vertexScores(numVertices);
+    for (unsigned v = 0; v < numVertices; ++v)
+        vertexScores[v] = scoreTable.score(-1, numActiveTris[v]);
+    std::vector<float> triangleScores(numTriangles);
+    unsigned bestTri = 0;
+    for (unsigned t = 0; t < numTriangles; ++t)
     {
-        itr->score = 0.0f;
-        for (int i = 0; i < 3; ++i)
-            itr->score += vertices[itr->verts[i]].score;
+        triangleScores[t] = vertexScores[indices[t * 3]]
+            + vertexScores[indices[t * 3 + 1]]
+            + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTri])
+            bestTri = t;
     }
+    std::vector<bool> triAdded(numTriangles, false);
+
+    // The model of the cache, most recently used first, with room for
+    // the three vertices of a triangle to push out the oldest entries.
+    unsigned cache[maxCacheSize + 3];
+    unsigned newCache[maxCacheSize + 3];
+    unsigned cacheSize = 0;
+    unsigned nextInputTri = 0;
+
     // Add Triangles to the draw list until there are no more.
-    unsigned trisLeft = triangles.size();
-    vertDrawList.reserve(trisLeft * 3);
-    LRUCache cache(maxCacheSize);
-    while (trisLeft-- > 0)
-    {
-        Triangle* triToAdd = 0;
-        float bestScore = 0.0;
-        for (std::vector<unsigned>::const_iterator itr = cache.entries.begin(),
-                 end = cache.entries.end();
-             itr != end;
-             ++itr)
-        {
-            TriangleScore tscore =  computeTriScores(vertices[*itr], vertices,
-                                                     triangles, vertTriListStore);
-            if (tscore.second > bestScore)
-            {
-                bestScore = tscore.second;
-                triToAdd = &triangles[tscore.first];
-            }
-        }
-        if (!triToAdd)
-        {
-            // The cache was empty, or all the triangles that use
-            // vertices in the cache have already been added.
-            OSG_DEBUG << "VertexCacheVisitor searching all triangles" << std::endl;
-            TriangleList::iterator maxItr
-                = std::max_element(triangles.begin(), triangles.end(),
-                              CompareTriangle());
-            triToAdd = &(*maxItr);
-        }
-        assert(triToAdd != 0 && triToAdd->score > 0.0);
+    vertDrawList.reserve(numTriangles * 3);
+    const unsigned noTriangle = std::numeric_limits<unsigned>::max();
+    while (bestTri != noTriangle)
+    {
+        triAdded[bestTri] = true;
+        const unsigned* triVerts = &indices[bestTri * 3];
+
         // Add triangle vertices, and remove triangle from the
         // vertices that use it.
-        triToAdd->score = -1.0f;
-        unsigned triToAddIdx = triToAdd - &triangles[0];
+        unsigned newCacheSize = 0;
         for (unsigned i = 0; i < 3; ++i)
         {
-            unsigned vertIdx = triToAdd->verts[i];
-            Vertex* vert = &vertices[vertIdx];
+            unsigned vertIdx = triVerts[i];
             vertDrawList.push_back(vertIdx);
-            std::remove(vertTriListStore.begin() + vert->triList,
-                   vertTriListStore.begin() + vert->triList
-                   + vert->numActiveTris,
-                   triToAddIdx);
-            vert->numActiveTris--;
+            newCache[newCacheSize++] = vertIdx;
+
+            unsigned* activeBegin = &vertTriListStore[triList[vertIdx]];
+            unsigned* activeEnd = activeBegin + numActiveTris[vertIdx];
+            unsigned* pos = std::find(activeBegin, activeEnd, bestTri);
+            std::swap(*pos, *(activeEnd - 1));
+            --numActiveTris[vertIdx];
         }
-        // Assume that the three oldest cache entries will get kicked
-        // out, so reset their scores and those of their
-        // triangles. Otherwise we'll "lose" them and not be able to
-        // change their scores.
-        if (cache.maxSize - cache.entries.size() < 3)
+        for (unsigned i = 0; i < cacheSize; ++i)
         {
-            for (std::vector<unsigned>::iterator itr = cache.entries.end() - 3,
-                     end = cache.entries.end();
-                 itr != end;
-                ++itr)
+            unsigned vertIdx = cache[i];
+            if (vertIdx != triVerts[0] && vertIdx != triVerts[1] && vertIdx != triVerts[2])
+                newCache[newCacheSize++] = vertIdx;
+        }
+
+        // Update the scores of the vertices in the cache and of those
+        // ejected from it, passing the change on to their triangles.
+        for (unsigned i = 0; i < newCacheSize; ++i)
+        {
+            unsigned vertIdx = newCache[i];
+            int cachePosition = i < static_cast<unsigned>(maxCacheSize) ? static_cast<int>(i) : -1;
+            float score = scoreTable.score(cachePosition, numActiveTris[vertIdx]);
+            float delta = score - vertexScores[vertIdx];
+            vertexScores[vertIdx] = score;
+            for (unsigned j = triList[vertIdx], end = triList[vertIdx] + numActiveTris[vertIdx]; j < end; ++j)
+                triangleScores[vertTriListStore[j]] += delta;
+        }
+
+        cacheSize = osg::minimum(newCacheSize, static_cast<unsigned>(maxCacheSize));
+        std::copy(newCache, newCache + cacheSize, cache);
+
+        // Find the best triangle using a vertex in the cache.
+        bestTri = noTriangle;
+        float bestScore = 0.0f;
+        for (unsigned i = 0; i < cacheSize; ++i)
+        {
+            unsigned vertIdx = cache[i];
+            for (unsigned j = triList[vertIdx], end = triList[vertIdx] + numActiveTris[vertIdx]; j < end; ++j)
             {
-                vertices[*itr].cachePosition = -1;
-                vertices[*itr].score = findVertexScore(vertices[*itr]);
+                unsigned tri = vertTriListStore[j];
+                if (bestTri == noTriangle || triangleScores[tri] > bestScore)
+                {
+                    bestScore = triangleScores[tri];
+                    bestTri = tri;
+                }
             }
-            for (std::vector<unsigned>::iterator itr = cache.entries.end() - 3,
-                     end = cache.entries.end();
-                 itr != end;
-                ++itr)
-                computeTriScores(vertices[*itr], vertices, triangles,
-                                 vertTriListStore);
         }
-        cache.addEntries(&triToAdd->verts[0], &triToAdd->verts[3]);
-        for (std::vector<unsigned>::const_iterator itr = cache.entries.begin(),
-                 end = cache.entries.end();
-             itr != end;
-             ++itr)
+
+        if (bestTri == noTriangle)
         {
-            unsigned vertIdx = *itr;
-            vertices[vertIdx].cachePosition = itr - cache.entries.begin();
-            vertices[vertIdx].score = findVertexScore(vertices[vertIdx]);
+            // All the triangles that use vertices in the cache have
+            // already been added, so carry on from the next triangle
+            // in the original order.
+            while (nextInputTri < numTriangles && triAdded[nextInputTri])
+                ++nextInputTri;
+            if (nextInputTri < numTriangles)
+                bestTri = nextInputTri;
         }
-     }
+    }
 }
 
 void VertexCacheVisitor::optimizeVertices()
@@ -874,9 +745,210 @@ void VertexCacheVisitor::optimizeVertices()
     }
 }
 
+namespace
+{
+// A model of a FIFO cache of a given size, as used by GPUs. Rather
+// than storing the entries, the time each vertex entered the cache is
+// recorded, a vertex having been pushed out once as many others have
+// entered since.
+struct FIFOCache
+{
+    FIFOCache(unsigned numVertices, unsigned cacheSize_)
+        : timestamps(numVertices, 0), timestamp(cacheSize_ + 1), cacheSize(cacheSize_)
+    {
+    }
+
+    // Return true if the vertex was in the cache.
+    inline bool contains(unsigned vertex) const
+    {
+        return timestamp - timestamps[vertex] <= cacheSize;
+    }
+
+    // Add a vertex to the cache if it isn't already, returning the
+    // number of cache misses.
+    inline unsigned add(unsigned vertex)
+    {
+        if (contains(vertex))
+            return 0;
+        timestamps[vertex] = timestamp++;
+        return 1;
+    }
+
+    // Empty the cache.
+    inline void clear()
+    {
+        timestamp += cacheSize + 1;
+    }
+
+    std::vector<unsigned> timestamps;
+    unsigned timestamp;
+    unsigned cacheSize;
+};
+
+// Split the triangles into the clusters of the algorithm of Sander et
+// al. and reorder them. Hard boundaries are where the cache has to be
+// refilled, as none of a triangle's vertices are in it. Each run of
+// triangles between them is split again, modelling the cache as empty
+// at the start of each cluster, once the cache miss ratio of the
+// cluster falls to within the threshold of that of the whole run.
+// The clusters are then sorted by how far they face away from the
+// centre of the mesh, those facing outwards being drawn first.
+void reorderForOverdraw(const Vec3Array& vertices, IndexList& indices,
+                        unsigned cacheSize, float threshold)
+{
+    const unsigned numTriangles = indices.size() / 3;
+
+    FIFOCache cache(vertices.size(), cacheSize);
+    std::vector<unsigned> hardBoundaries;
+    std::vector<unsigned> triMisses(numTriangles);
+    for (unsigned t = 0; t < numTriangles; ++t)
+    {
+        unsigned misses = cache.add(indices[t * 3])
+            + cache.add(indices[t * 3 + 1])
+            + cache.add(indices[t * 3 + 2]);
+        if (t == 0 || misses == 3)
+            hardBoundaries.push_back(t);
+        triMisses[t] = misses;
+    }
+    hardBoundaries.push_back(numTriangles);
+
+    std::vector<unsigned> clusters;
+    for (unsigned h = 0; h + 1 < hardBoundaries.size(); ++h)
+    {
+        unsigned begin = hardBoundaries[h];
+        unsigned end = hardBoundaries[h + 1];
+        unsigned runMisses = 0;
+        for (unsigned t = begin; t < end; ++t)
+            runMisses += triMisses[t];
+        float clusterThreshold = threshold * float(runMisses) / float(end - begin);
+
+        cache.clear();
+        clusters.push_back(begin);
+        unsigned clusterBegin = begin;
+        unsigned clusterMisses = 0;
+        for (unsigned t = begin; t < end; ++t)
+        {
+            clusterMisses += cache.add(indices[t * 3])
+                + cache.add(indices[t * 3 + 1])
+                + cache.add(indices[t * 3 + 2]);
+            if (t + 1 < end
+                && float(clusterMisses) <= clusterThreshold * float(t + 1 - clusterBegin))
+            {
+                cache.clear();
+                clusters.push_back(t + 1);
+                clusterBegin = t + 1;
+                clusterMisses = 0;
+            }
+        }
+    }
+    clusters.push_back(numTriangles);
+
+    // Area weighted centroids and normals of the clusters and the mesh.
+    const unsigned numClusters = clusters.size() - 1;
+    std::vector<Vec3d> clusterCentroids(numClusters);
+    std::vector<Vec3d> clusterNormals(numClusters);
+    Vec3d meshCentroid;
+    double meshArea = 0.0;
+    for (unsigned c = 0; c < numClusters; ++c)
+    {
+        Vec3d centroid, normal;
+        double area = 0.0;
+        for (unsigned t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const Vec3d v0(vertices[indices[t * 3]]);
+            const Vec3d v1(vertices[indices[t * 3 + 1]]);
+            const Vec3d v2(vertices[indices[t * 3 + 2]]);
+            Vec3d triNormal = (v1 - v0) ^ (v2 - v0);
+            double triArea = triNormal.length();
+            centroid += (v0 + v1 + v2) * (triArea / 3.0);
+            normal += triNormal;
+            area += triArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        clusterCentroids[c] = area > 0.0 ? centroid / area : Vec3d(vertices[indices[clusters[c] * 3]]);
+        normal.normalize();
+        clusterNormals[c] = normal;
+    }
+    if (meshArea > 0.0)
+        meshCentroid /= meshArea;
+
+    std::vector<std::pair<double, unsigned> > order(numClusters);
+    for (unsigned c = 0; c < numClusters; ++c)
+        order[c] = std::make_pair(-((clusterCentroids[c] - meshCentroid) * clusterNormals[c]), c);
+    std::stable_sort(order.begin(), order.end());
+
+    IndexList reordered;
+    reordered.reserve(indices.size());
+    for (unsigned c = 0; c < numClusters; ++c)
+    {
+        unsigned cluster = order[c].second;
+        reordered.insert(reordered.end(),
+                         indices.begin() + clusters[cluster] * 3,
+                         indices.begin() + clusters[cluster + 1] * 3);
+    }
+    std::copy(reordered.begin(), reordered.end(), indices.begin());
+}
+}
+
+void ReduceOverdrawVisitor::reduceOverdraw(Geometry& geom)
+{
+    const Vec3Array* vertices = dynamic_cast<const Vec3Array*>(geom.getVertexArray());
+    if (!vertices || vertices->empty())
+        return;
+
+    bool reordered = false;
+    Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
+             end = primSets.end();
+         itr != end;
+         ++itr)
+    {
+        DrawElements* elements = (*itr)->getDrawElements();
+        if (!elements || elements->getMode() != PrimitiveSet::TRIANGLES)
+            continue;
+
+        unsigned numIndices = elements->getNumIndices() - elements->getNumIndices() % 3;
+        // Too few triangles to have more than one cluster.
+        if (numIndices < 3 * 32)
+            continue;
+
+        IndexList indices(numIndices);
+        bool valid = true;
+        for (unsigned i = 0; i < numIndices && valid; ++i)
+        {
+            indices[i] = elements->getElement(i);
+            valid = indices[i] < vertices->size();
+        }
+        if (!valid)
+            continue;
+
+        reorderForOverdraw(*vertices, indices, _cacheSize, _threshold);
+
+        for (unsigned i = 0; i < numIndices; ++i)
+            elements->setElement(i, indices[i]);
+        elements->dirty();
+        reordered = true;
+    }
+
+    if (reordered)
+        geom.dirtyGLObjects();
+}
+
+void ReduceOverdrawVisitor::reduceOverdraw()
+{
+    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
+         itr != end;
+         ++itr)
+    {
+        reduceOverdraw(*(*itr));
+    }
+}
+
 VertexCacheMissVisitor::VertexCacheMissVisitor(unsigned cacheSize)
     : osg::NodeVisitor(NodeVisitor::TRAVERSE_ALL_CHILDREN), misses(0),
-      triangles(0), _cacheSize(cacheSize)
+      triangles(0), vertices(0), pixelsShaded(0.0), pixelsCovered(0.0),
+      _cacheSize(cacheSize), _estimateOverdraw(false)
 {
 }
 
@@ -884,6 +956,9 @@ void VertexCacheMissVisitor::reset()
 {
     misses = 0;
     triangles = 0;
+    vertices = 0;
+    pixelsShaded = 0.0;
+    pixelsCovered = 0.0;
 }
 
 void VertexCacheMissVisitor::apply(Geometry& geom)
@@ -893,72 +968,101 @@ void VertexCacheMissVisitor::apply(Geometry& geom)
 
 namespace
 {
-// The cache miss algorithm models an LRU cache because it results in an
-// order that is insensitive to the actual cache size of the GPU. Real
-// GPUs use a FIFO cache, so the statistics gatherer simulates that.
-struct FIFOCache
+// Size of the grid the triangles are rasterized to, in each direction,
+// to estimate overdraw.
+const int overdrawGridSize = 256;
+
+// Rasterize a triangle, already projected to the grid, with a depth
+// test, counting the pixels shaded. Only the counter clockwise, front
+// facing, triangles are drawn.
+void rasterizeTriangle(const Vec3& p0, const Vec3& p1, const Vec3& p2,
+                       std::vector<float>& depthBuffer, double& pixelsShaded)
 {
-    FIFOCache(size_t maxSize_) : maxSize(maxSize_)
-    {
-        entries.reserve(maxSize_);
-    }
-    std::vector<unsigned> entries;
-    size_t maxSize;
-
-    // Add a list of values to the cache
-    void addEntries(unsigned* begin, unsigned* end)
-    {
-        // Make room for new cache entries
-        size_t newEnts = end - begin;
-        if (entries.size() < maxSize)
-            entries.resize(osg::minimum(entries.size() + newEnts, maxSize));
-        std::vector<unsigned>::iterator copyEnd = entries.end() - newEnts;
-        std::copy_backward(entries.begin(), copyEnd, entries.end());
-        std::copy(begin, end, entries.begin());
-    }
+    float area = (p1.x() - p0.x()) * (p2.y() - p0.y()) - (p1.y() - p0.y()) * (p2.x() - p0.x());
+    if (area <= 0.0f)
+        return;
 
-    bool empty()
-    {
-        return entries.empty();
-    }
-};
+    int minX = osg::maximum(0, static_cast<int>(floorf(osg::minimum(p0.x(), osg::minimum(p1.x(), p2.x())))));
+    int maxX = osg::minimum(overdrawGridSize - 1, static_cast<int>(ceilf(osg::maximum(p0.x(), osg::maximum(p1.x(), p2.x())))));
+    int minY = osg::maximum(0, static_cast<int>(floorf(osg::minimum(p0.y(), osg::minimum(p1.y(), p2.y())))));
+    int maxY = osg::minimum(overdrawGridSize - 1, static_cast<int>(ceilf(osg::maximum(p0.y(), osg::maximum(p1.y(), p2.y())))));
 
-// Insert vertices in a cache and record cache misses
-struct CacheRecordOperator
-{
-    CacheRecordOperator() : cache(0), misses(0), triangles(0) {}
-    FIFOCache* cache;
-    unsigned misses;
-    unsigned triangles;
-    void operator()(unsigned p1, unsigned p2, unsigned p3)
+    float invArea = 1.0f / area;
+    for (int y = minY; y <= maxY; ++y)
     {
-        unsigned verts[3];
-        verts[0] = p1;
-        verts[1] = p2;
-        verts[2] = p3;
-        triangles++;
-        for (int i = 0; i < 3; ++i)
+        float py = float(y) + 0.5f;
+        for (int x = minX; x <= maxX; ++x)
         {
-            if (std::find(cache->entries.begin(), cache->entries.end(), verts[i])
-                == cache->entries.end())
-                misses++;
+            float px = float(x) + 0.5f;
+            float w0 = (p2.x() - p1.x()) * (py - p1.y()) - (p2.y() - p1.y()) * (px - p1.x());
+            float w1 = (p0.x() - p2.x()) * (py - p2.y()) - (p0.y() - p2.y()) * (px - p2.x());
+            float w2 = (p1.x() - p0.x()) * (py - p0.y()) - (p1.y() - p0.y()) * (px - p0.x());
+            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                continue;
+
+            float depth = (w0 * p0.z() + w1 * p1.z() + w2 * p2.z()) * invArea;
+            float& stored = depthBuffer[y * overdrawGridSize + x];
+            if (depth < stored)
+            {
+                stored = depth;
+                pixelsShaded += 1.0;
+            }
         }
-        cache->addEntries(&verts[0], &verts[3]);
     }
-};
+}
 
-struct CacheRecorder : public TriangleIndexFunctor<CacheRecordOperator>
+// Estimate overdraw by drawing the triangles in order, looking along
+// each axis in both directions, with the bounding box of the mesh
+// filling the grid.
+void estimateOverdraw(const Vec3Array& vertices, const IndexList& indices,
+                      double& pixelsShaded, double& pixelsCovered)
 {
-    CacheRecorder(unsigned cacheSize)
-    {
-        cache = new FIFOCache(cacheSize);
-    }
+    BoundingBox bb;
+    for (IndexList::const_iterator itr = indices.begin(), end = indices.end();
+         itr != end;
+         ++itr)
+        bb.expandBy(vertices[*itr]);
+    float extent = osg::maximum(bb.xMax() - bb.xMin(), osg::maximum(bb.yMax() - bb.yMin(), bb.zMax() - bb.zMin()));
+    if (!bb.valid() || extent <= 0.0f)
+        return;
+    float scale = float(overdrawGridSize - 1) / extent;
 
-    ~CacheRecorder()
+    std::vector<float> depthBuffer(overdrawGridSize * overdrawGridSize);
+    for (int axis = 0; axis < 3; ++axis)
     {
-        delete cache;
+        for (int direction = -1; direction <= 1; direction += 2)
+        {
+            // The grid axes are chosen so that counter clockwise
+            // triangles facing the viewer stay counter clockwise.
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            if (direction > 0)
+                std::swap(u, v);
+
+            std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+            for (unsigned i = 0; i + 2 < indices.size(); i += 3)
+            {
+                Vec3 p[3];
+                for (int j = 0; j < 3; ++j)
+                {
+                    const Vec3& vertex = vertices[indices[i + j]];
+                    p[j].set((vertex[u] - bb._min[u]) * scale,
+                             (vertex[v] - bb._min[v]) * scale,
+                             vertex[axis] * float(direction));
+                }
+                rasterizeTriangle(p[0], p[1], p[2], depthBuffer, pixelsShaded);
+            }
+
+            for (std::vector<float>::const_iterator itr = depthBuffer.begin(), end = depthBuffer.end();
+                 itr != end;
+                 ++itr)
+            {
+                if (*itr != FLT_MAX)
+                    pixelsCovered += 1.0;
+            }
+        }
     }
-};
+}
 }
 
 void VertexCacheMissVisitor::doGeometry(Geometry& geom)
@@ -967,16 +1071,38 @@ void VertexCacheMissVisitor::doGeometry(Geometry& geom)
     if (!vertArray || vertArray->getNumElements()==0)
         return;
     Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
-    CacheRecorder recorder(_cacheSize);
+    IndexList indices;
+    TriangleCollector collector(&indices);
     for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
              end = primSets.end();
          itr != end;
          ++itr)
     {
-        (*itr)->accept(recorder);
+        (*itr)->accept(collector);
     }
-    misses += recorder.misses;
-    triangles += recorder.triangles;
+    if (indices.empty())
+        return;
+
+    unsigned numVertices = osg::maximum(vertArray->getNumElements(),
+                                        *std::max_element(indices.begin(), indices.end()) + 1);
+    FIFOCache cache(numVertices, _cacheSize);
+    std::vector<bool> used(numVertices, false);
+    for (IndexList::const_iterator itr = indices.begin(), end = indices.end();
+         itr != end;
+         ++itr)
+    {
+        misses += cache.add(*itr);
+        if (!used[*itr])
+        {
+            used[*itr] = true;
+            ++vertices;
+        }
+    }
+    triangles += indices.size() / 3;
+
+    const Vec3Array* vec3Array = dynamic_cast<const Vec3Array*>(vertArray);
+    if (_estimateOverdraw && vec3Array && numVertices == vec3Array->size())
+        estimateOverdraw(*vec3Array, indices, pixelsShaded, pixelsCovered);
 }
 
 namespace
@@ -1179,6 +1305,305 @@ void VertexAccessOrderVisitor::optimizeOrder(Geometry& geom)
     geom.dirtyGLObjects();
 }
 
+namespace
+{
+// Grows each meshlet from a seed triangle across shared vertices,
+// adding the neighbouring triangle that brings in the fewest new
+// vertices, then the one closest to the centre of the meshlet, until
+// the vertex or triangle limit is reached or no neighbours are left.
+class MeshletBuilder
+{
+public:
+    MeshletBuilder(const Vec3Array& vertices, const IndexList& indices,
+                   unsigned maxVertices, unsigned maxTriangles)
+        : _vertices(vertices), _indices(indices),
+          _maxVertices(osg::maximum(maxVertices, 3u)),
+          _maxTriangles(osg::maximum(maxTriangles, 1u)),
+          _numTriangles(indices.size() / 3),
+          _vertexTriangleOffsets(vertices.size() + 1, 0),
+          _liveTriangles(vertices.size(), 0),
+          _vertexMeshlet(vertices.size(), 0),
+          _used(_numTriangles, false),
+          _centroids(_numTriangles)
+    {
+        for (unsigned i = 0; i < _indices.size(); ++i)
+            ++_liveTriangles[_indices[i]];
+        for (unsigned v = 0; v < _liveTriangles.size(); ++v)
+            _vertexTriangleOffsets[v + 1] = _vertexTriangleOffsets[v] + _liveTriangles[v];
+
+        std::vector<unsigned> fill(_vertexTriangleOffsets.begin(), _vertexTriangleOffsets.end() - 1);
+        _vertexTriangles.resize(_indices.size());
+        for (unsigned t = 0; t < _numTriangles; ++t)
+        {
+            for (unsigned k = 0; k < 3; ++k)
+                _vertexTriangles[fill[_indices[t * 3 + k]]++] = t;
+            _centroids[t] = (_vertices[_indices[t * 3]] + _vertices[_indices[t * 3 + 1]]
+                             + _vertices[_indices[t * 3 + 2]]) / 3.0f;
+        }
+    }
+
+    void build(IndexList& newIndices, MeshletGeometry::MeshletList& meshlets)
+    {
+        newIndices.clear();
+        newIndices.reserve(_indices.size());
+        meshlets.clear();
+
+        unsigned seed = 0;
+        for (;;)
+        {
+            while (seed < _numTriangles && _used[seed])
+                ++seed;
+            if (seed == _numTriangles)
+                break;
+
+            MeshletGeometry::Meshlet meshlet;
+            meshlet.firstIndex = newIndices.size();
+            _meshletVertices.clear();
+            _centroidSum.set(0.0f, 0.0f, 0.0f);
+            unsigned meshletId = meshlets.size() + 1;
+            unsigned numTriangles = 0;
+
+            for (unsigned tri = seed; tri != invalidTriangle; tri = findNext(tri, meshletId, numTriangles))
+            {
+                addTriangle(tri, meshletId, newIndices);
+                if (++numTriangles == _maxTriangles)
+                    break;
+            }
+
+            meshlet.numIndices = newIndices.size() - meshlet.firstIndex;
+            computeBounds(meshlet, newIndices);
+            meshlets.push_back(meshlet);
+        }
+    }
+
+protected:
+    static const unsigned invalidTriangle;
+
+    unsigned numNewVertices(unsigned tri, unsigned meshletId) const
+    {
+        unsigned num = 0;
+        for (unsigned k = 0; k < 3; ++k)
+            if (_vertexMeshlet[_indices[tri * 3 + k]] != meshletId)
+                ++num;
+        return num;
+    }
+
+    void addTriangle(unsigned tri, unsigned meshletId, IndexList& newIndices)
+    {
+        for (unsigned k = 0; k < 3; ++k)
+        {
+            unsigned v = _indices[tri * 3 + k];
+            if (_vertexMeshlet[v] != meshletId)
+            {
+                _vertexMeshlet[v] = meshletId;
+                _meshletVertices.push_back(v);
+            }
+            --_liveTriangles[v];
+            newIndices.push_back(v);
+        }
+        _used[tri] = true;
+        _centroidSum += _centroids[tri];
+    }
+
+    // Score the unused triangles around vertex v, keeping the best.
+    void scoreNeighbours(unsigned v, unsigned meshletId, const Vec3& center,
+                         unsigned& best, unsigned& bestNew, float& bestDistance) const
+    {
+        unsigned freeVertices = _maxVertices - _meshletVertices.size();
+        for (unsigned i = _vertexTriangleOffsets[v]; i < _vertexTriangleOffsets[v + 1]; ++i)
+        {
+            unsigned tri = _vertexTriangles[i];
+            if (_used[tri])
+                continue;
+            unsigned num = numNewVertices(tri, meshletId);
+            if (num > freeVertices || num > bestNew)
+                continue;
+            float distance = (_centroids[tri] - center).length2();
+            if (num < bestNew || distance < bestDistance)
+            {
+                best = tri;
+                bestNew = num;
+                bestDistance = distance;
+            }
+        }
+    }
+
+    unsigned findNext(unsigned last, unsigned meshletId, unsigned numTriangles) const
+    {
+        Vec3 center = _centroidSum / static_cast<float>(numTriangles);
+        unsigned best = invalidTriangle;
+        unsigned bestNew = 4;
+        float bestDistance = std::numeric_limits<float>::max();
+
+        // the neighbours of the last triangle keep the meshlet compact
+        // and are cheap to find, only when there are none are the
+        // neighbours of all of the meshlet's vertices considered.
+        for (unsigned k = 0; k < 3; ++k)
+            scoreNeighbours(_indices[last * 3 + k], meshletId, center, best, bestNew, bestDistance);
+
+        if (best == invalidTriangle)
+        {
+            for (unsigned i = 0; i < _meshletVertices.size(); ++i)
+            {
+                if (_liveTriangles[_meshletVertices[i]] > 0)
+                    scoreNeighbours(_meshletVertices[i], meshletId, center, best, bestNew, bestDistance);
+            }
+        }
+        return best;
+    }
+
+    void computeBounds(MeshletGeometry::Meshlet& meshlet, const IndexList& newIndices) const
+    {
+        BoundingBox bb;
+        for (unsigned i = 0; i < _meshletVertices.size(); ++i)
+            bb.expandBy(_vertices[_meshletVertices[i]]);
+        meshlet.center = bb.center();
+        float radius2 = 0.0f;
+        for (unsigned i = 0; i < _meshletVertices.size(); ++i)
+            radius2 = osg::maximum(radius2, (_vertices[_meshletVertices[i]] - meshlet.center).length2());
+        meshlet.radius = sqrtf(radius2);
+
+        // the normal cone, its axis is the average of the triangle
+        // normals and its spread the largest angle between a normal and
+        // the axis, too wide a spread can never be back face culled.
+        std::vector<Vec3> normals;
+        normals.reserve(meshlet.numIndices / 3);
+        Vec3 axis;
+        for (unsigned i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.numIndices; i += 3)
+        {
+            const Vec3& v0 = _vertices[newIndices[i]];
+            Vec3 normal = (_vertices[newIndices[i + 1]] - v0) ^ (_vertices[newIndices[i + 2]] - v0);
+            if (normal.normalize() > 0.0f)
+            {
+                normals.push_back(normal);
+                axis += normal;
+            }
+        }
+
+        meshlet.coneCutoff = 1.0f;
+        if (normals.empty() || axis.normalize() == 0.0f)
+            return;
+        meshlet.coneAxis = axis;
+
+        float minDot = 1.0f;
+        for (unsigned i = 0; i < normals.size(); ++i)
+            minDot = osg::minimum(minDot, normals[i] * axis);
+        if (minDot > 0.1f)
+            meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+
+    const Vec3Array& _vertices;
+    const IndexList& _indices;
+    unsigned _maxVertices;
+    unsigned _maxTriangles;
+    unsigned _numTriangles;
+    std::vector<unsigned> _vertexTriangleOffsets;
+    std::vector<unsigned> _vertexTriangles;
+    std::vector<unsigned> _liveTriangles;
+    std::vector<unsigned> _vertexMeshlet;
+    std::vector<bool> _used;
+    std::vector<Vec3> _centroids;
+    std::vector<unsigned> _meshletVertices;
+    Vec3 _centroidSum;
+};
+
+const unsigned MeshletBuilder::invalidTriangle = std::numeric_limits<unsigned>::max();
+}
+
+MeshletGeometry* MeshletVisitor::createMeshletGeometry(const Geometry& geom) const
+{
+    if (dynamic_cast<const MeshletGeometry*>(&geom) || geom.getDrawCallback())
+        return 0;
+
+    const Vec3Array* vertices = dynamic_cast<const Vec3Array*>(geom.getVertexArray());
+    if (!vertices || vertices->empty())
+        return 0;
+
+    // per primitive set arrays can't follow the triangles into the
+    // single primitive set of the meshlets.
+    Geometry::ArrayList arrays;
+    geom.getArrayList(arrays);
+    for (Geometry::ArrayList::const_iterator itr = arrays.begin(), end = arrays.end(); itr != end; ++itr)
+    {
+        if ((*itr)->getBinding() == osg::Array::BIND_PER_PRIMITIVE_SET)
+            return 0;
+    }
+
+    const Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    for (Geometry::PrimitiveSetList::const_iterator itr = primSets.begin(),
+             end = primSets.end();
+         itr != end;
+         ++itr)
+    {
+        // Can only deal with polygons, drawn once.
+        switch ((*itr)->getMode())
+        {
+        case(PrimitiveSet::TRIANGLES):
+        case(PrimitiveSet::TRIANGLE_STRIP):
+        case(PrimitiveSet::TRIANGLE_FAN):
+        case(PrimitiveSet::QUADS):
+        case(PrimitiveSet::QUAD_STRIP):
+        case(PrimitiveSet::POLYGON):
+            break;
+        default:
+            return 0;
+        }
+        if ((*itr)->getNumInstances() > 0)
+            return 0;
+    }
+
+    IndexList indices;
+    TriangleCollector collector(&indices);
+    geom.accept(collector);
+    for (IndexList::const_iterator itr = indices.begin(), end = indices.end(); itr != end; ++itr)
+    {
+        if (*itr >= vertices->size())
+            return 0;
+    }
+    if (indices.size() / 3 <= _maximumNumTriangles)
+        return 0;
+
+    IndexList newIndices;
+    MeshletGeometry::MeshletList meshlets;
+    MeshletBuilder builder(*vertices, indices, _maximumNumVertices, _maximumNumTriangles);
+    builder.build(newIndices, meshlets);
+
+    osg::ref_ptr<MeshletGeometry> meshletGeometry = new MeshletGeometry(geom);
+    osg::DrawElementsUInt* elements = new DrawElementsUInt(GL_TRIANGLES, newIndices.begin(), newIndices.end());
+    if (geom.getUseVertexBufferObjects())
+    {
+        elements->setElementBufferObject(new ElementBufferObject);
+    }
+    meshletGeometry->setMeshlets(elements, meshlets);
+    return meshletGeometry.release();
+}
+
+void MeshletVisitor::buildMeshlets()
+{
+    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
+         itr != end;
+         ++itr)
+    {
+        osg::ref_ptr<Geometry> geom = *itr;
+        if (!isOperationPermissibleForObject(geom.get()))
+            continue;
+
+        osg::ref_ptr<MeshletGeometry> meshletGeometry = createMeshletGeometry(*geom);
+        if (!meshletGeometry)
+            continue;
+
+        osg::Node::ParentList parents = geom->getParents();
+        for (osg::Node::ParentList::iterator pitr = parents.begin(); pitr != parents.end(); ++pitr)
+        {
+            (*pitr)->replaceChild(geom.get(), meshletGeometry.get());
+        }
+
+        ++_numMeshletGeometries;
+        _numMeshlets += meshletGeometry->getMeshlets().size();
+    }
+    _geometryList.clear();
+}
+
 void SharedArrayOptimizer::findDuplicatedUVs(const osg::Geometry& geometry)
 {
     _deduplicateUvs.clear();
@@ -0,0 +1,161 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+#include <osgUtil/MeshletGeometry>
+
+#include <osg/CullFace>
+#include <osg/FrontFace>
+#include <osg/Polytope>
+#include <osg/State>
+
+using namespace osgUtil;
+
+MeshletGeometry::MeshletGeometry():
+    _meshletCulling(true)
+{
+}
+
+MeshletGeometry::MeshletGeometry(const osg::Geometry& geometry, const osg::CopyOp& copyop):
+    osg::Geometry(geometry, copyop),
+    _meshletCulling(true)
+{
+    removePrimitiveSet(0, getNumPrimitiveSets());
+}
+
+MeshletGeometry::MeshletGeometry(const MeshletGeometry& geometry, const osg::CopyOp& copyop):
+    osg::Geometry(geometry, copyop),
+    _meshlets(geometry._meshlets),
+    _meshletCulling(geometry._meshletCulling)
+{
+    // the copied primitives include the meshlet elements, deep copied or not as the CopyOp requires.
+    _elements = getNumPrimitiveSets()==1 ? dynamic_cast<osg::DrawElementsUInt*>(getPrimitiveSet(0)) : 0;
+    if (!_elements) _meshlets.clear();
+}
+
+void MeshletGeometry::setMeshlets(osg::DrawElementsUInt* elements, const MeshletList& meshlets)
+{
+    removePrimitiveSet(0, getNumPrimitiveSets());
+
+    _elements = elements;
+    _meshlets = meshlets;
+
+    if (_elements.valid()) addPrimitiveSet(_elements.get());
+}
+
+unsigned int MeshletGeometry::cull(const osg::Matrix& modelview, const osg::Matrix& projection, bool backFaceCulling, RangeList& ranges) const
+{
+    ranges.clear();
+
+    // the frustum and eye in the local coordinates of the meshlets.
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(modelview*projection);
+
+    osg::Matrix inverseModelView;
+    if (!inverseModelView.invert(modelview)) backFaceCulling = false;
+
+    // back face culling is only valid when the modelview doesn't mirror the triangles.
+    double determinant = modelview(0,0)*(modelview(1,1)*modelview(2,2)-modelview(1,2)*modelview(2,1)) -
+                         modelview(0,1)*(modelview(1,0)*modelview(2,2)-modelview(1,2)*modelview(2,0)) +
+                         modelview(0,2)*(modelview(1,0)*modelview(2,1)-modelview(1,1)*modelview(2,0));
+    if (determinant<=0.0) backFaceCulling = false;
+
+    bool orthographic = projection(0,3)==0.0 && projection(1,3)==0.0 && projection(2,3)==0.0 && projection(3,3)==1.0;
+    osg::Vec3 eye = inverseModelView.getTrans();
+    osg::Vec3 viewDirection = osg::Matrix::transform3x3(osg::Vec3(0.0f,0.0f,-1.0f), inverseModelView);
+    viewDirection.normalize();
+
+    unsigned int numVisible = 0;
+    for(MeshletList::const_iterator itr = _meshlets.begin(); itr != _meshlets.end(); ++itr)
+    {
+        const Meshlet& meshlet = *itr;
+
+        if (!frustum.contains(osg::BoundingSphere(meshlet.center, meshlet.radius))) continue;
+
+        if (backFaceCulling && meshlet.coneCutoff<1.0f)
+        {
+            // all the triangles face away when the direction to them is within the cone of the back faces.
+            if (orthographic)
+            {
+                if (viewDirection*meshlet.coneAxis >= meshlet.coneCutoff) continue;
+            }
+            else
+            {
+                osg::Vec3 direction = meshlet.center - eye;
+                if (direction*meshlet.coneAxis >= meshlet.coneCutoff*direction.length() + meshlet.radius) continue;
+            }
+        }
+
+        ++numVisible;
+
+        if (!ranges.empty() && ranges.back().first+ranges.back().second==meshlet.firstIndex)
+        {
+            ranges.back().second += meshlet.numIndices;
+        }
+        else
+        {
+            ranges.push_back(Range(meshlet.firstIndex, meshlet.numIndices));
+        }
+    }
+
+    return numVisible;
+}
+
+bool MeshletGeometry::isBackFaceCulled(const osg::State& state) const
+{
+    if (!state.getLastAppliedMode(GL_CULL_FACE)) return false;
+
+    const osg::CullFace* cullFace = static_cast<const osg::CullFace*>(state.getLastAppliedAttribute(osg::StateAttribute::CULLFACE));
+    if (cullFace && cullFace->getMode()!=osg::CullFace::BACK) return false;
+
+    const osg::FrontFace* frontFace = static_cast<const osg::FrontFace*>(state.getLastAppliedAttribute(osg::StateAttribute::FRONTFACE));
+    if (frontFace && frontFace->getMode()!=osg::FrontFace::COUNTER_CLOCKWISE) return false;
+
+    return true;
+}
+
+void MeshletGeometry::drawPrimitivesImplementation(osg::RenderInfo& renderInfo) const
+{
+    if (!_meshletCulling || !_elements.valid() || _meshlets.empty() || getNumPrimitiveSets()!=1)
+    {
+        osg::Geometry::drawPrimitivesImplementation(renderInfo);
+        return;
+    }
+
+    osg::State& state = *renderInfo.getState();
+
+    RangeList ranges;
+    ranges.reserve(_meshlets.size()/4);
+    cull(state.getModelViewMatrix(), state.getProjectionMatrix(), isBackFaceCulled(state), ranges);
+    if (ranges.empty()) return;
+
+    GLenum mode = _elements->getMode();
+    bool usingVertexBufferObjects = state.useVertexBufferObject(_supportsVertexBufferObjects && _useVertexBufferObjects);
+    osg::GLBufferObject* ebo = usingVertexBufferObjects ? _elements->getOrCreateGLBufferObject(state.getContextID()) : 0;
+    if (ebo)
+    {
+        state.getCurrentVertexArrayState()->bindElementBufferObject(ebo);
+        GLsizeiptr offset = ebo->getOffset(_elements->getBufferIndex());
+        for(RangeList::const_iterator itr = ranges.begin(); itr != ranges.end(); ++itr)
+        {
+            glDrawElements(mode, itr->second, GL_UNSIGNED_INT, (const GLvoid *)(offset + itr->first*sizeof(GLuint)));
+        }
+    }
+    else
+    {
+        if (usingVertexBufferObjects) state.getCurrentVertexArrayState()->unbindElementBufferObject();
+        for(RangeList::const_iterator itr = ranges.begin(); itr != ranges.end(); ++itr)
+        {
+            glDrawElements(mode, itr->second, GL_UNSIGNED_INT, &((*_elements)[itr->first]));
+        }
+    }
+}
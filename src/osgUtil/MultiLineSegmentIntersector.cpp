@@ -0,0 +1,497 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/MultiLineSegmentIntersector>
+
+#include <osg/OperationThread>
+#include <osg/Notify>
+
+#include <algorithm>
+#include <math.h>
+
+// The segments are culled against bounding spheres two at a time with SSE2 instructions when the build targets them,
+// in double precision as LineSegmentIntersector does, otherwise one at a time.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define MULTILINESEGMENTINTERSECTOR_USE_SSE2
+#endif
+
+using namespace osgUtil;
+
+namespace
+{
+
+// Threads shared by all MultiLineSegmentIntersectors for traversing batches of segments in parallel, started on demand.
+class IntersectionThreads : public osg::Referenced
+{
+public:
+
+    IntersectionThreads():
+        _operationQueue(new osg::OperationQueue) {}
+
+    osg::OperationQueue* getOperationQueue(unsigned int numThreads)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        while(_threads.size() < numThreads)
+        {
+            osg::ref_ptr<osg::OperationThread> thread = new osg::OperationThread;
+            thread->setOperationQueue(_operationQueue.get());
+            thread->startThread();
+            _threads.push_back(thread);
+        }
+
+        return _operationQueue.get();
+    }
+
+protected:
+
+    virtual ~IntersectionThreads()
+    {
+        for(Threads::iterator itr = _threads.begin(); itr != _threads.end(); ++itr)
+        {
+            (*itr)->setDone(true);
+        }
+
+        // cancel() waits for each thread to stop running, join() then releases it before the queue is destroyed.
+        for(Threads::iterator itr = _threads.begin(); itr != _threads.end(); ++itr)
+        {
+            (*itr)->cancel();
+            (*itr)->join();
+        }
+    }
+
+    typedef std::vector< osg::ref_ptr<osg::OperationThread> > Threads;
+
+    OpenThreads::Mutex                  _mutex;
+    osg::ref_ptr<osg::OperationQueue>   _operationQueue;
+    Threads                             _threads;
+};
+
+IntersectionThreads* getIntersectionThreads()
+{
+    static osg::ref_ptr<IntersectionThreads> s_intersectionThreads = new IntersectionThreads;
+    return s_intersectionThreads.get();
+}
+
+osg::RefMatrix* copyMatrix(const osg::RefMatrix* matrix)
+{
+    return matrix ? new osg::RefMatrix(*matrix) : 0;
+}
+
+// set up an IntersectionVisitor to traverse a batch of segments as the one given would.
+void copySettings(const IntersectionVisitor& iv, IntersectionVisitor& visitor)
+{
+    visitor.setTraversalMode(iv.getTraversalMode());
+    visitor.setTraversalMask(iv.getTraversalMask());
+    visitor.setNodeMaskOverride(iv.getNodeMaskOverride());
+    visitor.setFrameStamp(const_cast<osg::FrameStamp*>(iv.getFrameStamp()));
+    visitor.setUseKdTreeWhenAvailable(iv.getUseKdTreeWhenAvailable());
+    visitor.setDoDummyTraversal(iv.getDoDummyTraversal());
+    visitor.setReadCallback(const_cast<IntersectionVisitor::ReadCallback*>(iv.getReadCallback()));
+    visitor.setReferenceEyePoint(iv.getReferenceEyePoint());
+    visitor.setReferenceEyePointCoordinateFrame(iv.getReferenceEyePointCoordinateFrame());
+    visitor.setLODSelectionMode(iv.getLODSelectionMode());
+
+    if (iv.getWindowMatrix()) visitor.pushWindowMatrix(copyMatrix(iv.getWindowMatrix()));
+    if (iv.getProjectionMatrix()) visitor.pushProjectionMatrix(copyMatrix(iv.getProjectionMatrix()));
+    if (iv.getViewMatrix()) visitor.pushViewMatrix(copyMatrix(iv.getViewMatrix()));
+    if (iv.getModelMatrix()) visitor.pushModelMatrix(copyMatrix(iv.getModelMatrix()));
+}
+
+// Traverses a batch of segments. The subgraph and settings are owned by the caller of computeIntersections(), which
+// blocks until the operation completes.
+class BatchOperation : public osg::Operation
+{
+public:
+
+    BatchOperation(MultiLineSegmentIntersector* intersector, osg::Node* node, const IntersectionVisitor* iv, osg::RefBlockCount* block):
+        osg::Operation("MultiLineSegmentIntersectorBatch", false),
+        _intersector(intersector),
+        _node(node),
+        _iv(iv),
+        _block(block) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        IntersectionVisitor visitor(_intersector);
+        copySettings(*_iv, visitor);
+        _node->accept(visitor);
+
+        _block->completed();
+    }
+
+    MultiLineSegmentIntersector*        _intersector;
+    osg::Node*                          _node;
+    const IntersectionVisitor*          _iv;
+    osg::ref_ptr<osg::RefBlockCount>    _block;
+};
+
+}
+
+MultiLineSegmentIntersector::MultiLineSegmentIntersector(CoordinateFrame cf, IntersectionLimit intersectionLimit):
+    Intersector(cf, intersectionLimit),
+    _parent(0),
+    _activeDepth(0),
+    _baseDepth(0),
+    _numThreads(0)
+{
+}
+
+unsigned int MultiLineSegmentIntersector::addSegment(const osg::Vec3d& start, const osg::Vec3d& end)
+{
+    unsigned int index = static_cast<unsigned int>(_starts.size());
+
+    _starts.push_back(start);
+    _ends.push_back(end);
+    _allSegments.push_back(ActiveSegment(index, index));
+
+    osg::Vec3d d = end-start;
+    double length2 = d.length2();
+    _sx.push_back(start.x()); _sy.push_back(start.y()); _sz.push_back(start.z());
+    _dx.push_back(d.x()); _dy.push_back(d.y()); _dz.push_back(d.z());
+    _inverseLength2.push_back(length2>0.0 ? 1.0/length2 : 0.0);
+
+    if (!_parent)
+    {
+        _intersections.push_back(Intersections());
+        _lineSegmentIntersectors.push_back(0);
+    }
+
+    return index;
+}
+
+void MultiLineSegmentIntersector::clear()
+{
+    _starts.clear();
+    _ends.clear();
+    _allSegments.clear();
+    _sx.clear(); _sy.clear(); _sz.clear();
+    _dx.clear(); _dy.clear(); _dz.clear();
+    _inverseLength2.clear();
+    _intersections.clear();
+    _lineSegmentIntersectors.clear();
+    _activeDepth = 0;
+}
+
+const MultiLineSegmentIntersector::ActiveSegments& MultiLineSegmentIntersector::getActiveSegments()
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+
+    // no node has been entered since this intersector was created, so all its segments are active.
+    if (top->_activeDepth==_baseDepth) return _allSegments;
+
+    return top->_activeStack[top->_activeDepth-1];
+}
+
+bool MultiLineSegmentIntersector::reachedLimit(unsigned int segment) const
+{
+    return _intersectionLimit == LIMIT_ONE && !_intersections[segment].empty();
+}
+
+Intersector* MultiLineSegmentIntersector::clone(osgUtil::IntersectionVisitor& iv)
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+
+    // compute the matrix that takes the segments from their CoordinateFrame into the local MODEL coordinate frame,
+    // transforming only those still active.
+    osg::Matrix matrix(LineSegmentIntersector::getTransformation(iv, _coordinateFrame));
+
+    osg::ref_ptr<MultiLineSegmentIntersector> mlsi = new MultiLineSegmentIntersector(_coordinateFrame, _intersectionLimit);
+    mlsi->_parent = top;
+    mlsi->setPrecisionHint(getPrecisionHint());
+    mlsi->_baseDepth = top->_activeDepth;
+
+    const ActiveSegments& active = top->_activeDepth>0 ? top->_activeStack[top->_activeDepth-1] : top->_allSegments;
+    for(ActiveSegments::const_iterator itr = active.begin(); itr != active.end(); ++itr)
+    {
+        if (top->reachedLimit(itr->segment)) continue;
+
+        mlsi->addSegment(top->_starts[itr->segment] * matrix, top->_ends[itr->segment] * matrix);
+        mlsi->_allSegments.back().segment = itr->segment;
+    }
+
+    return mlsi.release();
+}
+
+bool MultiLineSegmentIntersector::enter(const osg::Node& node)
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+
+    // make room for the segments active below the node before taking a reference to those active above it.
+    if (top->_activeStack.size()<=top->_activeDepth) top->_activeStack.resize(top->_activeDepth+1);
+
+    const ActiveSegments& active = getActiveSegments();
+    ActiveSegments& result = top->_activeStack[top->_activeDepth];
+    result.clear();
+
+    const osg::BoundingSphere& bs = node.getBound();
+    bool cull = node.isCullingActive() && bs.valid();
+
+    unsigned int numActive = static_cast<unsigned int>(active.size());
+    unsigned int i = 0;
+
+    double cx = bs._center.x(), cy = bs._center.y(), cz = bs._center.z();
+    double radius2 = double(bs._radius)*double(bs._radius);
+
+#if defined(MULTILINESEGMENTINTERSECTOR_USE_SSE2)
+    if (cull)
+    {
+        // the closest point of each segment to the center of the sphere, compared with its radius.
+        __m128d centerX = _mm_set1_pd(cx), centerY = _mm_set1_pd(cy), centerZ = _mm_set1_pd(cz);
+        __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0), r2 = _mm_set1_pd(radius2);
+        for(; i+2<=numActive; i+=2)
+        {
+            unsigned int a = active[i].slot, b = active[i+1].slot;
+
+            __m128d smx = _mm_sub_pd(_mm_set_pd(_sx[b], _sx[a]), centerX);
+            __m128d smy = _mm_sub_pd(_mm_set_pd(_sy[b], _sy[a]), centerY);
+            __m128d smz = _mm_sub_pd(_mm_set_pd(_sz[b], _sz[a]), centerZ);
+            __m128d dx = _mm_set_pd(_dx[b], _dx[a]);
+            __m128d dy = _mm_set_pd(_dy[b], _dy[a]);
+            __m128d dz = _mm_set_pd(_dz[b], _dz[a]);
+
+            __m128d smd = _mm_add_pd(_mm_add_pd(_mm_mul_pd(smx, dx), _mm_mul_pd(smy, dy)), _mm_mul_pd(smz, dz));
+            __m128d t = _mm_sub_pd(zero, _mm_mul_pd(smd, _mm_set_pd(_inverseLength2[b], _inverseLength2[a])));
+            t = _mm_min_pd(_mm_max_pd(t, zero), one);
+
+            __m128d px = _mm_add_pd(smx, _mm_mul_pd(dx, t));
+            __m128d py = _mm_add_pd(smy, _mm_mul_pd(dy, t));
+            __m128d pz = _mm_add_pd(smz, _mm_mul_pd(dz, t));
+            __m128d distance2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(px, px), _mm_mul_pd(py, py)), _mm_mul_pd(pz, pz));
+
+            int mask = _mm_movemask_pd(_mm_cmple_pd(distance2, r2));
+            if ((mask&1) && !top->reachedLimit(active[i].segment)) result.push_back(ActiveSegment(active[i].segment, a));
+            if ((mask&2) && !top->reachedLimit(active[i+1].segment)) result.push_back(ActiveSegment(active[i+1].segment, b));
+        }
+    }
+#endif
+
+    for(; i<numActive; ++i)
+    {
+        unsigned int s = active[i].slot;
+        if (top->reachedLimit(active[i].segment)) continue;
+
+        if (cull)
+        {
+            double smx = _sx[s]-cx, smy = _sy[s]-cy, smz = _sz[s]-cz;
+            double t = -(smx*_dx[s] + smy*_dy[s] + smz*_dz[s])*_inverseLength2[s];
+            t = t<0.0 ? 0.0 : (t>1.0 ? 1.0 : t);
+
+            double px = smx+_dx[s]*t, py = smy+_dy[s]*t, pz = smz+_dz[s]*t;
+            if (px*px+py*py+pz*pz > radius2) continue;
+        }
+
+        result.push_back(ActiveSegment(active[i].segment, s));
+    }
+
+    // drop segments that can only find intersections further than their nearest.
+    if (_intersectionLimit == LIMIT_NEAREST && cull)
+    {
+        ActiveSegments::iterator end = result.begin();
+        for(ActiveSegments::iterator itr = result.begin(); itr != result.end(); ++itr)
+        {
+            const Intersections& intersections = top->_intersections[itr->segment];
+            if (!intersections.empty())
+            {
+                unsigned int s = itr->slot;
+                osg::Vec3d sm(_sx[s]-cx, _sy[s]-cy, _sz[s]-cz);
+                double ratio = (sm.length() - bs._radius) * sqrt(_inverseLength2[s]);
+                if (ratio >= intersections.begin()->ratio) continue;
+            }
+            *(end++) = *itr;
+        }
+        result.erase(end, result.end());
+    }
+
+    if (result.empty()) return false;
+
+    ++(top->_activeDepth);
+    return true;
+}
+
+void MultiLineSegmentIntersector::leave()
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+    if (top->_activeDepth>0) --(top->_activeDepth);
+}
+
+void MultiLineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable)
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+
+    // intersect the active segments with LineSegmentIntersectors kept for each segment by the top intersector.
+    LineSegmentIntersector::LineSegmentIntersectorList lineSegmentIntersectors;
+    std::vector<unsigned int> segments;
+
+    const ActiveSegments& active = getActiveSegments();
+    for(ActiveSegments::const_iterator itr = active.begin(); itr != active.end(); ++itr)
+    {
+        if (top->reachedLimit(itr->segment)) continue;
+
+        osg::ref_ptr<LineSegmentIntersector>& lsi = top->_lineSegmentIntersectors[itr->segment];
+        if (!lsi) lsi = new LineSegmentIntersector(MODEL, _starts[itr->slot], _ends[itr->slot], 0, _intersectionLimit);
+        lsi->reset();
+        lsi->setStart(_starts[itr->slot]);
+        lsi->setEnd(_ends[itr->slot]);
+        lsi->setPrecisionHint(getPrecisionHint());
+
+        lineSegmentIntersectors.push_back(lsi.get());
+        segments.push_back(itr->segment);
+    }
+
+    if (lineSegmentIntersectors.empty()) return;
+
+    if (!LineSegmentIntersector::intersectBatch(iv, drawable, lineSegmentIntersectors))
+    {
+        for(LineSegmentIntersector::LineSegmentIntersectorList::iterator itr = lineSegmentIntersectors.begin();
+            itr != lineSegmentIntersectors.end();
+            ++itr)
+        {
+            (*itr)->intersect(iv, drawable);
+        }
+    }
+
+    for(unsigned int i=0; i<lineSegmentIntersectors.size(); ++i)
+    {
+        Intersections& intersections = lineSegmentIntersectors[i]->getIntersections();
+        if (!intersections.empty())
+        {
+            top->_intersections[segments[i]].insert(intersections.begin(), intersections.end());
+            intersections.clear();
+        }
+    }
+}
+
+void MultiLineSegmentIntersector::reset()
+{
+    Intersector::reset();
+
+    for(std::vector<Intersections>::iterator itr = _intersections.begin(); itr != _intersections.end(); ++itr)
+    {
+        itr->clear();
+    }
+    _activeDepth = 0;
+}
+
+bool MultiLineSegmentIntersector::containsIntersections()
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+    for(std::vector<Intersections>::const_iterator itr = top->_intersections.begin(); itr != top->_intersections.end(); ++itr)
+    {
+        if (!itr->empty()) return true;
+    }
+    return false;
+}
+
+bool MultiLineSegmentIntersector::mayIntersect(const osg::BoundingBox& bb)
+{
+    MultiLineSegmentIntersector* top = _parent ? _parent : this;
+
+    const ActiveSegments& active = getActiveSegments();
+    for(ActiveSegments::const_iterator itr = active.begin(); itr != active.end(); ++itr)
+    {
+        if (top->reachedLimit(itr->segment)) continue;
+
+        // clip the segment's ratios against the slabs of the box in turn.
+        unsigned int s = itr->slot;
+        const double start[3] = { _sx[s], _sy[s], _sz[s] };
+        const double direction[3] = { _dx[s], _dy[s], _dz[s] };
+        double r0 = 0.0, r1 = 1.0;
+        for(unsigned int axis=0; axis<3 && r0<=r1; ++axis)
+        {
+            if (direction[axis]==0.0)
+            {
+                if (start[axis]<bb._min[axis] || start[axis]>bb._max[axis]) r0 = 2.0;
+                continue;
+            }
+
+            double inverse = 1.0/direction[axis];
+            double ra = (double(bb._min[axis])-start[axis])*inverse;
+            double rb = (double(bb._max[axis])-start[axis])*inverse;
+            if (ra>rb) std::swap(ra, rb);
+            if (ra>r0) r0 = ra;
+            if (rb<r1) r1 = rb;
+        }
+
+        if (r0<=r1) return true;
+    }
+    return false;
+}
+
+void MultiLineSegmentIntersector::computeIntersections(osg::Node& node, const IntersectionVisitor& iv)
+{
+    reset();
+
+    unsigned int numSegments = getNumSegments();
+    if (numSegments==0) return;
+
+    // bounds are computed on demand, so compute them before traversing the subgraph on several threads.
+    node.getBound();
+
+    // several batches per thread, each of at least a few segments, balancing batches that find more to intersect.
+    unsigned int numBatches = std::min(4*(_numThreads+1), (numSegments+15)/16);
+    if (numBatches<=1)
+    {
+        IntersectionVisitor visitor(this);
+        copySettings(iv, visitor);
+        node.accept(visitor);
+        return;
+    }
+
+    std::vector< osg::ref_ptr<MultiLineSegmentIntersector> > batches;
+    for(unsigned int b=0; b<numBatches; ++b)
+    {
+        osg::ref_ptr<MultiLineSegmentIntersector> batch = new MultiLineSegmentIntersector(_coordinateFrame, _intersectionLimit);
+        batch->setPrecisionHint(getPrecisionHint());
+        for(unsigned int i=(numSegments*b)/numBatches; i<(numSegments*(b+1))/numBatches; ++i)
+        {
+            batch->addSegment(_starts[i], _ends[i]);
+        }
+        batches.push_back(batch);
+    }
+
+    osg::OperationQueue* operationQueue = getIntersectionThreads()->getOperationQueue(_numThreads);
+
+    // a BlockCount starts released, so needs resetting to wait for the batches to complete.
+    osg::ref_ptr<osg::RefBlockCount> block = new osg::RefBlockCount(numBatches-1);
+    block->reset();
+
+    for(unsigned int b=1; b<numBatches; ++b)
+    {
+        operationQueue->add(new BatchOperation(batches[b].get(), &node, &iv, block.get()));
+    }
+
+    // traverse the first batch on this thread, then help with any not picked up by the threads yet and wait for the rest.
+    {
+        IntersectionVisitor visitor(batches[0].get());
+        copySettings(iv, visitor);
+        node.accept(visitor);
+    }
+
+    osg::ref_ptr<osg::Operation> operation;
+    while((operation = operationQueue->getNextOperation(false)).valid())
+    {
+        (*operation)(0);
+    }
+    block->block();
+
+    for(unsigned int b=0; b<numBatches; ++b)
+    {
+        unsigned int first = (numSegments*b)/numBatches;
+        for(unsigned int i=0; i<batches[b]->getNumSegments(); ++i)
+        {
+            _intersections[first+i].swap(batches[b]->_intersections[i]);
+        }
+    }
+}
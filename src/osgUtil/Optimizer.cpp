@@ -33,8 +33,13 @@
 #include <osg/ImageStream>
 #include <osg/Timer>
 #include <osg/TexMat>
+#include <osg/OperationThread>
+#include <osg/os_utils>
 #include <osg/io_utils>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
 #include <osgUtil/TransformAttributeFunctor>
 #include <osgUtil/Tessellator>
 #include <osgUtil/Statistics>
@@ -46,14 +51,392 @@
 #include <sstream>
 
 #include <iterator>
+#include <iomanip>
+
+#if defined(__linux__)
+    #include <stdio.h>
+    #include <unistd.h>
+#endif
 
 using namespace osgUtil;
 
+namespace
+{
+
+// Applies a functor to a list of items, each caller of the operation taking the next item until all are done.
+template<class T, class F>
+class ParallelForOperation : public osg::Operation
+{
+public:
+
+    ParallelForOperation(const std::vector<T*>& items, F& functor):
+        osg::Operation("ParallelForOperation", false),
+        _items(items),
+        _functor(functor),
+        _next(0) {}
+
+    virtual void operator () (osg::Object*)
+    {
+        unsigned int i;
+        while((i = (++_next)-1) < _items.size())
+        {
+            _functor(*_items[i]);
+        }
+    }
+
+    const std::vector<T*>&  _items;
+    F&                      _functor;
+    OpenThreads::Atomic     _next;
+};
+
+class ParallelForThread : public OpenThreads::Thread
+{
+public:
+
+    ParallelForThread(osg::Operation* operation):
+        _operation(operation) {}
+
+    virtual void run() { (*_operation)(0); }
+
+    osg::ref_ptr<osg::Operation> _operation;
+};
+
+// Apply the functor to each of the items on numThreads additional threads and the calling thread, the threads
+// are only started for the duration of the call as each pass of the Optimizer runs for long enough to amortize them.
+template<class T, class F>
+void runInParallel(unsigned int numThreads, const std::vector<T*>& items, F& functor)
+{
+    if (items.empty()) return;
+
+    osg::ref_ptr< ParallelForOperation<T,F> > operation = new ParallelForOperation<T,F>(items, functor);
+
+    numThreads = osg::minimum(numThreads, static_cast<unsigned int>(items.size()-1));
+
+    std::vector<ParallelForThread*> threads;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        ParallelForThread* thread = new ParallelForThread(operation.get());
+        thread->start();
+        threads.push_back(thread);
+    }
+
+    (*operation)(0);
+
+    for(std::vector<ParallelForThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+}
+
+typedef std::set<const osg::Referenced*> SharableObjects;
+
+// collect the objects of a Geometry that a pass operating on it may modify, and so can't be shared with
+// another Geometry processed at the same time.
+void collectSharableObjects(const osg::Geometry& geometry, SharableObjects& objects)
+{
+    osg::Geometry::ArrayList arrays;
+    geometry.getArrayList(arrays);
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        objects.insert(itr->get());
+        if ((*itr)->getBufferObject()) objects.insert((*itr)->getBufferObject());
+    }
+
+    const osg::Geometry::PrimitiveSetList& primitives = geometry.getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::const_iterator itr = primitives.begin(); itr != primitives.end(); ++itr)
+    {
+        objects.insert(itr->get());
+        if ((*itr)->getBufferObject()) objects.insert((*itr)->getBufferObject());
+    }
+}
+
+// return true if a change to the children of the group can't affect nodes outside of the group, other than
+// dirtying bounds, so that the group can be modified at the same time as other independent groups.
+bool isIndependent(const osg::Group& group)
+{
+    for(unsigned int i=0; i<group.getNumChildren(); ++i)
+    {
+        const osg::Node* child = group.getChild(i);
+        if (child->getNumParents()!=1 ||
+            child->getUpdateCallback() || child->getNumChildrenRequiringUpdateTraversal()!=0 ||
+            child->getEventCallback() || child->getNumChildrenRequiringEventTraversal()!=0 ||
+            !child->isCullingActive() || child->getNumChildrenWithCullingDisabled()!=0 ||
+            child->getNumChildrenWithOccluderNodes()!=0 || dynamic_cast<const osg::OccluderNode*>(child))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Collects the Groups that the MergeGeometryVisitor would merge, in traversal order.
+class MergeGroupCollector : public osg::NodeVisitor
+{
+public:
+
+    MergeGroupCollector():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    {
+        setNodeMaskOverride(0xffffffff);
+    }
+
+    virtual void apply(osg::Group& group)
+    {
+        if (_visited.insert(&group).second) _groups.push_back(&group);
+        traverse(group);
+    }
+
+    virtual void apply(osg::Billboard&) {}
+
+    std::set<osg::Group*>       _visited;
+    std::vector<osg::Group*>    _groups;
+};
+
+struct MergeGroupFunctor
+{
+    MergeGroupFunctor(Optimizer::MergeGeometryVisitor& mgv): _mgv(mgv) {}
+
+    void operator() (osg::Group& group) { _mgv.mergeGroup(group); }
+
+    Optimizer::MergeGeometryVisitor& _mgv;
+};
+
+// Merge the Geometries of the independent Groups of the subgraph in parallel, then the remaining Groups.
+void mergeGeometryInParallel(unsigned int numThreads, osg::Node* node, Optimizer::MergeGeometryVisitor& mgv)
+{
+    MergeGroupCollector collector;
+    node->accept(collector);
+
+    std::vector<osg::Group*> independent;
+    std::vector<osg::Group*> dependent;
+    for(std::vector<osg::Group*>::iterator itr = collector._groups.begin(); itr != collector._groups.end(); ++itr)
+    {
+        if (isIndependent(**itr)) independent.push_back(*itr);
+        else dependent.push_back(*itr);
+    }
+
+    MergeGroupFunctor functor(mgv);
+    runInParallel(numThreads, independent, functor);
+
+    for(std::vector<osg::Group*>::iterator itr = dependent.begin(); itr != dependent.end(); ++itr)
+    {
+        functor(**itr);
+    }
+}
+
+// Applies a per Geometry method of one of the mesh optimizing visitors.
+template<class V>
+struct GeometryMethodFunctor : public Optimizer::GeometryFunctor
+{
+    typedef void (V::*Method)(osg::Geometry&);
+
+    GeometryMethodFunctor(V& visitor, Method method): _visitor(visitor), _method(method) {}
+
+    virtual void operator() (osg::Geometry& geometry) { (_visitor.*_method)(geometry); }
+
+    V&      _visitor;
+    Method  _method;
+};
+
+template<class V>
+void applyToCollectedGeometries(const Optimizer& optimizer, V& visitor, void (V::*method)(osg::Geometry&))
+{
+    Optimizer::GeometryList geometries(visitor.getGeometryList().begin(), visitor.getGeometryList().end());
+    GeometryMethodFunctor<V> functor(visitor, method);
+    optimizer.forEachGeometry(geometries, functor);
+}
+
+class CountNodesVisitor : public osg::NodeVisitor
+{
+public:
+
+    CountNodesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _numNodes(0)
+    {
+        setNodeMaskOverride(0xffffffff);
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        ++_numNodes;
+        traverse(node);
+    }
+
+    unsigned int _numNodes;
+};
+
+unsigned int countNodes(osg::Node* node)
+{
+    CountNodesVisitor cnv;
+    node->accept(cnv);
+    return cnv._numNodes;
+}
+
+double getResidentMemory()
+{
+#if defined(__linux__)
+    double residentMemory = 0.0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file)
+    {
+        unsigned long size = 0, resident = 0;
+        if (fscanf(file, "%lu %lu", &size, &resident)==2)
+        {
+            residentMemory = double(resident) * double(sysconf(_SC_PAGESIZE));
+        }
+        fclose(file);
+    }
+    return residentMemory;
+#else
+    return 0.0;
+#endif
+}
+
+// Records the PassReport of an optimization pass run within the lifetime of the recorder.
+class PassRecorder
+{
+public:
+
+    PassRecorder(Optimizer* optimizer, const char* name, osg::Node* node, bool parallel=false):
+        _optimizer(optimizer->getReportPasses() ? optimizer : 0),
+        _node(node),
+        _startMemory(0.0),
+        _startTick(0)
+    {
+        if (!_optimizer) return;
+
+        _report.name = name;
+        _report.numThreads = parallel ? optimizer->getNumThreads()+1 : 1;
+        _report.numNodesVisited = countNodes(_node);
+        _startMemory = getResidentMemory();
+        _startTick = osg::Timer::instance()->tick();
+    }
+
+    ~PassRecorder()
+    {
+        if (!_optimizer) return;
+
+        _report.time = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
+        _report.memoryDelta = getResidentMemory() - _startMemory;
+        _report.numNodesAfter = countNodes(_node);
+        _optimizer->getPassReports().push_back(_report);
+    }
+
+protected:
+
+    Optimizer*              _optimizer;
+    osg::Node*              _node;
+    double                  _startMemory;
+    osg::Timer_t            _startTick;
+    Optimizer::PassReport   _report;
+};
+
+}
+
+static osg::ApplicationUsageProxy Optimizer_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_NUM_THREADS <int>","Set the number of additional threads used to run the Optimizer passes that work on independent Groups and Geometries in parallel.");
+
+Optimizer::Optimizer():
+    _numThreads(0),
+    _reportPasses(false)
+{
+    osg::getEnvVar("OSG_OPTIMIZER_NUM_THREADS", _numThreads);
+}
+
 void Optimizer::reset()
 {
+    _passReports.clear();
 }
 
-static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
+void Optimizer::forEachGeometry(const GeometryList& geometries, GeometryFunctor& functor) const
+{
+    if (_numThreads==0)
+    {
+        for(GeometryList::const_iterator itr = geometries.begin(); itr != geometries.end(); ++itr)
+        {
+            functor(**itr);
+        }
+        return;
+    }
+
+    // count the Geometries using each array, PrimitiveSet and BufferObject.
+    typedef std::map<const osg::Referenced*, unsigned int> UseCountMap;
+    UseCountMap useCounts;
+    for(GeometryList::const_iterator itr = geometries.begin(); itr != geometries.end(); ++itr)
+    {
+        SharableObjects objects;
+        collectSharableObjects(**itr, objects);
+        for(SharableObjects::iterator oitr = objects.begin(); oitr != objects.end(); ++oitr)
+        {
+            ++useCounts[*oitr];
+        }
+    }
+
+    GeometryList independent;
+    GeometryList dependent;
+    for(GeometryList::const_iterator itr = geometries.begin(); itr != geometries.end(); ++itr)
+    {
+        SharableObjects objects;
+        collectSharableObjects(**itr, objects);
+
+        bool shared = false;
+        for(SharableObjects::iterator oitr = objects.begin(); oitr != objects.end() && !shared; ++oitr)
+        {
+            shared = useCounts[*oitr]>1;
+        }
+
+        if (shared) dependent.push_back(*itr);
+        else independent.push_back(*itr);
+    }
+
+    OSG_INFO<<"Optimizer::forEachGeometry() "<<independent.size()<<" Geometries in parallel, "<<dependent.size()<<" with shared data serially"<<std::endl;
+
+    runInParallel(_numThreads, independent, functor);
+
+    for(GeometryList::iterator itr = dependent.begin(); itr != dependent.end(); ++itr)
+    {
+        functor(**itr);
+    }
+}
+
+void Optimizer::writePassReports(std::ostream& out) const
+{
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out<<std::left<<std::setw(56)<<"Pass"
+       <<std::right<<std::setw(10)<<"Time (s)"
+       <<std::setw(14)<<"Memory (MB)"
+       <<std::setw(12)<<"Visited"
+       <<std::setw(12)<<"After"
+       <<std::setw(9)<<"Threads"<<std::endl;
+
+    double totalTime = 0.0;
+    double totalMemoryDelta = 0.0;
+    out<<std::fixed;
+    for(PassReportList::const_iterator itr = _passReports.begin(); itr != _passReports.end(); ++itr)
+    {
+        out<<std::left<<std::setw(56)<<itr->name
+           <<std::right<<std::setprecision(3)<<std::setw(10)<<itr->time
+           <<std::setprecision(1)<<std::setw(14)<<itr->memoryDelta/(1024.0*1024.0)
+           <<std::setw(12)<<itr->numNodesVisited
+           <<std::setw(12)<<itr->numNodesAfter
+           <<std::setw(9)<<itr->numThreads<<std::endl;
+
+        totalTime += itr->time;
+        totalMemoryDelta += itr->memoryDelta;
+    }
+
+    out<<std::left<<std::setw(56)<<"Total"
+       <<std::right<<std::setprecision(3)<<std::setw(10)<<totalTime
+       <<std::setprecision(1)<<std::setw(14)<<totalMemoryDelta/(1024.0*1024.0)<<std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | REDUCE_OVERDRAW | VERTEX_PRETRANSFORM | MESHLETS | BUFFER_OBJECT_SETTINGS");
 
 void Optimizer::optimize(osg::Node* node)
 {
@@ -127,9 +510,15 @@ void Optimizer::optimize(osg::Node* node)
         if(str.find("~VERTEX_POSTTRANSFORM")!=std::string::npos) options ^= VERTEX_POSTTRANSFORM;
         else if(str.find("VERTEX_POSTTRANSFORM")!=std::string::npos) options |= VERTEX_POSTTRANSFORM;
 
+        if(str.find("~REDUCE_OVERDRAW")!=std::string::npos) options ^= REDUCE_OVERDRAW;
+        else if(str.find("REDUCE_OVERDRAW")!=std::string::npos) options |= REDUCE_OVERDRAW;
+
         if(str.find("~VERTEX_PRETRANSFORM")!=std::string::npos) options ^= VERTEX_PRETRANSFORM;
         else if(str.find("VERTEX_PRETRANSFORM")!=std::string::npos) options |= VERTEX_PRETRANSFORM;
 
+        if(str.find("~MESHLETS")!=std::string::npos) options ^= MESHLETS;
+        else if(str.find("MESHLETS")!=std::string::npos) options |= MESHLETS;
+
         if(str.find("~BUFFER_OBJECT_SETTINGS")!=std::string::npos) options ^= BUFFER_OBJECT_SETTINGS;
         else if(str.find("BUFFER_OBJECT_SETTINGS")!=std::string::npos) options |= BUFFER_OBJECT_SETTINGS;
     }
@@ -156,6 +545,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & STATIC_OBJECT_DETECTION)
     {
+        PassRecorder recorder(this, "STATIC_OBJECT_DETECTION", node);
+
         StaticObjectDetectionVisitor sodv;
         node->accept(sodv);
     }
@@ -163,6 +554,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & TESSELLATE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing TESSELLATE_GEOMETRY"<<std::endl;
+        PassRecorder recorder(this, "TESSELLATE_GEOMETRY", node);
 
         TessellateVisitor tsv;
         node->accept(tsv);
@@ -171,6 +563,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & REMOVE_LOADED_PROXY_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_LOADED_PROXY_NODES"<<std::endl;
+        PassRecorder recorder(this, "REMOVE_LOADED_PROXY_NODES", node);
 
         RemoveLoadedProxyNodesVisitor rlpnv(this);
         node->accept(rlpnv);
@@ -181,6 +574,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & COMBINE_ADJACENT_LODS)
     {
         OSG_INFO<<"Optimizer::optimize() doing COMBINE_ADJACENT_LODS"<<std::endl;
+        PassRecorder recorder(this, "COMBINE_ADJACENT_LODS", node);
 
         CombineLODsVisitor clv(this);
         node->accept(clv);
@@ -190,6 +584,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & OPTIMIZE_TEXTURE_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing OPTIMIZE_TEXTURE_SETTINGS"<<std::endl;
+        PassRecorder recorder(this, "OPTIMIZE_TEXTURE_SETTINGS", node);
 
         TextureVisitor tv(true,true, // unref image
                           false,false, // client storage
@@ -201,6 +596,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & SHARE_DUPLICATE_STATE)
     {
         OSG_INFO<<"Optimizer::optimize() doing SHARE_DUPLICATE_STATE"<<std::endl;
+        PassRecorder recorder(this, "SHARE_DUPLICATE_STATE", node);
 
         bool combineDynamicState = false;
         bool combineStaticState = true;
@@ -214,6 +610,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & TEXTURE_ATLAS_BUILDER)
     {
         OSG_INFO<<"Optimizer::optimize() doing TEXTURE_ATLAS_BUILDER"<<std::endl;
+        PassRecorder recorder(this, "TEXTURE_ATLAS_BUILDER", node);
 
         // traverse the scene collecting textures into texture atlas.
         TextureAtlasVisitor tav(this);
@@ -233,6 +630,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & COPY_SHARED_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing COPY_SHARED_NODES"<<std::endl;
+        PassRecorder recorder(this, "COPY_SHARED_NODES", node);
 
         CopySharedSubgraphsVisitor cssv(this);
         node->accept(cssv);
@@ -242,6 +640,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & FLATTEN_STATIC_TRANSFORMS)
     {
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS"<<std::endl;
+        PassRecorder recorder(this, "FLATTEN_STATIC_TRANSFORMS", node);
 
         int i=0;
         bool result = false;
@@ -263,6 +662,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS)
     {
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS"<<std::endl;
+        PassRecorder recorder(this, "FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS", node);
 
         // now combine any adjacent static transforms.
         FlattenStaticTransformsDuplicatingSharedSubgraphsVisitor fstdssv(this);
@@ -273,6 +673,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & REMOVE_REDUNDANT_NODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_REDUNDANT_NODES"<<std::endl;
+        PassRecorder recorder(this, "REMOVE_REDUNDANT_NODES", node);
 
         RemoveEmptyNodesVisitor renv(this);
         node->accept(renv);
@@ -287,6 +688,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MERGE_GEODES)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEODES"<<std::endl;
+        PassRecorder recorder(this, "MERGE_GEODES", node);
 
         osg::Timer_t startTick = osg::Timer::instance()->tick();
 
@@ -301,6 +703,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MAKE_FAST_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MAKE_FAST_GEOMETRY"<<std::endl;
+        PassRecorder recorder(this, "MAKE_FAST_GEOMETRY", node);
 
         MakeFastGeometryVisitor mgv(this);
         node->accept(mgv);
@@ -309,12 +712,14 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & MERGE_GEOMETRY)
     {
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEOMETRY"<<std::endl;
+        PassRecorder recorder(this, "MERGE_GEOMETRY", node, _numThreads>0);
 
         osg::Timer_t startTick = osg::Timer::instance()->tick();
 
         MergeGeometryVisitor mgv(this);
         mgv.setTargetMaximumNumberOfVertices(10000);
-        node->accept(mgv);
+        if (_numThreads>0) mergeGeometryInParallel(_numThreads, node, mgv);
+        else node->accept(mgv);
 
         osg::Timer_t endTick = osg::Timer::instance()->tick();
 
@@ -324,6 +729,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & FLATTEN_BILLBOARDS)
     {
+        PassRecorder recorder(this, "FLATTEN_BILLBOARDS", node);
+
         FlattenBillboardVisitor fbv(this);
         node->accept(fbv);
         fbv.process();
@@ -332,6 +739,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & SPATIALIZE_GROUPS)
     {
         OSG_INFO<<"Optimizer::optimize() doing SPATIALIZE_GROUPS"<<std::endl;
+        PassRecorder recorder(this, "SPATIALIZE_GROUPS", node);
 
         SpatializeGroupsVisitor sv(this);
         node->accept(sv);
@@ -341,30 +749,52 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & INDEX_MESH)
     {
         OSG_INFO<<"Optimizer::optimize() doing INDEX_MESH"<<std::endl;
+        PassRecorder recorder(this, "INDEX_MESH", node, _numThreads>0);
         IndexMeshVisitor imv(this);
         node->accept(imv);
-        imv.makeMesh();
+        applyToCollectedGeometries(*this, imv, &IndexMeshVisitor::makeMesh);
     }
 
     if (options & VERTEX_POSTTRANSFORM)
     {
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_POSTTRANSFORM"<<std::endl;
+        PassRecorder recorder(this, "VERTEX_POSTTRANSFORM", node, _numThreads>0);
         VertexCacheVisitor vcv;
         node->accept(vcv);
-        vcv.optimizeVertices();
+        applyToCollectedGeometries(*this, vcv, &VertexCacheVisitor::optimizeVertices);
+    }
+
+    if (options & REDUCE_OVERDRAW)
+    {
+        OSG_INFO<<"Optimizer::optimize() doing REDUCE_OVERDRAW"<<std::endl;
+        PassRecorder recorder(this, "REDUCE_OVERDRAW", node, _numThreads>0);
+        ReduceOverdrawVisitor rov(this);
+        node->accept(rov);
+        applyToCollectedGeometries(*this, rov, &ReduceOverdrawVisitor::reduceOverdraw);
     }
 
     if (options & VERTEX_PRETRANSFORM)
     {
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_PRETRANSFORM"<<std::endl;
+        PassRecorder recorder(this, "VERTEX_PRETRANSFORM", node, _numThreads>0);
         VertexAccessOrderVisitor vaov;
         node->accept(vaov);
-        vaov.optimizeOrder();
+        applyToCollectedGeometries(*this, vaov, &VertexAccessOrderVisitor::optimizeOrder);
+    }
+
+    if (options & MESHLETS)
+    {
+        OSG_INFO<<"Optimizer::optimize() doing MESHLETS"<<std::endl;
+        PassRecorder recorder(this, "MESHLETS", node);
+        MeshletVisitor mv(this);
+        node->accept(mv);
+        mv.buildMeshlets();
     }
 
     if (options & BUFFER_OBJECT_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
+        PassRecorder recorder(this, "BUFFER_OBJECT_SETTINGS", node);
         BufferObjectVisitor bov(true, true, true, true, true, false);
         node->accept(bov);
     }
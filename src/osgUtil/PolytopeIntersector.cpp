@@ -536,6 +536,12 @@ bool PolytopeIntersector::enter(const osg::Node& node)
     return !node.isCullingActive() || _polytope.contains( node.getBound() );
 }
 
+bool PolytopeIntersector::mayIntersect(const osg::BoundingBox& bb)
+{
+    if (reachedLimit()) return false;
+    return _polytope.contains(bb);
+}
+
 
 void PolytopeIntersector::leave()
 {
@@ -0,0 +1,860 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/QuadricSimplifier>
+#include <osgUtil/MeshOptimizers>
+
+#include <osg/TriangleIndexFunctor>
+#include <osg/Notify>
+#include <osg/Timer>
+#include <osg/BoundingBox>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <vector>
+#include <float.h>
+
+using namespace osgUtil;
+
+namespace
+{
+
+typedef std::vector<unsigned int> IndexList;
+
+const unsigned int invalidIndex = 0xffffffffu;
+
+struct TriangleCollectOperator
+{
+    IndexList* indices;
+
+    TriangleCollectOperator(): indices(0) {}
+
+    inline void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1==p2 || p2==p3 || p1==p3) return;
+        indices->push_back(p1);
+        indices->push_back(p2);
+        indices->push_back(p3);
+    }
+};
+
+typedef osg::TriangleIndexFunctor<TriangleCollectOperator> TriangleCollector;
+
+// A symmetric 4x4 matrix summing the squared distances from a set of weighted planes, along with the total weight
+// of the planes so that the error of a position can be given as a mean squared distance.
+struct Quadric
+{
+    double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33, w;
+
+    Quadric(): a00(0.0), a01(0.0), a02(0.0), a03(0.0), a11(0.0), a12(0.0), a13(0.0), a22(0.0), a23(0.0), a33(0.0), w(0.0) {}
+
+    void addPlane(const osg::Vec3d& n, double d, double weight)
+    {
+        a00 += weight*n.x()*n.x(); a01 += weight*n.x()*n.y(); a02 += weight*n.x()*n.z(); a03 += weight*n.x()*d;
+        a11 += weight*n.y()*n.y(); a12 += weight*n.y()*n.z(); a13 += weight*n.y()*d;
+        a22 += weight*n.z()*n.z(); a23 += weight*n.z()*d;
+        a33 += weight*d*d;
+        w += weight;
+    }
+
+    void add(const Quadric& q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+        a11 += q.a11; a12 += q.a12; a13 += q.a13;
+        a22 += q.a22; a23 += q.a23;
+        a33 += q.a33;
+        w += q.w;
+    }
+
+    double evaluate(const osg::Vec3d& p) const
+    {
+        double x = p.x(), y = p.y(), z = p.z();
+        return x*(a00*x + 2.0*(a01*y + a02*z + a03)) +
+               y*(a11*y + 2.0*(a12*z + a13)) +
+               z*(a22*z + 2.0*a23) +
+               a33;
+    }
+};
+
+// the combined error of two quadrics at a position, as a mean squared distance.
+inline double collapseError(const Quadric& q1, const Quadric& q2, const osg::Vec3d& p)
+{
+    double weight = q1.w + q2.w;
+    double error = q1.evaluate(p) + q2.evaluate(p);
+    return (weight>0.0 && error>0.0) ? error/weight : 0.0;
+}
+
+enum VertexKind
+{
+    MANIFOLD,   // interior vertex with a single set of attributes, collapsed along any edge
+    BORDER,     // on an open border, collapsed along the border only
+    SEAM,       // on an attribute seam with two sets of attributes, collapsed along the seam only
+    LOCKED      // corners, non manifold and vertices shared between regions being simplified in parallel
+};
+
+// weight of the planes perpendicular to border and seam edges, relative to the planes of the triangles, so that
+// collapses moving a border or seam cost more than those within a surface.
+const double edgeWeight = 10.0;
+
+// A triangle mesh in flat arrays. Vertices of the Geometry, the wedges, are grouped by position, the triangles of each
+// position being found through a linked list of the corners of the triangles, the list of a position collapsed being
+// appended to that of the position it collapsed onto.
+struct Mesh
+{
+    std::vector<osg::Vec3d>     positions;
+    IndexList                   wedgePositions;     // position of each vertex of the Geometry
+    IndexList                   indices;            // vertex of each corner, three per triangle
+    std::vector<unsigned char>  triangleAlive;
+
+    IndexList                   firstCorner;        // per position
+    IndexList                   lastCorner;         // per position
+    IndexList                   nextCorner;         // per corner
+
+    std::vector<Quadric>        quadrics;           // per position
+    std::vector<unsigned char>  kinds;              // per position
+    std::vector<unsigned char>  removed;            // per position
+    IndexList                   stamps;             // per position, invalidating collapses queued before changes
+    std::vector<unsigned char>  queued;             // per position, set while a valid collapse is queued
+    IndexList                   regions;            // per position, invalidIndex when shared between regions
+
+    inline unsigned int position(unsigned int corner) const { return wedgePositions[indices[corner]]; }
+
+    void build(const osg::Vec3Array& vertices, const IndexList& triangles, bool weldSeams, bool lockBorders);
+
+    // append the positions adjacent to p in live triangles, unsorted and possibly repeated.
+    void getNeighbours(unsigned int p, IndexList& neighbours) const
+    {
+        for(unsigned int c=firstCorner[p]; c!=invalidIndex; c=nextCorner[c])
+        {
+            unsigned int t = c/3;
+            if (!triangleAlive[t]) continue;
+            unsigned int base = t*3;
+            for(unsigned int i=0; i<3; ++i)
+            {
+                unsigned int other = position(base+i);
+                if (other!=p) neighbours.push_back(other);
+            }
+        }
+    }
+
+    // drop the corners of dead triangles from the list of p.
+    void compactCorners(unsigned int p)
+    {
+        unsigned int first = invalidIndex, last = invalidIndex;
+        for(unsigned int c=firstCorner[p]; c!=invalidIndex; c=nextCorner[c])
+        {
+            if (!triangleAlive[c/3]) continue;
+            if (last==invalidIndex) first = c;
+            else nextCorner[last] = c;
+            last = c;
+        }
+        if (last!=invalidIndex) nextCorner[last] = invalidIndex;
+        firstCorner[p] = first;
+        lastCorner[p] = last;
+    }
+
+    bool canCollapse(unsigned int from, unsigned int to, IndexList& scratch) const;
+
+    // collapse from onto to, returning the number of triangles removed.
+    unsigned int collapse(unsigned int from, unsigned int to);
+};
+
+struct PositionLess
+{
+    const osg::Vec3Array& vertices;
+    PositionLess(const osg::Vec3Array& v): vertices(v) {}
+    bool operator()(unsigned int lhs, unsigned int rhs) const { return vertices[lhs]<vertices[rhs]; }
+};
+
+struct HalfEdge
+{
+    unsigned int p0, p1;    // positions, p0<p1
+    unsigned int w0, w1;    // vertices at p0 and p1
+    unsigned int triangle;
+
+    bool operator<(const HalfEdge& rhs) const
+    {
+        if (p0<rhs.p0) return true;
+        if (rhs.p0<p0) return false;
+        return p1<rhs.p1;
+    }
+};
+
+void Mesh::build(const osg::Vec3Array& vertices, const IndexList& triangles, bool weldSeams, bool lockBorders)
+{
+    // group the vertices by position.
+    unsigned int numVertices = vertices.size();
+    IndexList order(numVertices);
+    for(unsigned int i=0; i<numVertices; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), PositionLess(vertices));
+
+    wedgePositions.resize(numVertices);
+    IndexList firstWedge;
+    for(unsigned int i=0; i<numVertices; ++i)
+    {
+        if (i==0 || vertices[order[i-1]]<vertices[order[i]])
+        {
+            positions.push_back(osg::Vec3d(vertices[order[i]]));
+            firstWedge.push_back(order[i]);
+        }
+        wedgePositions[order[i]] = positions.size()-1;
+    }
+
+    indices = triangles;
+    if (weldSeams)
+    {
+        for(IndexList::iterator itr = indices.begin(); itr != indices.end(); ++itr) *itr = firstWedge[wedgePositions[*itr]];
+    }
+
+    unsigned int numPositions = positions.size();
+    unsigned int numTriangles = indices.size()/3;
+    triangleAlive.assign(numTriangles, 1);
+
+    // drop triangles made degenerate by grouping the vertices.
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        unsigned int p0 = position(t*3), p1 = position(t*3+1), p2 = position(t*3+2);
+        if (p0==p1 || p1==p2 || p0==p2) triangleAlive[t] = 0;
+    }
+
+    firstCorner.assign(numPositions, invalidIndex);
+    lastCorner.assign(numPositions, invalidIndex);
+    nextCorner.assign(indices.size(), invalidIndex);
+    for(unsigned int c=0; c<indices.size(); ++c)
+    {
+        if (!triangleAlive[c/3]) continue;
+        unsigned int p = position(c);
+        if (lastCorner[p]==invalidIndex) firstCorner[p] = c;
+        else nextCorner[lastCorner[p]] = c;
+        lastCorner[p] = c;
+    }
+
+    // classify the edges as interior, border, seam or non manifold.
+    std::vector<HalfEdge> halfEdges;
+    halfEdges.reserve(indices.size());
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        if (!triangleAlive[t]) continue;
+        for(unsigned int i=0; i<3; ++i)
+        {
+            unsigned int wa = indices[t*3+i], wb = indices[t*3+(i+1)%3];
+            HalfEdge edge;
+            edge.triangle = t;
+            if (wedgePositions[wa]<wedgePositions[wb]) { edge.p0 = wedgePositions[wa]; edge.w0 = wa; edge.p1 = wedgePositions[wb]; edge.w1 = wb; }
+            else { edge.p0 = wedgePositions[wb]; edge.w0 = wb; edge.p1 = wedgePositions[wa]; edge.w1 = wa; }
+            halfEdges.push_back(edge);
+        }
+    }
+    std::sort(halfEdges.begin(), halfEdges.end());
+
+    quadrics.assign(numPositions, Quadric());
+    std::vector<unsigned char> numBorderEdges(numPositions, 0), numSeamEdges(numPositions, 0), numWedges(numPositions, 0), nonManifold(numPositions, 0);
+
+    for(unsigned int i=0; i<halfEdges.size(); )
+    {
+        unsigned int end = i+1;
+        while(end<halfEdges.size() && !(halfEdges[i]<halfEdges[end])) ++end;
+
+        const HalfEdge& edge = halfEdges[i];
+        bool border = (end-i)==1;
+        bool seam = (end-i)==2 && (halfEdges[i].w0!=halfEdges[i+1].w0 || halfEdges[i].w1!=halfEdges[i+1].w1);
+        if (end-i>2)
+        {
+            nonManifold[edge.p0] = nonManifold[edge.p1] = 1;
+        }
+        else if (border || seam)
+        {
+            unsigned char& b0 = border ? numBorderEdges[edge.p0] : numSeamEdges[edge.p0];
+            unsigned char& b1 = border ? numBorderEdges[edge.p1] : numSeamEdges[edge.p1];
+            if (b0<255) ++b0;
+            if (b1<255) ++b1;
+
+            // a plane through the edge perpendicular to the triangle, resisting collapses that move the edge.
+            const osg::Vec3d& v0 = positions[edge.p0];
+            const osg::Vec3d& v1 = positions[edge.p1];
+            unsigned int t = edge.triangle;
+            osg::Vec3d normal = (positions[position(t*3+1)]-positions[position(t*3)])^(positions[position(t*3+2)]-positions[position(t*3)]);
+            osg::Vec3d direction = v1-v0;
+            osg::Vec3d perpendicular = normal^direction;
+            if (perpendicular.normalize()>0.0)
+            {
+                double weight = direction.length2()*edgeWeight;
+                double d = -(perpendicular*v0);
+                quadrics[edge.p0].addPlane(perpendicular, d, weight);
+                quadrics[edge.p1].addPlane(perpendicular, d, weight);
+            }
+        }
+        i = end;
+    }
+
+    // count the vertices in use at each position.
+    std::vector<unsigned char> used(numVertices, 0);
+    for(unsigned int c=0; c<indices.size(); ++c)
+    {
+        if (!triangleAlive[c/3] || used[indices[c]]) continue;
+        used[indices[c]] = 1;
+        unsigned char& count = numWedges[wedgePositions[indices[c]]];
+        if (count<255) ++count;
+    }
+
+    kinds.assign(numPositions, LOCKED);
+    for(unsigned int p=0; p<numPositions; ++p)
+    {
+        if (nonManifold[p] || numWedges[p]==0) continue;
+        if (numWedges[p]==1 && numBorderEdges[p]==0 && numSeamEdges[p]==0) kinds[p] = MANIFOLD;
+        else if (numWedges[p]==1 && numBorderEdges[p]==2 && numSeamEdges[p]==0) kinds[p] = lockBorders ? LOCKED : BORDER;
+        else if (numWedges[p]==2 && numBorderEdges[p]==0 && numSeamEdges[p]==2) kinds[p] = SEAM;
+    }
+
+    // the planes of the triangles, weighted by area.
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        if (!triangleAlive[t]) continue;
+        unsigned int p0 = position(t*3), p1 = position(t*3+1), p2 = position(t*3+2);
+        osg::Vec3d normal = (positions[p1]-positions[p0])^(positions[p2]-positions[p0]);
+        double area = normal.normalize()*0.5;
+        if (area<=0.0) continue;
+        double d = -(normal*positions[p0]);
+        quadrics[p0].addPlane(normal, d, area);
+        quadrics[p1].addPlane(normal, d, area);
+        quadrics[p2].addPlane(normal, d, area);
+    }
+
+    removed.assign(numPositions, 0);
+    stamps.assign(numPositions, 0);
+    queued.assign(numPositions, 0);
+}
+
+bool Mesh::canCollapse(unsigned int from, unsigned int to, IndexList& scratch) const
+{
+    unsigned char kind = kinds[from];
+    if (kind==LOCKED) return false;
+    if (kind==BORDER && kinds[to]!=BORDER && kinds[to]!=LOCKED) return false;
+    if (kind==SEAM && kinds[to]!=SEAM && kinds[to]!=LOCKED) return false;
+
+    // map each vertex at from to the vertex at to in a triangle sharing the edge, and check the triangles left
+    // around from don't flip over.
+    unsigned int wedges[2] = { invalidIndex, invalidIndex };
+    unsigned int mapped[2] = { invalidIndex, invalidIndex };
+    unsigned int numShared = 0;
+    const osg::Vec3d& target = positions[to];
+    for(unsigned int c=firstCorner[from]; c!=invalidIndex; c=nextCorner[c])
+    {
+        unsigned int t = c/3;
+        if (!triangleAlive[t]) continue;
+
+        unsigned int wedge = indices[c];
+        unsigned int w = (wedges[0]==invalidIndex || wedges[0]==wedge) ? 0 : 1;
+        if (w==1 && wedges[1]!=invalidIndex && wedges[1]!=wedge) return false;
+        wedges[w] = wedge;
+
+        unsigned int c1 = t*3+(c%3+1)%3, c2 = t*3+(c%3+2)%3;
+        unsigned int p1 = position(c1), p2 = position(c2);
+        if (p1==to || p2==to)
+        {
+            unsigned int toWedge = indices[p1==to ? c1 : c2];
+            if (mapped[w]!=invalidIndex && mapped[w]!=toWedge) return false;
+            mapped[w] = toWedge;
+            ++numShared;
+        }
+        else
+        {
+            const osg::Vec3d& v1 = positions[p1];
+            const osg::Vec3d& v2 = positions[p2];
+            osg::Vec3d before = (v1-positions[from])^(v2-positions[from]);
+            osg::Vec3d after = (v1-target)^(v2-target);
+            double product = before*after;
+            if (product<=0.0 || product*product<0.0625*before.length2()*after.length2()) return false;
+        }
+    }
+
+    if (mapped[0]==invalidIndex) return false;
+    if (kind==BORDER && numShared!=1) return false;
+    if (kind==SEAM && (numShared!=2 || mapped[1]==invalidIndex || mapped[0]==mapped[1])) return false;
+    if (kind==MANIFOLD && numShared!=2) return false;
+
+    // the link condition, the only positions adjacent to both being those of the triangles sharing the edge,
+    // so the collapse doesn't join separate sheets of the surface.
+    scratch.clear();
+    getNeighbours(from, scratch);
+    std::sort(scratch.begin(), scratch.end());
+    scratch.erase(std::unique(scratch.begin(), scratch.end()), scratch.end());
+    unsigned int numFromNeighbours = scratch.size();
+    scratch.resize(numFromNeighbours*2, 0);
+
+    unsigned int numCommon = 0;
+    for(unsigned int c=firstCorner[to]; c!=invalidIndex; c=nextCorner[c])
+    {
+        unsigned int t = c/3;
+        if (!triangleAlive[t]) continue;
+        for(unsigned int i=1; i<3; ++i)
+        {
+            unsigned int other = position(t*3+(c%3+i)%3);
+            IndexList::iterator itr = std::lower_bound(scratch.begin(), scratch.begin()+numFromNeighbours, other);
+            if (itr==scratch.begin()+numFromNeighbours || *itr!=other) continue;
+
+            // count each common neighbour once, flagging those found after the sorted neighbours of from.
+            unsigned int& found = scratch[numFromNeighbours+(itr-scratch.begin())];
+            if (!found) { found = 1; ++numCommon; }
+        }
+    }
+    return numCommon==numShared;
+}
+
+unsigned int Mesh::collapse(unsigned int from, unsigned int to)
+{
+    unsigned int numRemoved = 0;
+    unsigned int wedges[2] = { invalidIndex, invalidIndex };
+    unsigned int mapped[2] = { invalidIndex, invalidIndex };
+
+    // find the vertices at to replacing those at from, as checked by canCollapse().
+    for(unsigned int c=firstCorner[from]; c!=invalidIndex; c=nextCorner[c])
+    {
+        unsigned int t = c/3;
+        if (!triangleAlive[t]) continue;
+        unsigned int c1 = t*3+(c%3+1)%3, c2 = t*3+(c%3+2)%3;
+        if (position(c1)!=to && position(c2)!=to) continue;
+        unsigned int w = (wedges[0]==invalidIndex || wedges[0]==indices[c]) ? 0 : 1;
+        wedges[w] = indices[c];
+        mapped[w] = indices[position(c1)==to ? c1 : c2];
+    }
+
+    for(unsigned int c=firstCorner[from]; c!=invalidIndex; c=nextCorner[c])
+    {
+        unsigned int t = c/3;
+        if (!triangleAlive[t]) continue;
+        unsigned int c1 = t*3+(c%3+1)%3, c2 = t*3+(c%3+2)%3;
+        if (position(c1)==to || position(c2)==to)
+        {
+            triangleAlive[t] = 0;
+            ++numRemoved;
+        }
+        else
+        {
+            indices[c] = (indices[c]==wedges[1]) ? mapped[1] : mapped[0];
+        }
+    }
+
+    if (firstCorner[from]!=invalidIndex)
+    {
+        if (lastCorner[to]==invalidIndex) firstCorner[to] = firstCorner[from];
+        else nextCorner[lastCorner[to]] = firstCorner[from];
+        lastCorner[to] = lastCorner[from];
+    }
+    firstCorner[from] = lastCorner[from] = invalidIndex;
+    compactCorners(to);
+
+    quadrics[to].add(quadrics[from]);
+    removed[from] = 1;
+    return numRemoved;
+}
+
+struct Collapse
+{
+    double          error;
+    unsigned int    from;
+    unsigned int    to;
+    unsigned int    stamp;
+
+    // ordered for a heap with the smallest error on top.
+    bool operator<(const Collapse& rhs) const { return error>rhs.error; }
+};
+
+// Simplifies the positions of a region of the mesh, or the whole mesh when region is invalidIndex. Positions outside the
+// region, or shared with other regions, are neither collapsed nor collapsed onto, so that regions may be simplified in
+// parallel.
+class RegionSimplifier
+{
+public:
+    RegionSimplifier(Mesh& mesh, unsigned int region, double maximumErrorSquared):
+        _mesh(mesh),
+        _region(region),
+        _maximumErrorSquared(maximumErrorSquared) {}
+
+    // returns the number of triangles removed.
+    unsigned int simplify(const IndexList& positions, unsigned int numTriangles, unsigned int targetNumTriangles)
+    {
+        _heap.clear();
+        for(IndexList::const_iterator itr = positions.begin(); itr != positions.end(); ++itr)
+        {
+            queueBestCollapse(*itr);
+        }
+
+        unsigned int numRemoved = 0;
+        while(!_heap.empty() && numTriangles-numRemoved>targetNumTriangles)
+        {
+            std::pop_heap(_heap.begin(), _heap.end());
+            Collapse collapse = _heap.back();
+            _heap.pop_back();
+
+            if (_mesh.removed[collapse.from] || _mesh.stamps[collapse.from]!=collapse.stamp) continue;
+            _mesh.queued[collapse.from] = 0;
+
+            // collapses are updated lazily, their errors rising as the quadrics they collapse onto are merged.
+            if (_mesh.removed[collapse.to])
+            {
+                queueBestCollapse(collapse.from);
+                continue;
+            }
+
+            double error = collapseError(_mesh.quadrics[collapse.from], _mesh.quadrics[collapse.to], _mesh.positions[collapse.to]);
+            if (error>collapse.error)
+            {
+                collapse.error = error;
+                push(collapse);
+                continue;
+            }
+
+            if (collapse.error>_maximumErrorSquared) break;
+
+            if (!_mesh.canCollapse(collapse.from, collapse.to, _scratch))
+            {
+                queueBestCollapse(collapse.from);
+                continue;
+            }
+
+            numRemoved += _mesh.collapse(collapse.from, collapse.to);
+
+            // queue the position collapsed onto, and its neighbours left without a valid collapse before.
+            _updated.clear();
+            _mesh.getNeighbours(collapse.to, _updated);
+            for(IndexList::iterator itr = _updated.begin(); itr != _updated.end(); ++itr)
+            {
+                if (!_mesh.queued[*itr] && inRegion(*itr)) queueBestCollapse(*itr);
+            }
+            if (inRegion(collapse.to)) queueBestCollapse(collapse.to);
+        }
+        return numRemoved;
+    }
+
+protected:
+
+    inline bool inRegion(unsigned int p) const
+    {
+        return _region==invalidIndex || _mesh.regions[p]==_region;
+    }
+
+    void push(const Collapse& collapse)
+    {
+        _heap.push_back(collapse);
+        std::push_heap(_heap.begin(), _heap.end());
+        _mesh.queued[collapse.from] = 1;
+    }
+
+    // queue the collapse of from with the smallest error, replacing any already queued.
+    void queueBestCollapse(unsigned int from)
+    {
+        ++_mesh.stamps[from];
+        _mesh.queued[from] = 0;
+        if (_mesh.removed[from] || _mesh.kinds[from]==LOCKED) return;
+
+        _neighbours.clear();
+        _mesh.getNeighbours(from, _neighbours);
+        std::sort(_neighbours.begin(), _neighbours.end());
+        _neighbours.erase(std::unique(_neighbours.begin(), _neighbours.end()), _neighbours.end());
+
+        // check the candidates in order of error, as most collapses are valid.
+        _candidates.clear();
+        for(IndexList::iterator itr = _neighbours.begin(); itr != _neighbours.end(); ++itr)
+        {
+            if (!inRegion(*itr)) continue;
+            double error = collapseError(_mesh.quadrics[from], _mesh.quadrics[*itr], _mesh.positions[*itr]);
+            if (error<=_maximumErrorSquared) _candidates.push_back(Candidate(error, *itr));
+        }
+        std::sort(_candidates.begin(), _candidates.end());
+
+        for(CandidateList::iterator itr = _candidates.begin(); itr != _candidates.end(); ++itr)
+        {
+            if (_mesh.canCollapse(from, itr->second, _scratch))
+            {
+                Collapse collapse;
+                collapse.error = itr->first;
+                collapse.from = from;
+                collapse.to = itr->second;
+                collapse.stamp = _mesh.stamps[from];
+                push(collapse);
+                return;
+            }
+        }
+    }
+
+    typedef std::pair<double, unsigned int> Candidate;
+    typedef std::vector<Candidate> CandidateList;
+
+    Mesh&                   _mesh;
+    unsigned int            _region;
+    double                  _maximumErrorSquared;
+    std::vector<Collapse>   _heap;
+    CandidateList           _candidates;
+    IndexList               _neighbours;
+    IndexList               _updated;
+    IndexList               _scratch;
+};
+
+struct Region
+{
+    IndexList       positions;
+    unsigned int    numTriangles;
+    unsigned int    targetNumTriangles;
+    unsigned int    numRemoved;
+
+    Region(): numTriangles(0), targetNumTriangles(0), numRemoved(0) {}
+};
+
+struct CentroidLess
+{
+    const std::vector<osg::Vec3d>& centroids;
+    unsigned int axis;
+    CentroidLess(const std::vector<osg::Vec3d>& c, unsigned int a): centroids(c), axis(a) {}
+    bool operator()(unsigned int lhs, unsigned int rhs) const { return centroids[lhs][axis]<centroids[rhs][axis]; }
+};
+
+// split the triangles at the median of their centroids along the longest axis of their bounds, recursively.
+void partition(const std::vector<osg::Vec3d>& centroids, IndexList::iterator begin, IndexList::iterator end,
+               unsigned int firstRegion, unsigned int numRegions, IndexList& triangleRegions)
+{
+    if (numRegions<=1 || end-begin<2)
+    {
+        for(IndexList::iterator itr = begin; itr != end; ++itr) triangleRegions[*itr] = firstRegion;
+        return;
+    }
+
+    osg::BoundingBoxd bb;
+    for(IndexList::iterator itr = begin; itr != end; ++itr) bb.expandBy(centroids[*itr]);
+    osg::Vec3d size = bb._max-bb._min;
+    unsigned int axis = (size.x()>=size.y() && size.x()>=size.z()) ? 0 : (size.y()>=size.z() ? 1 : 2);
+
+    IndexList::iterator middle = begin+(end-begin)/2;
+    std::nth_element(begin, middle, end, CentroidLess(centroids, axis));
+
+    unsigned int numLower = numRegions/2;
+    partition(centroids, begin, middle, firstRegion, numLower, triangleRegions);
+    partition(centroids, middle, end, firstRegion+numLower, numRegions-numLower, triangleRegions);
+}
+
+struct RegionOperation
+{
+    Mesh&                       mesh;
+    std::vector<Region>&        regions;
+    double                      maximumErrorSquared;
+    OpenThreads::Atomic         next;
+
+    RegionOperation(Mesh& m, std::vector<Region>& r, double e): mesh(m), regions(r), maximumErrorSquared(e) {}
+
+    void run()
+    {
+        unsigned int i;
+        while((i = (++next)-1) < regions.size())
+        {
+            Region& region = regions[i];
+            RegionSimplifier simplifier(mesh, i, maximumErrorSquared);
+            region.numRemoved = simplifier.simplify(region.positions, region.numTriangles, region.targetNumTriangles);
+        }
+    }
+};
+
+class RegionThread : public OpenThreads::Thread
+{
+public:
+    RegionThread(RegionOperation& operation): _operation(operation) {}
+    virtual void run() { _operation.run(); }
+protected:
+    RegionOperation& _operation;
+};
+
+// simplify regions of the mesh in parallel, returning the number of triangles removed. The positions shared between
+// regions are left for the final pass over the whole mesh.
+unsigned int simplifyRegions(Mesh& mesh, unsigned int numThreads, double sampleRatio, double maximumErrorSquared)
+{
+    unsigned int numTriangles = mesh.triangleAlive.size();
+    std::vector<osg::Vec3d> centroids(numTriangles);
+    IndexList liveTriangles;
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        if (!mesh.triangleAlive[t]) continue;
+        centroids[t] = (mesh.positions[mesh.position(t*3)]+mesh.positions[mesh.position(t*3+1)]+mesh.positions[mesh.position(t*3+2)])/3.0;
+        liveTriangles.push_back(t);
+    }
+
+    // a couple of regions per thread, balancing regions that simplify at different rates.
+    unsigned int numRegions = 2*(numThreads+1);
+    IndexList triangleRegions(numTriangles, invalidIndex);
+    partition(centroids, liveTriangles.begin(), liveTriangles.end(), 0, numRegions, triangleRegions);
+
+    std::vector<Region> regions(numRegions);
+    for(IndexList::iterator itr = liveTriangles.begin(); itr != liveTriangles.end(); ++itr) ++regions[triangleRegions[*itr]].numTriangles;
+
+    mesh.regions.assign(mesh.positions.size(), invalidIndex);
+    for(unsigned int p=0; p<mesh.positions.size(); ++p)
+    {
+        unsigned int region = invalidIndex;
+        for(unsigned int c=mesh.firstCorner[p]; c!=invalidIndex; c=mesh.nextCorner[c])
+        {
+            unsigned int triangleRegion = triangleRegions[c/3];
+            if (region==invalidIndex) region = triangleRegion;
+            else if (region!=triangleRegion) { region = invalidIndex; break; }
+        }
+        mesh.regions[p] = region;
+        if (region!=invalidIndex) regions[region].positions.push_back(p);
+    }
+
+    for(std::vector<Region>::iterator itr = regions.begin(); itr != regions.end(); ++itr)
+    {
+        itr->targetNumTriangles = static_cast<unsigned int>(double(itr->numTriangles)*sampleRatio);
+    }
+
+    RegionOperation operation(mesh, regions, maximumErrorSquared);
+    std::vector<RegionThread*> threads;
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        threads.push_back(new RegionThread(operation));
+        threads.back()->start();
+    }
+
+    operation.run();
+
+    for(std::vector<RegionThread*>::iterator itr = threads.begin(); itr != threads.end(); ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+
+    unsigned int numRemoved = 0;
+    for(std::vector<Region>::iterator itr = regions.begin(); itr != regions.end(); ++itr) numRemoved += itr->numRemoved;
+    return numRemoved;
+}
+
+bool isPolygonMode(GLenum mode)
+{
+    switch(mode)
+    {
+        case(GL_TRIANGLES):
+        case(GL_TRIANGLE_STRIP):
+        case(GL_TRIANGLE_FAN):
+        case(GL_QUADS):
+        case(GL_QUAD_STRIP):
+        case(GL_POLYGON):
+            return true;
+        default:
+            return false;
+    }
+}
+
+}
+
+// regions are only simplified in parallel when each has enough triangles to outweigh the final pass over their borders.
+static const unsigned int minimumNumTrianglesPerRegion = 4096;
+
+QuadricSimplifier::QuadricSimplifier(double sampleRatio, double maximumError):
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _sampleRatio(sampleRatio),
+    _maximumError(maximumError),
+    _preserveSeams(true),
+    _lockBorders(false),
+    _numThreads(0)
+{
+}
+
+bool QuadricSimplifier::simplify(osg::Geometry& geometry)
+{
+    if (_sampleRatio>=1.0f && _maximumError>=FLT_MAX) return false;
+
+    osg::Vec3Array* vertices = dynamic_cast<osg::Vec3Array*>(geometry.getVertexArray());
+    if (!vertices || vertices->empty())
+    {
+        OSG_INFO<<"QuadricSimplifier::simplify() only simplifies Geometry with an osg::Vec3Array of vertices."<<std::endl;
+        return false;
+    }
+
+    // the polygon PrimitiveSets are replaced, so arrays bound to them can't be kept.
+    osg::Geometry::ArrayList arrays;
+    geometry.getArrayList(arrays);
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin(); itr != arrays.end(); ++itr)
+    {
+        if ((*itr)->getBinding()==osg::Array::BIND_PER_PRIMITIVE_SET) return false;
+    }
+
+    TriangleCollector collector;
+    IndexList triangles;
+    collector.indices = &triangles;
+    osg::Geometry::PrimitiveSetList keptPrimitiveSets;
+    osg::Geometry::PrimitiveSetList& primitiveSets = geometry.getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::iterator itr = primitiveSets.begin(); itr != primitiveSets.end(); ++itr)
+    {
+        osg::PrimitiveSet* primitiveSet = itr->get();
+        if (primitiveSet->getNumInstances()>0) return false;
+        if (isPolygonMode(primitiveSet->getMode())) primitiveSet->accept(collector);
+        else keptPrimitiveSets.push_back(primitiveSet);
+    }
+
+    unsigned int numTriangles = triangles.size()/3;
+    if (numTriangles==0) return false;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    Mesh mesh;
+    mesh.build(*vertices, triangles, !_preserveSeams, _lockBorders);
+
+    unsigned int numLive = 0;
+    for(unsigned int t=0; t<numTriangles; ++t) numLive += mesh.triangleAlive[t];
+
+    double ratio = osg::clampBetween(double(_sampleRatio), 0.0, 1.0);
+    unsigned int targetNumTriangles = static_cast<unsigned int>(double(numTriangles)*ratio);
+    double maximumErrorSquared = (_maximumError>=FLT_MAX) ? DBL_MAX : double(_maximumError)*double(_maximumError);
+
+    if (_numThreads>0 && numLive/(2*(_numThreads+1))>=minimumNumTrianglesPerRegion)
+    {
+        numLive -= simplifyRegions(mesh, _numThreads, ratio, maximumErrorSquared);
+    }
+
+    if (numLive>targetNumTriangles)
+    {
+        IndexList positions;
+        positions.reserve(mesh.positions.size());
+        for(unsigned int p=0; p<mesh.positions.size(); ++p)
+        {
+            if (!mesh.removed[p]) positions.push_back(p);
+        }
+
+        RegionSimplifier simplifier(mesh, invalidIndex, maximumErrorSquared);
+        numLive -= simplifier.simplify(positions, numLive, targetNumTriangles);
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+    elements->reserve(numLive*3);
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        if (!mesh.triangleAlive[t]) continue;
+        elements->push_back(mesh.indices[t*3]);
+        elements->push_back(mesh.indices[t*3+1]);
+        elements->push_back(mesh.indices[t*3+2]);
+    }
+
+    primitiveSets.clear();
+    primitiveSets.push_back(elements.get());
+    primitiveSets.insert(primitiveSets.end(), keptPrimitiveSets.begin(), keptPrimitiveSets.end());
+
+    // remove the vertices no longer used, when all the PrimitiveSets are indexed.
+    VertexAccessOrderVisitor vaov;
+    vaov.optimizeOrder(geometry);
+
+    geometry.dirtyGLObjects();
+    geometry.dirtyBound();
+
+    OSG_INFO<<"QuadricSimplifier::simplify() "<<numTriangles<<" triangles to "<<numLive<<" in "
+            <<osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick())<<"ms"<<std::endl;
+
+    return true;
+}
@@ -22,6 +22,7 @@
 #include <osg/AlphaFunc>
 
 #include <algorithm>
+#include <typeinfo>
 
 using namespace osg;
 using namespace osgUtil;
@@ -113,7 +114,7 @@ void RenderBin::removeRenderBinPrototype(RenderBin* proto)
 
 static bool s_defaultBinSortModeInitialized = false;
 static RenderBin::SortMode s_defaultBinSortMode = RenderBin::SORT_BY_STATE;
-static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT");
+static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT | TRAVERSAL_ORDER | SORT_BY_PROGRAM_TEXTURE_THEN_FRONT_TO_BACK | SORT_BY_STATE_COST");
 
 void RenderBin::setDefaultRenderBinSortMode(RenderBin::SortMode mode)
 {
@@ -136,6 +137,8 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
             else if (strcmp(str,"SORT_FRONT_TO_BACK")==0) s_defaultBinSortMode = RenderBin::SORT_FRONT_TO_BACK;
             else if (strcmp(str,"SORT_BACK_TO_FRONT")==0) s_defaultBinSortMode = RenderBin::SORT_BACK_TO_FRONT;
             else if (strcmp(str,"TRAVERSAL_ORDER")==0) s_defaultBinSortMode = RenderBin::TRAVERSAL_ORDER;
+            else if (strcmp(str,"SORT_BY_PROGRAM_TEXTURE_THEN_FRONT_TO_BACK")==0) s_defaultBinSortMode = RenderBin::SORT_BY_PROGRAM_TEXTURE_THEN_FRONT_TO_BACK;
+            else if (strcmp(str,"SORT_BY_STATE_COST")==0) s_defaultBinSortMode = RenderBin::SORT_BY_STATE_COST;
         }
     }
 
@@ -149,6 +152,8 @@ RenderBin::RenderBin()
     _stage = NULL;
     _sorted = false;
     _sortMode = getDefaultRenderBinSortMode();
+    _numMergedStateGraphs = 0;
+    _numAvoidedStateChanges = 0;
 }
 
 RenderBin::RenderBin(SortMode mode)
@@ -158,6 +163,8 @@ RenderBin::RenderBin(SortMode mode)
     _stage = NULL;
     _sorted = false;
     _sortMode = mode;
+    _numMergedStateGraphs = 0;
+    _numAvoidedStateChanges = 0;
 
 #if 1
     if (_sortMode==SORT_BACK_TO_FRONT)
@@ -189,7 +196,9 @@ RenderBin::RenderBin(const RenderBin& rhs,const CopyOp& copyop):
         _sortMode(rhs._sortMode),
         _sortCallback(rhs._sortCallback),
         _drawCallback(rhs._drawCallback),
-        _stateset(rhs._stateset)
+        _stateset(rhs._stateset),
+        _numMergedStateGraphs(0),
+        _numAvoidedStateChanges(0)
 {
 
 }
@@ -202,8 +211,40 @@ void RenderBin::reset()
 {
     _stateGraphList.clear();
     _renderLeafList.clear();
+
+    // keep the child bins, along with the capacity of their lists, for reuse by find_or_insert() next frame.
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr!=_bins.end();
+        ++itr)
+    {
+        itr->second->reset();
+        _reuseBins[itr->first] = itr->second;
+    }
     _bins.clear();
+
     _sorted = false;
+    _numMergedStateGraphs = 0;
+    _numAvoidedStateChanges = 0;
+}
+
+RenderBin* RenderBin::reuseRenderBin(int binNum, const RenderBin& prototype)
+{
+    RenderBinList::iterator itr = _reuseBins.find(binNum);
+    if (itr==_reuseBins.end()) return 0;
+
+    RenderBin* rb = itr->second.get();
+    if (typeid(*rb)!=typeid(prototype) ||
+        rb->_sortMode!=prototype._sortMode ||
+        rb->_sortCallback!=prototype._sortCallback ||
+        rb->_drawCallback!=prototype._drawCallback ||
+        rb->_stateset!=prototype._stateset)
+    {
+        return 0;
+    }
+
+    _bins[binNum] = rb;
+    _reuseBins.erase(itr);
+    return rb;
 }
 
 void RenderBin::sort()
@@ -250,6 +291,12 @@ void RenderBin::sortImplementation()
         case(TRAVERSAL_ORDER):
             sortTraversalOrder();
             break;
+        case(SORT_BY_PROGRAM_TEXTURE_THEN_FRONT_TO_BACK):
+            sortByProgramTextureThenFrontToBack();
+            break;
+        case(SORT_BY_STATE_COST):
+            sortByStateCost();
+            break;
     }
 }
 
@@ -292,58 +339,493 @@ void RenderBin::sortByStateThenFrontToBack()
     std::sort(_stateGraphList.begin(),_stateGraphList.end(),StateGraphFrontToBackSortFunctor());
 }
 
-struct FrontToBackSortFunctor
+namespace
 {
-    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+
+// bins with fewer leaves than this are sorted with std::stable_sort, as the radix sort's fixed cost doesn't pay off.
+const unsigned int RADIX_SORT_THRESHOLD = 256;
+
+// map a float onto an unsigned integer with the same ordering, so that depths can be radix sorted.
+inline uint32_t orderedKey(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+// least significant byte first radix sort of keys, using buffer as scratch space.
+void radixSort(RenderBin::SortKeyList& keys, RenderBin::SortKeyList& buffer)
+{
+    const unsigned int numPasses = sizeof(uint64_t);
+    const size_t numKeys = keys.size();
+
+    // count the occurrences of each byte value for all passes in a single read of the keys.
+    unsigned int counts[numPasses][256];
+    memset(counts, 0, sizeof(counts));
+    for(size_t i=0; i<numKeys; ++i)
     {
-        return (lhs->_depth<rhs->_depth);
+        uint64_t key = keys[i].key;
+        for(unsigned int pass=0; pass<numPasses; ++pass)
+        {
+            ++counts[pass][(key >> (pass*8)) & 0xff];
+        }
     }
-};
 
+    buffer.resize(numKeys);
+    RenderBin::SortKey* source = &keys.front();
+    RenderBin::SortKey* destination = &buffer.front();
+
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        unsigned int shift = pass*8;
+        unsigned int* count = counts[pass];
+
+        // skip the passes where all the keys share the same byte, such as the unused high bytes of depth only keys.
+        if (count[(source[0].key >> shift) & 0xff]==numKeys) continue;
+
+        unsigned int offset = 0;
+        for(unsigned int b=0; b<256; ++b)
+        {
+            unsigned int n = count[b];
+            count[b] = offset;
+            offset += n;
+        }
+
+        for(size_t i=0; i<numKeys; ++i)
+        {
+            destination[count[(source[i].key >> shift) & 0xff]++] = source[i];
+        }
+
+        std::swap(source, destination);
+    }
+
+    if (source!=&keys.front()) keys.swap(buffer);
+}
+
+// find the Program and unit 0 texture applied to the leaves of a StateGraph, from the nearest StateSet that sets them.
+void getProgramAndTexture(const StateGraph* sg, const osg::StateAttribute*& program, const osg::StateAttribute*& texture)
+{
+    program = 0;
+    texture = 0;
+    for(; sg && (!program || !texture); sg = sg->_parent)
+    {
+        const osg::StateSet* stateset = sg->getStateSet();
+        if (!stateset) continue;
+
+        if (!program) program = stateset->getAttribute(osg::StateAttribute::PROGRAM);
+        if (!texture) texture = stateset->getTextureAttribute(0, osg::StateAttribute::TEXTURE);
+    }
+}
+
+typedef std::map<const osg::StateAttribute*, uint64_t> AttributeRankMap;
+
+// number the attributes in the order first encountered, saturating at the 16 bits available in the packed key.
+uint64_t getRank(AttributeRankMap& ranks, const osg::StateAttribute* attribute)
+{
+    if (!attribute) return 0;
+
+    AttributeRankMap::iterator itr = ranks.find(attribute);
+    if (itr!=ranks.end()) return itr->second;
+
+    uint64_t rank = osg::minimum(ranks.size()+1, size_t(0xffff));
+    ranks[attribute] = rank;
+    return rank;
+}
+
+}
+
+void RenderBin::sortRenderLeafListByKey()
+{
+    if (_sortKeys.size()<RADIX_SORT_THRESHOLD) std::stable_sort(_sortKeys.begin(), _sortKeys.end());
+    else radixSort(_sortKeys, _sortKeysBuffer);
+
+    _renderLeafList.clear();
+    _renderLeafList.reserve(_sortKeys.size());
+    for(SortKeyList::iterator itr = _sortKeys.begin();
+        itr != _sortKeys.end();
+        ++itr)
+    {
+        _renderLeafList.push_back(itr->leaf);
+    }
+
+    _sortKeys.clear();
+}
 
 void RenderBin::sortFrontToBack()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into acending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),FrontToBackSortFunctor());
+    _sortKeys.resize(_renderLeafList.size());
+    for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+    {
+        _sortKeys[i].key = orderedKey(_renderLeafList[i]->_depth);
+        _sortKeys[i].leaf = _renderLeafList[i];
+    }
+    sortRenderLeafListByKey();
+}
+
+void RenderBin::sortBackToFront()
+{
+    copyLeavesFromStateGraphListToRenderLeafList();
 
-//    cout << "sort front to back"<<endl;
+    // now sort the list into descending depth order.
+    _sortKeys.resize(_renderLeafList.size());
+    for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+    {
+        _sortKeys[i].key = ~orderedKey(_renderLeafList[i]->_depth);
+        _sortKeys[i].leaf = _renderLeafList[i];
+    }
+    sortRenderLeafListByKey();
 }
 
-struct BackToFrontSortFunctor
+void RenderBin::sortTraversalOrder()
 {
-    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+    copyLeavesFromStateGraphListToRenderLeafList();
+
+    // now sort the list into traversal order.
+    _sortKeys.resize(_renderLeafList.size());
+    for(unsigned int i=0; i<_renderLeafList.size(); ++i)
     {
-        return (rhs->_depth<lhs->_depth);
+        _sortKeys[i].key = _renderLeafList[i]->_traversalOrderNumber;
+        _sortKeys[i].leaf = _renderLeafList[i];
+    }
+    sortRenderLeafListByKey();
+}
+
+void RenderBin::sortByProgramTextureThenFrontToBack()
+{
+    // pack the Program rank, texture rank and depth of each leaf into a single key, with the ranks computed
+    // once per StateGraph, so that all three orderings are applied by a single sort.
+    AttributeRankMap programRanks;
+    AttributeRankMap textureRanks;
+
+    _sortKeys.clear();
+
+    bool detectedNaN = false;
+
+    for(StateGraphList::iterator itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr)
+    {
+        const osg::StateAttribute* program;
+        const osg::StateAttribute* texture;
+        getProgramAndTexture(*itr, program, texture);
+
+        uint64_t stateKey = (getRank(programRanks, program) << 48) | (getRank(textureRanks, texture) << 32);
+
+        for(StateGraph::LeafList::iterator dw_itr = (*itr)->_leaves.begin();
+            dw_itr != (*itr)->_leaves.end();
+            ++dw_itr)
+        {
+            if (!osg::isNaN((*dw_itr)->_depth))
+            {
+                SortKey sortKey;
+                sortKey.key = stateKey | orderedKey((*dw_itr)->_depth);
+                sortKey.leaf = dw_itr->get();
+                _sortKeys.push_back(sortKey);
+            }
+            else
+            {
+                detectedNaN = true;
+            }
+        }
     }
+
+    if (detectedNaN) OSG_NOTICE<<"Warning: RenderBin::sortByProgramTextureThenFrontToBack() detected NaN depth values, database may be corrupted."<<std::endl;
+
+    // empty the render graph list to prevent it being drawn along side the render leaf list (see drawImplementation.)
+    _stateGraphList.clear();
+
+    sortRenderLeafListByKey();
+}
+
+namespace
+{
+
+// the parts of the state of a StateGraph weighed by the cost model of sortByStateCost(), gathered from its path of StateSet's.
+struct StateCostFeatures
+{
+    StateCostFeatures(): program(0) {}
+
+    const osg::StateAttribute*                  program;
+    std::vector<const osg::StateAttribute*>     textures;
+    std::vector<const osg::UniformBase*>        uniforms;
 };
 
-void RenderBin::sortBackToFront()
+void getStateCostFeatures(const StateGraph* sg, StateCostFeatures& features)
 {
-    copyLeavesFromStateGraphListToRenderLeafList();
+    for(; sg; sg = sg->_parent)
+    {
+        const osg::StateSet* stateset = sg->getStateSet();
+        if (!stateset) continue;
 
-    // now sort the list into acending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),BackToFrontSortFunctor());
+        // the nearest StateSet to the leaves takes precedence, overrides are ignored as only the cost is estimated.
+        if (!features.program) features.program = stateset->getAttribute(osg::StateAttribute::PROGRAM);
+
+        unsigned int numUnits = stateset->getTextureAttributeList().size();
+        if (features.textures.size()<numUnits) features.textures.resize(numUnits, 0);
+        for(unsigned int unit=0; unit<numUnits; ++unit)
+        {
+            if (!features.textures[unit]) features.textures[unit] = stateset->getTextureAttribute(unit, osg::StateAttribute::TEXTURE);
+        }
 
-//    cout << "sort back to front"<<endl;
+        const osg::StateSet::UniformList& uniforms = stateset->getUniformList();
+        for(osg::StateSet::UniformList::const_iterator itr = uniforms.begin();
+            itr != uniforms.end();
+            ++itr)
+        {
+            features.uniforms.push_back(itr->second.first.get());
+        }
+    }
+
+    std::sort(features.uniforms.begin(), features.uniforms.end());
 }
 
+// count the Program, texture and uniform changes needed to move from the state of one StateGraph to another.
+unsigned int countStateChanges(const StateCostFeatures& lhs, const StateCostFeatures& rhs)
+{
+    unsigned int numChanges = (lhs.program!=rhs.program) ? 1 : 0;
 
-struct TraversalOrderFunctor
+    unsigned int numUnits = osg::maximum(lhs.textures.size(), rhs.textures.size());
+    for(unsigned int unit=0; unit<numUnits; ++unit)
+    {
+        const osg::StateAttribute* lhs_texture = unit<lhs.textures.size() ? lhs.textures[unit] : 0;
+        const osg::StateAttribute* rhs_texture = unit<rhs.textures.size() ? rhs.textures[unit] : 0;
+        if (lhs_texture!=rhs_texture) ++numChanges;
+    }
+
+    // uniforms in one list but not the other.
+    std::vector<const osg::UniformBase*>::const_iterator litr = lhs.uniforms.begin();
+    std::vector<const osg::UniformBase*>::const_iterator ritr = rhs.uniforms.begin();
+    while(litr!=lhs.uniforms.end() && ritr!=rhs.uniforms.end())
+    {
+        if (*litr<*ritr) { ++numChanges; ++litr; }
+        else if (*ritr<*litr) { ++numChanges; ++ritr; }
+        else { ++litr; ++ritr; }
+    }
+    numChanges += (lhs.uniforms.end()-litr) + (rhs.uniforms.end()-ritr);
+
+    return numChanges;
+}
+
+// hash of the structure of a StateSet, the modes, attribute types and uniform names it sets, with StateSet::compare()
+// used to resolve which StateSet's with the same hash are equivalent.
+unsigned int hashStateSet(const osg::StateSet* stateset)
+{
+    if (!stateset) return 0;
+
+    unsigned int hash = stateset->getRenderingHint()*31 + stateset->getBinNumber();
+
+    const osg::StateSet::ModeList& modes = stateset->getModeList();
+    for(osg::StateSet::ModeList::const_iterator itr = modes.begin(); itr != modes.end(); ++itr)
+    {
+        hash = hash*31 + itr->first;
+        hash = hash*31 + itr->second;
+    }
+
+    const osg::StateSet::AttributeList& attributes = stateset->getAttributeList();
+    for(osg::StateSet::AttributeList::const_iterator itr = attributes.begin(); itr != attributes.end(); ++itr)
+    {
+        hash = hash*31 + itr->first.first;
+        hash = hash*31 + itr->first.second;
+        hash = hash*31 + itr->second.second;
+    }
+
+    const osg::StateSet::TextureModeList& textureModes = stateset->getTextureModeList();
+    for(unsigned int unit=0; unit<textureModes.size(); ++unit)
+    {
+        for(osg::StateSet::ModeList::const_iterator itr = textureModes[unit].begin(); itr != textureModes[unit].end(); ++itr)
+        {
+            hash = hash*31 + unit;
+            hash = hash*31 + itr->first;
+            hash = hash*31 + itr->second;
+        }
+    }
+
+    const osg::StateSet::TextureAttributeList& textureAttributes = stateset->getTextureAttributeList();
+    for(unsigned int unit=0; unit<textureAttributes.size(); ++unit)
+    {
+        for(osg::StateSet::AttributeList::const_iterator itr = textureAttributes[unit].begin(); itr != textureAttributes[unit].end(); ++itr)
+        {
+            hash = hash*31 + unit;
+            hash = hash*31 + itr->first.first;
+            hash = hash*31 + itr->second.second;
+        }
+    }
+
+    const osg::StateSet::UniformList& uniforms = stateset->getUniformList();
+    for(osg::StateSet::UniformList::const_iterator itr = uniforms.begin(); itr != uniforms.end(); ++itr)
+    {
+        hash = hash*31 + itr->first.size();
+        hash = hash*31 + itr->second.second;
+    }
+
+    return hash;
+}
+
+// maps each StateGraph onto the first StateGraph found whose path of StateSet's is equivalent in content.
+class StateGraphCanonicalizer
 {
-    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+public:
+
+    StateGraph* canonical(StateGraph* sg)
     {
-        return (lhs->_traversalOrderNumber<rhs->_traversalOrderNumber);
+        CanonicalMap::iterator itr = _canonicalMap.find(sg);
+        if (itr!=_canonicalMap.end()) return itr->second;
+
+        StateGraph* result = sg;
+        if (sg->_parent)
+        {
+            // StateGraph's are equivalent if their parents are equivalent and their StateSet's are equal in content.
+            Key key(canonical(sg->_parent), hashStateSet(sg->getStateSet()));
+            Candidates& candidates = _buckets[key];
+
+            // bound the number of comparisons for StateSet's that differ only in attribute contents.
+            const unsigned int maxNumComparisons = 8;
+            unsigned int numComparisons = 0;
+            for(Candidates::iterator citr = candidates.begin();
+                citr != candidates.end() && numComparisons<maxNumComparisons;
+                ++citr, ++numComparisons)
+            {
+                const osg::StateSet* lhs = (*citr)->getStateSet();
+                const osg::StateSet* rhs = sg->getStateSet();
+                if (lhs==rhs || (lhs && rhs && lhs->compare(*rhs, true)==0))
+                {
+                    result = *citr;
+                    break;
+                }
+            }
+
+            if (result==sg) candidates.push_back(sg);
+        }
+
+        _canonicalMap[sg] = result;
+        return result;
     }
+
+protected:
+
+    typedef std::map<StateGraph*, StateGraph*> CanonicalMap;
+    typedef std::pair<StateGraph*, unsigned int> Key;
+    typedef std::vector<StateGraph*> Candidates;
+
+    CanonicalMap                    _canonicalMap;
+    std::map<Key, Candidates>       _buckets;
 };
 
-void RenderBin::sortTraversalOrder()
+struct StateCostSortKey
 {
-    copyLeavesFromStateGraphListToRenderLeafList();
+    unsigned int programRank;
+    unsigned int textureRank;
+    unsigned int uniformRank;
+    unsigned int index;
 
-    // now sort the list into acending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
+    bool operator < (const StateCostSortKey& rhs) const
+    {
+        if (programRank<rhs.programRank) return true;
+        if (rhs.programRank<programRank) return false;
+        if (textureRank<rhs.textureRank) return true;
+        if (rhs.textureRank<textureRank) return false;
+        return uniformRank<rhs.uniformRank;
+    }
+};
+
+// number the values in the order first encountered.
+template<typename T>
+unsigned int getFirstEncounteredRank(std::map<T, unsigned int>& ranks, const T& value)
+{
+    typename std::map<T, unsigned int>::iterator itr = ranks.find(value);
+    if (itr!=ranks.end()) return itr->second;
+
+    unsigned int rank = ranks.size();
+    ranks[value] = rank;
+    return rank;
+}
+
+}
+
+void RenderBin::sortByStateCost()
+{
+    _numMergedStateGraphs = 0;
+    _numAvoidedStateChanges = 0;
+
+    if (_stateGraphList.size()<2) return;
+
+    // the state of each StateGraph, gathered once.
+    std::vector<StateCostFeatures> features(_stateGraphList.size());
+    for(unsigned int i=0; i<_stateGraphList.size(); ++i)
+    {
+        getStateCostFeatures(_stateGraphList[i], features[i]);
+    }
+
+    unsigned int numChangesBefore = 0;
+    for(unsigned int i=1; i<_stateGraphList.size(); ++i)
+    {
+        numChangesBefore += countStateChanges(features[i-1], features[i]);
+    }
+
+    // move the leaves of StateGraph's into the first StateGraph of this bin that is equivalent to them,
+    // the emptied StateGraph's are pruned after the cull.
+    StateGraphCanonicalizer canonicalizer;
+    std::map<StateGraph*, unsigned int> representatives;
+    std::vector<unsigned int> indices;
+    for(unsigned int i=0; i<_stateGraphList.size(); ++i)
+    {
+        StateGraph* sg = _stateGraphList[i];
+        StateGraph* canonical = canonicalizer.canonical(sg);
+
+        std::map<StateGraph*, unsigned int>::iterator itr = representatives.find(canonical);
+        if (itr==representatives.end())
+        {
+            representatives[canonical] = i;
+            indices.push_back(i);
+            continue;
+        }
+
+        StateGraph* representative = _stateGraphList[itr->second];
+        for(StateGraph::LeafList::iterator litr = sg->_leaves.begin();
+            litr != sg->_leaves.end();
+            ++litr)
+        {
+            representative->addLeaf(litr->get());
+        }
+        sg->_leaves.clear();
+        ++_numMergedStateGraphs;
+    }
+
+    // order by Program, then by textures, then by uniforms, ranking each in the order first encountered so that
+    // StateGraph's with the same state keep their relative order.
+    std::map<const osg::StateAttribute*, unsigned int> programRanks;
+    std::map< std::vector<const osg::StateAttribute*>, unsigned int > textureRanks;
+    std::map< std::vector<const osg::UniformBase*>, unsigned int > uniformRanks;
+
+    std::vector<StateCostSortKey> keys(indices.size());
+    for(unsigned int i=0; i<indices.size(); ++i)
+    {
+        const StateCostFeatures& f = features[indices[i]];
+        keys[i].programRank = getFirstEncounteredRank(programRanks, f.program);
+        keys[i].textureRank = getFirstEncounteredRank(textureRanks, f.textures);
+        keys[i].uniformRank = getFirstEncounteredRank(uniformRanks, f.uniforms);
+        keys[i].index = indices[i];
+    }
+    std::stable_sort(keys.begin(), keys.end());
+
+    unsigned int numChangesAfter = 0;
+    for(unsigned int i=1; i<keys.size(); ++i)
+    {
+        numChangesAfter += countStateChanges(features[keys[i-1].index], features[keys[i].index]);
+    }
+
+    StateGraphList sortedStateGraphList;
+    sortedStateGraphList.reserve(keys.size());
+    for(unsigned int i=0; i<keys.size(); ++i)
+    {
+        sortedStateGraphList.push_back(_stateGraphList[keys[i].index]);
+    }
+    _stateGraphList.swap(sortedStateGraphList);
+
+    _numAvoidedStateChanges = numChangesBefore>numChangesAfter ? numChangesBefore-numChangesAfter : 0;
 }
 
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
@@ -395,6 +877,14 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     RenderBinList::iterator itr = _bins.find(binNum);
     if (itr!=_bins.end()) return itr->second.get();
 
+    // reuse the bin from the previous frame if it is still of the kind requested.
+    RenderBin* prototype = getRenderBinPrototype(binName);
+    if (prototype && !dynamic_cast<RenderStage*>(prototype))
+    {
+        RenderBin* rb = reuseRenderBin(binNum, *prototype);
+        if (rb) return rb;
+    }
+
     // create a rendering bin and insert into bin list.
     RenderBin* rb = RenderBin::createRenderBin(binName);
     if (rb)
@@ -419,6 +909,25 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     return rb;
 }
 
+RenderBin* RenderBin::find_or_insert(const RenderBin& bin)
+{
+    RenderBinList::iterator itr = _bins.find(bin._binNum);
+    if (itr!=_bins.end()) return itr->second.get();
+
+    RenderBin* reused = reuseRenderBin(bin._binNum, bin);
+    if (reused) return reused;
+
+    // shallow clone the bin so that the sort mode, callbacks and StateSet are retained, then clear its contents.
+    RenderBin* rb = dynamic_cast<RenderBin*>(bin.clone(osg::CopyOp::SHALLOW_COPY));
+    if (!rb) rb = new RenderBin(bin._sortMode);
+    rb->reset();
+    rb->_binNum = bin._binNum;
+    rb->_parent = this;
+    rb->_stage = _stage;
+    _bins[bin._binNum] = rb;
+    return rb;
+}
+
 void RenderBin::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     renderInfo.pushRenderBin(this);
@@ -479,15 +988,7 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
             ++oitr)
         {
 
-            for(StateGraph::LeafList::iterator dw_itr = (*oitr)->_leaves.begin();
-                dw_itr != (*oitr)->_leaves.end();
-                ++dw_itr)
-            {
-                RenderLeaf* rl = dw_itr->get();
-                rl->render(renderInfo,previous);
-                previous = rl;
-
-            }
+            drawLeaves(renderInfo, (*oitr)->_leaves, previous);
         }
     }
     else
@@ -497,15 +998,7 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
             ++oitr)
         {
 
-            for(StateGraph::LeafList::iterator dw_itr = (*oitr)->_leaves.begin();
-                dw_itr != (*oitr)->_leaves.end();
-                ++dw_itr)
-            {
-                RenderLeaf* rl = dw_itr->get();
-                rl->render(renderInfo,previous);
-                previous = rl;
-
-            }
+            drawLeaves(renderInfo, (*oitr)->_leaves, previous);
         }
     }
 
@@ -527,6 +1020,63 @@ void RenderBin::drawImplementation(osg::RenderInfo& renderInfo,RenderLeaf*& prev
     // OSG_NOTICE<<"end RenderBin::drawImplementation "<<className()<<std::endl;
 }
 
+void RenderBin::drawLeaves(osg::RenderInfo& renderInfo, StateGraph::LeafList& leaves, RenderLeaf*& previous)
+{
+    osg::State& state = *renderInfo.getState();
+
+    StateGraph::LeafList::iterator dw_itr = leaves.begin();
+    while(dw_itr != leaves.end())
+    {
+        RenderLeaf* rl = dw_itr->get();
+        const DrawIndirectBatch::Member* member = DrawIndirectBatch::getMember(rl->_drawable.get());
+        if (!member)
+        {
+            rl->render(renderInfo,previous);
+            previous = rl;
+            ++dw_itr;
+            continue;
+        }
+
+        // gather the following leaves of the same batch drawn with the same matrices.
+        DrawIndirectBatch* batch = member->getBatch();
+        _batchMembers.clear();
+        _batchMembers.push_back(member);
+
+        StateGraph::LeafList::iterator end_itr = dw_itr;
+        for(++end_itr; end_itr != leaves.end(); ++end_itr)
+        {
+            RenderLeaf* next = end_itr->get();
+            const DrawIndirectBatch::Member* nextMember = DrawIndirectBatch::getMember(next->_drawable.get());
+            if (!nextMember || nextMember->getBatch()!=batch ||
+                next->_projection!=rl->_projection || next->_modelview!=rl->_modelview) break;
+
+            _batchMembers.push_back(nextMember);
+        }
+
+        if (_batchMembers.size()>1 && !state.getAbortRendering() && DrawIndirectBatch::isSupported(state))
+        {
+            rl->applyState(renderInfo,previous);
+
+            if (!state.getRecordingMode()) batch->draw(renderInfo, _batchMembers);
+
+            for(; dw_itr != end_itr; ++dw_itr)
+            {
+                previous = dw_itr->get();
+                if (previous->_dynamic) state.decrementDynamicObjectCount();
+            }
+        }
+        else
+        {
+            for(; dw_itr != end_itr; ++dw_itr)
+            {
+                RenderLeaf* batchedLeaf = dw_itr->get();
+                batchedLeaf->render(renderInfo,previous);
+                previous = batchedLeaf;
+            }
+        }
+    }
+}
+
 // stats
 bool RenderBin::getStats(Statistics& stats) const
 {
@@ -561,6 +1111,8 @@ bool RenderBin::getStats(Statistics& stats) const
         statsCollected = true;
     }
     stats.addStateGraphs(_stateGraphList.size());
+    stats.addMergedStateGraphs(_numMergedStateGraphs);
+    stats.addAvoidedStateChanges(_numAvoidedStateChanges);
     for(StateGraphList::const_iterator oitr=_stateGraphList.begin();
         oitr!=_stateGraphList.end();
         ++oitr)
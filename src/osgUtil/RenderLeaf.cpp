@@ -28,6 +28,23 @@ void RenderLeaf::render(osg::RenderInfo& renderInfo,RenderLeaf* previous)
         return;
     }
 
+    applyState(renderInfo, previous);
+
+    // draw the drawable, unless only the state changes are being recorded.
+    if (!state.getRecordingMode()) _drawable->draw(renderInfo);
+
+    if (_dynamic)
+    {
+        state.decrementDynamicObjectCount();
+    }
+
+    // OSG_NOTICE<<"RenderLeaf "<<_drawable->getName()<<" "<<_depth<<std::endl;
+}
+
+void RenderLeaf::applyState(osg::RenderInfo& renderInfo,RenderLeaf* previous)
+{
+    osg::State& state = *renderInfo.getState();
+
     if (previous)
     {
 
@@ -54,14 +71,6 @@ void RenderLeaf::render(osg::RenderInfo& renderInfo,RenderLeaf* previous)
             state.apply(rg->getStateSet());
 
         }
-
-        // if we are using osg::Program which requires OSG's generated uniforms to track
-        // modelview and projection matrices then apply them now.
-        if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
-
-
-        // draw the drawable
-        _drawable->draw(renderInfo);
     }
     else
     {
@@ -73,19 +82,9 @@ void RenderLeaf::render(osg::RenderInfo& renderInfo,RenderLeaf* previous)
         StateGraph::moveStateGraph(state,NULL,_parent->_parent);
 
         state.apply(_parent->getStateSet());
-
-        // if we are using osg::Program which requires OSG's generated uniforms to track
-        // modelview and projection matrices then apply them now.
-        if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
-
-        // draw the drawable
-        _drawable->draw(renderInfo);
     }
 
-    if (_dynamic)
-    {
-        state.decrementDynamicObjectCount();
-    }
-
-    // OSG_NOTICE<<"RenderLeaf "<<_drawable->getName()<<" "<<_depth<<std::endl;
+    // if we are using osg::Program which requires OSG's generated uniforms to track
+    // modelview and projection matrices then apply them now.
+    if (state.getUseModelViewAndProjectionUniforms()) state.applyModelViewAndProjectionUniformsIfRequired();
 }
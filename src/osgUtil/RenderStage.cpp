@@ -210,6 +210,34 @@ void RenderStage::addPostRenderStage(RenderStage* rs, int order)
     }
 }
 
+void RenderStage::movePreAndPostRenderStages(RenderStage& rs)
+{
+    for(RenderStageList::iterator pre_itr = rs._preRenderList.begin();
+        pre_itr != rs._preRenderList.end();
+        ++pre_itr)
+    {
+        if (rs._renderStageLighting.valid() && pre_itr->second->getInheritedPositionalStateContainer()==rs._renderStageLighting.get())
+        {
+            pre_itr->second->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        }
+        addPreRenderStage(pre_itr->second.get(), pre_itr->first);
+    }
+
+    for(RenderStageList::iterator post_itr = rs._postRenderList.begin();
+        post_itr != rs._postRenderList.end();
+        ++post_itr)
+    {
+        if (rs._renderStageLighting.valid() && post_itr->second->getInheritedPositionalStateContainer()==rs._renderStageLighting.get())
+        {
+            post_itr->second->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        }
+        addPostRenderStage(post_itr->second.get(), post_itr->first);
+    }
+
+    rs._preRenderList.clear();
+    rs._postRenderList.clear();
+}
+
 void RenderStage::drawPreRenderStages(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     if (_preRenderList.empty()) return;
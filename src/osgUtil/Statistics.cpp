@@ -46,6 +46,8 @@ void Statistics::reset()
     nimpostor=0;
     numStateGraphs=0;
     numOrderedLeaves=0;
+    numMergedStateGraphs=0;
+    numAvoidedStateChanges=0;
 
     _binNo = 0;
 
@@ -119,6 +121,8 @@ void Statistics::add(const Statistics& stats)
     nimpostor += stats.nimpostor;
     numStateGraphs += stats.numStateGraphs;
     numOrderedLeaves += stats.numOrderedLeaves;
+    numMergedStateGraphs += stats.numMergedStateGraphs;
+    numAvoidedStateChanges += stats.numAvoidedStateChanges;
 
     _vertexCount += stats._vertexCount;
     for(PrimitiveValueMap::const_iterator pitr = stats._primitiveCount.begin();
@@ -23,6 +23,8 @@
 
 #include <osg/io_utils>
 
+#include <set>
+
 using namespace osgViewer;
 
 CompositeViewer::CompositeViewer()
@@ -1349,6 +1351,45 @@ void CompositeViewer::eventTraversal()
     }
 }
 
+void CompositeViewer::reportDatabasePagerStats(unsigned int frameNumber)
+{
+    typedef std::set<osgDB::DatabasePager*> DatabasePagers;
+    DatabasePagers databasePagers;
+
+    for(RefViews::iterator vitr = _views.begin();
+        vitr != _views.end();
+        ++vitr)
+    {
+        View* view = vitr->get();
+        osgDB::DatabasePager* databasePager = view->getDatabasePager();
+        if (!databasePager) continue;
+
+        osg::Stats* cameraStats = view->getCamera()->getStats();
+        if (cameraStats) databasePager->reportStats(frameNumber, *cameraStats);
+
+        databasePagers.insert(databasePager);
+    }
+
+    // views can share a scene and with it the scene's DatabasePager, so only sum each pager once.
+    for(DatabasePagers::iterator pitr = databasePagers.begin();
+        pitr != databasePagers.end();
+        ++pitr)
+    {
+        osg::ref_ptr<osg::Stats> pagerStats = new osg::Stats("DatabasePager", 1);
+        (*pitr)->reportStats(frameNumber, *pagerStats);
+
+        const osg::Stats::AttributeMap& attributes = pagerStats->getAttributeMap(frameNumber);
+        for(osg::Stats::AttributeMap::const_iterator aitr = attributes.begin();
+            aitr != attributes.end();
+            ++aitr)
+        {
+            double total = 0.0;
+            getViewerStats()->getAttribute(frameNumber, aitr->first, total);
+            getViewerStats()->setAttribute(frameNumber, aitr->first, total + aitr->second);
+        }
+    }
+}
+
 void CompositeViewer::updateTraversal()
 {
     if (_done) return;
@@ -1448,6 +1489,9 @@ void CompositeViewer::updateTraversal()
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
+
+        reportDatabasePagerStats(_frameStamp->getFrameNumber());
+        if (osgDB::Registry::instance()->getObjectCache()) osgDB::Registry::instance()->getObjectCache()->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
     }
 
 }
@@ -14,6 +14,8 @@
 #include <stdio.h>
 
 #include <osg/GLExtensions>
+#include <osg/BufferObject>
+#include <osg/ContextData>
 #include <OpenThreads/ReentrantMutex>
 
 #include <osgUtil/Optimizer>
@@ -608,6 +610,15 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     stats->setAttribute(frameNumber, "Number of StateGraphs", static_cast<double>(sceneStats.numStateGraphs));
     stats->setAttribute(frameNumber, "Visible number of impostors", static_cast<double>(sceneStats.nimpostor));
     stats->setAttribute(frameNumber, "Number of ordered leaves", static_cast<double>(sceneStats.numOrderedLeaves));
+    stats->setAttribute(frameNumber, "Number of merged StateGraphs", static_cast<double>(sceneStats.numMergedStateGraphs));
+    stats->setAttribute(frameNumber, "Number of avoided state changes", static_cast<double>(sceneStats.numAvoidedStateChanges));
+
+    osgUtil::CullVisitor::PoolStatistics poolStats;
+    if (sceneView->getCullVisitor()) sceneView->getCullVisitor()->getPoolStatistics(poolStats);
+    if (sceneView->getCullVisitorLeft()) sceneView->getCullVisitorLeft()->getPoolStatistics(poolStats);
+    if (sceneView->getCullVisitorRight()) sceneView->getCullVisitorRight()->getPoolStatistics(poolStats);
+    stats->setAttribute(frameNumber, "Cull number of pooled objects", static_cast<double>(poolStats.getNumObjects()));
+    stats->setAttribute(frameNumber, "Cull number of allocations", static_cast<double>(poolStats.getNumAllocated()));
 
     unsigned int totalNumPrimitiveSets = 0;
     const osgUtil::Statistics::PrimitiveValueMap& pvm = sceneStats.getPrimitiveValueMap();
@@ -796,6 +807,11 @@ void Renderer::draw()
             stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
         }
 
+        if (stats && stats->collectStats("scene"))
+        {
+            stats->setAttribute(frameNumber, "Draw number of bytes streamed", osg::get<osg::GLBufferObjectManager>(state->getContextID())->getNumberBytesStreamed());
+        }
+
         sceneView->clearReferencesToDependentCameras();
     }
 
@@ -905,6 +921,11 @@ void Renderer::cull_draw()
         stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
     }
 
+    if (stats && stats->collectStats("scene"))
+    {
+        stats->setAttribute(frameNumber, "Draw number of bytes streamed", osg::get<osg::GLBufferObjectManager>(state->getContextID())->getNumberBytesStreamed());
+    }
+
     DEBUG_MESSAGE<<"end cull_draw() "<<this<<std::endl;
 
 }
@@ -1221,6 +1221,9 @@ void Viewer::updateTraversal()
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
+
+        if (_scene.valid() && _scene->getDatabasePager()) _scene->getDatabasePager()->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
+        if (osgDB::Registry::instance()->getObjectCache()) osgDB::Registry::instance()->getObjectCache()->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
     }
 }
 
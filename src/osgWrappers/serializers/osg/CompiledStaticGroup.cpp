@@ -0,0 +1,12 @@
+#include <osg/CompiledStaticGroup>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+REGISTER_OBJECT_WRAPPER( CompiledStaticGroup,
+                         new osg::CompiledStaticGroup,
+                         osg::CompiledStaticGroup,
+                         "osg::Object osg::Node osg::Group osg::CompiledStaticGroup" )
+{
+    // the compiled arrays are rebuilt from the children on first use.
+}
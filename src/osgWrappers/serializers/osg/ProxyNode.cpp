@@ -113,7 +113,15 @@ struct ProxyNodeFinishedObjectReadCallback : public osgDB::FinishedObjectReadCal
         {
             for(unsigned int i=0; i<proxyNode.getNumFileNames(); i++)
             {
-                if(i >= proxyNode.getNumChildren() && !proxyNode.getFileName(i).empty())
+                if(i >= proxyNode.getNumChildren() && !proxyNode.getFileName(i).empty() && is.getExternalFileLoader())
+                {
+                    // queue the read to run in parallel, using a copy of the options as the database path differs per child.
+                    osg::ref_ptr<osgDB::Options> options = is.getOptions()->cloneOptions();
+                    osgDB::FilePathList& fpl = options->getDatabasePathList();
+                    fpl.push_front( fpl.empty() ? osgDB::getFilePath(proxyNode.getFileName(i)) : fpl.front()+'/'+ osgDB::getFilePath(proxyNode.getFileName(i)));
+                    is.getExternalFileLoader()->addNode(proxyNode.getFileName(i), options.get(), &proxyNode, i);
+                }
+                else if(i >= proxyNode.getNumChildren() && !proxyNode.getFileName(i).empty())
                 {
                     osgDB::FilePathList& fpl = ((osgDB::ReaderWriter::Options*)is.getOptions())->getDatabasePathList();
                     fpl.push_front( fpl.empty() ? osgDB::getFilePath(proxyNode.getFileName(i)) : fpl.front()+'/'+ osgDB::getFilePath(proxyNode.getFileName(i)));
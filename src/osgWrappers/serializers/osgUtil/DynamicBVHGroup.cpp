@@ -0,0 +1,13 @@
+#include <osgUtil/DynamicBVHGroup>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+REGISTER_OBJECT_WRAPPER( osgUtil_DynamicBVHGroup,
+                         new osgUtil::DynamicBVHGroup,
+                         osgUtil::DynamicBVHGroup,
+                         "osg::Object osg::Node osg::Group osgUtil::DynamicBVHGroup" )
+{
+    // the hierarchy is rebuilt from the children as they are added.
+    ADD_FLOAT_SERIALIZER( Margin, 0.1f );  // _margin
+}
@@ -0,0 +1,57 @@
+#include <osgUtil/MeshletGeometry>
+#include <osgDB/ObjectWrapper>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+// the meshlets are ranges of the Geometry's single DrawElementsUInt, which is written with the PrimitiveSetList.
+static bool checkMeshlets( const osgUtil::MeshletGeometry& geom )
+{
+    return geom.getMeshlets().size()>0;
+}
+
+static bool readMeshlets( osgDB::InputStream& is, osgUtil::MeshletGeometry& geom )
+{
+    osgUtil::MeshletGeometry::MeshletList meshlets;
+    unsigned int size = is.readSize();
+    is >> is.BEGIN_BRACKET;
+    for ( unsigned int i=0; i<size; ++i )
+    {
+        osgUtil::MeshletGeometry::Meshlet meshlet;
+        is >> meshlet.firstIndex >> meshlet.numIndices;
+        is >> meshlet.center >> meshlet.radius;
+        is >> meshlet.coneAxis >> meshlet.coneCutoff;
+        meshlets.push_back( meshlet );
+    }
+    is >> is.END_BRACKET;
+
+    osg::DrawElementsUInt* elements = geom.getNumPrimitiveSets()==1 ?
+        dynamic_cast<osg::DrawElementsUInt*>(geom.getPrimitiveSet(0)) : 0;
+    if ( elements ) geom.setMeshlets( elements, meshlets );
+    else OSG_WARN << "MeshletGeometry: meshlets read without a DrawElementsUInt, ignoring them." << std::endl;
+    return true;
+}
+
+static bool writeMeshlets( osgDB::OutputStream& os, const osgUtil::MeshletGeometry& geom )
+{
+    const osgUtil::MeshletGeometry::MeshletList& meshlets = geom.getMeshlets();
+    os.writeSize(meshlets.size());
+    os << os.BEGIN_BRACKET << std::endl;
+    for ( osgUtil::MeshletGeometry::MeshletList::const_iterator itr=meshlets.begin();
+          itr!=meshlets.end(); ++itr )
+    {
+        os << itr->firstIndex << itr->numIndices;
+        os << itr->center << itr->radius;
+        os << itr->coneAxis << itr->coneCutoff << std::endl;
+    }
+    os << os.END_BRACKET << std::endl;
+    return true;
+}
+
+REGISTER_OBJECT_WRAPPER( osgUtil_MeshletGeometry,
+                         new osgUtil::MeshletGeometry,
+                         osgUtil::MeshletGeometry,
+                         "osg::Object osg::Node osg::Drawable osg::Geometry osgUtil::MeshletGeometry" )
+{
+    ADD_BOOL_SERIALIZER( MeshletCulling, true );  // _meshletCulling
+    ADD_USER_SERIALIZER( Meshlets );  // _meshlets
+}